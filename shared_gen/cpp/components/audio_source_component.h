@@ -8,6 +8,7 @@ class AudioSourceComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 7 };
 	static const constexpr char* componentName{ "AudioSource" };
+	static constexpr Halley::StringId componentId{ "AudioSource" };
 
 	Halley::ResourceReference<Halley::AudioEvent> event{};
 	float rangeMin{ 50 };
@@ -8,6 +8,7 @@ class CameraComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 4 };
 	static const constexpr char* componentName{ "Camera" };
+	static constexpr Halley::StringId componentId{ "Camera" };
 
 	float zoom{ 1 };
 	Halley::String id{};
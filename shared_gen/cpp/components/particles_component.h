@@ -8,6 +8,7 @@ class ParticlesComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 5 };
 	static const constexpr char* componentName{ "Particles" };
+	static constexpr Halley::StringId componentId{ "Particles" };
 
 	Halley::Particles particles{};
 	std::vector<Halley::Sprite> sprites{};
@@ -8,6 +8,7 @@ class ScriptComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 8 };
 	static const constexpr char* componentName{ "Script" };
+	static constexpr Halley::StringId componentId{ "Script" };
 
 	Halley::ScriptGraph scriptGraph{};
 	Halley::ScriptState scriptState{};
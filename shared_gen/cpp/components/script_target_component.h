@@ -8,6 +8,7 @@ class ScriptTargetComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 9 };
 	static const constexpr char* componentName{ "ScriptTarget" };
+	static constexpr Halley::StringId componentId{ "ScriptTarget" };
 
 
 	ScriptTargetComponent() {
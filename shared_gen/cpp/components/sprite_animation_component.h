@@ -8,6 +8,7 @@ class SpriteAnimationComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 3 };
 	static const constexpr char* componentName{ "SpriteAnimation" };
+	static constexpr Halley::StringId componentId{ "SpriteAnimation" };
 
 	Halley::AnimationPlayer player{};
 
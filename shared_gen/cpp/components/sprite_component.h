@@ -8,6 +8,7 @@ class SpriteComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 1 };
 	static const constexpr char* componentName{ "Sprite" };
+	static constexpr Halley::StringId componentId{ "Sprite" };
 
 	Halley::Sprite sprite{};
 	int layer{ 0 };
@@ -8,6 +8,7 @@ class TextLabelComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 2 };
 	static const constexpr char* componentName{ "TextLabel" };
+	static constexpr Halley::StringId componentId{ "TextLabel" };
 
 	Halley::TextRenderer text{};
 	int layer{ 0 };
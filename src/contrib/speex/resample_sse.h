@@ -0,0 +1,34 @@
+/* SSE versions of the single precision inner products used by resample.c.
+   Each lane accumulates the same terms, in the same order, as the corresponding accumulator in the generic code,
+   and the lanes are summed in the same order too, so the output is bit-identical to the non-SSE build. */
+
+#include <xmmintrin.h>
+
+#define OVERRIDE_INNER_PRODUCT_SINGLE
+static inline float inner_product_single(const float *a, const float *b, unsigned int len)
+{
+   unsigned int i;
+   float accum[4];
+   __m128 sum = _mm_setzero_ps();
+   for (i=0;i<len;i+=4)
+   {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i)));
+   }
+   _mm_storeu_ps(accum, sum);
+   return accum[0] + accum[1] + accum[2] + accum[3];
+}
+
+#define OVERRIDE_INTERPOLATE_PRODUCT_SINGLE
+static inline float interpolate_product_single(const float *a, const float *b, unsigned int len, const spx_uint32_t oversample, float *frac)
+{
+   unsigned int i;
+   float accum[4];
+   __m128 sum = _mm_setzero_ps();
+   for (i=0;i<len;i++)
+   {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load1_ps(a+i), _mm_loadu_ps(b+i*oversample)));
+   }
+   sum = _mm_mul_ps(_mm_loadu_ps(frac), sum);
+   _mm_storeu_ps(accum, sum);
+   return accum[0] + accum[1] + accum[2] + accum[3];
+}
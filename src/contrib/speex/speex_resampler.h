@@ -39,6 +39,9 @@
 #define OUTSIDE_SPEEX
 #define RANDOM_PREFIX HALLEY
 #define FLOATING_POINT
+#if defined(_M_X64) || defined(__x86_64__)
+#define _USE_SSE
+#endif
 
 #ifndef SPEEX_RESAMPLER_H
 #define SPEEX_RESAMPLER_H
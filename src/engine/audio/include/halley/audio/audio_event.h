@@ -2,6 +2,7 @@
 #include "halley/resources/resource.h"
 #include "halley/maths/range.h"
 #include "halley/data_structures/maybe.h"
+#include "halley/text/string_id.h"
 #include "audio_clip.h"
 #include "audio_dynamics_config.h"
 
@@ -81,6 +82,7 @@ namespace Halley
 		std::vector<String> clips;
 		std::vector<std::shared_ptr<const AudioClip>> clipData;
 		String group;
+		StringId groupId;
 		Range<float> pitch;
 		Range<float> volume;
 		float delay = 0.0f;
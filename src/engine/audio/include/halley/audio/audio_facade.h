@@ -12,6 +12,7 @@ namespace Halley {
 	class AudioEngine;
 	class AudioHandleImpl;
 	class IAudioClip;
+	struct AudioCommand;
 
     class AudioFacade final : public AudioAPIInternal
     {
@@ -70,12 +71,12 @@ namespace Halley {
 	    AudioSpec audioSpec;
 		int lastDeviceNumber = 0;
 
-		RingBuffer<std::function<void()>> commandQueue;
-		std::vector<std::function<void()>> inbox;
+		RingBuffer<AudioCommand> commandQueue;
     	
 		RingBuffer<String> exceptions;
 		std::vector<uint32_t> playingSounds;
-		RingBuffer<std::vector<uint32_t>> finishedSoundsQueue;
+		std::vector<uint32_t> finishedSounds;
+		RingBuffer<uint32_t> finishedSoundsQueue;
 
 		std::map<int, AudioHandle> musicTracks;
 
@@ -85,7 +86,8 @@ namespace Halley {
 		void doStartPlayback(int deviceNumber, bool createEngine);
 	    void run();
 	    void stepAudio();
-	    void enqueue(std::function<void()> action);
+	    void enqueue(AudioCommand command);
+		void runCommand(AudioCommand& command);
 		
 		void stopMusic(AudioHandle& handle, float fade);
 
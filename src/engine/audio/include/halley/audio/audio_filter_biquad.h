@@ -6,6 +6,7 @@ namespace Halley {
     class AudioFilterBiquad final : public AudioSource {
     public:
 		AudioFilterBiquad(std::shared_ptr<AudioSource> src);
+		// Feed-forward coefficients a0..a2 and feedback coefficients b1..b2, normalised so that the output coefficient is 1
 		void setParameters(float a0, float a1, float a2, float b1, float b2);
     	
 	    uint8_t getNumberOfChannels() const override;
@@ -13,6 +14,19 @@ namespace Halley {
 	    bool getAudioData(size_t numSamples, AudioSourceData& dst) override;
 
     private:
+		struct State {
+			float z1 = 0;
+			float z2 = 0;
+		};
+
 		std::shared_ptr<AudioSource> src;
+		float a0 = 1;
+		float a1 = 0;
+		float a2 = 0;
+		float b1 = 0;
+		float b2 = 0;
+		std::array<State, AudioConfig::maxChannels> state;
+
+		void process(gsl::span<AudioConfig::SampleFormat> samples, State& channelState) const;
     };
 }
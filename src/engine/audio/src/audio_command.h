@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "halley/core/api/audio_api.h"
+#include "audio_position.h"
+#include "behaviours/audio_voice_behaviour.h"
+
+namespace Halley {
+	class AudioEvent;
+	class IAudioClip;
+
+	enum class AudioCommandType : uint8_t {
+		PostEvent,
+		Play,
+		SetMasterGain,
+		SetGroupGain,
+		SetOutputChannels,
+		SetListener,
+		SetVariable,
+		SetVoiceGain,
+		SetVoicePosition,
+		SetVoiceAudioPosition,
+		StopVoice,
+		AddVoiceBehaviour
+	};
+
+	// A command sent from the game thread to the audio thread
+	// Commands are stored in a preallocated ring buffer and moved out of it by the audio thread, so it never has to allocate
+	// to receive one. The moved-from slot is left for the game thread to reuse.
+	struct AudioCommand {
+		AudioCommandType type = AudioCommandType::SetMasterGain;
+		uint32_t id = 0;
+		float value = 0;
+		bool loop = false;
+		Vector3f vector;
+		String name;
+		std::shared_ptr<const AudioEvent> event;
+		std::shared_ptr<const IAudioClip> clip;
+		AudioPosition position;
+		AudioListenerData listener;
+		std::vector<AudioChannelData> channels;
+		std::unique_ptr<AudioVoiceBehaviour> behaviour;
+
+		AudioCommand() = default;
+		AudioCommand(AudioCommandType type, uint32_t id = 0)
+			: type(type)
+			, id(id)
+		{}
+	};
+}
@@ -8,6 +8,7 @@
 #include "halley/core/resources/resources.h"
 #include "audio_event.h"
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
 #include "halley/core/api/audio_api.h"
 #include "audio_variable_table.h"
 #include "halley/time/stopwatch.h"
@@ -23,6 +24,8 @@ AudioEngine::AudioEngine()
 	, needsBuffer(true)
 {
 	rng.setSeed(Random::getGlobal().getRawInt());
+	emitters.reserve(256);
+	finishedSounds.reserve(256);
 }
 
 AudioEngine::~AudioEngine()
@@ -77,22 +80,12 @@ void AudioEngine::addEmitter(uint32_t id, std::unique_ptr<AudioVoice> src)
 {
 	emitters.emplace_back(std::move(src));
 	emitters.back()->setId(id);
-	idToSource[id].push_back(emitters.back().get());
+	voiceTable.add(id, emitters.back().get());
 }
 
-const std::vector<AudioVoice*>& AudioEngine::getSources(uint32_t id)
+std::vector<uint32_t>& AudioEngine::getFinishedSounds()
 {
-	auto src = idToSource.find(id);
-	if (src != idToSource.end()) {
-		return src->second;
-	} else {
-		return dummyIdSource;
-	}
-}
-
-std::vector<uint32_t> AudioEngine::getFinishedSounds()
-{
-	return std::move(finishedSounds);
+	return finishedSounds;
 }
 
 void AudioEngine::start(AudioSpec s, AudioOutputAPI& o)
@@ -126,6 +119,7 @@ void AudioEngine::pause()
 
 void AudioEngine::generateBuffer()
 {
+	ProfilerEvent event("Audio Mix");
 	Stopwatch timer;
 	timer.start();
 	
@@ -294,15 +288,8 @@ void AudioEngine::removeFinishedEmitters()
 {
 	for (auto& e: emitters) {
 		if (e->isDone()) {
-			auto iter = idToSource.find(e->getId());
-			if (iter != idToSource.end()) {
-				auto& ems = iter->second;
-				if (ems.size() > 1) {
-					ems.erase(std::remove_if(ems.begin(), ems.end(), [] (const AudioVoice* e) { return e->isDone(); }), ems.end());
-				} else {
-					finishedSounds.push_back(iter->first);
-					idToSource.erase(iter);
-				}
+			if (voiceTable.remove(e->getId(), e.get())) {
+				finishedSounds.push_back(e->getId());
 			}
 		}
 	}
@@ -318,15 +305,15 @@ void AudioEngine::clearBuffer(gsl::span<AudioSamplePack> dst)
 	}
 }
 
-int AudioEngine::getGroupId(const String& group)
+int AudioEngine::getGroupId(StringId group)
 {
-	const auto iter = std::find(groupNames.begin(), groupNames.end(), group);
-	if (iter != groupNames.end()) {
-		return int(iter - groupNames.begin());
+	const auto iter = std::find(groupIds.begin(), groupIds.end(), group);
+	if (iter != groupIds.end()) {
+		return int(iter - groupIds.begin());
 	} else {
-		groupNames.push_back(group);
+		groupIds.push_back(group);
 		groupGains.push_back(1.0f);
-		return int(groupNames.size()) - 1;
+		return int(groupIds.size()) - 1;
 	}
 }
 
@@ -2,13 +2,14 @@
 #include "audio_buffer.h"
 #include <atomic>
 #include <condition_variable>
-#include <map>
 #include <vector>
 
 #include "audio_voice.h"
+#include "audio_voice_table.h"
 #include "halley/audio/resampler.h"
 #include "halley/data_structures/ring_buffer.h"
 #include "halley/maths/random.h"
+#include "halley/text/string_id.h"
 
 namespace Halley {
 	class AudioMixer;
@@ -29,8 +30,13 @@ namespace Halley {
 
 		void addEmitter(uint32_t id, std::unique_ptr<AudioVoice> src);
 
-		const std::vector<AudioVoice*>& getSources(uint32_t id);
-		std::vector<uint32_t> getFinishedSounds();
+		template <typename F>
+		void forEachSource(uint32_t id, F f) const
+		{
+			voiceTable.forEach(id, f);
+		}
+
+		std::vector<uint32_t>& getFinishedSounds();
 
 		void run();
 		void start(AudioSpec spec, AudioOutputAPI& out);
@@ -45,7 +51,7 @@ namespace Halley {
 
 		void setMasterGain(float gain);
 		void setGroupGain(const String& name, float gain);
-		int getGroupId(const String& group);
+		int getGroupId(StringId group);
 
     	void setVariable(const String& name, float value);
 
@@ -68,11 +74,10 @@ namespace Halley {
 		std::vector<std::unique_ptr<AudioVoice>> emitters;
 		std::vector<AudioChannelData> channels;
 		
-		std::map<uint32_t, std::vector<AudioVoice*>> idToSource;
-		std::vector<AudioVoice*> dummyIdSource;
+		AudioVoiceTable voiceTable;
 
 		float masterGain = 1.0f;
-		std::vector<String> groupNames;
+		std::vector<StringId> groupIds;
     	std::vector<float> groupGains;
 
 		AudioListenerData listener;
@@ -91,6 +91,7 @@ AudioEventActionPlay::AudioEventActionPlay(AudioEvent& event, const ConfigNode&
 	: event(event)
 {
 	group = node["group"].asString("");
+	groupId = group;
 	if (node.hasKey("clips")) {
 		for (auto& clipNode: node["clips"]) {
 			clips.push_back(clipNode.asString());
@@ -149,7 +150,7 @@ bool AudioEventActionPlay::run(AudioEngine& engine, uint32_t id, const AudioPosi
 		source = std::make_shared<AudioFilterResample>(source, int(lround(sampleRate * curPitch)), sampleRate, engine.getPool());
 	}
 
-	auto voice = std::make_unique<AudioVoice>(source, position, curVolume, engine.getGroupId(group));
+	auto voice = std::make_unique<AudioVoice>(source, position, curVolume, engine.getGroupId(groupId));
 	if (dynamics) {
 		voice->addBehaviour(std::make_unique<AudioVoiceDynamicsBehaviour>(dynamics.value(), engine));
 	}
@@ -179,6 +180,7 @@ void AudioEventActionPlay::deserialize(Deserializer& s)
 {
 	s >> clips;
 	s >> group;
+	groupId = group;
 	s >> pitch;
 	s >> volume;
 	s >> delay;
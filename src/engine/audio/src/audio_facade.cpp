@@ -1,9 +1,11 @@
 #include "audio_facade.h"
 #include "audio_engine.h"
+#include "audio_command.h"
 #include "audio_handle_impl.h"
 #include "behaviours/audio_voice_behaviour.h"
 #include "halley/support/console.h"
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
 #include "halley/core/resources/resources.h"
 #include "audio_event.h"
 #include "behaviours/audio_voice_fade_behaviour.h"
@@ -17,7 +19,7 @@ AudioFacade::AudioFacade(AudioOutputAPI& o, SystemAPI& system)
 	, started(false)
 	, commandQueue(1024)
 	, exceptions(16)
-	, finishedSoundsQueue(4)
+	, finishedSoundsQueue(1024)
 	, ownAudioThread(o.needsAudioThread())
 {
 }
@@ -163,10 +165,10 @@ AudioHandle AudioFacade::postEvent(const String& name, AudioPosition position)
 	uint32_t id = uniqueId++;
 
 	if (resources->exists<AudioEvent>(name)) {
-		const auto event = resources->get<AudioEvent>(name);
-		enqueue([=]() {
-			engine->postEvent(id, *event, position);
-		});
+		AudioCommand command(AudioCommandType::PostEvent, id);
+		command.event = resources->get<AudioEvent>(name);
+		command.position = std::move(position);
+		enqueue(std::move(command));
 	} else {
 		Logger::logError("Unknown audio event: \"" + name + "\"");
 	}
@@ -178,9 +180,12 @@ AudioHandle AudioFacade::postEvent(const String& name, AudioPosition position)
 AudioHandle AudioFacade::play(std::shared_ptr<const IAudioClip> clip, AudioPosition position, float volume, bool loop)
 {
 	uint32_t id = uniqueId++;
-	enqueue([=] () {
-		engine->play(id, clip, position, volume, loop);
-	});
+	AudioCommand command(AudioCommandType::Play, id);
+	command.clip = std::move(clip);
+	command.position = std::move(position);
+	command.value = volume;
+	command.loop = loop;
+	enqueue(std::move(command));
 	playingSounds.push_back(id);
 	return std::make_shared<AudioHandleImpl>(*this, id);
 }
@@ -230,24 +235,24 @@ void AudioFacade::stopAllMusic(float fadeOutTime)
 
 void AudioFacade::setMasterVolume(float volume)
 {
-	enqueue([=] () {
-		engine->setMasterGain(volumeToGain(volume));
-	});
+	AudioCommand command(AudioCommandType::SetMasterGain);
+	command.value = volumeToGain(volume);
+	enqueue(std::move(command));
 }
 
 void AudioFacade::setGroupVolume(const String& groupName, float volume)
 {
-	enqueue([=] () {
-		engine->setGroupGain(groupName, volumeToGain(volume));
-	});
+	AudioCommand command(AudioCommandType::SetGroupGain);
+	command.name = groupName;
+	command.value = volumeToGain(volume);
+	enqueue(std::move(command));
 }
 
 void AudioFacade::setOutputChannels(std::vector<AudioChannelData> audioChannelData)
 {
-	enqueue([=, audioChannelData = std::move(audioChannelData)] () mutable
-	{
-		engine->setOutputChannels(std::move(audioChannelData));
-	});
+	AudioCommand command(AudioCommandType::SetOutputChannels);
+	command.channels = std::move(audioChannelData);
+	enqueue(std::move(command));
 }
 
 void AudioFacade::stopMusic(AudioHandle& handle, float fadeOutTime)
@@ -268,18 +273,17 @@ void AudioFacade::onNeedBuffer()
 
 void AudioFacade::setListener(AudioListenerData listener)
 {
-	enqueue([=] () {
-		engine->setListener(listener);
-	});
+	AudioCommand command(AudioCommandType::SetListener);
+	command.listener = listener;
+	enqueue(std::move(command));
 }
 
 void AudioFacade::setGlobalVariable(const String& variable, float value)
 {
-	String nameCopy = variable;
-	enqueue([this, nameCopy = std::move(nameCopy), value]()
-	{
-		engine->setVariable(nameCopy, value);
-	});
+	AudioCommand command(AudioCommandType::SetVariable);
+	command.name = variable;
+	command.value = value;
+	enqueue(std::move(command));
 }
 
 void AudioFacade::onAudioException(std::exception& e)
@@ -291,6 +295,7 @@ void AudioFacade::onAudioException(std::exception& e)
 
 void AudioFacade::run()
 {
+	Profiler::setThreadName("Audio");
 	while (running) {
 		stepAudio();
 	}
@@ -303,19 +308,21 @@ void AudioFacade::stepAudio()
 			if (!running) {
 				return;
 			}
-			if (finishedSoundsQueue.canWrite(1)) {
-				auto finishedSounds = engine->getFinishedSounds();
-				if (!finishedSounds.empty()) {
-					finishedSoundsQueue.writeOne(std::move(finishedSounds));
-				}
+
+			// Anything that doesn't fit is kept by the engine until the next step
+			auto& engineFinished = engine->getFinishedSounds();
+			const size_t nToWrite = std::min(engineFinished.size(), finishedSoundsQueue.availableToWrite());
+			if (nToWrite > 0) {
+				finishedSoundsQueue.write(gsl::span<const uint32_t>(engineFinished.data(), nToWrite));
+				engineFinished.erase(engineFinished.begin(), engineFinished.begin() + nToWrite);
 			}
 		}
 
-		const size_t nToRead = commandQueue.availableToRead();
-		inbox.resize(nToRead);
-		commandQueue.read(gsl::span<std::function<void()>>(inbox.data(), nToRead));
-		for (auto& action : inbox) {
-			action();
+		// Each command is moved out and popped before it runs, so one that throws isn't run again on the next step
+		for (size_t n = commandQueue.availableToRead(); n > 0; --n) {
+			auto command = std::move(commandQueue.peekOne());
+			commandQueue.popOne();
+			runCommand(command);
 		}
 
 		if (ownAudioThread) {
@@ -328,11 +335,11 @@ void AudioFacade::stepAudio()
 	}
 }
 
-void AudioFacade::enqueue(std::function<void()> action)
+void AudioFacade::enqueue(AudioCommand command)
 {
 	if (running) {
 		if (commandQueue.canWrite(1)) {
-			commandQueue.writeOne(std::move(action));
+			commandQueue.writeOne(std::move(command));
 		} else {
 			Logger::logError("Out of space on audio command queue.");
 		}
@@ -352,12 +359,90 @@ void AudioFacade::pump()
 	}
 
 	if (running) {
-		while (finishedSoundsQueue.canRead(1)) {
-			auto finishedSounds = finishedSoundsQueue.readOne();
+		if (!finishedSoundsQueue.empty()) {
+			finishedSounds.resize(finishedSoundsQueue.availableToRead());
+			finishedSoundsQueue.read(gsl::span<uint32_t>(finishedSounds));
+			std::sort(finishedSounds.begin(), finishedSounds.end());
 			playingSounds.erase(std::remove_if(playingSounds.begin(), playingSounds.end(), [&] (uint32_t id) -> bool
 			{
-				return std::find(finishedSounds.begin(), finishedSounds.end(), id) != finishedSounds.end();
+				return std::binary_search(finishedSounds.begin(), finishedSounds.end(), id);
 			}), playingSounds.end());
 		}
 	}
 }
+
+void AudioFacade::runCommand(AudioCommand& command)
+{
+	switch (command.type) {
+	case AudioCommandType::PostEvent:
+		engine->postEvent(command.id, *command.event, command.position);
+		break;
+
+	case AudioCommandType::Play:
+		engine->play(command.id, std::move(command.clip), std::move(command.position), command.value, command.loop);
+		break;
+
+	case AudioCommandType::SetMasterGain:
+		engine->setMasterGain(command.value);
+		break;
+
+	case AudioCommandType::SetGroupGain:
+		engine->setGroupGain(command.name, command.value);
+		break;
+
+	case AudioCommandType::SetOutputChannels:
+		engine->setOutputChannels(std::move(command.channels));
+		break;
+
+	case AudioCommandType::SetListener:
+		engine->setListener(command.listener);
+		break;
+
+	case AudioCommandType::SetVariable:
+		engine->setVariable(command.name, command.value);
+		break;
+
+	case AudioCommandType::SetVoiceGain:
+		engine->forEachSource(command.id, [&] (AudioVoice& voice)
+		{
+			voice.setUserGain(command.value);
+		});
+		break;
+
+	case AudioCommandType::SetVoicePosition:
+		engine->forEachSource(command.id, [&] (AudioVoice& voice)
+		{
+			voice.setAudioSourcePosition(command.vector);
+		});
+		break;
+
+	case AudioCommandType::SetVoiceAudioPosition:
+		engine->forEachSource(command.id, [&] (AudioVoice& voice)
+		{
+			voice.setAudioSourcePosition(command.position);
+		});
+		break;
+
+	case AudioCommandType::StopVoice:
+		engine->forEachSource(command.id, [&] (AudioVoice& voice)
+		{
+			if (command.value >= 0.001f) {
+				voice.addBehaviour(std::make_unique<AudioVoiceFadeBehaviour>(command.value, 1.0f, 0.0f, true));
+			} else {
+				voice.stop();
+			}
+		});
+		break;
+
+	case AudioCommandType::AddVoiceBehaviour:
+		engine->forEachSource(command.id, [&] (AudioVoice& voice)
+		{
+			if (command.behaviour) {
+				voice.addBehaviour(std::move(command.behaviour));
+			} else {
+				Logger::logWarning("AudioVoiceBehaviour lost since event has more than one voice.");
+			}
+		});
+		break;
+	}
+}
@@ -17,8 +17,40 @@ bool AudioFilterBiquad::isReady() const
 	return src->isReady();
 }
 
+void AudioFilterBiquad::setParameters(float a0, float a1, float a2, float b1, float b2)
+{
+	this->a0 = a0;
+	this->a1 = a1;
+	this->a2 = a2;
+	this->b1 = b1;
+	this->b2 = b2;
+}
+
 bool AudioFilterBiquad::getAudioData(size_t numSamples, AudioSourceData& dst)
 {
-	// TODO
-	return src->getAudioData(numSamples, dst);
+	const bool playing = src->getAudioData(numSamples, dst);
+
+	const size_t nChannels = src->getNumberOfChannels();
+	for (size_t i = 0; i < nChannels; ++i) {
+		process(dst[i].subspan(0, numSamples), state[i]);
+	}
+
+	return playing;
+}
+
+void AudioFilterBiquad::process(gsl::span<AudioConfig::SampleFormat> samples, State& channelState) const
+{
+	// Transposed direct form II. Each output feeds into the next, so this can't be vectorised across samples without
+	// changing the result; keep the state in registers instead.
+	float z1 = channelState.z1;
+	float z2 = channelState.z2;
+	for (auto& sample: samples) {
+		const float x = sample;
+		const float y = a0 * x + z1;
+		z1 = a1 * x - b1 * y + z2;
+		z2 = a2 * x - b2 * y;
+		sample = y;
+	}
+	channelState.z1 = z1;
+	channelState.z2 = z2;
 }
@@ -1,9 +1,7 @@
 #include "audio_handle_impl.h"
 #include "audio_facade.h"
-#include "audio_engine.h"
+#include "audio_command.h"
 #include <algorithm>
-#include "behaviours/audio_voice_fade_behaviour.h"
-#include "halley/support/logger.h"
 
 using namespace Halley;
 
@@ -17,10 +15,9 @@ void AudioHandleImpl::setGain(float gain)
 {
 	if (std::abs(gain - this->gain) > 0.00001f) {
 		this->gain = gain;
-		enqueue([gain] (AudioVoice& src)
-		{
-			src.setUserGain(gain);
-		});
+		AudioCommand command(AudioCommandType::SetVoiceGain, handleId);
+		command.value = gain;
+		facade.enqueue(std::move(command));
 	}
 }
 
@@ -31,65 +28,30 @@ void AudioHandleImpl::setVolume(float volume)
 
 void AudioHandleImpl::setPosition(Vector2f pos)
 {
-	enqueue([pos] (AudioVoice& src)
-	{
-		src.setAudioSourcePosition(Vector3f(pos));
-	});
+	AudioCommand command(AudioCommandType::SetVoicePosition, handleId);
+	command.vector = Vector3f(pos);
+	facade.enqueue(std::move(command));
 }
 
 void AudioHandleImpl::setPan(float pan)
 {
-	enqueue([pan] (AudioVoice& src)
-	{
-		src.setAudioSourcePosition(AudioPosition::makeUI(pan));
-	});
+	AudioCommand command(AudioCommandType::SetVoiceAudioPosition, handleId);
+	command.position = AudioPosition::makeUI(pan);
+	facade.enqueue(std::move(command));
 }
 
 void AudioHandleImpl::stop(float fadeTime)
 {
-	enqueue([fadeTime] (AudioVoice& src)
-	{
-		if (fadeTime >= 0.001f) {
-			src.addBehaviour(std::make_unique<AudioVoiceFadeBehaviour>(fadeTime, 1.0f, 0.0f, true));
-		} else {
-			src.stop();
-		}
-	});
+	AudioCommand command(AudioCommandType::StopVoice, handleId);
+	command.value = fadeTime;
+	facade.enqueue(std::move(command));
 }
 
-// This is kind of like a unique_ptr, but copying it also moves it. >_>
-template <typename T>
-class BadPointer {
-public:
-	BadPointer(T* v) : v(v) {}
-	BadPointer(const BadPointer& other) : v(other.v) { other.v = nullptr; }
-	BadPointer(BadPointer&& other) : v(other.v) { other.v = nullptr; }
-	~BadPointer() { delete v; }
-
-	T* release()
-	{
-		auto value = v;
-		v = nullptr;
-		return value;
-	}
-
-private:
-	mutable T* v = nullptr;
-};
-
-void AudioHandleImpl::addBehaviour(std::unique_ptr<AudioVoiceBehaviour> b)
+void AudioHandleImpl::addBehaviour(std::unique_ptr<AudioVoiceBehaviour> behaviour)
 {
-	// Gotta work around std::function requiring copyable
-	BadPointer<AudioVoiceBehaviour> behaviour = b.release();
-	enqueue([behaviour] (AudioVoice& src) mutable
-	{
-		auto b = std::unique_ptr<AudioVoiceBehaviour>(behaviour.release());
-		if (b) {
-			src.addBehaviour(std::move(b));
-		} else {
-			Logger::logWarning("AudioVoiceBehaviour lost since event has more than one voice.");
-		}
-	});
+	AudioCommand command(AudioCommandType::AddVoiceBehaviour, handleId);
+	command.behaviour = std::move(behaviour);
+	facade.enqueue(std::move(command));
 }
 
 bool AudioHandleImpl::isPlaying() const
@@ -98,14 +60,3 @@ bool AudioHandleImpl::isPlaying() const
 	return std::binary_search(playing.begin(), playing.end(), handleId);
 }
 
-
-void AudioHandleImpl::enqueue(std::function<void(AudioVoice& src)> f)
-{
-	uint32_t id = handleId;
-	AudioEngine* engine = facade.engine.get();
-	facade.enqueue([id, engine, f = std::move(f)] () {
-		for (const auto& src: engine->getSources(id)) {
-			f(*src);
-		}
-	});
-}
@@ -1,11 +1,9 @@
 #pragma once
 #include "halley/core/api/audio_api.h"
-#include <functional>
 
 namespace Halley
 {
 	class AudioFacade;
-	class AudioVoice;
 
 	class AudioHandleImpl final : public IAudioHandle
 	{
@@ -24,7 +22,5 @@ namespace Halley
 		AudioFacade& facade;
 		uint32_t handleId;
 		float gain = 1.0f;
-
-		void enqueue(std::function<void(AudioVoice& src)> f);
 	};
 }
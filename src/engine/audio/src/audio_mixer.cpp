@@ -18,10 +18,13 @@ void AudioMixer::mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioS
 		}
 	} else {
 		// Interpolate the gain
-		const float scale = 1.0f / (dst.size() * AudioSamplePack::NumSamples);
+		// This is evaluated exactly as the SIMD mixers do it, so that every mixer produces the same output
+		const float scale = 1.0f / (nPacks * AudioSamplePack::NumSamples);
+		const float gainDiff = gain1 - gain0;
 		for (size_t i = 0; i < nPacks; ++i) {
 			for (size_t j = 0; j < AudioSamplePack::NumSamples; ++j) {
-				dst[i].samples[j] += src[i].samples[j] * lerp(gain0, gain1, (i * AudioSamplePack::NumSamples + j) * scale);
+				const float t = float(i * AudioSamplePack::NumSamples + j) * scale;
+				dst[i].samples[j] += src[i].samples[j] * (gainDiff * t + gain0);
 			}
 		}
 	}
@@ -66,73 +69,54 @@ void AudioMixer::compressRange(gsl::span<AudioSamplePack> buffer)
 	}
 }
 
-#ifdef HAS_SSE
-
-#ifdef _MSC_VER
-
+#if defined(HAS_SSE) && defined(_MSC_VER)
 #include <intrin.h>
-
-#else
-
-#include <cpuid.h>
-static inline unsigned long long _xgetbv(unsigned int index){
-	unsigned int eax, edx;
-	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
-	return ((unsigned long long)edx << 32) | eax;
-}
-#define _XCR_XFEATURE_ENABLED_MASK 0
-
 #endif
 
-#endif
-
-#ifdef HAS_AVX
-static bool hasAVX()
+AudioMixer::CPUFeatures AudioMixer::getCPUFeatures()
 {
-#ifndef _MSC_VER
-    // It's crashing on Linux :(
-    return false;
-#endif
+	CPUFeatures result;
 
-#ifdef HAS_SSE
+#if defined(HAS_SSE) && defined(_MSC_VER)
 	int regs[4];
-	int i = 1;
-
-#ifdef _WIN32
-	__cpuid(regs, i);
-#else
-	asm volatile
-	("cpuid" : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
-	: "a" (i), "c" (0));
-	// ECX is set to zero for CPUID function 4
+	__cpuid(regs, 1);
+	result.sse = (regs[3] & (1 << 25)) != 0;
+
+	// The OS must also save the YMM (and for AVX-512, the ZMM and opmask) registers on context switches
+	const bool osUsesXSAVE = (regs[2] & (1 << 27)) != 0;
+	const bool cpuAVX = (regs[2] & (1 << 28)) != 0;
+	const unsigned long long xcr0 = osUsesXSAVE ? _xgetbv(0) : 0;
+	result.avx = cpuAVX && (xcr0 & 0x6) == 0x6;
+
+	__cpuidex(regs, 7, 0);
+	result.avx512 = result.avx && (regs[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+#elif defined(HAS_SSE)
+	// These take the OS register saving support into account
+	__builtin_cpu_init();
+	result.sse = __builtin_cpu_supports("sse") != 0;
+	result.avx = __builtin_cpu_supports("avx") != 0;
+	result.avx512 = __builtin_cpu_supports("avx512f") != 0;
 #endif
 
-	bool osUsesXSAVE_XRSTORE = regs[2] & (1 << 27) || false;
-	bool cpuAVXSuport = regs[2] & (1 << 28) || false;
-
-	if (osUsesXSAVE_XRSTORE && cpuAVXSuport) {
-		unsigned long long xcrFeatureMask = _xgetbv(_XCR_XFEATURE_ENABLED_MASK);
-		return (xcrFeatureMask & 0x6) == 0x6;
-	} else {
-		return false;
-	}
-#else
-	return false;
-#endif
+	return result;
 }
-#endif
 
 std::unique_ptr<AudioMixer> AudioMixer::makeMixer()
 {
+	[[maybe_unused]] const auto features = getCPUFeatures();
+
 #ifdef HAS_AVX
-	if (hasAVX()) {
+	if (features.avx512) {
+		return std::make_unique<AudioMixerAVX512>();
+	}
+	if (features.avx) {
 		return std::make_unique<AudioMixerAVX>();
-	} else {
+	}
+#endif
+#ifdef HAS_SSE
+	if (features.sse) {
 		return std::make_unique<AudioMixerSSE>();
 	}
-#elif HAS_SEE
-	return std::make_unique<AudioMixerSSE>();
-#else
-	return std::make_unique<AudioMixer>();
 #endif
+	return std::make_unique<AudioMixer>();
 }
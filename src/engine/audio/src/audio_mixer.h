@@ -5,16 +5,24 @@
 
 #if defined(_M_X64) || defined(__x86_64__)
 #define HAS_SSE
-#if !defined(__linux__)
 #define HAS_AVX
 #endif
-#endif
 
 #if defined(_M_IX86) || defined(__i386)
 // Might not be available, but do we really care about such old processors?
 #define HAS_SSE
 #endif
 
+// AVX kernels are compiled per function with target attributes rather than per file, so that no AVX code can leak into
+// inline functions shared with the rest of the program. They're only called after checking the CPU at runtime.
+#if defined(HAS_AVX) && (defined(__GNUC__) || defined(__clang__))
+#define HALLEY_TARGET_AVX __attribute__((target("avx")))
+#define HALLEY_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define HALLEY_TARGET_AVX
+#define HALLEY_TARGET_AVX512
+#endif
+
 namespace Halley
 {
 	class AudioMixer
@@ -26,6 +34,15 @@ namespace Halley
 		virtual void interleaveChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> srcs);
 		virtual void concatenateChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> srcs);
 		virtual void compressRange(gsl::span<AudioSamplePack> buffer);
+
+		struct CPUFeatures {
+			bool sse = false;
+			bool avx = false;
+			bool avx512 = false;
+		};
+		static CPUFeatures getCPUFeatures();
+
+		// Picks the fastest mixer supported by the running CPU
 		static std::unique_ptr<AudioMixer> makeMixer();
 	};
 }
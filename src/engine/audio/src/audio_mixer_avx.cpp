@@ -1,11 +1,8 @@
 #include "audio_mixer_avx.h"
 
 #ifdef HAS_AVX
-#include <xmmintrin.h>
-
-#ifdef __clang__
 #include <immintrin.h>
-#endif
+#include <gsl/gsl_assert>
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -13,49 +10,106 @@
 
 using namespace Halley;
 
-void AudioMixerAVX::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+HALLEY_TARGET_AVX void AudioMixerAVX::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
 {
-	gsl::span<const __m256> src(reinterpret_cast<const __m256*>(srcRaw.data()), srcRaw.size() * 2);
-	gsl::span<__m256> dst(reinterpret_cast<__m256*>(dstRaw.data()), dstRaw.size() * 2);
-	const size_t nSamples = size_t(src.size());
+	const auto* src = reinterpret_cast<const __m256*>(srcRaw.data());
+	auto* dst = reinterpret_cast<__m256*>(dstRaw.data());
+	const size_t nSamples = size_t(srcRaw.size()) * 2;
 
 	if (gain0 == gain1) {
-		__m256 gain = _mm256_broadcast_ss(&gain0);
+		const __m256 gain = _mm256_set1_ps(gain0);
 		for (size_t i = 0; i < nSamples; i += 2) {
 			dst[i] = _mm256_add_ps(dst[i], _mm256_mul_ps(src[i], gain));
 			dst[i + 1] = _mm256_add_ps(dst[i + 1], _mm256_mul_ps(src[i + 1], gain));
 		}
 	} else {
-		const float sc = 1.0f / (dst.size() * 16);
-		const float gainDiff = gain1 - gain0;
-		const float eight = 8.0f;
-
-		__m256 gain0p = _mm256_broadcast_ss(&gain0);
-		__m256 gain1p = _mm256_broadcast_ss(&gainDiff);
-		__m256 scale = _mm256_broadcast_ss(&sc);
-		__m256 inc = _mm256_broadcast_ss(&eight);
-		__m256 offset = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+		const float sc = 1.0f / (srcRaw.size() * AudioSamplePack::NumSamples);
+
+		const __m256 gain0p = _mm256_set1_ps(gain0);
+		const __m256 gain1p = _mm256_set1_ps(gain1 - gain0);
+		const __m256 scale = _mm256_set1_ps(sc);
+		const __m256 inc = _mm256_set1_ps(8.0f);
+		__m256 offset = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
 		for (size_t i = 0; i < nSamples; ++i) {
-			__m256 t = _mm256_mul_ps(offset, scale);
-			__m256 gain = _mm256_add_ps(gain0p, _mm256_mul_ps(gain1p, t));
+			const __m256 t = _mm256_mul_ps(offset, scale);
+			const __m256 gain = _mm256_add_ps(_mm256_mul_ps(gain1p, t), gain0p);
 			offset = _mm256_add_ps(offset, inc);
 			dst[i] = _mm256_add_ps(dst[i], _mm256_mul_ps(src[i], gain));
 		}
 	}
 }
 
-void AudioMixerAVX::compressRange(gsl::span<AudioSamplePack> buffer)
+HALLEY_TARGET_AVX void AudioMixerAVX::interleaveChannels(gsl::span<AudioSamplePack> dstBuffer, gsl::span<AudioBuffer*> srcs)
+{
+	Expects(srcs.size() == 2);
+
+	// Each destination pack interleaves half a pack from each source
+	const auto* left = reinterpret_cast<const __m256*>(srcs[0]->packs.data());
+	const auto* right = reinterpret_cast<const __m256*>(srcs[1]->packs.data());
+	auto* dst = reinterpret_cast<__m256*>(dstBuffer.data());
+	const size_t nSrc = size_t(dstBuffer.size());
+
+	for (size_t i = 0; i < nSrc; ++i) {
+		// unpack works within 128-bit lanes, so the halves need to be put back in order afterwards
+		const __m256 lo = _mm256_unpacklo_ps(left[i], right[i]);
+		const __m256 hi = _mm256_unpackhi_ps(left[i], right[i]);
+		dst[2 * i] = _mm256_permute2f128_ps(lo, hi, 0x20);
+		dst[2 * i + 1] = _mm256_permute2f128_ps(lo, hi, 0x31);
+	}
+}
+
+HALLEY_TARGET_AVX void AudioMixerAVX::compressRange(gsl::span<AudioSamplePack> buffer)
 {
-	gsl::span<__m256> dst(reinterpret_cast<__m256*>(buffer.data()), buffer.size() * 2);
-	const size_t nSamples = size_t(dst.size());
+	auto* dst = reinterpret_cast<__m256*>(buffer.data());
+	const size_t nSamples = size_t(buffer.size()) * 2;
 
-	float val = 0.99995f;
-	__m256 minVal = { -val, -val, -val, -val, -val, -val, -val, -val };
-	__m256 maxVal = { val, val, val, val, val, val, val, val };
+	const __m256 minVal = _mm256_set1_ps(-0.99995f);
+	const __m256 maxVal = _mm256_set1_ps(0.99995f);
 
 	for (size_t i = 0; i < nSamples; ++i) {
 		dst[i] = _mm256_max_ps(minVal, _mm256_min_ps(dst[i], maxVal));
 	}
 }
 
+HALLEY_TARGET_AVX512 void AudioMixerAVX512::mixAudio(gsl::span<const AudioSamplePack> srcRaw, gsl::span<AudioSamplePack> dstRaw, float gain0, float gain1)
+{
+	const auto* src = reinterpret_cast<const __m512*>(srcRaw.data());
+	auto* dst = reinterpret_cast<__m512*>(dstRaw.data());
+	const size_t nSamples = size_t(srcRaw.size());
+
+	if (gain0 == gain1) {
+		const __m512 gain = _mm512_set1_ps(gain0);
+		for (size_t i = 0; i < nSamples; ++i) {
+			dst[i] = _mm512_add_ps(dst[i], _mm512_mul_ps(src[i], gain));
+		}
+	} else {
+		const float sc = 1.0f / (srcRaw.size() * AudioSamplePack::NumSamples);
+
+		const __m512 gain0p = _mm512_set1_ps(gain0);
+		const __m512 gain1p = _mm512_set1_ps(gain1 - gain0);
+		const __m512 scale = _mm512_set1_ps(sc);
+		const __m512 inc = _mm512_set1_ps(16.0f);
+		__m512 offset = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+		for (size_t i = 0; i < nSamples; ++i) {
+			const __m512 t = _mm512_mul_ps(offset, scale);
+			const __m512 gain = _mm512_add_ps(_mm512_mul_ps(gain1p, t), gain0p);
+			offset = _mm512_add_ps(offset, inc);
+			dst[i] = _mm512_add_ps(dst[i], _mm512_mul_ps(src[i], gain));
+		}
+	}
+}
+
+HALLEY_TARGET_AVX512 void AudioMixerAVX512::compressRange(gsl::span<AudioSamplePack> buffer)
+{
+	auto* dst = reinterpret_cast<__m512*>(buffer.data());
+	const size_t nSamples = size_t(buffer.size());
+
+	const __m512 minVal = _mm512_set1_ps(-0.99995f);
+	const __m512 maxVal = _mm512_set1_ps(0.99995f);
+
+	for (size_t i = 0; i < nSamples; ++i) {
+		dst[i] = _mm512_max_ps(minVal, _mm512_min_ps(dst[i], maxVal));
+	}
+}
+
 #endif
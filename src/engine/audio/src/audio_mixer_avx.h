@@ -4,7 +4,16 @@
 #ifdef HAS_AVX
 namespace Halley
 {
-	class AudioMixerAVX final : public AudioMixer
+	class AudioMixerAVX : public AudioMixer
+	{
+	public:
+		void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+		void interleaveChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> srcs) override;
+		void compressRange(gsl::span<AudioSamplePack> buffer) override;
+	};
+
+	// A pack is exactly one AVX-512 register, so mixing and clamping get their own kernels; the rest is inherited
+	class AudioMixerAVX512 final : public AudioMixerAVX
 	{
 	public:
 		void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
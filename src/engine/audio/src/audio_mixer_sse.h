@@ -8,6 +8,7 @@ namespace Halley
 	{
 	public:
 		void mixAudio(gsl::span<const AudioSamplePack> src, gsl::span<AudioSamplePack> dst, float gainStart, float gainEnd) override;
+		void interleaveChannels(gsl::span<AudioSamplePack> dst, gsl::span<AudioBuffer*> srcs) override;
 		void compressRange(gsl::span<AudioSamplePack> buffer) override;
 	};
 }
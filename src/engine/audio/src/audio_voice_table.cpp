@@ -0,0 +1,88 @@
+#include "audio_voice_table.h"
+#include <gsl/gsl_assert>
+#include "halley/utils/utils.h"
+
+using namespace Halley;
+
+AudioVoiceTable::AudioVoiceTable(size_t initialCapacity)
+{
+	const size_t capacity = nextPowerOf2(std::max(initialCapacity, size_t(16)));
+	entries.resize(capacity);
+	mask = capacity - 1;
+}
+
+void AudioVoiceTable::add(uint32_t id, AudioVoice* voice)
+{
+	Expects(voice != nullptr);
+
+	// Keep the load factor under 3/4, so probe sequences stay short
+	if ((count + 1) * 4 > entries.size() * 3) {
+		grow();
+	}
+	insert(Entry{ id, voice });
+	++count;
+}
+
+bool AudioVoiceTable::remove(uint32_t id, AudioVoice* voice)
+{
+	size_t i = getHomeSlot(id);
+	while (entries[i].voice && !(entries[i].id == id && entries[i].voice == voice)) {
+		i = (i + 1) & mask;
+	}
+	if (!entries[i].voice) {
+		return false;
+	}
+
+	// Backward shift deletion: pull later entries of the probe sequence into the hole, so lookups never need tombstones
+	entries[i] = Entry();
+	--count;
+	for (size_t j = (i + 1) & mask; entries[j].voice; j = (j + 1) & mask) {
+		const size_t home = getHomeSlot(entries[j].id);
+		const bool canMove = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+		if (canMove) {
+			entries[i] = entries[j];
+			entries[j] = Entry();
+			i = j;
+		}
+	}
+
+	return !contains(id);
+}
+
+bool AudioVoiceTable::contains(uint32_t id) const
+{
+	for (size_t i = getHomeSlot(id); entries[i].voice; i = (i + 1) & mask) {
+		if (entries[i].id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t AudioVoiceTable::getHomeSlot(uint32_t id) const
+{
+	// Ids are handed out sequentially, so scramble them before masking (Fibonacci hashing)
+	return size_t((uint64_t(id) * 11400714819323198485ull) >> 32) & mask;
+}
+
+void AudioVoiceTable::insert(Entry entry)
+{
+	size_t i = getHomeSlot(entry.id);
+	while (entries[i].voice) {
+		i = (i + 1) & mask;
+	}
+	entries[i] = entry;
+}
+
+void AudioVoiceTable::grow()
+{
+	auto old = std::move(entries);
+	entries.clear();
+	entries.resize(old.size() * 2);
+	mask = entries.size() - 1;
+	for (const auto& e: old) {
+		if (e.voice) {
+			insert(e);
+		}
+	}
+}
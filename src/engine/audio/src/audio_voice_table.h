@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <halley/data_structures/vector.h>
+
+namespace Halley {
+	class AudioVoice;
+
+	// Maps audio handle ids to the voices playing for them, using open addressing with linear probing
+	// An id can have several voices (one per voice started by its event); each is stored as a separate entry.
+	// Storage is preallocated, so adding and removing voices doesn't allocate unless the table grows past its load limit.
+	class AudioVoiceTable {
+	public:
+		explicit AudioVoiceTable(size_t initialCapacity = 1024);
+
+		void add(uint32_t id, AudioVoice* voice);
+
+		// Returns true if the voice was found and was the last one for its id
+		bool remove(uint32_t id, AudioVoice* voice);
+
+		bool contains(uint32_t id) const;
+		size_t size() const { return count; }
+
+		template <typename F>
+		void forEach(uint32_t id, F f) const
+		{
+			for (size_t i = getHomeSlot(id); entries[i].voice; i = (i + 1) & mask) {
+				if (entries[i].id == id) {
+					f(*entries[i].voice);
+				}
+			}
+		}
+
+	private:
+		struct Entry {
+			uint32_t id = 0;
+			AudioVoice* voice = nullptr;
+		};
+
+		Vector<Entry> entries;
+		size_t mask = 0;
+		size_t count = 0;
+
+		size_t getHomeSlot(uint32_t id) const;
+		void insert(Entry entry);
+		void grow();
+	};
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <optional>
 #include "halley/text/halleystring.h"
 #include "halley/support/logger.h"
 #include "devcon_server.h"
@@ -21,6 +22,7 @@ namespace Halley
 		void update();
 
 		void onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg);
+		void onReceiveProfileCaptureRequest(const DevCon::ProfileCaptureRequestMsg& msg);
 
 	private:
 		const HalleyAPI& api;
@@ -31,7 +33,11 @@ namespace Halley
 
 		std::shared_ptr<MessageQueue> queue;
 
+		// Sent once the profiler reaches the given frame number
+		std::optional<std::pair<uint64_t, int>> pendingProfileCapture;
+
 		void connect();
+		void sendProfileCapture(int numFrames);
 		void log(LoggerLevel level, const String& msg) override;
 	};
 }
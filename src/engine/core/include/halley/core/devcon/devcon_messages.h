@@ -17,7 +17,9 @@ namespace Halley
 		enum class MessageType
 		{
 			Log,
-			ReloadAssets
+			ReloadAssets,
+			ProfileCaptureRequest,
+			ProfileCapture
 		};
 
 
@@ -60,5 +62,42 @@ namespace Halley
 		private:
 			std::vector<String> ids;
 		};
+
+		class ProfileCaptureRequestMsg final : public DevConMessage
+		{
+		public:
+			ProfileCaptureRequestMsg(gsl::span<const gsl::byte> data);
+			ProfileCaptureRequestMsg(int numFrames);
+
+			void serialize(Serializer& s) const override;
+
+			int getNumFrames() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			int numFrames;
+		};
+
+		// Captures are sent as a Chrome trace, split across as many messages as needed
+		class ProfileCaptureMsg final : public DevConMessage
+		{
+		public:
+			constexpr static size_t maxChunkSize = 256 * 1024;
+
+			ProfileCaptureMsg(gsl::span<const gsl::byte> data);
+			ProfileCaptureMsg(String chunk, bool last);
+
+			void serialize(Serializer& s) const override;
+
+			const String& getChunk() const;
+			bool isLast() const;
+
+			MessageType getMessageType() const override;
+
+		private:
+			String chunk;
+			bool last;
+		};
 	}
 }
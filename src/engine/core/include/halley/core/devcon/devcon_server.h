@@ -4,6 +4,8 @@
 #include <memory>
 #include "halley/text/halleystring.h"
 #include <set>
+#include <functional>
+#include <optional>
 
 namespace Halley
 {
@@ -15,6 +17,8 @@ namespace Halley
 		constexpr static int devConPort = 12500;
 		class LogMsg;
 		class ReloadAssetsMsg;
+		class ProfileCaptureRequestMsg;
+		class ProfileCaptureMsg;
 	}
 
 	class DevConServerConnection
@@ -25,25 +29,38 @@ namespace Halley
 		void update();
 		
 		void reloadAssets(const std::vector<String>& assetIds);
+		void requestProfileCapture(int numFrames);
+		std::optional<String> takeProfileCapture();
 
 	private:
 		std::shared_ptr<IConnection> connection;
 		std::shared_ptr<MessageQueue> queue;
+		String profileCaptureBuffer;
+		std::optional<String> profileCapture;
 
 		void onReceiveLogMsg(const DevCon::LogMsg& msg);
+		void onReceiveProfileCaptureMsg(const DevCon::ProfileCaptureMsg& msg);
 	};
 
 	class DevConServer
 	{
 	public:
+		// Receives each capture as Chrome trace JSON
+		using ProfileCaptureCallback = std::function<void(const String&)>;
+
 		DevConServer(std::unique_ptr<NetworkService> service, int port = DevCon::devConPort);
 
 		void update();
 
 		void reloadAssets(const std::vector<String>& assetIds);
 
+		// Asks every connected game for a capture of its next numFrames frames, or its last ones if it was already recording
+		void requestProfileCapture(int numFrames);
+		void setProfileCaptureCallback(ProfileCaptureCallback callback);
+
 	private:
 		std::unique_ptr<NetworkService> service;
+		ProfileCaptureCallback profileCaptureCallback;
 		std::vector<std::shared_ptr<DevConServerConnection>> connections;
 	};
 }
@@ -100,18 +100,20 @@ namespace Halley
 		void setStencilReferenceOverride(std::optional<uint8_t> reference);
 		std::optional<uint8_t> getStencilReferenceOverride() const;
 
-		Material& set(const String& name, const std::shared_ptr<const Texture>& texture);
-		Material& set(const String& name, const std::shared_ptr<Texture>& texture);
+		Material& set(StringId name, const std::shared_ptr<const Texture>& texture);
+		Material& set(StringId name, const std::shared_ptr<Texture>& texture);
 
-		bool hasParameter(const String& name) const;
+		bool hasParameter(StringId name) const;
 
 		template <typename T>
-		Material& set(const String& name, const T& value)
+		Material& set(StringId name, const T& value)
 		{
 			getParameter(name).set(value);
 			return *this;
 		}
 
+		// Identifies everything that affects rendering: definition, textures, uniform data, enabled passes and stencil
+		// Materials with the same hash can be drawn in the same batch. It's cached, and only recomputed after a change.
 		uint64_t getHash() const;
 
 	private:
@@ -130,7 +132,7 @@ namespace Halley
 		std::optional<uint8_t> stencilReferenceOverride;
 
 		void initUniforms(bool forceLocalBlocks);
-		MaterialParameter& getParameter(const String& name);
+		MaterialParameter& getParameter(StringId name);
 
 		bool setUniform(int blockNumber, size_t offset, ShaderParameterType type, const void* data);
 		uint64_t computeHash() const;
@@ -5,6 +5,7 @@
 #include <halley/maths/vector3.h>
 #include <halley/maths/vector4.h>
 #include <halley/maths/matrix4.h>
+#include <halley/text/string_id.h>
 #include <memory>
 
 namespace Halley
@@ -23,9 +24,11 @@ namespace Halley
 		MaterialTextureParameter(Material& material, const String& name, TextureSamplerType samplerType);
 		unsigned int getAddress(int pass, ShaderType stage) const;
 		TextureSamplerType getSamplerType() const { return samplerType; }
+		StringId getId() const { return id; }
 
 	private:
 		String name;
+		StringId id;
 		Vector<int> addresses;
 		TextureSamplerType samplerType;
 	};
@@ -46,6 +49,7 @@ namespace Halley
 		bool set(const Matrix4f& m);
 
 		const String& getName() const { return name; }
+		StringId getId() const { return id; }
 		ShaderParameterType getType() const { return type; }
 
 	private:
@@ -55,6 +59,7 @@ namespace Halley
 		
 		Material* material;
 		String name;
+		StringId id;
 		size_t offset;
 		ShaderParameterType type;
 		int blockNumber;
@@ -20,11 +20,13 @@ namespace Halley
 	class Camera;
 	class RenderContext;
 	class Core;
+	class PainterCommandList;
 
 	class Painter
 	{
 		friend class RenderContext;
 		friend class Core;
+		friend class PainterCommandList;
 
 		struct PainterVertexData
 		{
@@ -36,6 +38,15 @@ namespace Halley
 			IndexType firstIndex;
 		};
 
+		struct LineVertex
+		{
+			Vector4f colour;
+			Vector2f position;
+			Vector2f normal;
+			Vector2f width;
+			char _padding[8];
+		};
+
 	public:
 		Painter(Resources& resources);
 		virtual ~Painter();
@@ -85,13 +96,26 @@ namespace Halley
 		// Polygon drawing
 		void drawPolygon(const Polygon& polygon, Colour4f colour, std::shared_ptr<Material> material = {});
 
+		// Replays draws recorded by a PainterCommandList, possibly on another thread
+		// Replaying lists in a fixed order produces exactly the same vertices, indices and draw calls as issuing those draws directly.
+		void draw(const PainterCommandList& commands);
+
 		size_t getNumDrawCalls() const { return nDrawCalls; }
 		size_t getNumVertices() const { return nVertices; }
 		size_t getNumTriangles() const { return nTriangles; }
 
+		// Batches are groups of draws submitted together, each taking one draw call per material pass
+		// Material changes count the batches that had to end early because the next draw used a different material
+		size_t getNumBatches() const { return nBatches; }
+		size_t getNumMaterialChanges() const { return nMaterialChanges; }
+		size_t getMaxBatchVertices() const { return maxBatchVertices; }
+
 		size_t getPrevDrawCalls() const { return prevDrawCalls; }
 		size_t getPrevVertices() const { return prevVertices; }
 		size_t getPrevTriangles() const { return prevTriangles; }
+		size_t getPrevBatches() const { return prevBatches; }
+		size_t getPrevMaterialChanges() const { return prevMaterialChanges; }
+		size_t getPrevMaxBatchVertices() const { return prevMaxBatchVertices; }
 
 		void setLogging(bool logging);
 
@@ -107,7 +131,7 @@ namespace Halley
 		virtual void setClip(Rect4i clip, bool enable) = 0;
 
 		virtual void onUpdateProjection(Material& material) = 0;
-		void generateQuadIndices(IndexType firstVertex, size_t numQuads, IndexType* target);
+		static void generateQuadIndices(IndexType firstVertex, size_t numQuads, IndexType* target);
 		RenderTarget& getActiveRenderTarget();
 
 		std::unique_ptr<Material> halleyGlobalMaterial;
@@ -136,6 +160,12 @@ namespace Halley
 		size_t prevDrawCalls = 0;
 		size_t prevVertices = 0;
 		size_t prevTriangles = 0;
+		size_t nBatches = 0;
+		size_t nMaterialChanges = 0;
+		size_t maxBatchVertices = 0;
+		size_t prevBatches = 0;
+		size_t prevMaterialChanges = 0;
+		size_t prevMaxBatchVertices = 0;
 		bool logging = true;
 
 		Vector<IndexType> stdQuadIndexCache;
@@ -158,7 +188,18 @@ namespace Halley
 		PainterVertexData addDrawData(const std::shared_ptr<Material>& material, size_t numVertices, size_t numIndices, bool standardQuadsOnly);
 
 		IndexType* getStandardQuadIndices(size_t numQuads);
-		void generateQuadIndicesOffset(IndexType firstVertex, IndexType lineStride, IndexType* target);
+		static void generateQuadIndicesOffset(IndexType firstVertex, IndexType lineStride, IndexType* target);
+
+		// Geometry generation, shared with PainterCommandList
+		static void writeSpriteVertices(const PainterVertexData& dst, size_t vertPosOffset, size_t numSprites, const void* vertexData);
+		static void writeSlicedSpriteVertices(const PainterVertexData& dst, size_t vertPosOffset, Vector2f scale, Vector4f slices, const void* vertexData);
+		static void makeLineVertices(gsl::span<const Vector2f> points, float width, Colour4f colour, bool loop, Vector<LineVertex>& vertices);
+		static void makePolygonVertices(const Polygon& polygon, Colour4f colour, Vector<LineVertex>& vertices, Vector<IndexType>& indices);
+		static Vector<Vector2f> makeCirclePoints(Vector2f centre, float radius);
+		static Vector<Vector2f> makeCircleArcPoints(Vector2f centre, float radius, Angle1f from, Angle1f to);
+		static Vector<Vector2f> makeEllipsePoints(Vector2f centre, Vector2f radius);
+		static Vector<Vector2f> makeRectPoints(Rect4f rect);
+		static Rect4i makeRelativeClip(const Camera& camera, Rect4i viewPort, Rect4f rect);
 
 		void updateProjection();
 		void updateClip();
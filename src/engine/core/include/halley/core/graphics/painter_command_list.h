@@ -0,0 +1,65 @@
+#pragma once
+#include "painter.h"
+#include <halley/data_structures/vector.h>
+
+namespace Halley
+{
+	// Records draws so they can be generated on a worker thread and replayed later with Painter::draw(const PainterCommandList&)
+	// Each list owns its vertex and index arenas, so any number of threads can record their own list at the same time.
+	// Construct it on the render thread, as it captures the painter's camera, viewport and clip at that point.
+	class PainterCommandList
+	{
+		friend class Painter;
+
+	public:
+		explicit PainterCommandList(Painter& painter);
+
+		void clear();
+		bool empty() const { return commands.empty(); }
+		size_t getNumCommands() const { return commands.size(); }
+
+		void setRelativeClip(Rect4f rect);
+		void setClip(Rect4i rect);
+		void setClip();
+
+		void draw(const std::shared_ptr<Material>& material, size_t numVertices, const void* vertexData, gsl::span<const IndexType> indices, PrimitiveType primitiveType = PrimitiveType::Triangle);
+		void drawQuads(const std::shared_ptr<Material>& material, size_t numVertices, const void* vertexData);
+		void drawSprites(const std::shared_ptr<Material>& material, size_t numSprites, const void* vertexData);
+		void drawSlicedSprite(const std::shared_ptr<Material>& material, Vector2f scale, Vector4f slices, const void* vertexData);
+
+		void drawLine(gsl::span<const Vector2f> points, float width, Colour4f colour, bool loop = false, std::shared_ptr<Material> material = {});
+		void drawCircle(Vector2f centre, float radius, float width, Colour4f colour, std::shared_ptr<Material> material = {});
+		void drawCircleArc(Vector2f centre, float radius, float width, Angle1f from, Angle1f to, Colour4f colour, std::shared_ptr<Material> material = {});
+		void drawEllipse(Vector2f centre, Vector2f radius, float width, Colour4f colour, std::shared_ptr<Material> material = {});
+		void drawRect(Rect4f rect, float width, Colour4f colour, std::shared_ptr<Material> material = {});
+		void drawPolygon(const Polygon& polygon, Colour4f colour, std::shared_ptr<Material> material = {});
+
+	private:
+		struct Command
+		{
+			uint32_t materialIdx;
+			bool standardQuadsOnly;
+			std::optional<Rect4i> clip;
+			size_t vertexOffset;
+			size_t numVertices;
+			size_t indexOffset;
+			size_t numIndices;
+		};
+
+		Camera camera;
+		Rect4i viewPort;
+		std::optional<Rect4i> clip;
+		std::shared_ptr<Material> solidLineMaterial;
+		std::shared_ptr<Material> solidPolygonMaterial;
+
+		Vector<Command> commands;
+		Vector<std::shared_ptr<Material>> materials;
+		Vector<char> vertices;
+		Vector<IndexType> indices;
+
+		Vector<Painter::LineVertex> lineVertices;
+		Vector<IndexType> polygonIndices;
+
+		Painter::PainterVertexData addDrawData(const std::shared_ptr<Material>& material, size_t numVertices, size_t numIndices, bool standardQuadsOnly);
+	};
+}
@@ -11,6 +11,10 @@ namespace Halley
 		friend class Core;
 
 	public:
+		RenderContext(Painter& painter, const Camera& camera, RenderTarget& renderTarget);
+		RenderContext(const RenderContext& context) noexcept;
+		RenderContext(RenderContext&& context) noexcept;
+
 		void bind(const std::function<void(Painter&)>& f)
 		{
 			pushContext();
@@ -20,9 +24,6 @@ namespace Halley
 			popContext();
 		}
 
-		RenderContext(const RenderContext& context) noexcept;
-		RenderContext(RenderContext&& context) noexcept;
-
 		RenderContext with(const Camera& camera) const;
 		RenderContext with(RenderTarget& defaultRenderTarget) const;
 		const Camera& getCamera() const { return camera; }
@@ -38,7 +39,6 @@ namespace Halley
 
 		RenderContext* restore = nullptr;
 
-		RenderContext(Painter& painter, const Camera& camera, RenderTarget& renderTarget);
 		void setActive();
 		void setInactive();
 		void pushContext();
@@ -6,6 +6,7 @@
 #include "render_graph_definition.h"
 #include "render_graph_pin_type.h"
 #include "halley/core/graphics/texture_descriptor.h"
+#include "halley/data_structures/frame_allocator.h"
 
 namespace Halley {
 	class Material;
@@ -51,8 +52,8 @@ namespace Halley {
 		void prepareInputPin(InputPin& pin, VideoAPI& video, Vector2i targetSize);
 		void allocateVideoResources(VideoAPI& video);
 		
-		void render(const RenderGraph& graph, const RenderContext& rc, std::vector<RenderGraphNode*>& renderQueue);
-		void notifyOutputs(std::vector<RenderGraphNode*>& renderQueue);
+		void render(const RenderGraph& graph, const RenderContext& rc, FrameVector<RenderGraphNode*>& renderQueue);
+		void notifyOutputs(FrameVector<RenderGraphNode*>& renderQueue);
 
 		void resetTextures();
 		int8_t makeTexture(VideoAPI& video, RenderGraphPinType type);
@@ -4,24 +4,34 @@
 #include <halley/time/halleytime.h>
 
 #include "animation_player.h"
+#include "halley/data_structures/vector.h"
 
 namespace Halley {
 	class Random;
 	class Animation;
 	
 	class Particles {
-		struct Particle {
-			Vector2f pos;
-			Vector2f vel;
-			Angle1f angle;
-			float scale = 1;
-			float time = 0;
-			float ttl = 1;
-			bool alive = true;
+		// Stored as one array per field, so the update can process several particles at a time
+		// Sizes are always a multiple of 4, and the values past the live particles are ignored
+		struct ParticleData {
+			Vector<float> posX;
+			Vector<float> posY;
+			Vector<float> velX;
+			Vector<float> velY;
+			Vector<float> time;
+			Vector<float> ttl;
+			Vector<float> invTtl;
+			Vector<float> scale;
+			Vector<float> alpha;
+
+			size_t size() const;
+			void resize(size_t size);
+			void swap(size_t a, size_t b);
 		};
 		
 	public:
 		Particles();
+		explicit Particles(const ConfigNode& node);
 		Particles(const ConfigNode& node, Resources& resources);
 
 		ConfigNode toConfigNode() const;
@@ -43,6 +53,7 @@ namespace Halley {
 
 		bool isAnimated() const;
 		bool isAlive() const;
+		size_t getNumParticles() const;
 		
 		[[nodiscard]] gsl::span<Sprite> getSprites();
 		[[nodiscard]] gsl::span<const Sprite> getSprites() const;
@@ -55,8 +66,10 @@ namespace Halley {
 		bool firstUpdate = true;
 		float spawnRateMultiplier = 1.0f;
 
-		std::vector<Sprite> sprites;
-		std::vector<Particle> particles;
+		// Sprites are only brought up to date with the simulation when they're requested
+		mutable std::vector<Sprite> sprites;
+		mutable bool spritesDirty = false;
+		ParticleData particles;
 		std::vector<AnimationPlayerLite> animationPlayers;
 		
 		size_t nParticlesAlive = 0;
@@ -91,6 +104,8 @@ namespace Halley {
 		void spawn(size_t n);
 		void initializeParticle(size_t index);
 		void updateParticles(float t);
+		void updateParticleRange(size_t start, size_t end, float t);
+		void updateSprites() const;
 
 		Vector2f getSpawnPosition() const;
 	};
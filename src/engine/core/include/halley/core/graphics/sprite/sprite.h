@@ -17,6 +17,7 @@ namespace Halley
 	class Texture;
 	class MaterialDefinition;
 	class Painter;
+	class PainterCommandList;
 
 	struct SpriteVertexAttrib
 	{
@@ -56,6 +57,11 @@ namespace Halley
 		static void draw(gsl::span<const Sprite> sprites, Painter& painter);
 		static void drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painter);
 
+		// Record into a command list instead, e.g. from a worker thread
+		void draw(PainterCommandList& commands, const std::optional<Rect4f>& extClip = {}) const;
+		static void draw(gsl::span<const Sprite> sprites, PainterCommandList& commands);
+		static void drawMixedMaterials(const Sprite* sprites, size_t n, PainterCommandList& commands);
+
 		Sprite& setMaterial(Resources& resources, String materialName = "");
 		Sprite& setMaterial(std::shared_ptr<Material> m, bool shared = true);
 		Sprite& setMaterial(std::unique_ptr<Material> m);
@@ -67,6 +73,11 @@ namespace Halley
 			return *material;
 		}
 		bool hasMaterial() const { return material != nullptr; }
+		const std::shared_ptr<Material>& getMaterialPtr() const { return material; }
+		const SpriteVertexAttrib& getVertexAttrib() const { return vertexAttrib; }
+
+		// True if this sprite is drawn as a single unclipped quad, and can therefore be batched with other sprites sharing its material
+		bool isBatchable() const { return material && !sliced && !hasClip; }
 		bool hasCompatibleMaterial(const Material& other) const;
 
 		Sprite& setImage(Resources& resources, const String& imageName, String materialName = "");
@@ -181,7 +192,12 @@ namespace Halley
 		void doSetSprite(const SpriteSheetEntry& entry, bool applyPivot);
 		void computeSize();
 
-		template<typename F> void paintWithClip(Painter& painter, const std::optional<Rect4f>& clip, F f) const;
+		template<typename P, typename F> void paintWithClip(P& painter, const std::optional<Rect4f>& clip, F f) const;
+		template<typename P> void doDraw(P& painter, const std::optional<Rect4f>& extClip) const;
+		template<typename P> void doDrawNormal(P& painter, const std::optional<Rect4f>& extClip) const;
+		template<typename P> void doDrawSliced(P& painter, Vector4s slices, const std::optional<Rect4f>& extClip) const;
+		template<typename P> static void doDrawSprites(gsl::span<const Sprite> sprites, P& painter);
+		template<typename P> static void doDrawMixedMaterials(const Sprite* sprites, size_t n, P& painter);
 
 #ifdef ENABLE_HOT_RELOAD
 	public:
@@ -5,6 +5,8 @@
 #include "halley/maths/rect.h"
 #include <limits>
 #include <optional>
+#include <memory>
+#include "sprite.h"
 
 namespace Halley
 {
@@ -12,6 +14,7 @@ namespace Halley
 	class String;
 	class Sprite;
 	class Painter;
+	class Material;
 
 	enum class SpritePainterEntryType
 	{
@@ -32,12 +35,15 @@ namespace Halley
 		SpritePainterEntry(SpritePainterEntryType type, size_t spriteIdx, size_t count, int mask, int layer, float tieBreaker, size_t insertOrder, std::optional<Rect4f> clip);
 
 		bool operator<(const SpritePainterEntry& o) const;
+		uint64_t getSortKey() const;
 		SpritePainterEntryType getType() const;
 		gsl::span<const Sprite> getSprites() const;
 		gsl::span<const TextRenderer> getTexts() const;
 		uint32_t getIndex() const;
 		uint32_t getCount() const;
 		int getMask() const;
+		int getLayer() const;
+		float getTieBreaker() const;
 		const std::optional<Rect4f>& getClip() const;
 
 	private:
@@ -68,15 +74,52 @@ namespace Halley
 		
 		void draw(int mask, Painter& painter);
 
+		// Groups entries on the same layer by material, ignoring their tie breakers and the order they were added in, so they
+		// can be drawn in fewer batches. Only suitable when the order of entries within a layer doesn't matter.
+		// Text and callbacks are drawn after the sprites on their layer, in their usual order.
+		void setReorderWithinLayer(bool enabled);
+
 	private:
+		struct SortItem {
+			uint64_t key;
+			uint32_t entryIdx;
+
+			bool operator==(const SortItem& other) const { return key == other.key && entryIdx == other.entryIdx; }
+			bool operator!=(const SortItem& other) const { return !(*this == other); }
+		};
+
+		// The order of the last draw with a given mask. Most frames submit the same entries with the same keys as the
+		// previous one, in which case sorting can be skipped altogether.
+		struct SortCache {
+			int mask = 0;
+			Vector<SortItem> candidates;
+			Vector<SortItem> sorted;
+		};
+
 		Vector<SpritePainterEntry> sprites;
 		Vector<Sprite> cachedSprites;
 		Vector<TextRenderer> cachedText;
 		Vector<SpritePainterEntry::Callback> callbacks;
-		bool dirty = false;
 
-		void draw(gsl::span<const Sprite> sprite, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
-		void draw(gsl::span<const TextRenderer> text, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
-		void draw(const SpritePainterEntry::Callback& callback, Painter& painter, const std::optional<Rect4f>& clip) const;
+		Vector<SortItem> candidates;
+		Vector<SortItem> sortScratch;
+		Vector<SortCache> sortCaches;
+
+		Vector<SpriteVertexAttrib> batchVertices;
+		std::shared_ptr<Material> batchMaterial;
+
+		bool reorderWithinLayer = false;
+
+		const Vector<SortItem>& getSortedEntries(int mask, Rect4f view);
+		void gatherCandidates(int mask, Rect4f view);
+		uint64_t getSortKey(const SpritePainterEntry& entry) const;
+		static void radixSort(Vector<SortItem>& items, Vector<SortItem>& scratch);
+
+		void draw(gsl::span<const Sprite> sprite, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip);
+		void draw(gsl::span<const TextRenderer> text, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip);
+		void draw(const SpritePainterEntry::Callback& callback, Painter& painter, const std::optional<Rect4f>& clip);
+
+		void addToBatch(const Sprite& sprite, Painter& painter);
+		void flushBatch(Painter& painter);
 	};
 }
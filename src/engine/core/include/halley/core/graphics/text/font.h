@@ -61,6 +61,7 @@ namespace Halley
 		void addGlyph(const Glyph& glyph);
 
 		std::shared_ptr<Material> getMaterial() const;
+		void setMaterial(std::shared_ptr<Material> material);
 
 		void serialize(Serializer& deserializer) const;
 		void deserialize(Deserializer& deserializer);
@@ -14,6 +14,7 @@ namespace Halley
 {
 	class LocalisedString;
 	class Painter;
+	class PainterCommandList;
 	class Material;
 
 	using ColourOverride = std::pair<size_t, std::optional<Colour4f>>;
@@ -48,6 +49,7 @@ namespace Halley
 
 		void generateSprites(std::vector<Sprite>& sprites) const;
 		void draw(Painter& painter, const std::optional<Rect4f>& extClip = {}) const;
+		void draw(PainterCommandList& commands, const std::optional<Rect4f>& extClip = {}) const;
 
 		void setSpriteFilter(SpriteFilter f);
 
@@ -96,7 +98,18 @@ namespace Halley
 
 		std::vector<ColourOverride> colourOverrides;
 
+		struct GlyphRun {
+			std::shared_ptr<Material> material;
+			size_t start;
+			size_t count;
+		};
+
+		// Glyphs are laid out relative to the text position, so moving the text doesn't need them laid out again
 		mutable Vector<Sprite> spritesCache;
+		mutable Vector<Vector2f> glyphOffsets;
+		mutable Vector<SpriteVertexAttrib> verticesCache;
+		mutable Vector<GlyphRun> glyphRuns;
+		mutable Vector<Sprite> filteredSprites;
 		mutable bool materialDirty = true;
 		mutable bool glyphsDirty = true;
 		mutable bool positionDirty = true;
@@ -105,7 +118,11 @@ namespace Halley
 		void updateMaterial(Material& material, const Font& font) const;
 		void updateMaterialForFont(const Font& font) const;
 		void updateMaterials() const;
+		void updateCache() const;
+		void layoutGlyphs() const;
 		float getScale(const Font& font) const;
+
+		template <typename P> void doDraw(P& painter, const std::optional<Rect4f>& extClip) const;
 	};
 
 	class ColourStringBuilder {
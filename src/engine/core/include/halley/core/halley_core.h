@@ -14,6 +14,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 
 #include "graphics/blend.h"
 #include "graphics/painter.h"
+#include "graphics/painter_command_list.h"
 #include "graphics/render_context.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
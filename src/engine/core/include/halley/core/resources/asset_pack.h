@@ -3,7 +3,10 @@
 #include "halley/text/halleystring.h"
 #include <memory>
 #include <gsl/span>
+#include <deque>
 #include "halley/resources/resource_data.h"
+#include "halley/bytes/block_compression.h"
+#include "halley/text/string_converter.h"
 
 namespace Halley {
 	enum class AssetType;
@@ -12,6 +15,7 @@ namespace Halley {
 	class AssetDatabase;
 	class ResourceData;
 	class ResourceDataReader;
+	class MemoryMappedFile;
 
 	struct AssetPackHeader {
 		std::array<char, 8> identifier;
@@ -22,12 +26,47 @@ namespace Halley {
 		void init(size_t assetDbSize);
 	};
 
+	enum class AssetPackCompression {
+		None,
+		LZ			// BlockCompression, so streams can decompress one block at a time
+	};
+
+	template <>
+	struct EnumNames<AssetPackCompression> {
+		constexpr std::array<const char*, 2> operator()() const {
+			return{{
+				"none",
+				"lz"
+			}};
+		}
+	};
+
+	enum class AssetPackMode {
+		Reader,			// Assets are read from the pack's reader on demand
+		Memory,			// The whole pack has been read into memory
+		MemoryMapped	// The pack file is mapped into memory, and assets are views into the mapping
+	};
+
+	struct AssetPackStats {
+		AssetPackMode mode = AssetPackMode::Reader;
+		size_t dataSize = 0;
+		size_t memoryBudget = 0;
+		size_t budgetedBytes = 0;	// Mapped bytes served and not yet released, when there's a budget
+		uint64_t staticLoads = 0;
+		uint64_t streamLoads = 0;
+		uint64_t bytesCopied = 0;	// Read out of the pack into new buffers
+		uint64_t bytesViewed = 0;	// Served as views into pack memory, without copying
+		uint64_t bytesDecompressed = 0;	// Produced by decompressing compressed assets
+		uint64_t releases = 0;		// Ranges released back to the OS to stay within budget
+	};
+
     class AssetPack {
     public:
 		AssetPack();
 		AssetPack(const AssetPack& other) = delete;
 		AssetPack(AssetPack&& other) noexcept;
 		AssetPack(std::unique_ptr<ResourceDataReader> reader, const String& encryptionKey = "", bool preLoad = false);
+		AssetPack(std::unique_ptr<MemoryMappedFile> file, const String& encryptionKey = "");
 		~AssetPack();
 
 		AssetPack& operator=(const AssetPack& other) = delete;
@@ -40,6 +79,9 @@ namespace Halley {
 
 		Bytes writeOut() const;
 
+		// Entry paths are "pos:size" for assets stored as is, or "pos:size:compression:rawSize"
+		static String makeEntryPath(size_t pos, size_t size, AssetPackCompression compression = AssetPackCompression::None, size_t rawSize = 0);
+
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream);
 
 		void readToMemory();
@@ -50,14 +92,52 @@ namespace Halley {
 
 		std::unique_ptr<ResourceDataReader> extractReader();
 
+		AssetPackMode getMode() const;
+
+		// Only applies to memory mapped packs: once the assets served add up to more than this, the pages of the oldest
+		// ones are released back to the OS (they're paged back in from the file if touched again). 0 means no limit.
+		void setMemoryBudget(size_t bytes);
+		AssetPackStats getStats() const;
+
     private:
+		friend class CompressedPackDataReader;
+
+		struct EntryLocation {
+			size_t pos = 0;
+			size_t size = 0;
+			AssetPackCompression compression = AssetPackCompression::None;
+			size_t rawSize = 0;
+		};
+
 		std::unique_ptr<AssetDatabase> assetDb;
 		std::unique_ptr<ResourceDataReader> reader;
 		std::atomic<bool> hasReader;
-		std::mutex readerMutex;
+		mutable std::mutex readerMutex;
 		size_t dataOffset = 0;
 		Bytes data;
+		std::shared_ptr<MemoryMappedFile> mappedFile; // Shared with the views handed out, so it stays mapped while they're alive
+		gsl::span<const gsl::byte> mappedData;
 		std::array<char, 16> iv;
+
+		std::atomic<uint64_t> staticLoads = 0;
+		std::atomic<uint64_t> streamLoads = 0;
+		std::atomic<uint64_t> bytesCopied = 0;
+		std::atomic<uint64_t> bytesViewed = 0;
+		std::atomic<uint64_t> bytesDecompressed = 0;
+		std::atomic<size_t> memoryBudget = 0;
+
+		mutable std::mutex budgetMutex;
+		std::deque<std::pair<size_t, size_t>> budgetedRanges;
+		size_t budgetedBytes = 0;
+		uint64_t releases = 0;
+
+		void readHeader(const AssetPackHeader& header, size_t totalSize);
+		void loadAssetDatabase(gsl::span<const gsl::byte> assetDbBytes);
+		bool hasEncryption(const String& encryptionKey) const;
+		void onMappedRangeUsed(size_t pos, size_t size);
+		EntryLocation getEntryLocation(const String& asset, AssetType type) const;
+		gsl::span<const gsl::byte> getView(size_t pos, size_t size) const;
+		std::unique_ptr<ResourceData> getCompressedData(const String& asset, const EntryLocation& entry);
     };
 
 
@@ -78,4 +158,29 @@ namespace Halley {
 		size_t curPos = 0;
 		mutable std::mutex mutex;
 	};
+
+	// Streams a block compressed asset, decompressing one block at a time as it's read
+	class CompressedPackDataReader final : public ResourceDataReader {
+	public:
+		CompressedPackDataReader(AssetPack& pack, size_t startPos, size_t compressedSize);
+
+		size_t size() const override;
+		int read(gsl::span<gsl::byte> dst) override;
+		void seek(int64_t pos, int whence) override;
+		size_t tell() const override;
+		void close() override;
+
+	private:
+		AssetPack& pack;
+		const size_t startPos;
+		const size_t compressedSize;
+		BlockCompression::Index index;
+		size_t curPos = 0;
+		size_t curBlock = std::numeric_limits<size_t>::max();
+		Bytes compressedBlock;
+		Bytes block;
+		mutable std::mutex mutex;
+
+		void loadBlock(size_t blockIdx);
+	};
 }
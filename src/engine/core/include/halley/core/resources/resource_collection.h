@@ -4,6 +4,7 @@
 #include <memory>
 #include <functional>
 #include <halley/text/halleystring.h>
+#include <halley/text/string_id.h>
 #include <halley/resources/resource_data.h>
 #include <halley/data_structures/hash_map.h>
 
@@ -45,27 +46,27 @@ namespace Halley
 		void setResourceEnumerator(ResourceEnumeratorFunc enumerator);
 
 		void clear();
-		void unload(const String& assetId);
+		void unload(StringId assetId);
 		void unloadAll(int minDepth = 0);
-		bool exists(const String& assetId) const;
+		bool exists(StringId assetId) const;
 		void setFallback(const String& assetId);
 
 		void reload(const String& assetId);
 		void purge(const String& assetId);
 
-		std::shared_ptr<Resource> getUntyped(const String& name, ResourceLoadPriority priority = ResourceLoadPriority::Normal);
+		std::shared_ptr<Resource> getUntyped(StringId name, ResourceLoadPriority priority = ResourceLoadPriority::Normal);
 
 		std::vector<String> enumerate() const;
 
 	protected:
 		virtual std::shared_ptr<Resource> loadResource(ResourceLoader& loader) = 0;
 
-		std::shared_ptr<Resource> doGet(const String& name, ResourceLoadPriority priority, bool allowFallback);
+		std::shared_ptr<Resource> doGet(StringId name, ResourceLoadPriority priority, bool allowFallback);
 		std::pair<std::shared_ptr<Resource>, bool> loadAsset(const String& assetId, ResourceLoadPriority priority, bool allowFallback);
 
 	private:
 		Resources& parent;
-		HashMap<String, Wrapper> resources;
+		HashMap<StringId, Wrapper> resources;
 		String fallback;
 		AssetType type;
 		ResourceLoaderFunc resourceLoader;
@@ -82,7 +83,7 @@ namespace Halley
 			: ResourceCollectionBase(parent, type)
 		{}
 
-		std::shared_ptr<const T> get(const String& assetId, ResourceLoadPriority priority = ResourceLoadPriority::Normal)
+		std::shared_ptr<const T> get(StringId assetId, ResourceLoadPriority priority = ResourceLoadPriority::Normal)
 		{
 			return std::static_pointer_cast<T>(doGet(assetId, priority, true));
 		}
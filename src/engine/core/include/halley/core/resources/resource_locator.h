@@ -33,6 +33,8 @@ namespace Halley {
 	class ResourceData;
 	class SystemAPI;
 	class AssetDatabase;
+	class PackResourceLocator;
+	struct AssetPackStats;
 
 	class IResourceLocatorProvider {
 	public:
@@ -52,6 +54,14 @@ namespace Halley {
 		std::vector<String> getAssetsFromPack(const Path& path, const String& encryptionKey = "") const;
 		void removePack(const Path& path);
 
+		// When enabled, packs that aren't preloaded are memory mapped where the platform supports it (off by default)
+		// Only enable it if pack files are never modified in place while the game runs, as that would change mapped memory under it.
+		void setMemoryMapPacks(bool enabled);
+
+		// Per pack limit on memory mapped asset data kept resident, see AssetPack::setMemoryBudget; 0 means no limit
+		void setPackMemoryBudget(size_t bytes);
+		HashMap<String, AssetPackStats> getPackStats() const;
+
 		const Metadata* getMetaData(const String& resource, AssetType type) const override;
 
 		std::unique_ptr<ResourceDataStatic> getStatic(const String& asset, AssetType type, bool throwOnFail) override;
@@ -69,6 +79,9 @@ namespace Halley {
 		SystemAPI& system;
 		HashMap<String, IResourceLocatorProvider*> locatorPaths;
 		HashMap<String, IResourceLocatorProvider*> assetToLocator;
+		HashMap<String, PackResourceLocator*> packLocators;
+		bool memoryMapPacks = false;
+		size_t packMemoryBudget = 0;
 		Vector<std::unique_ptr<IResourceLocatorProvider>> locators;
 
 		void add(std::unique_ptr<IResourceLocatorProvider> locator, const Path& path);
@@ -70,13 +70,13 @@ namespace Halley {
 		}
 
 		template <typename T>
-		std::shared_ptr<const T> get(const String& name, ResourceLoadPriority priority = ResourceLoadPriority::Normal) const
+		std::shared_ptr<const T> get(StringId name, ResourceLoadPriority priority = ResourceLoadPriority::Normal) const
 		{
 			return of<T>().get(name, priority);
 		}
 
 		template <typename T>
-		void unload(const String& name) const
+		void unload(StringId name) const
 		{
 			of<T>().unload(name);
 		}
@@ -94,7 +94,7 @@ namespace Halley {
 		}
 
 		template <typename T>
-		[[nodiscard]] bool exists(const String& name) const
+		[[nodiscard]] bool exists(StringId name) const
 		{
 			return of<T>().exists(name);
 		}
@@ -2,6 +2,7 @@
 #include "halley/net/connection/network_service.h"
 #include "halley/net/connection/message_queue_tcp.h"
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
 #include "halley/core/api/halley_api.h"
 #include "halley/net/connection/message_queue.h"
 #include "devcon/devcon_messages.h"
@@ -41,10 +42,22 @@ void DevConClient::update()
 			onReceiveReloadAssets(dynamic_cast<DevCon::ReloadAssetsMsg&>(msg));
 			break;
 
+		case DevCon::MessageType::ProfileCaptureRequest:
+			onReceiveProfileCaptureRequest(dynamic_cast<DevCon::ProfileCaptureRequestMsg&>(msg));
+			break;
+
 		default:
 			break;
 		}
 	}
+
+	if (pendingProfileCapture && Profiler::getFrameNumber() >= pendingProfileCapture->first) {
+		const int numFrames = pendingProfileCapture->second;
+		pendingProfileCapture.reset();
+		if (queue->isConnected()) {
+			sendProfileCapture(numFrames);
+		}
+	}
 }
 
 void DevConClient::onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg)
@@ -52,6 +65,31 @@ void DevConClient::onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg)
 	resources.reloadAssets(msg.getIds());
 }
 
+void DevConClient::onReceiveProfileCaptureRequest(const DevCon::ProfileCaptureRequestMsg& msg)
+{
+	// If it wasn't recording, the frames have to happen first
+	const int numFrames = std::max(1, msg.getNumFrames());
+	const auto frame = Profiler::getFrameNumber();
+	if (Profiler::isEnabled()) {
+		pendingProfileCapture = std::make_pair(frame, numFrames);
+	} else {
+		Profiler::setEnabled(true);
+		pendingProfileCapture = std::make_pair(frame + numFrames + 1, numFrames);
+	}
+}
+
+void DevConClient::sendProfileCapture(int numFrames)
+{
+	const auto trace = Profiler::capture(size_t(numFrames)).toChromeTrace();
+	const auto& str = trace.cppStr();
+	const size_t chunkSize = DevCon::ProfileCaptureMsg::maxChunkSize;
+	for (size_t pos = 0; pos < str.size(); pos += chunkSize) {
+		const bool last = pos + chunkSize >= str.size();
+		queue->enqueue(std::make_unique<DevCon::ProfileCaptureMsg>(String(str.substr(pos, chunkSize)), last), 0);
+	}
+	queue->sendAll();
+}
+
 void DevConClient::connect()
 {
 	queue = std::make_shared<MessageQueueTCP>(service->connect(address, port));
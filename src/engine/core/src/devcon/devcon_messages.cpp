@@ -12,6 +12,8 @@ void DevCon::setupMessageQueue(MessageQueue& queue)
 
 	queue.addFactory<LogMsg>();
 	queue.addFactory<ReloadAssetsMsg>();
+	queue.addFactory<ProfileCaptureRequestMsg>();
+	queue.addFactory<ProfileCaptureMsg>();
 }
 
 LogMsg::LogMsg(gsl::span<const gsl::byte> data)
@@ -72,3 +74,63 @@ MessageType ReloadAssetsMsg::getMessageType() const
 {
 	return MessageType::ReloadAssets;
 }
+
+
+ProfileCaptureRequestMsg::ProfileCaptureRequestMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> numFrames;
+}
+
+ProfileCaptureRequestMsg::ProfileCaptureRequestMsg(int numFrames)
+	: numFrames(numFrames)
+{}
+
+void ProfileCaptureRequestMsg::serialize(Serializer& s) const
+{
+	s << numFrames;
+}
+
+int ProfileCaptureRequestMsg::getNumFrames() const
+{
+	return numFrames;
+}
+
+MessageType ProfileCaptureRequestMsg::getMessageType() const
+{
+	return MessageType::ProfileCaptureRequest;
+}
+
+
+ProfileCaptureMsg::ProfileCaptureMsg(gsl::span<const gsl::byte> data)
+{
+	Deserializer s(data);
+	s >> chunk;
+	s >> last;
+}
+
+ProfileCaptureMsg::ProfileCaptureMsg(String chunk, bool last)
+	: chunk(std::move(chunk))
+	, last(last)
+{}
+
+void ProfileCaptureMsg::serialize(Serializer& s) const
+{
+	s << chunk;
+	s << last;
+}
+
+const String& ProfileCaptureMsg::getChunk() const
+{
+	return chunk;
+}
+
+bool ProfileCaptureMsg::isLast() const
+{
+	return last;
+}
+
+MessageType ProfileCaptureMsg::getMessageType() const
+{
+	return MessageType::ProfileCapture;
+}
@@ -25,6 +25,10 @@ void DevConServerConnection::update()
 			onReceiveLogMsg(dynamic_cast<DevCon::LogMsg&>(msg));
 			break;
 
+		case DevCon::MessageType::ProfileCapture:
+			onReceiveProfileCaptureMsg(dynamic_cast<DevCon::ProfileCaptureMsg&>(msg));
+			break;
+
 		case DevCon::MessageType::ReloadAssets:
 			// TODO;
 
@@ -40,11 +44,33 @@ void DevConServerConnection::reloadAssets(const std::vector<String>& ids)
 	queue->sendAll();
 }
 
+void DevConServerConnection::requestProfileCapture(int numFrames)
+{
+	queue->enqueue(std::make_unique<DevCon::ProfileCaptureRequestMsg>(numFrames), 0);
+	queue->sendAll();
+}
+
+std::optional<String> DevConServerConnection::takeProfileCapture()
+{
+	auto result = std::move(profileCapture);
+	profileCapture.reset();
+	return result;
+}
+
 void DevConServerConnection::onReceiveLogMsg(const DevCon::LogMsg& msg)
 {
 	Logger::log(msg.getLevel(), "[REMOTE] " + msg.getMessage());
 }
 
+void DevConServerConnection::onReceiveProfileCaptureMsg(const DevCon::ProfileCaptureMsg& msg)
+{
+	profileCaptureBuffer += msg.getChunk();
+	if (msg.isLast()) {
+		profileCapture = std::move(profileCaptureBuffer);
+		profileCaptureBuffer = String();
+	}
+}
+
 DevConServer::DevConServer(std::unique_ptr<NetworkService> s, int port)
 	: service(std::move(s))
 {
@@ -63,6 +89,14 @@ void DevConServer::update()
 
 	for (auto& c: connections) {
 		c->update();
+
+		if (auto capture = c->takeProfileCapture()) {
+			if (profileCaptureCallback) {
+				profileCaptureCallback(capture.value());
+			} else {
+				Logger::logWarning("Received a profile capture, but nothing is set to receive it.");
+			}
+		}
 	}
 }
 
@@ -72,3 +106,15 @@ void DevConServer::reloadAssets(const std::vector<String>& ids)
 		c->reloadAssets(ids);
 	}
 }
+
+void DevConServer::requestProfileCapture(int numFrames)
+{
+	for (auto& c: connections) {
+		c->requestProfileCapture(numFrames);
+	}
+}
+
+void DevConServer::setProfileCaptureCallback(ProfileCaptureCallback callback)
+{
+	profileCaptureCallback = std::move(callback);
+}
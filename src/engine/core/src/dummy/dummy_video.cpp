@@ -2,6 +2,7 @@
 #include <halley/core/graphics/painter.h>
 #include <halley/core/graphics/texture.h>
 #include <halley/core/graphics/shader.h>
+#include <halley/core/graphics/material/material_definition.h>
 #include <halley/core/graphics/render_target/render_target_texture.h>
 #include "dummy_system.h"
 
@@ -112,13 +113,45 @@ void DummyPainter::doStartRender() {}
 
 void DummyPainter::doEndRender() {}
 
-void DummyPainter::setVertices(const MaterialDefinition&, size_t, void*, size_t, unsigned short*, bool) {}
+void DummyPainter::setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly)
+{
+	if (recording) {
+		const auto* vertexBytes = static_cast<const char*>(vertexData);
+		current.material = material.getName();
+		current.vertices.assign(vertexBytes, vertexBytes + numVertices * material.getVertexStride());
+		current.indices.assign(indices, indices + numIndices);
+		current.standardQuadsOnly = standardQuadsOnly;
+	}
+}
 
-void DummyPainter::drawTriangles(size_t) {}
+void DummyPainter::drawTriangles(size_t)
+{
+	if (recording) {
+		recorded.push_back(current);
+	}
+}
 
 void DummyPainter::setViewPort(Rect4i) {}
 
-void DummyPainter::setClip(Rect4i, bool) {}
+void DummyPainter::setClip(Rect4i clip, bool enable)
+{
+	current.clip = enable ? clip : std::optional<Rect4i>();
+}
+
+void DummyPainter::setRecording(bool enabled)
+{
+	recording = enabled;
+}
+
+const Vector<DummyPainter::RecordedDrawCall>& DummyPainter::getRecordedDrawCalls() const
+{
+	return recorded;
+}
+
+void DummyPainter::clearRecordedDrawCalls()
+{
+	recorded.clear();
+}
 
 void DummyPainter::setMaterialData(const Material&) {}
 
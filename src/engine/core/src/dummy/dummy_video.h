@@ -53,7 +53,22 @@ namespace Halley {
 	class DummyPainter : public Painter
 	{
 	public:
+		// When recording is enabled, every draw call that reaches the backend is stored, so output can be inspected without a GPU
+		struct RecordedDrawCall
+		{
+			String material;
+			Vector<char> vertices;
+			Vector<IndexType> indices;
+			std::optional<Rect4i> clip;
+			bool standardQuadsOnly = false;
+		};
+
 		explicit DummyPainter(Resources& resources);
+
+		void setRecording(bool enabled);
+		const Vector<RecordedDrawCall>& getRecordedDrawCalls() const;
+		void clearRecordedDrawCalls();
+
 		void clear(std::optional<Colour> colour, std::optional<float> depth, std::optional<uint8_t> stencil) override;
 		void setMaterialPass(const Material& material, int pass) override;
 		void doStartRender() override;
@@ -64,5 +79,10 @@ namespace Halley {
 		void setClip(Rect4i clip, bool enable) override;
 		void setMaterialData(const Material& material) override;
 		void onUpdateProjection(Material& material) override;
+
+	private:
+		bool recording = false;
+		RecordedDrawCall current;
+		Vector<RecordedDrawCall> recorded;
 	};
 }
@@ -13,6 +13,8 @@
 #include <halley/os/os.h>
 #include <halley/support/debug.h>
 #include <halley/support/console.h>
+#include <halley/support/profiler.h>
+#include <halley/data_structures/frame_allocator.h>
 #include <halley/concurrency/concurrent.h>
 #include <fstream>
 #include <chrono>
@@ -131,6 +133,8 @@ void Core::onReloaded()
 	if (api->system) {
 		api->system->setThreadName("main");
 	}
+	Profiler::setThreadName("main");
+	Profiler::setEnabled(isDevMode());
 
 	if (api->systemInternal) {
 		api->systemInternal->onResume();
@@ -333,6 +337,9 @@ void Core::onFixedUpdate(Time time)
 
 void Core::onVariableUpdate(Time time)
 {
+	Profiler::onFrameStart();
+	FrameArena::onFrameStart();
+
 	if (api->system) {
 		api->systemInternal->onTickMainLoop();
 	}
@@ -349,6 +356,7 @@ void Core::onVariableUpdate(Time time)
 void Core::doFixedUpdate(Time time)
 {
 	HALLEY_DEBUG_TRACE();
+	ProfilerEvent event("Fixed Update");
 	auto& engineTimer = engineTimers[int(TimeLine::FixedUpdate)];
 	auto& gameTimer = gameTimers[int(TimeLine::FixedUpdate)];
 
@@ -371,6 +379,7 @@ void Core::doFixedUpdate(Time time)
 void Core::doVariableUpdate(Time time)
 {
 	HALLEY_DEBUG_TRACE();
+	ProfilerEvent event("Variable Update");
 	auto& engineTimer = engineTimers[int(TimeLine::VariableUpdate)];
 	auto& gameTimer = gameTimers[int(TimeLine::VariableUpdate)];
 
@@ -405,6 +414,7 @@ void Core::doVariableUpdate(Time time)
 void Core::doRender(Time)
 {
 	HALLEY_DEBUG_TRACE();
+	ProfilerEvent event("Render");
 	auto& engineTimer = engineTimers[int(TimeLine::Render)];
 	auto& gameTimer = gameTimers[int(TimeLine::Render)];
 	bool gameSampled = false;
@@ -442,7 +452,10 @@ void Core::doRender(Time)
 
 		engineTimer.pause();
 		vsyncTimer.beginSample();
-		api->video->finishRender();
+		{
+			ProfilerEvent vsyncEvent("Vsync");
+			api->video->finishRender();
+		}
 		vsyncTimer.endSample();
 		engineTimer.resume();
 	}
@@ -299,7 +299,9 @@ bool Material::setUniform(int blockNumber, size_t offset, ShaderParameterType ty
 uint64_t Material::computeHash() const
 {
 	Hash::Hasher hasher;
-	
+
+	hasher.feed(materialDefinition.get());
+
 	for (const auto& texture: textures) {
 		hasher.feed(texture.get());
 	}
@@ -371,7 +373,10 @@ MaterialDepthStencil Material::getDepthStencil(int pass) const
 
 void Material::setStencilReferenceOverride(std::optional<uint8_t> reference)
 {
-	stencilReferenceOverride = reference;
+	if (stencilReferenceOverride != reference) {
+		stencilReferenceOverride = reference;
+		needToUpdateHash = true;
+	}
 }
 
 std::optional<uint8_t> Material::getStencilReferenceOverride() const
@@ -384,11 +389,10 @@ const Vector<MaterialTextureParameter>& Material::getTextureUniforms() const
 	return textureUniforms;
 }
 
-Material& Material::set(const String& name, const std::shared_ptr<const Texture>& texture)
+Material& Material::set(StringId name, const std::shared_ptr<const Texture>& texture)
 {
-	auto& texs = materialDefinition->getTextures();
-	for (size_t i = 0; i < texs.size(); ++i) {
-		if (texs[i].name == name) {
+	for (size_t i = 0; i < textureUniforms.size(); ++i) {
+		if (textureUniforms[i].getId() == name) {
 			const auto textureUnit = i;
 			if (textures[textureUnit] != texture) {
 				textures[textureUnit] = texture;
@@ -398,18 +402,18 @@ Material& Material::set(const String& name, const std::shared_ptr<const Texture>
 		}
 	}
 
-	throw Exception("Texture sampler \"" + name + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
+	throw Exception("Texture sampler \"" + name.getString() + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
 }
 
-Material& Material::set(const String& name, const std::shared_ptr<Texture>& texture)
+Material& Material::set(StringId name, const std::shared_ptr<Texture>& texture)
 {
 	return set(name, std::shared_ptr<const Texture>(texture));
 }
 
-bool Material::hasParameter(const String& name) const
+bool Material::hasParameter(StringId name) const
 {
 	for (auto& u: uniforms) {
-		if (u.name == name) {
+		if (u.id == name) {
 			return true;
 		}
 	}
@@ -425,15 +429,15 @@ uint64_t Material::getHash() const
 	return hashValue;
 }
 
-MaterialParameter& Material::getParameter(const String& name)
+MaterialParameter& Material::getParameter(StringId name)
 {
 	for (auto& u : uniforms) {
-		if (u.name == name) {
+		if (u.id == name) {
 			return u;
 		}
 	}
 
-	throw Exception("Uniform \"" + name + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
+	throw Exception("Uniform \"" + name.getString() + "\" not available in material \"" + materialDefinition->getName() + "\"", HalleyExceptions::Graphics);
 }
 
 std::shared_ptr<Material> Material::clone() const
@@ -11,6 +11,7 @@ constexpr static int shaderStageCount = int(ShaderType::NumOfShaderTypes);
 
 MaterialTextureParameter::MaterialTextureParameter(Material& material, const String& name, TextureSamplerType samplerType)
 	: name(name)
+	, id(name)
 	, samplerType(samplerType)
 {
 	auto& definition = material.getDefinition();
@@ -31,6 +32,7 @@ unsigned MaterialTextureParameter::getAddress(int pass, ShaderType stage) const
 MaterialParameter::MaterialParameter(Material& material, String name, ShaderParameterType type, int blockNumber, size_t offset)
 	: material(&material)
 	, name(std::move(name))
+	, id(this->name)
 	, offset(offset)
 	, type(type)
 	, blockNumber(blockNumber)
@@ -1,4 +1,5 @@
 #include "halley/core/graphics/painter.h"
+#include "halley/core/graphics/painter_command_list.h"
 
 #include <cassert>
 
@@ -13,18 +14,11 @@
 
 #include "halley/maths/bezier.h"
 #include "halley/maths/polygon.h"
+#include "halley/support/profiler.h"
 #include "resources/resources.h"
 
 using namespace Halley;
 
-struct LineVertex {
-	Vector4f colour;
-	Vector2f position;
-	Vector2f normal;
-	Vector2f width;
-	char _padding[8];
-};
-
 Painter::Painter(Resources& resources)
 	: halleyGlobalMaterial(std::make_unique<Material>(resources.get<MaterialDefinition>("Halley/MaterialBase"), true))
 	, resources(resources)
@@ -43,7 +37,11 @@ void Painter::startRender()
 	prevDrawCalls = nDrawCalls;
 	prevTriangles = nTriangles;
 	prevVertices = nVertices;
+	prevBatches = nBatches;
+	prevMaterialChanges = nMaterialChanges;
+	prevMaxBatchVertices = maxBatchVertices;
 	nDrawCalls = nTriangles = nVertices = 0;
+	nBatches = nMaterialChanges = maxBatchVertices = 0;
 
 	resetPending();
 	doStartRender();
@@ -59,6 +57,7 @@ void Painter::endRender()
 
 void Painter::flush()
 {
+	ProfilerEvent event("Painter Flush");
 	flushPending();
 }
 
@@ -143,11 +142,13 @@ void Painter::drawSprites(const std::shared_ptr<Material>& material, size_t numS
 	Expects(vertexData != nullptr);
 
 	const size_t verticesPerSprite = 4;
-	const size_t numVertices = verticesPerSprite * numSprites;
-	const size_t vertPosOffset = material->getDefinition().getVertexPosOffset();
-
-	const auto result = addDrawData(material, numVertices, numSprites * 6, true);
+	const auto result = addDrawData(material, verticesPerSprite * numSprites, numSprites * 6, true);
+	writeSpriteVertices(result, material->getDefinition().getVertexPosOffset(), numSprites, vertexData);
+}
 
+void Painter::writeSpriteVertices(const PainterVertexData& result, size_t vertPosOffset, size_t numSprites, const void* vertexData)
+{
+	const size_t verticesPerSprite = 4;
 	const char* const src = reinterpret_cast<const char*>(vertexData);
 
 	for (size_t i = 0; i < numSprites; i++) {
@@ -192,9 +193,13 @@ void Painter::drawSlicedSprite(const std::shared_ptr<Material>& material, Vector
 
 	const size_t numVertices = 16;
 	const size_t numIndices = 9 * 6; // 9 quads, 6 indices per quad
-	const size_t vertPosOffset = material->getDefinition().getVertexPosOffset();
-
 	const auto result = addDrawData(material, numVertices, numIndices, false);
+	writeSlicedSpriteVertices(result, material->getDefinition().getVertexPosOffset(), scale, slices, vertexData);
+}
+
+void Painter::writeSlicedSpriteVertices(const PainterVertexData& result, size_t vertPosOffset, Vector2f scale, Vector4f slices, const void* vertexData)
+{
+	const size_t numVertices = 16;
 	const char* const src = static_cast<const char*>(vertexData);
 
 	// Vertices
@@ -232,6 +237,13 @@ void Painter::drawLine(gsl::span<const Vector2f> points, float width, Colour4f c
 		return;
 	}
 
+	Vector<LineVertex> vertices;
+	makeLineVertices(points, width, colour, loop, vertices);
+	drawQuads(material, vertices.size(), vertices.data());
+}
+
+void Painter::makeLineVertices(gsl::span<const Vector2f> points, float width, Colour4f colour, bool loop, Vector<LineVertex>& vertices)
+{
 	const Vector4f col(colour.r, colour.g, colour.b, colour.a);
 
 	constexpr float normalPos[] = { -1, 1, 1, -1 };
@@ -239,7 +251,7 @@ void Painter::drawLine(gsl::span<const Vector2f> points, float width, Colour4f c
 
 	const size_t nPoints = points.size();
 	const size_t nSegments = (loop ? nPoints : (nPoints - 1));
-	std::vector<LineVertex> vertices(nSegments * 4);
+	vertices.resize(nSegments * 4);
 
 	auto segmentNormal = [&] (size_t i) -> std::optional<Vector2f>
 	{
@@ -287,8 +299,6 @@ void Painter::drawLine(gsl::span<const Vector2f> points, float width, Colour4f c
 			normal = nextNormal.value();
 		}
 	}
-
-	drawQuads(material, vertices.size(), vertices.data());
 }
 
 void Painter::drawLine(const BezierQuadratic& bezier, float width, Colour4f colour, std::shared_ptr<Material> material)
@@ -310,12 +320,7 @@ static size_t getSegmentsForArc(float radius, float arcLen)
 
 void Painter::drawCircle(Vector2f centre, float radius, float width, Colour4f colour, std::shared_ptr<Material> material)
 {
-	const size_t n = getSegmentsForArc(radius, 2 * float(pi()));
-	std::vector<Vector2f> points;
-	for (size_t i = 0; i < n; ++i) {
-		points.push_back(centre + Vector2f(radius, 0).rotate(Angle1f::fromRadians(i * 2.0f * float(pi()) / n)));
-	}
-	drawLine(points, width, colour, true, std::move(material));
+	drawLine(makeCirclePoints(centre, radius), width, colour, true, std::move(material));
 }
 
 void Painter::drawCircle(Circle circle, float width, Colour4f colour, std::shared_ptr<Material> material)
@@ -325,13 +330,7 @@ void Painter::drawCircle(Circle circle, float width, Colour4f colour, std::share
 
 void Painter::drawCircleArc(Vector2f centre, float radius, float width, Angle1f from, Angle1f to, Colour4f colour, std::shared_ptr<Material> material)
 {
-	const float arcLen = (to - from).getRadians() + (from.turnSide(to) > 0 ? 0.0f : 0 * float(pi()));
-	const size_t n = getSegmentsForArc(radius, arcLen);
-	std::vector<Vector2f> points;
-	for (size_t i = 0; i < n; ++i) {
-		points.push_back(centre + Vector2f(radius, 0).rotate(from + Angle1f::fromRadians(i * arcLen / (n - 1))));
-	}
-	drawLine(points, width, colour, false, std::move(material));
+	drawLine(makeCircleArcPoints(centre, radius, from, to), width, colour, false, std::move(material));
 }
 
 void Painter::drawCircleArc(Circle circle, float width, Angle1f from, Angle1f to, Colour4f colour, std::shared_ptr<Material> material)
@@ -340,23 +339,54 @@ void Painter::drawCircleArc(Circle circle, float width, Angle1f from, Angle1f to
 }
 
 void Painter::drawEllipse(Vector2f centre, Vector2f radius, float width, Colour4f colour, std::shared_ptr<Material> material)
+{
+	drawLine(makeEllipsePoints(centre, radius), width, colour, true, std::move(material));
+}
+
+void Painter::drawRect(Rect4f rect, float width, Colour4f colour, std::shared_ptr<Material> material)
+{
+	drawLine(makeRectPoints(rect), width, colour, true, std::move(material));
+}
+
+Vector<Vector2f> Painter::makeCirclePoints(Vector2f centre, float radius)
+{
+	const size_t n = getSegmentsForArc(radius, 2 * float(pi()));
+	Vector<Vector2f> points;
+	for (size_t i = 0; i < n; ++i) {
+		points.push_back(centre + Vector2f(radius, 0).rotate(Angle1f::fromRadians(i * 2.0f * float(pi()) / n)));
+	}
+	return points;
+}
+
+Vector<Vector2f> Painter::makeCircleArcPoints(Vector2f centre, float radius, Angle1f from, Angle1f to)
+{
+	const float arcLen = (to - from).getRadians() + (from.turnSide(to) > 0 ? 0.0f : 0 * float(pi()));
+	const size_t n = getSegmentsForArc(radius, arcLen);
+	Vector<Vector2f> points;
+	for (size_t i = 0; i < n; ++i) {
+		points.push_back(centre + Vector2f(radius, 0).rotate(from + Angle1f::fromRadians(i * arcLen / (n - 1))));
+	}
+	return points;
+}
+
+Vector<Vector2f> Painter::makeEllipsePoints(Vector2f centre, Vector2f radius)
 {
 	const size_t n = getSegmentsForArc(std::max(radius.x, radius.y), 2 * float(pi()));
-	std::vector<Vector2f> points;
+	Vector<Vector2f> points;
 	for (size_t i = 0; i < n; ++i) {
 		points.push_back(centre + Vector2f(1.0f, 0).rotate(Angle1f::fromRadians(i * 2.0f * float(pi()) / n)) * radius);
 	}
-	drawLine(points, width, colour, true, std::move(material));
+	return points;
 }
 
-void Painter::drawRect(Rect4f rect, float width, Colour4f colour, std::shared_ptr<Material> material)
+Vector<Vector2f> Painter::makeRectPoints(Rect4f rect)
 {
-	std::vector<Vector2f> points;
+	Vector<Vector2f> points;
 	points.push_back(rect.getTopLeft());
 	points.push_back(rect.getTopRight());
 	points.push_back(rect.getBottomRight());
 	points.push_back(rect.getBottomLeft());
-	drawLine(points, width, colour, true, std::move(material));
+	return points;
 }
 
 void Painter::drawPolygon(const Polygon& polygon, Colour4f colour, std::shared_ptr<Material> material)
@@ -376,25 +406,50 @@ void Painter::drawPolygon(const Polygon& polygon, Colour4f colour, std::shared_p
 		return;
 	}
 
+	Vector<LineVertex> vertices;
+	Vector<IndexType> indices;
+	makePolygonVertices(polygon, colour, vertices, indices);
+	draw(material, vertices.size(), vertices.data(), indices, PrimitiveType::Triangle);
+}
+
+void Painter::makePolygonVertices(const Polygon& polygon, Colour4f colour, Vector<LineVertex>& vertices, Vector<IndexType>& indices)
+{
 	auto col = Vector4f(colour.r, colour.g, colour.b, colour.a);
 	
 	const auto& vs = polygon.getVertices();
 	const auto n = vs.size();
-	std::vector<LineVertex> vertices(n);
+	vertices.resize(n);
 	for (size_t i = 0; i < n; ++i) {
 		vertices[i].position = vs[i];
 		vertices[i].colour = col;
 		vertices[i].normal = Vector2f();
 		vertices[i].width = Vector2f();
 	}
-	std::vector<IndexType> indices((n - 2) * 3);
+	indices.resize((n - 2) * 3);
 	for (size_t i = 0; i < n - 2; ++i) {
-		indices.push_back(0);
-		indices.push_back(static_cast<IndexType>(i) + 1);
-		indices.push_back(static_cast<IndexType>(i) + 2);
+		indices[i * 3] = 0;
+		indices[i * 3 + 1] = static_cast<IndexType>(i) + 1;
+		indices[i * 3 + 2] = static_cast<IndexType>(i) + 2;
 	}
+}
 
-	draw(material, vertices.size(), vertices.data(), indices, PrimitiveType::Triangle);
+void Painter::draw(const PainterCommandList& commands)
+{
+	for (const auto& command: commands.commands) {
+		pendingClip = command.clip;
+
+		const auto result = addDrawData(commands.materials[command.materialIdx], command.numVertices, command.numIndices, command.standardQuadsOnly);
+		memcpy(result.dstVertex, commands.vertices.data() + command.vertexOffset, result.dataSize);
+
+		// Indices were recorded relative to the first vertex of their draw
+		const IndexType* srcIndex = commands.indices.data() + command.indexOffset;
+		for (size_t i = 0; i < command.numIndices; ++i) {
+			result.dstIndex[i] = srcIndex[i] + result.firstIndex;
+		}
+	}
+
+	// Leave the clip as drawing directly would have
+	pendingClip = commands.clip;
 }
 
 void Painter::setLogging(bool logging)
@@ -448,6 +503,11 @@ void Painter::unbind(RenderContext& context)
 }
 
 void Painter::setRelativeClip(Rect4f rect)
+{
+	setClip(makeRelativeClip(camera, viewPort, rect));
+}
+
+Rect4i Painter::makeRelativeClip(const Camera& camera, Rect4i viewPort, Rect4f rect)
 {
 	std::array<Vector2f, 4> ps = {{ rect.getTopLeft(), rect.getTopRight(), rect.getBottomLeft(), rect.getBottomRight() }};
 	float x0 = -std::numeric_limits<float>::infinity();
@@ -461,7 +521,7 @@ void Painter::setRelativeClip(Rect4f rect)
 		y0 = std::max(y0, point.y);
 		y1 = std::min(y1, point.y);
 	}
-	setClip(Rect4i(Vector2i(Vector2f(x0, y0).floor()), Vector2i(Vector2f(x1, y1).ceil())));
+	return Rect4i(Vector2i(Vector2f(x0, y0).floor()), Vector2i(Vector2f(x1, y1).ceil()));
 }
 
 void Painter::setClip(Rect4i rect)
@@ -501,7 +561,11 @@ void Painter::startDrawCall(const std::shared_ptr<Material>& material)
 	constexpr bool enableDynamicBatching = true;
 
 	if (material != materialPending) {
-		if (!enableDynamicBatching || (materialPending != std::shared_ptr<Material>() && !(*material == *materialPending))) {
+		// Different instances with the same state can share a batch; the hash covers the definition too
+		if (!enableDynamicBatching || (materialPending && material->getHash() != materialPending->getHash())) {
+			if (logging && verticesPending > 0) {
+				nMaterialChanges++;
+			}
 			flushPending();
 		}
 		materialPending = material;
@@ -511,6 +575,10 @@ void Painter::startDrawCall(const std::shared_ptr<Material>& material)
 void Painter::flushPending()
 {
 	if (verticesPending > 0) {
+		if (logging) {
+			nBatches++;
+			maxBatchVertices = std::max(maxBatchVertices, verticesPending);
+		}
 		executeDrawPrimitives(*materialPending, verticesPending, vertexBuffer.data(), gsl::span<const IndexType>(indexBuffer.data(), indicesPending));
 	}
 
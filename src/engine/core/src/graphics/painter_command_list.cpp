@@ -0,0 +1,165 @@
+#include "halley/core/graphics/painter_command_list.h"
+#include "halley/core/graphics/material/material.h"
+#include "halley/core/graphics/material/material_definition.h"
+#include "halley/maths/polygon.h"
+#include <cstring>
+#include <gsl/gsl_assert>
+
+using namespace Halley;
+
+PainterCommandList::PainterCommandList(Painter& painter)
+	: camera(painter.getCurrentCamera())
+	, viewPort(painter.getViewPort())
+	, clip(painter.pendingClip)
+	, solidLineMaterial(painter.getSolidLineMaterial())
+	, solidPolygonMaterial(painter.getSolidPolygonMaterial())
+{
+}
+
+void PainterCommandList::clear()
+{
+	commands.clear();
+	materials.clear();
+	vertices.clear();
+	indices.clear();
+}
+
+void PainterCommandList::setRelativeClip(Rect4f rect)
+{
+	setClip(Painter::makeRelativeClip(camera, viewPort, rect));
+}
+
+void PainterCommandList::setClip(Rect4i rect)
+{
+	clip = rect;
+}
+
+void PainterCommandList::setClip()
+{
+	clip = std::optional<Rect4i>();
+}
+
+void PainterCommandList::draw(const std::shared_ptr<Material>& material, size_t numVertices, const void* vertexData, gsl::span<const IndexType> indices, PrimitiveType primitiveType)
+{
+	Expects(primitiveType == PrimitiveType::Triangle);
+	Expects(indices.size() % 3 == 0);
+
+	const auto result = addDrawData(material, numVertices, indices.size(), false);
+	memcpy(result.dstVertex, vertexData, result.dataSize);
+	memcpy(result.dstIndex, indices.data(), indices.size() * sizeof(IndexType));
+}
+
+void PainterCommandList::drawQuads(const std::shared_ptr<Material>& material, size_t numVertices, const void* vertexData)
+{
+	Expects(numVertices % 4 == 0);
+	Expects(vertexData != nullptr);
+
+	const auto result = addDrawData(material, numVertices, numVertices * 3 / 2, true);
+	memcpy(result.dstVertex, vertexData, result.dataSize);
+	Painter::generateQuadIndices(result.firstIndex, numVertices / 4, result.dstIndex);
+}
+
+void PainterCommandList::drawSprites(const std::shared_ptr<Material>& material, size_t numSprites, const void* vertexData)
+{
+	Expects(vertexData != nullptr);
+
+	const auto result = addDrawData(material, 4 * numSprites, numSprites * 6, true);
+	Painter::writeSpriteVertices(result, material->getDefinition().getVertexPosOffset(), numSprites, vertexData);
+}
+
+void PainterCommandList::drawSlicedSprite(const std::shared_ptr<Material>& material, Vector2f scale, Vector4f slices, const void* vertexData)
+{
+	Expects(vertexData != nullptr);
+	if (scale.x < 0.00001f || scale.y < 0.00001f) {
+		return;
+	}
+
+	const auto result = addDrawData(material, 16, 9 * 6, false);
+	Painter::writeSlicedSpriteVertices(result, material->getDefinition().getVertexPosOffset(), scale, slices, vertexData);
+}
+
+void PainterCommandList::drawLine(gsl::span<const Vector2f> points, float width, Colour4f colour, bool loop, std::shared_ptr<Material> material)
+{
+	if (!material) {
+		material = solidLineMaterial;
+	}
+
+	if (points.size() < 2) {
+		return;
+	}
+
+	Painter::makeLineVertices(points, width, colour, loop, lineVertices);
+	drawQuads(material, lineVertices.size(), lineVertices.data());
+}
+
+void PainterCommandList::drawCircle(Vector2f centre, float radius, float width, Colour4f colour, std::shared_ptr<Material> material)
+{
+	drawLine(Painter::makeCirclePoints(centre, radius), width, colour, true, std::move(material));
+}
+
+void PainterCommandList::drawCircleArc(Vector2f centre, float radius, float width, Angle1f from, Angle1f to, Colour4f colour, std::shared_ptr<Material> material)
+{
+	drawLine(Painter::makeCircleArcPoints(centre, radius, from, to), width, colour, false, std::move(material));
+}
+
+void PainterCommandList::drawEllipse(Vector2f centre, Vector2f radius, float width, Colour4f colour, std::shared_ptr<Material> material)
+{
+	drawLine(Painter::makeEllipsePoints(centre, radius), width, colour, true, std::move(material));
+}
+
+void PainterCommandList::drawRect(Rect4f rect, float width, Colour4f colour, std::shared_ptr<Material> material)
+{
+	drawLine(Painter::makeRectPoints(rect), width, colour, true, std::move(material));
+}
+
+void PainterCommandList::drawPolygon(const Polygon& polygon, Colour4f colour, std::shared_ptr<Material> material)
+{
+	if (!polygon.isValid()) {
+		return;
+	}
+
+	if (!material) {
+		material = solidPolygonMaterial;
+	}
+
+	if (!polygon.isConvex()) {
+		for (const auto& p: polygon.splitIntoConvex()) {
+			drawPolygon(p, colour, material);
+		}
+		return;
+	}
+
+	lineVertices.clear();
+	polygonIndices.clear();
+	Painter::makePolygonVertices(polygon, colour, lineVertices, polygonIndices);
+	draw(material, lineVertices.size(), lineVertices.data(), polygonIndices, PrimitiveType::Triangle);
+}
+
+Painter::PainterVertexData PainterCommandList::addDrawData(const std::shared_ptr<Material>& material, size_t numVertices, size_t numIndices, bool standardQuadsOnly)
+{
+	Expects(material != nullptr);
+	Expects(numVertices > 0);
+	Expects(numIndices >= numVertices);
+
+	// Consecutive draws usually share a material, so only store it when it changes
+	if (materials.empty() || materials.back() != material) {
+		materials.push_back(material);
+	}
+
+	Painter::PainterVertexData result;
+	result.vertexSize = material->getDefinition().getVertexSize();
+	result.vertexStride = material->getDefinition().getVertexStride();
+	result.dataSize = numVertices * result.vertexStride;
+	result.firstIndex = 0;
+
+	const size_t vertexOffset = vertices.size();
+	const size_t indexOffset = indices.size();
+	vertices.resize(vertexOffset + result.dataSize);
+	indices.resize(indexOffset + numIndices);
+	result.dstVertex = vertices.data() + vertexOffset;
+	result.dstIndex = indices.data() + indexOffset;
+
+	commands.push_back(Command{ uint32_t(materials.size() - 1), standardQuadsOnly, clip, vertexOffset, numVertices, indexOffset, numIndices });
+
+	return result;
+}
@@ -105,7 +105,7 @@ void RenderGraph::render(const RenderContext& rc, VideoAPI& video)
 		node->allocateVideoResources(video);
 	}
 
-	std::vector<RenderGraphNode*> renderQueue;
+	FrameVector<RenderGraphNode*> renderQueue;
 	renderQueue.reserve(nodes.size());
 	for (auto& node: nodes) {
 		if (node->activeInCurrentPass && node->depsLeft == 0) {
@@ -207,7 +207,7 @@ int8_t RenderGraphNode::makeTexture(VideoAPI& video, RenderGraphPinType type)
 	return result;
 }
 
-void RenderGraphNode::render(const RenderGraph& graph, const RenderContext& rc, std::vector<RenderGraphNode*>& renderQueue)
+void RenderGraphNode::render(const RenderGraph& graph, const RenderContext& rc, FrameVector<RenderGraphNode*>& renderQueue)
 {
 	renderNode(graph, rc);
 	notifyOutputs(renderQueue);
@@ -296,7 +296,7 @@ std::shared_ptr<Texture> RenderGraphNode::getOutputTexture(uint8_t pin)
 	}
 }
 
-void RenderGraphNode::notifyOutputs(std::vector<RenderGraphNode*>& renderQueue)
+void RenderGraphNode::notifyOutputs(FrameVector<RenderGraphNode*>& renderQueue)
 {
 	for (const auto& output: outputPins) {
 		for (const auto& other: output.others) {
@@ -1,16 +1,47 @@
 #include "graphics/sprite/particles.h"
 
+#include "halley/concurrency/concurrent.h"
+#include "halley/data_structures/frame_allocator.h"
 #include "halley/maths/random.h"
+#include "halley/maths/simd.h"
 #include "halley/support/logger.h"
 
 using namespace Halley;
 
+namespace {
+	constexpr size_t particlesPerChunk = 4096;
+
+	// Runs f(start, end) over [0, n), split across threads if there's enough work for it
+	// Chunk starts are always a multiple of 4
+	template <typename F>
+	void forEachChunk(size_t n, bool allowThreads, F f)
+	{
+		if (allowThreads && n > 2 * particlesPerChunk && Executors::hasInstance()) {
+			FrameVector<size_t> chunks;
+			for (size_t i = 0; i < n; i += particlesPerChunk) {
+				chunks.push_back(i);
+			}
+			Concurrent::foreachChunked(Executors::getCPUAux(), chunks.begin(), chunks.end(), 1, [&] (size_t start)
+			{
+				f(start, std::min(start + particlesPerChunk, n));
+			});
+		} else {
+			f(0, n);
+		}
+	}
+}
+
 Particles::Particles()
 	: rng(&Random::getGlobal())
 {
 }
 
 Particles::Particles(const ConfigNode& node, Resources& resources)
+	: Particles(node)
+{
+}
+
+Particles::Particles(const ConfigNode& node)
 	: rng(&Random::getGlobal())
 {
 	spawnRate = node["spawnRate"].asFloat(100);
@@ -132,10 +163,10 @@ void Particles::update(Time t)
 
 	// Remove dead particles
 	for (size_t i = 0; i < nParticlesAlive; ) {
-		if (!particles[i].alive) {
+		if (particles.time[i] >= particles.ttl[i]) {
 			if (i != nParticlesAlive - 1) {
 				// Swap with last particle that's alive
-				std::swap(particles[i], particles[nParticlesAlive - 1]);
+				particles.swap(i, nParticlesAlive - 1);
 				std::swap(sprites[i], sprites[nParticlesAlive - 1]);
 				if (isAnimated()) {
 					std::swap(animationPlayers[i], animationPlayers[nParticlesAlive - 1]);
@@ -148,6 +179,8 @@ void Particles::update(Time t)
 		}
 	}
 
+	spritesDirty = true;
+
 	// Update visibility
 	nParticlesVisible = nParticlesAlive;
 	if (nParticlesVisible > 0 && !sprites[0].hasMaterial()) {
@@ -175,13 +208,20 @@ bool Particles::isAlive() const
 	return nParticlesAlive > 0 || !destroyWhenDone;
 }
 
+size_t Particles::getNumParticles() const
+{
+	return nParticlesAlive;
+}
+
 gsl::span<Sprite> Particles::getSprites()
 {
+	updateSprites();
 	return gsl::span<Sprite>(sprites).subspan(0, nParticlesVisible);
 }
 
 gsl::span<const Sprite> Particles::getSprites() const
 {
+	updateSprites();
 	return gsl::span<const Sprite>(sprites).subspan(0, nParticlesVisible);
 }
 
@@ -210,15 +250,19 @@ void Particles::spawn(size_t n)
 void Particles::initializeParticle(size_t index)
 {
 	const auto startDirection = Angle1f::fromDegrees(rng->getFloat(angle - angleScatter, angle + angleScatter));
-	
-	auto& particle = particles[index];
-	particle.alive = true;
-	particle.time = 0;
-	particle.ttl = rng->getFloat(ttl - ttlScatter, ttl + ttlScatter);
-	particle.pos = getSpawnPosition();
-	particle.angle = rotateTowardsMovement ? startDirection : Angle1f();
-	particle.scale = startScale;
-	particle.vel = Vector2f(rng->getFloat(speed - speedScatter, speed + speedScatter), startDirection);
+	const auto pos = getSpawnPosition();
+	const auto vel = Vector2f(rng->getFloat(speed - speedScatter, speed + speedScatter), startDirection);
+	const float particleTtl = rng->getFloat(ttl - ttlScatter, ttl + ttlScatter);
+
+	particles.posX[index] = pos.x;
+	particles.posY[index] = pos.y;
+	particles.velX[index] = vel.x;
+	particles.velY[index] = vel.y;
+	particles.time[index] = 0;
+	particles.ttl[index] = particleTtl;
+	particles.invTtl[index] = particleTtl > 0 ? 1.0f / particleTtl : 0.0f;
+	particles.scale[index] = startScale;
+	particles.alpha[index] = 1;
 
 	auto& sprite = sprites[index];
 	if (isAnimated()) {
@@ -227,52 +271,104 @@ void Particles::initializeParticle(size_t index)
 	} else if (!baseSprites.empty()) {
 		sprite = rng->getRandomElement(baseSprites);
 	}
+
+	// Unless it follows the movement, the rotation never changes, so it's only set here
+	sprite.setRotation(rotateTowardsMovement ? startDirection : Angle1f());
 }
 
 void Particles::updateParticles(float time)
 {
-	const bool hasAnim = isAnimated();
-	
-	for (size_t i = 0; i < nParticlesAlive; ++i) {
-		if (hasAnim) {
+	if (isAnimated()) {
+		for (size_t i = 0; i < nParticlesAlive; ++i) {
 			animationPlayers[i].update(time, sprites[i]);
 		}
-		
-		auto& particle = particles[i];
+	}
 
-		particle.time += time;
-		if (particle.time >= particle.ttl) {
-			particle.alive = false;
-		} else {
-			particle.vel += acceleration * time;
-			
-			if (speedDamp > 0.0001f) {
-				particle.vel = damp(particle.vel, Vector2f(), speedDamp, time);
-			}
+	// Random numbers can't be generated from several threads at once
+	const bool allowThreads = directionScatter <= 0.00001f;
+	forEachChunk(nParticlesAlive, allowThreads, [&] (size_t start, size_t end)
+	{
+		updateParticleRange(start, end, time);
+	});
+}
 
-			if (directionScatter > 0.00001f) {
-				particle.vel = particle.vel.rotate(Angle1f::fromDegrees(rng->getFloat(-directionScatter * time, directionScatter * time)));
-			}
-			
-			particle.pos += particle.vel * time;
+void Particles::updateParticleRange(size_t start, size_t end, float time)
+{
+	Expects(start % 4 == 0);
+
+	// The SIMD passes run on whole groups of 4, which the arrays always have room for
+	const size_t simdEnd = alignUp(end, size_t(4));
+	Expects(simdEnd <= particles.size());
+
+	const float dampFactor = speedDamp > 0.0001f ? std::exp(-speedDamp * time) : 1.0f;
+	const auto dt = SIMDVec4::loadSingleValue(time);
+	const auto accelX = SIMDVec4::loadSingleValue(acceleration.x * time);
+	const auto accelY = SIMDVec4::loadSingleValue(acceleration.y * time);
+	const auto damping = SIMDVec4::loadSingleValue(dampFactor);
+
+	for (size_t i = start; i < simdEnd; i += 4) {
+		const auto t = SIMDVec4::loadUnaligned(&particles.time[i]) + dt;
+		t.storeUnaligned(&particles.time[i]);
+		((SIMDVec4::loadUnaligned(&particles.velX[i]) + accelX) * damping).storeUnaligned(&particles.velX[i]);
+		((SIMDVec4::loadUnaligned(&particles.velY[i]) + accelY) * damping).storeUnaligned(&particles.velY[i]);
+	}
 
-			if (rotateTowardsMovement && particle.vel.squaredLength() > 0.001f) {
-				particle.angle = particle.vel.angle();
-			}
+	if (directionScatter > 0.00001f) {
+		for (size_t i = start; i < end; ++i) {
+			const auto vel = Vector2f(particles.velX[i], particles.velY[i]).rotate(Angle1f::fromDegrees(rng->getFloat(-directionScatter * time, directionScatter * time)));
+			particles.velX[i] = vel.x;
+			particles.velY[i] = vel.y;
+		}
+	}
 
-			particle.scale = lerp(startScale, endScale, particle.time / particle.ttl);
+	// Faded values are clamped to [0, 1], so a huge reciprocal works for a fade time of zero
+	const auto scale0 = SIMDVec4::loadSingleValue(startScale);
+	const auto scaleDelta = SIMDVec4::loadSingleValue(endScale - startScale);
+	const auto invFadeIn = SIMDVec4::loadSingleValue(fadeInTime > 0.000001f ? 1.0f / fadeInTime : 1e30f);
+	const auto invFadeOut = SIMDVec4::loadSingleValue(fadeOutTime > 0.00001f ? 1.0f / fadeOutTime : 1e30f);
+	const auto zero = SIMDVec4::loadZero();
+	const auto one = SIMDVec4::loadSingleValue(1.0f);
+
+	for (size_t i = start; i < simdEnd; i += 4) {
+		(SIMDVec4::loadUnaligned(&particles.posX[i]) + SIMDVec4::loadUnaligned(&particles.velX[i]) * dt).storeUnaligned(&particles.posX[i]);
+		(SIMDVec4::loadUnaligned(&particles.posY[i]) + SIMDVec4::loadUnaligned(&particles.velY[i]) * dt).storeUnaligned(&particles.posY[i]);
+
+		const auto t = SIMDVec4::loadUnaligned(&particles.time[i]);
+		const auto particleTtl = SIMDVec4::loadUnaligned(&particles.ttl[i]);
+		(scale0 + scaleDelta * t * SIMDVec4::loadUnaligned(&particles.invTtl[i])).storeUnaligned(&particles.scale[i]);
+		(t * invFadeIn).min((particleTtl - t) * invFadeOut).max(zero).min(one).storeUnaligned(&particles.alpha[i]);
+	}
+}
 
-			if (fadeInTime > 0.000001f || fadeOutTime > 0.00001f) {
-				const float alpha = clamp(std::min(particle.time / fadeInTime, (particle.ttl - particle.time) / fadeOutTime), 0.0f, 1.0f);
-				sprites[i].getColour().a = alpha;
+void Particles::updateSprites() const
+{
+	if (!spritesDirty) {
+		return;
+	}
+	spritesDirty = false;
+
+	// Only the fields that the simulation changes are copied; the rest were set when each particle spawned
+	const bool hasFade = fadeInTime > 0.000001f || fadeOutTime > 0.00001f;
+	forEachChunk(nParticlesVisible, true, [&] (size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; ++i) {
+			auto& sprite = sprites[i];
+			sprite
+				.setPosition(Vector2f(particles.posX[i], particles.posY[i]))
+				.setScale(particles.scale[i]);
+
+			if (hasFade) {
+				sprite.getColour().a = particles.alpha[i];
 			}
 
-			sprites[i]
-				.setPosition(particle.pos)
-				.setRotation(particle.angle)
-				.setScale(particle.scale);
+			if (rotateTowardsMovement) {
+				const auto vel = Vector2f(particles.velX[i], particles.velY[i]);
+				if (vel.squaredLength() > 0.001f) {
+					sprite.setRotation(vel.angle());
+				}
+			}
 		}
-	}
+	});
 }
 
 Vector2f Particles::getSpawnPosition() const
@@ -280,6 +376,26 @@ Vector2f Particles::getSpawnPosition() const
 	return position + Vector2f(rng->getFloat(-spawnArea.x * 0.5f, spawnArea.x * 0.5f), rng->getFloat(-spawnArea.y * 0.5f, spawnArea.y * 0.5f));
 }
 
+size_t Particles::ParticleData::size() const
+{
+	return time.size();
+}
+
+void Particles::ParticleData::resize(size_t size)
+{
+	Expects(size % 4 == 0);
+	for (auto* field: { &posX, &posY, &velX, &velY, &time, &ttl, &invTtl, &scale, &alpha }) {
+		field->resize(size);
+	}
+}
+
+void Particles::ParticleData::swap(size_t a, size_t b)
+{
+	for (auto* field: { &posX, &posY, &velX, &velY, &time, &ttl, &invTtl, &scale, &alpha }) {
+		std::swap((*field)[a], (*field)[b]);
+	}
+}
+
 ConfigNode ConfigNodeSerializer<Particles>::serialize(const Particles& particles, const ConfigNodeSerializationContext& context)
 {
 	return particles.toConfigNode();
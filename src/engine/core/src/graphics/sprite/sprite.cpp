@@ -2,6 +2,7 @@
 #include "graphics/sprite/sprite.h"
 #include "graphics/sprite/sprite_sheet.h"
 #include "halley/core/graphics/painter.h"
+#include "halley/core/graphics/painter_command_list.h"
 #include "halley/core/graphics/material/material.h"
 #include "halley/core/graphics/material/material_definition.h"
 #include "halley/core/graphics/material/material_parameter.h"
@@ -20,8 +21,8 @@ Sprite::Sprite()
 	setColour(Colour4f(1, 1, 1, 1));
 }
 
-template <typename F>
-void Sprite::paintWithClip(Painter& painter, const std::optional<Rect4f>& extClip, F f) const
+template <typename P, typename F>
+void Sprite::paintWithClip(P& painter, const std::optional<Rect4f>& extClip, F f) const
 {
 	const bool needsClip = hasClip || extClip;
 	if (needsClip) {
@@ -44,20 +45,42 @@ void Sprite::paintWithClip(Painter& painter, const std::optional<Rect4f>& extCli
 }
 
 void Sprite::draw(Painter& painter, const std::optional<Rect4f>& extClip) const
+{
+	doDraw(painter, extClip);
+}
+
+void Sprite::draw(PainterCommandList& commands, const std::optional<Rect4f>& extClip) const
+{
+	doDraw(commands, extClip);
+}
+
+template <typename P>
+void Sprite::doDraw(P& painter, const std::optional<Rect4f>& extClip) const
 {
 	if (sliced) {
-		drawSliced(painter, slices, extClip);
+		doDrawSliced(painter, slices, extClip);
 	} else {
-		drawNormal(painter, extClip);
+		doDrawNormal(painter, extClip);
 	}
 }
 
 void Sprite::drawSliced(Painter& painter, const std::optional<Rect4f>& extClip) const
 {
-	drawSliced(painter, slices, extClip);
+	doDrawSliced(painter, slices, extClip);
 }
 
 void Sprite::drawNormal(Painter& painter, const std::optional<Rect4f>& extClip) const
+{
+	doDrawNormal(painter, extClip);
+}
+
+void Sprite::drawSliced(Painter& painter, Vector4s slicesPixel, const std::optional<Rect4f>& extClip) const
+{
+	doDrawSliced(painter, slicesPixel, extClip);
+}
+
+template <typename P>
+void Sprite::doDrawNormal(P& painter, const std::optional<Rect4f>& extClip) const
 {
 	if (material) {
 		Expects(material->getDefinition().getVertexStride() == sizeof(SpriteVertexAttrib));
@@ -69,7 +92,8 @@ void Sprite::drawNormal(Painter& painter, const std::optional<Rect4f>& extClip)
 	}
 }
 
-void Sprite::drawSliced(Painter& painter, Vector4s slicesPixel, const std::optional<Rect4f>& extClip) const
+template <typename P>
+void Sprite::doDrawSliced(P& painter, Vector4s slicesPixel, const std::optional<Rect4f>& extClip) const
 {
 	if (material) {
 		Expects(material->getDefinition().getVertexStride() == sizeof(SpriteVertexAttrib));
@@ -89,6 +113,17 @@ void Sprite::drawSliced(Painter& painter, Vector4s slicesPixel, const std::optio
 }
 
 void Sprite::draw(gsl::span<const Sprite> sprites, Painter& painter) // static
+{
+	doDrawSprites(sprites, painter);
+}
+
+void Sprite::draw(gsl::span<const Sprite> sprites, PainterCommandList& commands) // static
+{
+	doDrawSprites(sprites, commands);
+}
+
+template <typename P>
+void Sprite::doDrawSprites(gsl::span<const Sprite> sprites, P& painter) // static
 {
 	if (sprites.empty()) {
 		return;
@@ -119,6 +154,17 @@ void Sprite::draw(gsl::span<const Sprite> sprites, Painter& painter) // static
 }
 
 void Sprite::drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painter)
+{
+	doDrawMixedMaterials(sprites, n, painter);
+}
+
+void Sprite::drawMixedMaterials(const Sprite* sprites, size_t n, PainterCommandList& commands)
+{
+	doDrawMixedMaterials(sprites, n, commands);
+}
+
+template <typename P>
+void Sprite::doDrawMixedMaterials(const Sprite* sprites, size_t n, P& painter)
 {
 	if (n == 0) {
 		return;
@@ -129,12 +175,12 @@ void Sprite::drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painte
 	for (size_t i = 0; i < n; ++i) {
 		auto* material = sprites[i].material.get();
 		if (material != lastMaterial) {
-			draw(gsl::span<const Sprite>(sprites + start, i - start), painter);
+			doDrawSprites(gsl::span<const Sprite>(sprites + start, i - start), painter);
 			start = i;
 			lastMaterial = material;
 		}
 	}
-	draw(gsl::span<const Sprite>(sprites + start, n - start), painter);
+	doDrawSprites(gsl::span<const Sprite>(sprites + start, n - start), painter);
 }
 
 Rect4f Sprite::getLocalAABB() const
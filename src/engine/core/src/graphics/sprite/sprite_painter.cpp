@@ -3,6 +3,11 @@
 #include "graphics/painter.h"
 #include <gsl/gsl>
 #include "graphics/text/text_renderer.h"
+#include "graphics/material/material.h"
+#include "graphics/material/material_definition.h"
+#include "halley/utils/hash.h"
+#include <array>
+#include <cstring>
 
 using namespace Halley;
 
@@ -51,6 +56,18 @@ bool SpritePainterEntry::operator<(const SpritePainterEntry& o) const
 	}
 }
 
+uint64_t SpritePainterEntry::getSortKey() const
+{
+	// Orders the same way as operator<, minus insertOrder, which is preserved by sorting stably
+	// Sign bits are flipped so that signed integers and floats compare correctly as unsigned
+	const uint32_t layerBits = static_cast<uint32_t>(layer) ^ 0x80000000u;
+	const float tie = tieBreaker == 0.0f ? 0.0f : tieBreaker; // Collapse -0 into +0
+	uint32_t tieBits;
+	memcpy(&tieBits, &tie, sizeof(tieBits));
+	tieBits = (tieBits & 0x80000000u) != 0 ? ~tieBits : (tieBits | 0x80000000u);
+	return (static_cast<uint64_t>(layerBits) << 32) | tieBits;
+}
+
 SpritePainterEntryType SpritePainterEntry::getType() const
 {
 	return type;
@@ -86,6 +103,16 @@ int SpritePainterEntry::getMask() const
 	return mask;
 }
 
+int SpritePainterEntry::getLayer() const
+{
+	return layer;
+}
+
+float SpritePainterEntry::getTieBreaker() const
+{
+	return tieBreaker;
+}
+
 const std::optional<Rect4f>& SpritePainterEntry::getClip() const
 {
 	return clip;
@@ -96,6 +123,7 @@ void SpritePainter::start()
 	sprites.clear();
 	cachedSprites.clear();
 	cachedText.clear();
+	callbacks.clear();
 }
 
 void SpritePainter::start(size_t)
@@ -107,7 +135,6 @@ void SpritePainter::add(const Sprite& sprite, int mask, int layer, float tieBrea
 {
 	Expects(mask >= 0);
 	sprites.push_back(SpritePainterEntry(gsl::span<const Sprite>(&sprite, 1), mask, layer, tieBreaker, sprites.size(), std::move(clip)));
-	dirty = true;
 }
 
 void SpritePainter::addCopy(const Sprite& sprite, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
@@ -115,7 +142,6 @@ void SpritePainter::addCopy(const Sprite& sprite, int mask, int layer, float tie
 	Expects(mask >= 0);
 	sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), 1, mask, layer, tieBreaker, sprites.size(), std::move(clip)));
 	cachedSprites.push_back(sprite);
-	dirty = true;
 }
 
 void SpritePainter::add(gsl::span<const Sprite> sprites, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
@@ -123,7 +149,6 @@ void SpritePainter::add(gsl::span<const Sprite> sprites, int mask, int layer, fl
 	Expects(mask >= 0);
 	if (!sprites.empty()) {
 		this->sprites.push_back(SpritePainterEntry(sprites, mask, layer, tieBreaker, this->sprites.size(), std::move(clip)));
-		dirty = true;
 	}
 }
 
@@ -133,7 +158,6 @@ void SpritePainter::addCopy(gsl::span<const Sprite> sprites, int mask, int layer
 	if (!sprites.empty()) {
 		this->sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), sprites.size(), mask, layer, tieBreaker, this->sprites.size(), std::move(clip)));
 		cachedSprites.insert(cachedSprites.end(), sprites.begin(), sprites.end());
-		dirty = true;
 	}
 }
 
@@ -141,7 +165,6 @@ void SpritePainter::add(const TextRenderer& text, int mask, int layer, float tie
 {
 	Expects(mask >= 0);
 	sprites.push_back(SpritePainterEntry(gsl::span<const TextRenderer>(&text, 1), mask, layer, tieBreaker, sprites.size(), std::move(clip)));
-	dirty = true;
 }
 
 void SpritePainter::addCopy(const TextRenderer& text, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
@@ -149,7 +172,6 @@ void SpritePainter::addCopy(const TextRenderer& text, int mask, int layer, float
 	Expects(mask >= 0);
 	sprites.push_back(SpritePainterEntry(SpritePainterEntryType::TextCached, cachedText.size(), 1, mask, layer, tieBreaker, sprites.size(), std::move(clip)));
 	cachedText.push_back(text);
-	dirty = true;
 }
 
 void SpritePainter::add(SpritePainterEntry::Callback callback, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
@@ -157,63 +179,175 @@ void SpritePainter::add(SpritePainterEntry::Callback callback, int mask, int lay
 	Expects(mask >= 0);
 	sprites.push_back(SpritePainterEntry(SpritePainterEntryType::Callback, callbacks.size(), 1, mask, layer, tieBreaker, sprites.size(), std::move(clip)));
 	callbacks.push_back(std::move(callback));
-	dirty = true;
 }
 
 void SpritePainter::draw(int mask, Painter& painter)
 {
-	if (dirty) {
-		// TODO: implement hierarchical bucketing.
-		// - one bucket per layer
-		// - for each layer, one bucket per vertical band of the screen (32px or so)
-		// - sort each leaf bucket
-		std::sort(sprites.begin(), sprites.end()); // lol
-		dirty = false;
-	}
-
 	// View
 	const auto& cam = painter.getCurrentCamera();
 	Rect4f view = cam.getClippingRectangle();
 
 	// Draw!
-	for (auto& s : sprites) {
-		if ((s.getMask() & mask) != 0) {
-			const auto type = s.getType();
-			
-			if (type == SpritePainterEntryType::SpriteRef) {
-				draw(s.getSprites(), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::SpriteCached) {
-				draw(gsl::span<const Sprite>(cachedSprites.data() + s.getIndex(), s.getCount()), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::TextRef) {
-				draw(s.getTexts(), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::TextCached) {
-				draw(gsl::span<const TextRenderer>(cachedText.data() + s.getIndex(), s.getCount()), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::Callback) {
-				draw(callbacks.at(s.getIndex()), painter, s.getClip());
-			}
+	for (const auto& item: getSortedEntries(mask, view)) {
+		const auto& s = sprites[item.entryIdx];
+		const auto type = s.getType();
+
+		if (type == SpritePainterEntryType::SpriteRef) {
+			draw(s.getSprites(), painter, view, s.getClip());
+		} else if (type == SpritePainterEntryType::SpriteCached) {
+			draw(gsl::span<const Sprite>(cachedSprites.data() + s.getIndex(), s.getCount()), painter, view, s.getClip());
+		} else if (type == SpritePainterEntryType::TextRef) {
+			draw(s.getTexts(), painter, view, s.getClip());
+		} else if (type == SpritePainterEntryType::TextCached) {
+			draw(gsl::span<const TextRenderer>(cachedText.data() + s.getIndex(), s.getCount()), painter, view, s.getClip());
+		} else if (type == SpritePainterEntryType::Callback) {
+			draw(callbacks.at(s.getIndex()), painter, s.getClip());
 		}
 	}
+	flushBatch(painter);
 	painter.flush();
 }
 
-void SpritePainter::draw(gsl::span<const Sprite> sprites, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const
+const Vector<SpritePainter::SortItem>& SpritePainter::getSortedEntries(int mask, Rect4f view)
+{
+	gatherCandidates(mask, view);
+
+	auto iter = std::find_if(sortCaches.begin(), sortCaches.end(), [&] (const SortCache& c) { return c.mask == mask; });
+	if (iter == sortCaches.end()) {
+		sortCaches.emplace_back();
+		iter = sortCaches.end() - 1;
+		iter->mask = mask;
+	}
+
+	auto& cache = *iter;
+	if (cache.candidates != candidates) {
+		std::swap(cache.candidates, candidates);
+		cache.sorted = cache.candidates;
+		radixSort(cache.sorted, sortScratch);
+	}
+	return cache.sorted;
+}
+
+void SpritePainter::gatherCandidates(int mask, Rect4f view)
+{
+	candidates.clear();
+	candidates.reserve(sprites.size());
+
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		const auto& s = sprites[i];
+		if ((s.getMask() & mask) == 0) {
+			continue;
+		}
+
+		// Cull single sprites here, so they don't take part in sorting. Spans are culled per sprite as they're drawn.
+		const auto type = s.getType();
+		if (s.getCount() == 1) {
+			if (type == SpritePainterEntryType::SpriteRef && !s.getSprites()[0].isInView(view)) {
+				continue;
+			}
+			if (type == SpritePainterEntryType::SpriteCached && !cachedSprites[s.getIndex()].isInView(view)) {
+				continue;
+			}
+		}
+
+		candidates.push_back(SortItem{ getSortKey(s), static_cast<uint32_t>(i) });
+	}
+}
+
+uint64_t SpritePainter::getSortKey(const SpritePainterEntry& entry) const
+{
+	if (!reorderWithinLayer) {
+		return entry.getSortKey();
+	}
+
+	// Replaces the tie breaker with the material, keeping the largest value for everything that isn't a sprite
+	const auto type = entry.getType();
+	uint32_t materialBits = std::numeric_limits<uint32_t>::max();
+	if (type == SpritePainterEntryType::SpriteRef || type == SpritePainterEntryType::SpriteCached) {
+		const auto& sprite = type == SpritePainterEntryType::SpriteRef ? entry.getSprites()[0] : cachedSprites[entry.getIndex()];
+		materialBits = std::min(Hash::compressTo32(sprite.getMaterial().getHash()), materialBits - 1);
+	}
+	return (entry.getSortKey() & 0xFFFFFFFF00000000ull) | materialBits;
+}
+
+void SpritePainter::setReorderWithinLayer(bool enabled)
+{
+	reorderWithinLayer = enabled;
+}
+
+void SpritePainter::radixSort(Vector<SortItem>& items, Vector<SortItem>& scratch)
+{
+	const size_t n = items.size();
+	if (n < 64) {
+		// Items are in insertion order, so comparing indices on ties keeps this stable
+		std::sort(items.begin(), items.end(), [] (const SortItem& a, const SortItem& b)
+		{
+			return a.key != b.key ? a.key < b.key : a.entryIdx < b.entryIdx;
+		});
+		return;
+	}
+
+	// Least significant digit first, one byte per pass, with all histograms built upfront
+	constexpr size_t nPasses = sizeof(uint64_t);
+	std::array<std::array<uint32_t, 256>, nPasses> counts = {};
+	for (const auto& item: items) {
+		for (size_t pass = 0; pass < nPasses; ++pass) {
+			++counts[pass][(item.key >> (pass * 8)) & 0xFF];
+		}
+	}
+
+	scratch.resize(n);
+	for (size_t pass = 0; pass < nPasses; ++pass) {
+		auto& count = counts[pass];
+		const size_t shift = pass * 8;
+
+		// If every key shares this byte (e.g. they're all on the same layer), the pass wouldn't move anything
+		if (count[(items[0].key >> shift) & 0xFF] == n) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (auto& c: count) {
+			const auto cur = c;
+			c = offset;
+			offset += cur;
+		}
+
+		for (const auto& item: items) {
+			scratch[count[(item.key >> shift) & 0xFF]++] = item;
+		}
+		std::swap(items, scratch);
+	}
+}
+
+void SpritePainter::draw(gsl::span<const Sprite> sprites, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip)
 {
+	// Single sprites have already been culled when gathering
+	const bool culled = sprites.size() == 1;
+
 	for (const auto& sprite: sprites) {
-		if (sprite.isInView(view)) {
-			sprite.draw(painter, clip);
+		if (culled || sprite.isInView(view)) {
+			if (!clip && sprite.isBatchable()) {
+				addToBatch(sprite, painter);
+			} else {
+				flushBatch(painter);
+				sprite.draw(painter, clip);
+			}
 		}
 	}
 }
 
-void SpritePainter::draw(gsl::span<const TextRenderer> texts, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const
+void SpritePainter::draw(gsl::span<const TextRenderer> texts, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip)
 {
+	flushBatch(painter);
 	for (const auto& text: texts) {
 		text.draw(painter, clip);
 	}
 }
 
-void SpritePainter::draw(const SpritePainterEntry::Callback& callback, Painter& painter, const std::optional<Rect4f>& clip) const
+void SpritePainter::draw(const SpritePainterEntry::Callback& callback, Painter& painter, const std::optional<Rect4f>& clip)
 {
+	flushBatch(painter);
 	if (clip) {
 		painter.setRelativeClip(clip.value());
 	}
@@ -222,3 +356,29 @@ void SpritePainter::draw(const SpritePainterEntry::Callback& callback, Painter&
 		painter.setClip();
 	}
 }
+
+void SpritePainter::addToBatch(const Sprite& sprite, Painter& painter)
+{
+	// Keep well under the painter's limit of vertices per draw call
+	constexpr size_t maxBatchSize = 8192;
+
+	const auto& material = sprite.getMaterialPtr();
+	if (batchMaterial && (batchVertices.size() >= maxBatchSize || (material != batchMaterial && material->getHash() != batchMaterial->getHash()))) {
+		flushBatch(painter);
+	}
+
+	if (!batchMaterial) {
+		Expects(material->getDefinition().getVertexStride() == sizeof(SpriteVertexAttrib));
+		batchMaterial = material;
+	}
+	batchVertices.push_back(sprite.getVertexAttrib());
+}
+
+void SpritePainter::flushBatch(Painter& painter)
+{
+	if (!batchVertices.empty()) {
+		painter.drawSprites(batchMaterial, batchVertices.size(), batchVertices.data());
+		batchVertices.clear();
+	}
+	batchMaterial.reset();
+}
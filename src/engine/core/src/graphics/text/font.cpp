@@ -78,7 +78,7 @@ std::unique_ptr<Font> Font::loadResource(ResourceLoader& loader)
 	font->deserialize(ds);
 
 	auto texture = loader.getResources().get<Texture>(font->imageName);
-	auto matDef = loader.getResources().get<MaterialDefinition>(font->distanceField ? "Halley/Text" : "Halley/Sprite");
+	auto matDef = loader.getResources().get<MaterialDefinition>(font->distanceField ? StringId("Halley/Text") : StringId("Halley/Sprite"));
 	font->material = std::make_unique<Material>(matDef);
 	font->material->set("tex0", texture);
 
@@ -184,6 +184,11 @@ std::shared_ptr<Material> Font::getMaterial() const
 	return material;
 }
 
+void Font::setMaterial(std::shared_ptr<Material> m)
+{
+	material = std::move(m);
+}
+
 void Font::serialize(Serializer& s) const
 {
 	s << name;
@@ -1,7 +1,9 @@
 #include "graphics/text/text_renderer.h"
 #include "graphics/text/font.h"
 #include "halley/core/graphics/painter.h"
+#include "halley/core/graphics/painter_command_list.h"
 #include "halley/core/graphics/material/material.h"
+#include "halley/core/graphics/material/material_definition.h"
 #include "halley/core/graphics/material/material_parameter.h"
 #include <gsl/gsl_assert>
 
@@ -37,6 +39,7 @@ TextRenderer& TextRenderer::setFont(std::shared_ptr<const Font> v)
 {
 	if (font != v) {
 		font = v;
+		glyphsDirty = true;
 
 		if (font->isDistanceField()) {
 			materialDirty = true;
@@ -183,9 +186,41 @@ TextRenderer TextRenderer::clone() const
 }
 
 void TextRenderer::generateSprites(std::vector<Sprite>& sprites) const
+{
+	updateCache();
+	if (&sprites != &spritesCache) {
+		sprites = spritesCache;
+	}
+}
+
+void TextRenderer::updateCache() const
 {
 	Expects(font != nullptr);
 
+	if (font->isDistanceField() && materialDirty) {
+		// Glyphs share these materials, so they don't need to be laid out again
+		updateMaterials();
+		materialDirty = false;
+	}
+
+	if (glyphsDirty) {
+		layoutGlyphs();
+		glyphsDirty = false;
+		positionDirty = true;
+	}
+
+	if (positionDirty) {
+		for (size_t i = 0; i < spritesCache.size(); ++i) {
+			const auto pos = position + glyphOffsets[i];
+			spritesCache[i].setPos(pos);
+			verticesCache[i].pos = pos;
+		}
+		positionDirty = false;
+	}
+}
+
+void TextRenderer::layoutGlyphs() const
+{
 	bool floorEnabled = false;
 	auto floorAlign = [floorEnabled] (Vector2f a) -> Vector2f
 	{
@@ -197,112 +232,141 @@ void TextRenderer::generateSprites(std::vector<Sprite>& sprites) const
 	};
 
 	const bool hasMaterialOverride = font->isDistanceField();
-	if (hasMaterialOverride && materialDirty) {
-		updateMaterials();
-		materialDirty = false;
+	auto& sprites = spritesCache;
+
+	float mainScale = getScale(*font);
+	Vector2f p = floorAlign(Vector2f(0, font->getAscenderDistance() * mainScale));
+	if (offset != Vector2f(0, 0)) {
+		p -= floorAlign(getExtents() * offset);
 	}
 
-	if (glyphsDirty || positionDirty) {
-		float mainScale = getScale(*font);
-		Vector2f p = floorAlign(position + Vector2f(0, font->getAscenderDistance() * mainScale));
-		if (offset != Vector2f(0, 0)) {
-			p -= floorAlign(getExtents() * offset);
-		}
+	size_t startPos = 0;
+	size_t spritesInserted = 0;
+	Vector2f lineOffset;
 
-		size_t startPos = 0;
-		size_t spritesInserted = 0;
-		Vector2f lineOffset;
-
-		auto flush = [&] ()
-		{
-			// Line break, update previous characters!
-			if (align != 0) {
-				Vector2f off = floorAlign(-lineOffset * align);
-				for (size_t j = startPos; j < spritesInserted; j++) {
-					auto& sprite = sprites[j];
-					sprite.setPos(sprite.getPosition() + off);
-				}
+	auto flush = [&] ()
+	{
+		// Line break, update previous characters!
+		if (align != 0) {
+			Vector2f off = floorAlign(-lineOffset * align);
+			for (size_t j = startPos; j < spritesInserted; j++) {
+				auto& sprite = sprites[j];
+				sprite.setPos(sprite.getPosition() + off);
 			}
+		}
 
-			// Move pen
-			p.y += getLineHeight();
+		// Move pen
+		p.y += getLineHeight();
 
-			// Reset
-			startPos = spritesInserted;
-			lineOffset.x = 0;
-		};
+		// Reset
+		startPos = spritesInserted;
+		lineOffset.x = 0;
+	};
 
-		auto curCol = colour;
-		size_t curOverride = 0;
+	auto curCol = colour;
+	size_t curOverride = 0;
 
-		const size_t n = text.size();
+	// Most text only uses one font, so avoid looking up its material for every glyph
+	const Font* lastFont = nullptr;
+	std::shared_ptr<Material> lastMaterial;
 
-		size_t nGlyphs = 0;
-		for (size_t i = 0; i < n; i++) {
-			if (text[i] != '\n') {
-				++nGlyphs;
-			}
+	const size_t n = text.size();
+
+	size_t nGlyphs = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (text[i] != '\n') {
+			++nGlyphs;
 		}
-		sprites.resize(nGlyphs);
+	}
+	sprites.resize(nGlyphs);
 
-		for (size_t i = 0; i < n; i++) {
-			int c = text[i];
+	for (size_t i = 0; i < n; i++) {
+		int c = text[i];
 
-			// Check for colour override
-			while (curOverride < colourOverrides.size() && colourOverrides[curOverride].first == i) {
-				curCol = colourOverrides[curOverride].second ? colourOverrides[curOverride].second.value() : colour;
-				++curOverride;
+		// Check for colour override
+		while (curOverride < colourOverrides.size() && colourOverrides[curOverride].first == i) {
+			curCol = colourOverrides[curOverride].second ? colourOverrides[curOverride].second.value() : colour;
+			++curOverride;
+		}
+		
+		if (c == '\n') {
+			flush();
+		} else {
+			const auto& [glyph, fontForGlyph] = font->getGlyph(c);
+			const float scale = getScale(fontForGlyph);
+			const auto fontAdjustment = floorAlign(Vector2f(0, fontForGlyph.getAscenderDistance() - font->getAscenderDistance()) * scale);
+
+			if (&fontForGlyph != lastFont) {
+				lastFont = &fontForGlyph;
+				lastMaterial = hasMaterialOverride ? getMaterial(fontForGlyph) : fontForGlyph.getMaterial();
 			}
-			
-			if (c == '\n') {
+
+			sprites[spritesInserted++] = Sprite()
+				.setMaterial(lastMaterial, true)
+				.setSize(glyph.size)
+				.setTexRect(glyph.area)
+				.setColour(curCol)
+				.setPivot(glyph.horizontalBearing / glyph.size * Vector2f(-1, 1))
+				.setScale(scale)
+				.setPos(p + lineOffset + pixelOffset + fontAdjustment);
+
+			lineOffset.x += glyph.advance.x * scale;
+
+			if (i == n - 1) {
 				flush();
-			} else {
-				const auto& [glyph, fontForGlyph] = font->getGlyph(c);
-				const float scale = getScale(fontForGlyph);
-				const auto fontAdjustment = floorAlign(Vector2f(0, fontForGlyph.getAscenderDistance() - font->getAscenderDistance()) * scale);
-
-				std::shared_ptr<Material> materialToUse = hasMaterialOverride ? getMaterial(fontForGlyph) : fontForGlyph.getMaterial();
-
-				sprites[spritesInserted++] = Sprite()
-					.setMaterial(std::move(materialToUse), true)
-					.setSize(glyph.size)
-					.setTexRect(glyph.area)
-					.setColour(curCol)
-					.setPivot(glyph.horizontalBearing / glyph.size * Vector2f(-1, 1))
-					.setScale(scale)
-					.setPos(p + lineOffset + pixelOffset + fontAdjustment);
-
-				lineOffset.x += glyph.advance.x * scale;
-
-				if (i == n - 1) {
-					flush();
-				}
 			}
 		}
+	}
 
-		glyphsDirty = false;
-		positionDirty = false;
+	// Keep the vertex data ready to be handed to the painter as it is, one run per material
+	glyphOffsets.resize(nGlyphs);
+	verticesCache.resize(nGlyphs);
+	glyphRuns.clear();
+	for (size_t i = 0; i < nGlyphs; ++i) {
+		const auto& sprite = sprites[i];
+		glyphOffsets[i] = sprite.getPosition();
+		verticesCache[i] = sprite.getVertexAttrib();
+
+		const auto& material = sprite.getMaterialPtr();
+		if (glyphRuns.empty() || glyphRuns.back().material != material) {
+			Expects(material->getDefinition().getVertexStride() == sizeof(SpriteVertexAttrib));
+			glyphRuns.push_back(GlyphRun{ material, i, 0 });
+		}
+		++glyphRuns.back().count;
 	}
 }
 
 void TextRenderer::draw(Painter& painter, const std::optional<Rect4f>& extClip) const
 {
-	generateSprites(spritesCache);
+	doDraw(painter, extClip);
+}
+
+void TextRenderer::draw(PainterCommandList& commands, const std::optional<Rect4f>& extClip) const
+{
+	doDraw(commands, extClip);
+}
 
-	if (spriteFilter) {
-		// We don't know what the user will do with glyphs, so mark them as dirty
-		spriteFilter(gsl::span<Sprite>(spritesCache.data(), spritesCache.size()));
-		glyphsDirty = true;
-		positionDirty = true;
-	}
+template <typename P>
+void TextRenderer::doDraw(P& painter, const std::optional<Rect4f>& extClip) const
+{
+	updateCache();
 
 	const std::optional<Rect4f> myClip = clip ? clip.value() + position : std::optional<Rect4f>();
 	const auto finalClip = Rect4f::optionalIntersect(myClip, extClip);
 	if (finalClip) {
 		painter.setRelativeClip(finalClip.value());
 	}
-	
-	Sprite::drawMixedMaterials(spritesCache.data(), spritesCache.size(), painter);
+
+	if (spriteFilter) {
+		// We don't know what the user will do with glyphs, so give them a copy and keep the cache intact
+		filteredSprites = spritesCache;
+		spriteFilter(gsl::span<Sprite>(filteredSprites.data(), filteredSprites.size()));
+		Sprite::drawMixedMaterials(filteredSprites.data(), filteredSprites.size(), painter);
+	} else {
+		for (const auto& run: glyphRuns) {
+			painter.drawSprites(run.material, run.count, verticesCache.data() + run.start);
+		}
+	}
 
 	if (finalClip) {
 		painter.setClip();
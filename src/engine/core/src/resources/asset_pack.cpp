@@ -3,8 +3,11 @@
 #include "halley/resources/resource_data.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/bytes/compression.h"
+#include "halley/bytes/block_compression.h"
 #include "halley/maths/random.h"
 #include "halley/utils/encrypt.h"
+#include "halley/file/memory_mapped_file.h"
+#include <gsl/gsl_assert>
 
 using namespace Halley;
 
@@ -42,11 +45,7 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 	if (nRead != int(sizeof(header))) {
 		throw Exception("Unable to read header", HalleyExceptions::Resources);
 	}
-	if (memcmp(header.identifier.data(), "HALLEYPK", 8) != 0) {
-		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
-	}
-	iv = header.iv;
-	dataOffset = size_t(header.dataStartPos);
+	readHeader(header, totalSize);
 
 	// Read asset database
 	{
@@ -56,13 +55,10 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 		if (nRead != int(assetDbBytes.size())) {
 			throw Exception("Unable to read header", HalleyExceptions::Resources);
 		}
-		assetDb = std::make_unique<AssetDatabase>();
-		Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes));
+		loadAssetDatabase(gsl::as_bytes(gsl::span<const Byte>(assetDbBytes)));
 	}
 
-	std::array<char, 16> ivEmpty;
-	memset(ivEmpty.data(), 0, ivEmpty.size());
-	const bool hasCrypt = memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && !encryptionKey.isEmpty();
+	const bool hasCrypt = hasEncryption(encryptionKey);
 
 	if (preLoad || hasCrypt) {
 		readToMemory();
@@ -73,6 +69,29 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 	}
 }
 
+AssetPack::AssetPack(std::unique_ptr<MemoryMappedFile> file, const String& encryptionKey)
+	: hasReader(false)
+	, mappedFile(std::move(file))
+{
+	Expects(mappedFile);
+
+	const auto fileData = mappedFile->getData();
+	if (size_t(fileData.size()) < sizeof(AssetPackHeader)) {
+		throw Exception("Asset pack is invalid (too small)", HalleyExceptions::Resources);
+	}
+	AssetPackHeader header;
+	memcpy(&header, fileData.data(), sizeof(header));
+	readHeader(header, size_t(fileData.size()));
+	loadAssetDatabase(fileData.subspan(size_t(header.assetDbStartPos), size_t(header.dataStartPos - header.assetDbStartPos)));
+	mappedData = fileData.subspan(dataOffset);
+
+	if (hasEncryption(encryptionKey)) {
+		// Decrypting needs its own copy, so there's nothing to gain from keeping the mapping
+		readToMemory();
+		decrypt(encryptionKey);
+	}
+}
+
 AssetPack::~AssetPack()
 {
 }
@@ -85,10 +104,27 @@ AssetPack& AssetPack::operator=(AssetPack&& other) noexcept
 	dataOffset = other.dataOffset;
 	reader = std::move(other.reader);
 	data = std::move(other.data);
+	mappedFile = std::move(other.mappedFile);
+	mappedData = other.mappedData;
+	iv = other.iv;
 	hasReader = !!reader;
 
+	staticLoads = other.staticLoads.load();
+	streamLoads = other.streamLoads.load();
+	bytesCopied = other.bytesCopied.load();
+	bytesViewed = other.bytesViewed.load();
+	bytesDecompressed = other.bytesDecompressed.load();
+	memoryBudget = other.memoryBudget.load();
+	{
+		std::unique_lock<std::mutex> budgetLock(other.budgetMutex);
+		budgetedRanges = std::move(other.budgetedRanges);
+		budgetedBytes = other.budgetedBytes;
+		releases = other.releases;
+	}
+
 	other.hasReader = false;
 	other.reader.reset();
+	other.mappedData = {};
 
 	return *this;
 }
@@ -120,26 +156,57 @@ Bytes AssetPack::writeOut() const
 	header.init(assetDbBytes.size());
 	header.iv = iv;
 
-	auto result = Bytes(size_t(header.dataStartPos + data.size()));
+	const auto src = mappedFile ? mappedData : gsl::as_bytes(gsl::span<const Byte>(data));
+	auto result = Bytes(size_t(header.dataStartPos + src.size()));
 	memcpy(result.data(), &header, sizeof(AssetPackHeader));
 	memcpy(result.data() + header.assetDbStartPos, assetDbBytes.data(), assetDbBytes.size());
-	memcpy(result.data() + header.dataStartPos, data.data(), data.size());
+	memcpy(result.data() + header.dataStartPos, src.data(), src.size());
+	return result;
+}
+
+String AssetPack::makeEntryPath(size_t pos, size_t size, AssetPackCompression compression, size_t rawSize)
+{
+	auto result = toString(pos) + ":" + toString(size);
+	if (compression != AssetPackCompression::None) {
+		result += ":" + toString(compression) + ":" + toString(rawSize);
+	}
 	return result;
 }
 
 std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType type, bool stream)
 {
 	auto path = asset;
-	auto ps = assetDb->getDatabase(type).get(asset).path.split(':');
-	size_t pos = size_t(ps.at(0).toInteger());
-	size_t size = size_t(ps.at(1).toInteger());
+	const auto entry = getEntryLocation(asset, type);
+	const size_t pos = entry.pos;
+	const size_t size = entry.size;
 
 	if (stream) {
+		++streamLoads;
+		if (mappedFile) {
+			mappedFile->advise(dataOffset + pos, size, MemoryAccessHint::Sequential);
+			onMappedRangeUsed(pos, size);
+		}
+		if (entry.compression != AssetPackCompression::None) {
+			return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
+				return std::make_unique<CompressedPackDataReader>(*this, pos, size);
+			});
+		}
 		return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
 			return std::make_unique<PackDataReader>(*this, pos, size);
 		});
 	} else {
-		if (hasReader) {
+		++staticLoads;
+		if (entry.compression != AssetPackCompression::None) {
+			return getCompressedData(asset, entry);
+		} else if (mappedFile) {
+			const auto view = getView(pos, size);
+
+			// Fault the whole asset in up front, rather than a page at a time as the loader walks through it
+			mappedFile->advise(dataOffset + pos, size, MemoryAccessHint::WillNeed);
+			onMappedRangeUsed(pos, size);
+			bytesViewed += size;
+			return std::make_unique<ResourceDataStatic>(std::shared_ptr<const char>(mappedFile, reinterpret_cast<const char*>(view.data())), size, path);
+		} else if (hasReader) {
 			auto result = new char[size];
 			try {
 				readData(pos, gsl::as_writable_bytes(gsl::span<char>(result, size)));
@@ -150,17 +217,51 @@ std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType
 			}
 		} else {
 			// Preloaded
-			if (pos + size > data.size()) {
-				throw Exception("Asset \"" + asset + "\" is out of pack bounds.", HalleyExceptions::Resources);
-			}
+			const auto view = getView(pos, size);
+			bytesViewed += size;
+			return std::make_unique<ResourceDataStatic>(view.data(), size, path, false);
+		}
+	}
+}
 
-			return std::make_unique<ResourceDataStatic>(data.data() + pos, size, path, false);
+std::unique_ptr<ResourceData> AssetPack::getCompressedData(const String& asset, const EntryLocation& entry)
+{
+	// When loaded through ResourceLoader::getAsync, this already runs on the disk IO executor
+	Bytes packed;
+	gsl::span<const gsl::byte> src;
+	if (hasReader) {
+		packed.resize(entry.size);
+		readData(entry.pos, gsl::as_writable_bytes(gsl::span<Byte>(packed)));
+		src = gsl::as_bytes(gsl::span<const Byte>(packed));
+	} else {
+		src = getView(entry.pos, entry.size);
+		if (mappedFile) {
+			mappedFile->advise(dataOffset + entry.pos, entry.size, MemoryAccessHint::WillNeed);
+			onMappedRangeUsed(entry.pos, entry.size);
 		}
 	}
+
+	auto result = new char[entry.rawSize];
+	try {
+		BlockCompression::decompress(src, gsl::as_writable_bytes(gsl::span<char>(result, entry.rawSize)));
+		bytesDecompressed += entry.rawSize;
+		return std::make_unique<ResourceDataStatic>(result, entry.rawSize, asset, true);
+	} catch (...) {
+		delete[] result;
+		throw;
+	}
 }
 
 void AssetPack::readToMemory()
 {
+	if (mappedFile) {
+		data = Bytes(size_t(mappedData.size()));
+		memcpy(data.data(), mappedData.data(), data.size());
+		mappedData = {};
+		mappedFile.reset();
+		return;
+	}
+
 	std::unique_lock<std::mutex> lock(readerMutex);
 	reader->seek(dataOffset, SEEK_SET);
 	data = reader->readAll();
@@ -188,6 +289,8 @@ void AssetPack::decrypt(const String& key)
 
 void AssetPack::readData(size_t pos, gsl::span<gsl::byte> dst)
 {
+	bytesCopied += size_t(dst.size());
+
 	if (hasReader) {
 		std::unique_lock<std::mutex> lock(readerMutex);
 		if (reader) {
@@ -197,6 +300,15 @@ void AssetPack::readData(size_t pos, gsl::span<gsl::byte> dst)
 		}
 	}
 
+	if (mappedFile) {
+		// The mapping is immutable, so readers don't need to take turns
+		if (pos + size_t(dst.size()) > size_t(mappedData.size())) {
+			throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+		}
+		memcpy(dst.data(), mappedData.data() + pos, dst.size());
+		return;
+	}
+
 	// Didn't read with reader, read from data
 	if (pos + size_t(dst.size()) > data.size()) {
 		throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
@@ -211,6 +323,119 @@ std::unique_ptr<ResourceDataReader> AssetPack::extractReader()
 	return std::move(reader);
 }
 
+AssetPackMode AssetPack::getMode() const
+{
+	if (mappedFile) {
+		return AssetPackMode::MemoryMapped;
+	} else if (hasReader) {
+		return AssetPackMode::Reader;
+	} else {
+		return AssetPackMode::Memory;
+	}
+}
+
+void AssetPack::setMemoryBudget(size_t bytes)
+{
+	std::unique_lock<std::mutex> lock(budgetMutex);
+	memoryBudget = bytes;
+	if (bytes == 0) {
+		budgetedRanges.clear();
+		budgetedBytes = 0;
+	}
+}
+
+AssetPackStats AssetPack::getStats() const
+{
+	AssetPackStats result;
+	result.mode = getMode();
+	if (mappedFile) {
+		result.dataSize = size_t(mappedData.size());
+	} else {
+		std::unique_lock<std::mutex> lock(readerMutex);
+		result.dataSize = reader ? reader->size() - dataOffset : data.size();
+	}
+	result.memoryBudget = memoryBudget;
+	result.staticLoads = staticLoads;
+	result.streamLoads = streamLoads;
+	result.bytesCopied = bytesCopied;
+	result.bytesViewed = bytesViewed;
+	result.bytesDecompressed = bytesDecompressed;
+
+	std::unique_lock<std::mutex> lock(budgetMutex);
+	result.budgetedBytes = budgetedBytes;
+	result.releases = releases;
+	return result;
+}
+
+void AssetPack::readHeader(const AssetPackHeader& header, size_t totalSize)
+{
+	if (memcmp(header.identifier.data(), "HALLEYPK", 8) != 0) {
+		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
+	}
+	if (header.assetDbStartPos > header.dataStartPos || header.dataStartPos > totalSize) {
+		throw Exception("Asset pack is invalid (bad header)", HalleyExceptions::Resources);
+	}
+	iv = header.iv;
+	dataOffset = size_t(header.dataStartPos);
+}
+
+void AssetPack::loadAssetDatabase(gsl::span<const gsl::byte> assetDbBytes)
+{
+	assetDb = std::make_unique<AssetDatabase>();
+	Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes));
+}
+
+bool AssetPack::hasEncryption(const String& encryptionKey) const
+{
+	std::array<char, 16> ivEmpty;
+	memset(ivEmpty.data(), 0, ivEmpty.size());
+	return memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && !encryptionKey.isEmpty();
+}
+
+AssetPack::EntryLocation AssetPack::getEntryLocation(const String& asset, AssetType type) const
+{
+	auto ps = assetDb->getDatabase(type).get(asset).path.split(':');
+
+	EntryLocation result;
+	result.pos = size_t(ps.at(0).toInteger64());
+	result.size = size_t(ps.at(1).toInteger64());
+	if (ps.size() >= 4) {
+		result.compression = fromString<AssetPackCompression>(ps[2]);
+		result.rawSize = size_t(ps[3].toInteger64());
+	}
+	return result;
+}
+
+gsl::span<const gsl::byte> AssetPack::getView(size_t pos, size_t size) const
+{
+	const auto src = mappedFile ? mappedData : gsl::as_bytes(gsl::span<const Byte>(data));
+	if (pos + size > size_t(src.size())) {
+		throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+	}
+	return src.subspan(pos, size);
+}
+
+void AssetPack::onMappedRangeUsed(size_t pos, size_t size)
+{
+	const size_t budget = memoryBudget;
+	if (budget == 0) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(budgetMutex);
+	budgetedRanges.emplace_back(pos, size);
+	budgetedBytes += size;
+
+	// Release the oldest assets first, but never the one just handed out
+	while (budgetedBytes > budget && budgetedRanges.size() > 1) {
+		const auto range = budgetedRanges.front();
+		budgetedRanges.pop_front();
+		budgetedBytes -= range.second;
+		mappedFile->advise(dataOffset + range.first, range.second, MemoryAccessHint::DontNeed);
+		++releases;
+	}
+}
+
 PackDataReader::PackDataReader(AssetPack& pack, size_t startPos, size_t fileSize)
 	: pack(pack)
 	, startPos(startPos)
@@ -261,3 +486,99 @@ void PackDataReader::close()
 {
 }
 
+
+CompressedPackDataReader::CompressedPackDataReader(AssetPack& pack, size_t startPos, size_t compressedSize)
+	: pack(pack)
+	, startPos(startPos)
+	, compressedSize(compressedSize)
+{
+	if (compressedSize < sizeof(BlockCompression::Header)) {
+		throw Exception("Compressed asset is truncated.", HalleyExceptions::Resources);
+	}
+	BlockCompression::Header header;
+	pack.readData(startPos, gsl::as_writable_bytes(gsl::span<BlockCompression::Header>(&header, 1)));
+
+	Bytes table(header.getTableSize());
+	if (sizeof(header) + table.size() > compressedSize) {
+		throw Exception("Compressed asset is truncated.", HalleyExceptions::Resources);
+	}
+	pack.readData(startPos + sizeof(header), gsl::as_writable_bytes(gsl::span<Byte>(table)));
+	index = BlockCompression::Index(header, gsl::as_bytes(gsl::span<const Byte>(table)));
+}
+
+size_t CompressedPackDataReader::size() const
+{
+	return index.getRawSize();
+}
+
+int CompressedPackDataReader::read(gsl::span<gsl::byte> dst)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	size_t written = 0;
+	while (written < size_t(dst.size()) && curPos < index.getRawSize()) {
+		const size_t blockIdx = curPos / index.getBlockSize();
+		loadBlock(blockIdx);
+
+		const size_t blockPos = curPos - blockIdx * index.getBlockSize();
+		const size_t toCopy = std::min(block.size() - blockPos, size_t(dst.size()) - written);
+		memcpy(dst.data() + written, block.data() + blockPos, toCopy);
+		written += toCopy;
+		curPos += toCopy;
+	}
+
+	return int(written);
+}
+
+void CompressedPackDataReader::seek(int64_t pos, int whence)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	switch (whence) {
+	case SEEK_SET:
+		curPos = size_t(pos);
+		break;
+	case SEEK_CUR:
+		curPos = size_t(curPos + pos);
+		break;
+	case SEEK_END:
+		curPos = size_t(index.getRawSize() + pos);
+		break;
+	}
+}
+
+size_t CompressedPackDataReader::tell() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return curPos;
+}
+
+void CompressedPackDataReader::close()
+{
+}
+
+void CompressedPackDataReader::loadBlock(size_t blockIdx)
+{
+	if (blockIdx == curBlock) {
+		return;
+	}
+
+	const size_t offset = index.getBlockOffset(blockIdx);
+	const size_t packedSize = index.getCompressedBlockSize(blockIdx);
+	if (offset + packedSize > compressedSize) {
+		throw Exception("Compressed asset is truncated.", HalleyExceptions::Resources);
+	}
+
+	gsl::span<const gsl::byte> src;
+	if (pack.hasReader) {
+		compressedBlock.resize(packedSize);
+		pack.readData(startPos + offset, gsl::as_writable_bytes(gsl::span<Byte>(compressedBlock)));
+		src = gsl::as_bytes(gsl::span<const Byte>(compressedBlock));
+	} else {
+		// Decompress straight out of pack memory
+		src = pack.getView(startPos + offset, packedSize);
+	}
+
+	block.resize(index.getRawBlockSize(blockIdx));
+	index.decompressBlock(blockIdx, src, gsl::as_writable_bytes(gsl::span<Byte>(block)));
+	pack.bytesDecompressed += block.size();
+	curBlock = blockIdx;
+}
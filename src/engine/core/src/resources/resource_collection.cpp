@@ -21,7 +21,7 @@ void ResourceCollectionBase::clear()
 	resources.clear();
 }
 
-void ResourceCollectionBase::unload(const String& assetId)
+void ResourceCollectionBase::unload(StringId assetId)
 {
 	resources.erase(assetId);
 }
@@ -66,7 +66,7 @@ void ResourceCollectionBase::purge(const String& assetId)
 	}
 }
 
-std::shared_ptr<Resource> ResourceCollectionBase::getUntyped(const String& name, ResourceLoadPriority priority)
+std::shared_ptr<Resource> ResourceCollectionBase::getUntyped(StringId name, ResourceLoadPriority priority)
 {
 	return doGet(name, priority, true);
 }
@@ -109,7 +109,7 @@ std::pair<std::shared_ptr<Resource>, bool> ResourceCollectionBase::loadAsset(con
 	return std::make_pair(newRes, true);
 }
 
-std::shared_ptr<Resource> ResourceCollectionBase::doGet(const String& assetId, ResourceLoadPriority priority, bool allowFallback)
+std::shared_ptr<Resource> ResourceCollectionBase::doGet(StringId assetId, ResourceLoadPriority priority, bool allowFallback)
 {
 	// Look in cache and return if it's there
 	const auto res = resources.find(assetId);
@@ -118,11 +118,11 @@ std::shared_ptr<Resource> ResourceCollectionBase::doGet(const String& assetId, R
 	}
 	
 	// Load resource from disk
-	const auto [newRes, loaded] = loadAsset(assetId, priority, allowFallback);
+	const auto [newRes, loaded] = loadAsset(assetId.getString(), priority, allowFallback);
 
 	// Store in cache
 	if (loaded) {
-		newRes->setAssetId(assetId);
+		newRes->setAssetId(assetId.getString());
 		resources.emplace(assetId, Wrapper(newRes, 0));
 		newRes->onLoaded(parent);
 	}
@@ -130,7 +130,7 @@ std::shared_ptr<Resource> ResourceCollectionBase::doGet(const String& assetId, R
 	return newRes;
 }
 
-bool ResourceCollectionBase::exists(const String& assetId) const
+bool ResourceCollectionBase::exists(StringId assetId) const
 {
 	// Look in cache
 	const auto res = resources.find(assetId);
@@ -138,7 +138,7 @@ bool ResourceCollectionBase::exists(const String& assetId) const
 		return true;
 	}
 
-	return parent.locator->exists(assetId, type);
+	return parent.locator->exists(assetId.getString(), type);
 }
 
 void ResourceCollectionBase::setFallback(const String& assetId)
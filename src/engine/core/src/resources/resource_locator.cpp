@@ -6,6 +6,7 @@
 #include "api/system_api.h"
 #include "halley/text/string_converter.h"
 #include "halley/resources/resource.h"
+#include "halley/os/os.h"
 
 using namespace Halley;
 
@@ -120,9 +121,21 @@ void ResourceLocator::addFileSystem(const Path& path)
 
 void ResourceLocator::addPack(const Path& path, const String& encryptionKey, bool preLoad, bool allowFailure, std::optional<int> priority)
 {
+	if (memoryMapPacks && !preLoad) {
+		if (auto file = OS::get().mapFile(path)) {
+			auto resourceLocator = std::make_unique<PackResourceLocator>(std::move(file), path, encryptionKey, priority);
+			resourceLocator->setMemoryBudget(packMemoryBudget);
+			packLocators[path.getString()] = resourceLocator.get();
+			add(std::move(resourceLocator), path);
+			return;
+		}
+	}
+
 	auto dataReader = system.getDataReader(path.string());
 	if (dataReader) {
 		auto resourceLocator = std::make_unique<PackResourceLocator>(std::move(dataReader), path, encryptionKey, preLoad, priority);
+		resourceLocator->setMemoryBudget(packMemoryBudget);
+		packLocators[path.getString()] = resourceLocator.get();
 		add(std::move(resourceLocator), path);
 
 	} else {
@@ -137,6 +150,7 @@ void ResourceLocator::addPack(const Path& path, const String& encryptionKey, boo
 void ResourceLocator::removePack(const Path& path)
 {
 	auto* locatorToRemove = locatorPaths.find(path.getString())->second;
+	packLocators.erase(path.getString());
 	auto& dbToRemove = locatorToRemove->getAssetDatabase();
 	for (auto& asset : dbToRemove.getAssets()) {
 		auto result = assetToLocator.find(asset);
@@ -159,6 +173,28 @@ void ResourceLocator::removePack(const Path& path)
 	}
 }
 
+void ResourceLocator::setMemoryMapPacks(bool enabled)
+{
+	memoryMapPacks = enabled;
+}
+
+void ResourceLocator::setPackMemoryBudget(size_t bytes)
+{
+	packMemoryBudget = bytes;
+	for (auto& pack: packLocators) {
+		pack.second->setMemoryBudget(bytes);
+	}
+}
+
+HashMap<String, AssetPackStats> ResourceLocator::getPackStats() const
+{
+	HashMap<String, AssetPackStats> result;
+	for (auto& pack: packLocators) {
+		result[pack.first] = pack.second->getStats();
+	}
+	return result;
+}
+
 std::vector<String> ResourceLocator::getAssetsFromPack(const Path& path, const String& encryptionKey) const
 {
 	auto dataReader = system.getDataReader(path.string());
@@ -2,6 +2,8 @@
 #include <utility>
 #include "resources/asset_pack.h"
 #include "api/system_api.h"
+#include "halley/file/memory_mapped_file.h"
+#include "halley/os/os.h"
 using namespace Halley;
 
 PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> reader, Path path, String key, bool preLoad, std::optional<int> priority)
@@ -13,6 +15,16 @@ PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> rea
 	assetPack = std::make_unique<AssetPack>(std::move(reader), encryptionKey, preLoad);
 }
 
+PackResourceLocator::PackResourceLocator(std::unique_ptr<MemoryMappedFile> file, Path path, String key, std::optional<int> priority)
+	: path(std::move(path))
+	, encryptionKey(std::move(key))
+	, preLoad(false)
+	, memoryMapped(true)
+	, priority(priority)
+{
+	assetPack = std::make_unique<AssetPack>(std::move(file), encryptionKey);
+}
+
 PackResourceLocator::~PackResourceLocator()
 {
 }
@@ -41,7 +53,29 @@ void PackResourceLocator::purge(SystemAPI& sys)
 
 void PackResourceLocator::loadAfterPurge()
 {
-	assetPack = std::make_unique<AssetPack>(system->getDataReader(path.string()), encryptionKey, preLoad);
+	auto file = memoryMapped ? OS::get().mapFile(path) : std::unique_ptr<MemoryMappedFile>();
+	if (file) {
+		assetPack = std::make_unique<AssetPack>(std::move(file), encryptionKey);
+	} else {
+		assetPack = std::make_unique<AssetPack>(system->getDataReader(path.string()), encryptionKey, preLoad);
+	}
+	assetPack->setMemoryBudget(memoryBudget);
+}
+
+void PackResourceLocator::setMemoryBudget(size_t bytes)
+{
+	memoryBudget = bytes;
+	if (assetPack) {
+		assetPack->setMemoryBudget(bytes);
+	}
+}
+
+AssetPackStats PackResourceLocator::getStats()
+{
+	if (!assetPack) {
+		loadAfterPurge();
+	}
+	return assetPack->getStats();
 }
 
 int PackResourceLocator::getPriority() const
@@ -2,16 +2,21 @@
 
 #include "resources/resource_locator.h"
 #include "resources/asset_database.h"
+#include "resources/asset_pack.h"
 
 namespace Halley {
 	class SystemAPI;
-	class AssetPack;
+	class MemoryMappedFile;
 
 	class PackResourceLocator final : public IResourceLocatorProvider {
 	public:
 		explicit PackResourceLocator(std::unique_ptr<ResourceDataReader> reader, Path path, String encryptionKey = "", bool preLoad = false, std::optional<int> priority = {});
+		explicit PackResourceLocator(std::unique_ptr<MemoryMappedFile> file, Path path, String encryptionKey = "", std::optional<int> priority = {});
 		~PackResourceLocator();
 
+		void setMemoryBudget(size_t bytes);
+		AssetPackStats getStats();
+
 	protected:
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream) override;
 		const AssetDatabase& getAssetDatabase() override;
@@ -26,6 +31,8 @@ namespace Halley {
 		Path path;
 		String encryptionKey; // :(
 		bool preLoad;
+		bool memoryMapped = false;
+		size_t memoryBudget = 0;
 		std::optional<int> priority;
 		SystemAPI* system = nullptr;
 	};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <array>
+#include <gsl/span>
+#include "family_mask.h"
+#include "entity_id.h"
+#include <halley/data_structures/vector.h>
+#include <halley/data_structures/tree_map.h>
+
+namespace Halley {
+	class ComponentDeleterTable;
+
+	// Stores the components of every entity that shares the same component mask in contiguous, per-component arrays
+	// Memory is allocated in fixed-size chunks, so slot addresses are stable until the slot is freed. Families can either
+	// point at components one entity at a time, or walk the runs of live slots in each chunk (see Family::forEachChunk).
+	class Archetype {
+	public:
+		constexpr static size_t chunkCapacity = 64;
+		constexpr static size_t maxComponents = 256;
+
+		Archetype(FamilyMaskType mask, const Vector<int>& componentIds, const ComponentDeleterTable& table);
+		~Archetype();
+
+		Archetype(const Archetype& other) = delete;
+		Archetype& operator=(const Archetype& other) = delete;
+
+		FamilyMaskType getMask() const { return mask; }
+
+		size_t allocSlot(EntityId entityId);
+		void freeSlot(size_t slot);
+
+		// Calls f(firstSlot, count) for every run of live slots; runs never cross a chunk, so each component of a run is one array
+		template <typename F>
+		void forEachRange(F f) const
+		{
+			size_t slot = 0;
+			while (slot < nextSlot) {
+				if (!slotEntities[slot].isValid()) {
+					++slot;
+					continue;
+				}
+				const size_t chunkEnd = std::min(nextSlot, (slot / chunkCapacity + 1) * chunkCapacity);
+				size_t end = slot + 1;
+				while (end < chunkEnd && slotEntities[end].isValid()) {
+					++end;
+				}
+				f(slot, end - slot);
+				slot = end;
+			}
+		}
+
+		gsl::span<const EntityId> getEntityIds(size_t firstSlot, size_t count) const
+		{
+			return gsl::span<const EntityId>(slotEntities.data() + firstSlot, count);
+		}
+
+		void* getComponent(int componentId, size_t slot) const
+		{
+			if (componentId < 0 || size_t(componentId) >= maxComponents) {
+				return nullptr;
+			}
+			const auto column = columnByComponent[componentId];
+			if (column < 0) {
+				return nullptr;
+			}
+			return chunks[slot / chunkCapacity] + columns[column].offset + (slot % chunkCapacity) * columns[column].size;
+		}
+
+		bool owns(int componentId, size_t slot, const void* component) const
+		{
+			return component != nullptr && getComponent(componentId, slot) == component;
+		}
+
+		size_t getNumComponents() const { return columns.size(); }
+		size_t getNumChunks() const { return chunks.size(); }
+		size_t getLiveCount() const { return liveCount; }
+
+	private:
+		struct Column {
+			int componentId;
+			size_t size;
+			size_t offset;
+		};
+
+		FamilyMaskType mask;
+		Vector<Column> columns;
+		std::array<int16_t, maxComponents> columnByComponent;
+		size_t chunkSize = 0;
+		size_t chunkAlignment = alignof(std::max_align_t);
+
+		Vector<char*> chunks;
+		Vector<EntityId> slotEntities;
+		Vector<size_t> freeSlots;
+		size_t nextSlot = 0;
+		size_t liveCount = 0;
+
+		void allocChunk();
+	};
+
+	class ArchetypeStorage {
+	public:
+		Archetype& getArchetype(FamilyMaskType mask, const Vector<int>& componentIds, const ComponentDeleterTable& table);
+
+		size_t getNumArchetypes() const { return byCreation.size(); }
+		Archetype& getArchetype(size_t idx) const { return *byCreation[idx]; } // In order of creation
+
+	private:
+		TreeMap<FamilyMaskType, std::unique_ptr<Archetype>> archetypes;
+		Vector<Archetype*> byCreation;
+	};
+}
@@ -7,6 +7,7 @@
 #include "family_mask.h"
 #include "entity_id.h"
 #include "type_deleter.h"
+#include "archetype.h"
 #include <halley/data_structures/vector.h>
 
 #include "prefab.h"
@@ -23,17 +24,6 @@ namespace Halley {
 	template <class, class = void_t<>> struct HasOnAddedToEntityMember : std::false_type {};
 	template <class T> struct HasOnAddedToEntityMember<T, decltype(std::declval<T&>().onAddedToEntity(std::declval<EntityRef&>()))> : std::true_type { };
 	
-	class MessageEntry
-	{
-	public:
-		std::unique_ptr<Message> msg;
-		int type = -1;
-		int age = -1;
-
-		MessageEntry() {}
-		MessageEntry(std::unique_ptr<Message> msg, int type, int age) : msg(std::move(msg)), type(type), age(age) {}
-	};
-
 	class EntityRef;
 	class ConstEntityRef;
 
@@ -51,6 +41,10 @@ namespace Halley {
 		T* tryGetComponent()
 		{
 			constexpr int id = FamilyMask::RetrieveComponentIndex<T>::componentIndex;
+			if (archetype && !dirty) {
+				// Every entity in an archetype has the same layout, so there's nothing to search for
+				return static_cast<T*>(archetype->getComponent(id, archetypeSlot));
+			}
 			for (uint8_t i = 0; i < liveComponents; i++) {
 				if (components[i].first == id) {
 					return static_cast<T*>(components[i].second);
@@ -63,6 +57,10 @@ namespace Halley {
 		const T* tryGetComponent() const
 		{
 			constexpr int id = FamilyMask::RetrieveComponentIndex<T>::componentIndex;
+			if (archetype && !dirty) {
+				// Every entity in an archetype has the same layout, so there's nothing to search for
+				return static_cast<const T*>(archetype->getComponent(id, archetypeSlot));
+			}
 			for (uint8_t i = 0; i < liveComponents; i++) {
 				if (components[i].first == id) {
 					return static_cast<const T*>(components[i].second);
@@ -126,7 +124,7 @@ namespace Halley {
 		FamilyMaskType getMask() const;
 		EntityId getEntityId() const;
 
-		void refresh(MaskStorage& storage, ComponentDeleterTable& table);
+		bool refresh(MaskStorage& storage, ComponentDeleterTable& table, ArchetypeStorage* archetypes = nullptr);
 		void destroy();
 		
 		void sortChildrenByPrefabUUIDs(const std::vector<UUID>& uuids);
@@ -155,7 +153,6 @@ namespace Halley {
 		Vector<Entity*> children; // Cacheline 1 starts 16 bytes into this
 
 		// Cacheline 1
-		Vector<MessageEntry> inbox;
 		String name;
 
 		// Cacheline 2
@@ -163,6 +160,10 @@ namespace Halley {
 		UUID prefabUUID;
 		std::shared_ptr<const Prefab> prefab;
 
+		Archetype* archetype = nullptr;
+		size_t archetypeSlot = 0;
+		size_t worldIndex = 0;
+
 		uint8_t hierarchyRevision = 0;
 
 		Entity();
@@ -190,6 +191,8 @@ namespace Halley {
 		void removeComponentById(World& world, int id);
 		void removeAllComponents(World& world);
 		void deleteComponent(Component* component, int id, ComponentDeleterTable& table);
+		bool relocateComponents(ArchetypeStorage& archetypes, ComponentDeleterTable& table);
+		void releaseArchetypeSlot();
 		void keepOnlyComponentsWithIds(const std::vector<int>& ids, World& world);
 
 		void onReady();
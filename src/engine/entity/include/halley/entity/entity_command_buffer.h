@@ -0,0 +1,81 @@
+#pragma once
+
+#include <functional>
+#include <halley/data_structures/vector.h>
+#include <halley/text/halleystring.h>
+#include "entity.h"
+#include "world.h"
+
+namespace Halley {
+	// Records entity changes made from worker threads, to be applied on the main thread by World::spawnPending()
+	// Obtain one through World::getEntityCommandBuffer(), which returns a separate buffer for each thread.
+	// Commands run in the order they were recorded in, but there is no ordering between those recorded by different threads.
+	class EntityCommandBuffer {
+	public:
+		using Command = std::function<void(World&)>;
+
+		void createEntity(String name, std::function<void(EntityRef&)> onCreated = {})
+		{
+			commands.emplace_back([name = std::move(name), onCreated = std::move(onCreated)] (World& world)
+			{
+				auto e = world.createEntity(name);
+				if (onCreated) {
+					onCreated(e);
+				}
+			});
+		}
+
+		void destroyEntity(EntityId id)
+		{
+			commands.emplace_back([id] (World& world)
+			{
+				auto* entity = world.tryGetRawEntity(id);
+				if (entity && entity->isAlive()) {
+					world.destroyEntity(id);
+				}
+			});
+		}
+
+		template <typename T>
+		void addComponent(EntityId id, T component)
+		{
+			commands.emplace_back([id, component = std::move(component)] (World& world) mutable
+			{
+				auto* entity = world.tryGetRawEntity(id);
+				if (entity) {
+					EntityRef(*entity, world).addComponent(std::move(component));
+				}
+			});
+		}
+
+		template <typename T>
+		void removeComponent(EntityId id)
+		{
+			commands.emplace_back([id] (World& world)
+			{
+				auto* entity = world.tryGetRawEntity(id);
+				if (entity) {
+					EntityRef(*entity, world).removeComponent<T>();
+				}
+			});
+		}
+
+		void run(World& world)
+		{
+			// Commands might record further commands on this thread, so swap them out first
+			auto toRun = std::move(commands);
+			commands.clear();
+			for (auto& c: toRun) {
+				c(world);
+			}
+		}
+
+		bool empty() const
+		{
+			return commands.empty();
+		}
+
+	private:
+		Vector<Command> commands;
+	};
+}
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
 #include <gsl/gsl_assert>
 #include "family_type.h"
 #include "family_mask.h"
 #include "entity_id.h"
+#include "archetype.h"
 #include "halley/data_structures/nullable_reference.h"
 #include "halley/support/exception.h"
 #include "halley/support/debug.h"
@@ -14,6 +18,75 @@ namespace Halley {
 	class Entity;
 	class FamilyBindingBase;
 
+	// Maps entity ids to their slot in a family
+	// Paged by entity index, so families with few members don't pay for the size of the whole world
+	class EntitySlotIndex {
+	public:
+		constexpr static size_t invalidSlot = std::numeric_limits<uint32_t>::max();
+
+		size_t get(EntityId id) const
+		{
+			const auto idx = getIndex(id);
+			const auto page = idx / pageSize;
+			return page < pages.size() && pages[page] ? (*pages[page])[idx % pageSize] : invalidSlot;
+		}
+
+		void set(EntityId id, size_t slot);
+		void remove(EntityId id);
+		void clear();
+
+	private:
+		constexpr static size_t pageSize = 1024;
+		using Page = std::array<uint32_t, pageSize>;
+
+		Vector<std::unique_ptr<Page>> pages;
+
+		static size_t getIndex(EntityId id)
+		{
+			// The lower 32 bits are the index in the entity pool, the upper bits are the revision
+			return static_cast<size_t>(id.value & 0xFFFFFFFFll);
+		}
+	};
+
+	// A run of a family's entities whose components sit next to each other, one array per component type
+	class FamilyChunk {
+	public:
+		FamilyChunk(const Archetype& archetype, size_t firstSlot, size_t count)
+			: archetype(archetype)
+			, firstSlot(firstSlot)
+			, count(count)
+		{}
+
+		size_t size() const { return count; }
+
+		gsl::span<const EntityId> getEntityIds() const
+		{
+			return archetype.getEntityIds(firstSlot, count);
+		}
+
+		// For components the family requires
+		template <typename T>
+		gsl::span<T> get() const
+		{
+			auto result = tryGet<T>();
+			Expects(result.size() == count);
+			return result;
+		}
+
+		// For optional components; empty if these entities don't have it
+		template <typename T>
+		gsl::span<T> tryGet() const
+		{
+			auto* data = static_cast<T*>(archetype.getComponent(T::componentIndex, firstSlot));
+			return data ? gsl::span<T>(data, count) : gsl::span<T>();
+		}
+
+	private:
+		const Archetype& archetype;
+		size_t firstSlot;
+		size_t count;
+	};
+
 	class Family {
 		friend class World;
 
@@ -31,6 +104,23 @@ namespace Halley {
 			return static_cast<char*>(elems) + (n * elemSize);
 		}
 
+		// Calls f(const FamilyChunk&) for every run of the family's entities stored together, instead of going through a pointer per component per entity
+		// Requires archetype storage (see World::setArchetypeStorageEnabled). Entities come in storage order, which isn't the order of getElement().
+		template <typename F>
+		void forEachChunk(F f) const
+		{
+			Expects(archetypeStorageEnabled);
+			for (const auto* archetype: archetypes) {
+				archetype->forEachRange([&] (size_t firstSlot, size_t count)
+				{
+					f(FamilyChunk(*archetype, firstSlot, count));
+				});
+			}
+		}
+
+		// Returns EntitySlotIndex::invalidSlot if the entity isn't in the family (or was only added since the last update)
+		virtual size_t getIndexOf(EntityId id) const = 0;
+
 		void addOnEntitiesAdded(FamilyBindingBase* bind);
 		void removeOnEntityAdded(FamilyBindingBase* bind);
 		void addOnEntitiesRemoved(FamilyBindingBase* bind);
@@ -63,6 +153,10 @@ namespace Halley {
 	private:
 		FamilyMaskType inclusionMask;
 		FamilyMaskType optionalMask;
+
+		// Every archetype whose mask includes the family's, kept up to date by the World
+		Vector<const Archetype*> archetypes;
+		bool archetypeStorageEnabled = false;
 	};
 
 	class FamilyBase {
@@ -116,6 +210,7 @@ namespace Halley {
 	protected:
 		void addEntity(Entity& entity) override
 		{
+			slotIndex.set(entity.getEntityId(), entities.size());
 			auto& e = entities.emplace_back();
 			e.entityId = entity.getEntityId();
 			T::Type::loadComponents(entity, &e.data[0]);
@@ -125,14 +220,18 @@ namespace Halley {
 		
 		void refreshEntity(Entity& entity) override
 		{
-			for (auto& e: entities) {
-				if (e.entityId == entity.getEntityId()) {
-					T::Type::loadComponents(entity, &e.data[0]);
-					break;
-				}
+			auto* e = tryGetStorage(entity.getEntityId());
+			if (e) {
+				T::Type::loadComponents(entity, &e->data[0]);
 			}
 		}
 
+		size_t getIndexOf(EntityId id) const override
+		{
+			const size_t slot = slotIndex.get(id);
+			return slot < elemCount && entities[slot].entityId == id ? slot : EntitySlotIndex::invalidSlot;
+		}
+
 		void updateEntities() override
 		{
 			if (dirty) {
@@ -152,10 +251,11 @@ namespace Halley {
 			if (!toReload.empty()) {
 				// Notify reloads
 				HALLEY_DEBUG_TRACE();
-				std::vector<StorageType*> reloadedEntities;
-				for (auto& entity : entities) {
-					if (std::find(toReload.begin(), toReload.end(), entity.entityId) != toReload.end()) {
-						reloadedEntities.push_back(&entity);
+				reloadedEntities.clear();
+				for (const auto& id: toReload) {
+					auto* e = tryGetStorage(id);
+					if (e) {
+						reloadedEntities.push_back(e);
 					}
 				}
 				notifyReload(reloadedEntities.data(), reloadedEntities.size());
@@ -170,13 +270,25 @@ namespace Halley {
 		{
 			notifyRemove(entities.data(), entities.size());
 			entities.clear();
+			slotIndex.clear();
 			updateElems();
 		}
 
 	private:
 		Vector<StorageType> entities;
+		Vector<StorageType*> reloadedEntities;
+		EntitySlotIndex slotIndex;
 		bool dirty = false;
 
+		StorageType* tryGetStorage(EntityId id)
+		{
+			const size_t slot = slotIndex.get(id);
+			if (slot < entities.size() && entities[slot].entityId == id) {
+				return &entities[slot];
+			}
+			return nullptr;
+		}
+
 		void updateElems()
 		{
 			elems = entities.empty() ? nullptr : entities.data();
@@ -193,33 +305,24 @@ namespace Halley {
 				size_t removeCount = toRemove.size();
 				Expects(removeCount > 0);
 				Expects(removeCount <= entities.size());
-				std::sort(toRemove.begin(), toRemove.end());
-
-				for (size_t i = 1; i < toRemove.size(); ++i) {
-					Expects(toRemove[i - 1] != toRemove[i]);
-				}
 
 				// Move all entities to be removed to the back of the vector
+				// Note that an entity can't be both added to and removed from a family in the same update, so its slot in the index is unambiguous
 				{
-					int n = int(entities.size());
-					// Note: it's important to scan it forward. Scanning backwards would improve performance for short-lived entities,
-					// but it causes an issue where an entity is removed and added to the same family in one frame.
-					for (int i = 0; i < n; i++) {
-						EntityId id = entities[i].entityId;
-						auto iter = std::lower_bound(toRemove.begin(), toRemove.end(), id);
-						if (iter != toRemove.end() && id == *iter) {
-							toRemove.erase(iter);
-							if (i != n - 1) {
-								std::swap(entities[i], entities[n - 1]);
-								i--;
-							}
-							n--;
-							if (toRemove.empty()) {
-								break;
-							}
+					size_t n = entities.size();
+					for (const auto& id: toRemove) {
+						const size_t slot = slotIndex.get(id);
+						Expects(slot < n);
+						Expects(entities[slot].entityId == id);
+						--n;
+						if (slot != n) {
+							std::swap(entities[slot], entities[n]);
+							slotIndex.set(entities[slot].entityId, slot);
 						}
+						slotIndex.remove(id);
 					}
-					Ensures(size_t(n) + removeCount == entities.size());
+					toRemove.clear();
+					Ensures(n + removeCount == entities.size());
 				}
 
 				Expects(toRemove.empty());
@@ -22,6 +22,7 @@ namespace Halley {
 		void doInit(FamilyMaskType readMask, FamilyMaskType writeMask) noexcept;
 		
 		void* getElement(size_t index) const noexcept { return family->getElement(index); }
+		size_t getIndexOf(EntityId id) const noexcept { return family->getIndexOf(id); }
 		void setFamily(Family* family) noexcept;
 
 		void setOnEntitiesAdded(std::function<void(void*, size_t)> callback);
@@ -11,9 +11,10 @@ namespace Halley
 		virtual ~Message() {}
 		virtual size_t getSize() const = 0;
 
-		/*
+		// Messages stored in a MessageBus are constructed in its own slots
 		void* operator new(size_t size);
-		void operator delete(void* ptr);
-		*/
+		void* operator new(size_t size, void* where) { return where; }
+		void operator delete(void* ptr, size_t size);
+		void operator delete(void* ptr, void* where) {}
 	};
 }
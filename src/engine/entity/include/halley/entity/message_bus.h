@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <gsl/span>
+#include "entity_id.h"
+#include "message.h"
+#include <halley/data_structures/vector.h>
+
+namespace Halley {
+	// Holds the entity messages in flight, with one stream per message type
+	// Messages of each type live in fixed-size slots carved out of large blocks, and each stream keeps a contiguous list of
+	// (target, age) entries in the order they were sent, so delivering a type costs O(messages of that type).
+	// A message is pending from send until its sender dispatches, then delivered until the sender purges it (on its next update).
+	// Streams are not thread safe; systems that use entity messages never run concurrently (see SystemAccessSignature).
+	class MessageBus {
+	public:
+		struct Entry {
+			EntityId target;
+			Message* msg = nullptr;
+			int age = -1;
+			bool delivered = false;
+		};
+
+		MessageBus() = default;
+		~MessageBus();
+
+		MessageBus(const MessageBus& other) = delete;
+		MessageBus& operator=(const MessageBus& other) = delete;
+
+		template <typename T>
+		void send(EntityId target, int age, T msg)
+		{
+			auto& stream = getStream(T::messageIndex, sizeof(T), alignof(T));
+			auto* result = new (stream.allocSlot()) T(std::move(msg));
+			stream.entries.push_back(Entry{ target, result, age, false });
+		}
+
+		// Delivers everything pending from this age, except messages to entities that isDead() says are gone
+		template <typename F>
+		void dispatch(int type, int age, F isDead)
+		{
+			if (auto* stream = tryGetStream(type)) {
+				for (auto& e: stream->entries) {
+					if (!e.delivered && e.age == age) {
+						e.delivered = true;
+						if (isDead(e.target)) {
+							e.age = purgedAge;
+						}
+					}
+				}
+				stream->removeAge(purgedAge);
+			}
+		}
+
+		void purge(int type, int age);
+
+		gsl::span<const Entry> getMessages(int type) const;
+		size_t getNumMessages() const;
+
+	private:
+		constexpr static int purgedAge = -2;
+		constexpr static size_t slotsPerBlock = 64;
+
+		class Stream {
+		public:
+			Vector<Entry> entries;
+
+			Stream(size_t slotSize, size_t slotAlignment);
+			~Stream();
+
+			Stream(const Stream& other) = delete;
+			Stream& operator=(const Stream& other) = delete;
+
+			size_t getSlotSize() const { return slotSize; }
+			void* allocSlot();
+			void removeAge(int age);
+
+		private:
+			size_t slotSize;
+			size_t slotAlignment;
+			Vector<char*> blocks;
+			Vector<void*> freeSlots;
+		};
+
+		Vector<std::unique_ptr<Stream>> streams;
+
+		Stream& getStream(int type, size_t size, size_t alignment);
+		Stream* tryGetStream(int type) const;
+	};
+}
@@ -9,13 +9,17 @@
 #include "family_type.h"
 #include "entity.h"
 #include "halley/utils/type_traits.h"
+#include "halley/support/profiler.h"
 #include "system_message.h"
+#include "system_access.h"
 
 namespace Halley {
 	class Message;
 	class SystemMessage;
 	class HalleyAPI;
 
+	class EntityCommandBuffer;
+
 	template <typename T, std::size_t size = gsl::dynamic_extent> using Span = gsl::span<T, size>;
 
 	// True if T::init() exists
@@ -37,11 +41,13 @@ namespace Halley {
 	class System
 	{
 	public:
+		constexpr static size_t defaultParallelChunkSize = 64;
+
 		System(Vector<FamilyBindingBase*> families, Vector<int> messageTypesReceived);
 		virtual ~System() {}
 
 		const String& getName() const { return name; }
-		void setName(String n) { name = std::move(n); }
+		void setName(String n) { name = std::move(n); profilerName = Profiler::intern(name); }
 		size_t getEntityCount() const;
 		bool tryInit();
 
@@ -51,6 +57,8 @@ namespace Halley {
 		long long getNanoSecondsTakenMax() const { return timer.maxElapsedNanoSeconds(); }
 		void setCollectSamples(bool collect);
 
+		const SystemAccessSignature& getAccessSignature() const { return accessSignature; }
+
 		virtual bool canHandleSystemMessage(int messageId, const String& targetSystem) const { return false; }
 		void receiveSystemMessage(const SystemMessageContext& context);
 		void prepareSystemMessages();
@@ -69,6 +77,8 @@ namespace Halley {
 		virtual void onMessagesReceived(int, Message**, size_t*, size_t) {}
 		virtual void onSystemMessageReceived(int messageId, SystemMessage& msg, const std::function<void(std::byte*)>& callback) {}
 
+		void setAccessSignature(SystemAccessSignature signature) { accessSignature = std::move(signature); }
+
 		template <typename F, typename V>
 		static void invokeIndividual(F&& f, V& fam)
 		{
@@ -80,17 +90,28 @@ namespace Halley {
 		template <typename F, typename V>
 		static void invokeParallel(F&& f, V& fam)
 		{
-			Concurrent::foreach(std::begin(fam), std::end(fam), [&] (auto& e) {
+			parallelForEach(fam, f);
+		}
+
+		// Runs f on every element of the family, in chunks balanced across the CPU thread pool
+		// Use getEntityCommandBuffer() to create/destroy entities or add/remove components from within f.
+		template <typename V, typename F>
+		static void parallelForEach(V& fam, F&& f, size_t chunkSize = defaultParallelChunkSize)
+		{
+			Concurrent::foreachChunked(Executors::getCPU(), std::begin(fam), std::end(fam), chunkSize, [&] (auto& e) {
 				f(e);
 			});
 		}
 
+		EntityCommandBuffer& getEntityCommandBuffer() const;
+
 		template <typename T>
 		void sendMessageGeneric(EntityId entityId, T msg)
 		{
-			auto toSend = std::make_unique<T>();
-			*toSend = std::move(msg);
-			doSendMessage(entityId, std::move(toSend), T::messageIndex);
+			world->getMessageBus().send(entityId, systemId, std::move(msg));
+			if (std::find(messageTypesSent.begin(), messageTypesSent.end(), T::messageIndex) == messageTypesSent.end()) {
+				messageTypesSent.push_back(T::messageIndex);
+			}
 		}
 
 		template <typename T, typename R, typename F>
@@ -176,11 +197,14 @@ namespace Halley {
 
 	private:
 		friend class World;
+		friend class SystemScheduler;
 
 		Vector<FamilyBindingBase*> families;
 		Vector<int> messageTypesReceived;
-		Vector<EntityId> messagesSentTo;
-		Vector<std::pair<EntityId, MessageEntry>> outbox;
+		Vector<int> messageTypesSent;
+		Vector<std::pair<size_t, Message*>> messagesReceived;
+		Vector<Message*> inboxMessages;
+		Vector<size_t> inboxIndices;
 		Vector<const SystemMessageContext*> systemMessageInbox;
 		Vector<const SystemMessageContext*> systemMessages;
 
@@ -188,11 +212,13 @@ namespace Halley {
 		const HalleyAPI* api = nullptr;
 		Resources* resources = nullptr;
 		String name;
+		const char* profilerName = "System";
 		int systemId = -1;
 		bool initialised = false;
 		bool collectSamples = false;
 
 		StopwatchRollingAveraging timer;
+		SystemAccessSignature accessSignature;
 
 		void doUpdate(Time time);
 		void doRender(RenderContext& rc);
@@ -200,7 +226,6 @@ namespace Halley {
 
 		void purgeMessages();
 		void processMessages();
-		void doSendMessage(EntityId target, std::unique_ptr<Message> msg, int msgId);
 		size_t doSendSystemMessage(SystemMessageContext context, const String& targetSystem);
 		void dispatchMessages();
 	};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <halley/data_structures/vector.h>
+#include <halley/text/halleystring.h>
+
+namespace Halley {
+	// Describes what a system touches during update, so the scheduler knows which systems can run concurrently
+	// Generated by codegen from the system's families, services and messages. A default-constructed signature is exclusive,
+	// so hand-written systems always run on their own.
+	// Components flagged with "mutableCache" in their schema (e.g. Transform2D) update caches from const methods, so
+	// codegen lists them as written even for systems that only read them.
+	class SystemAccessSignature {
+	public:
+		SystemAccessSignature() = default;
+		SystemAccessSignature(Vector<int> componentsRead, Vector<int> componentsWritten, Vector<String> sharedResources, bool exclusive, bool entityMessages);
+
+		bool conflictsWith(const SystemAccessSignature& other) const;
+
+		bool isExclusive() const { return exclusive; }
+		const Vector<int>& getComponentsRead() const { return componentsRead; }
+		const Vector<int>& getComponentsWritten() const { return componentsWritten; }
+		const Vector<String>& getSharedResources() const { return sharedResources; }
+		bool usesEntityMessages() const { return entityMessages; }
+
+	private:
+		Vector<int> componentsRead;
+		Vector<int> componentsWritten;
+		Vector<String> sharedResources;
+		bool exclusive = true;
+		bool entityMessages = false;
+	};
+}
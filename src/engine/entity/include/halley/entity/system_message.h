@@ -12,6 +12,9 @@ namespace Halley
 	public:
 		virtual ~SystemMessage() {}
 		virtual size_t getSize() const = 0;
+
+		void* operator new(size_t size);
+		void operator delete(void* ptr, size_t size);
 	};
 
 	struct SystemMessageContext {
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <halley/data_structures/vector.h>
+#include <halley/time/halleytime.h>
+
+namespace Halley {
+	class System;
+	class ExecutionQueue;
+
+	// Runs the systems of one timeline, dispatching those that don't conflict with each other on a thread pool
+	// Systems are grouped into stages: each system runs after every earlier system it conflicts with, so their
+	// component and API access happens as it would in timeline order.
+	// onStageDone is called once after each stage, whether or not it ran in parallel, so anything it publishes (e.g.
+	// spawned entities) is seen by later stages but not by the rest of the stage that produced it.
+	class SystemScheduler {
+	public:
+		void markDirty();
+
+		void run(Vector<std::unique_ptr<System>>& systems, Time elapsed, ExecutionQueue& queue, const std::function<void()>& onStageDone);
+
+		size_t getNumStages() const { return stages.size(); }
+
+	private:
+		Vector<Vector<size_t>> stages;
+		bool dirty = true;
+
+		void buildStages(const Vector<std::unique_ptr<System>>& systems);
+	};
+}
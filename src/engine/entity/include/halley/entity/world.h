@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <typeinfo>
 #include <type_traits>
 #include "entity_id.h"
@@ -8,12 +9,16 @@
 #include "family.h"
 #include <halley/time/halleytime.h>
 #include <halley/text/halleystring.h>
+#include <halley/text/string_id.h>
 #include <halley/data_structures/mapped_pool.h>
 #include <halley/time/stopwatch.h>
 #include <halley/data_structures/vector.h>
+#include <halley/data_structures/hash_map.h>
 #include <halley/data_structures/tree_map.h>
 #include "service.h"
 #include "create_functions.h"
+#include "system_scheduler.h"
+#include "message_bus.h"
 #include "halley/utils/attributes.h"
 
 namespace Halley {
@@ -25,6 +30,8 @@ namespace Halley {
 	class System;
 	class Painter;
 	class HalleyAPI;
+	class ArchetypeStorage;
+	class EntityCommandBuffer;
 
 	class World
 	{
@@ -62,7 +69,8 @@ namespace Halley {
 			static_assert(std::is_base_of<Service, T>::value, "Must extend Service");
 
 			const auto serviceName = typeid(T).name();
-			const auto rawService = tryGetService(serviceName);
+			static const StringId serviceId = String(serviceName);
+			const auto rawService = tryGetService(serviceId);
 			if (!rawService) {
 				if constexpr (std::is_default_constructible_v<T>) {
 					return dynamic_cast<T&>(addService(std::make_shared<T>()));
@@ -97,9 +105,15 @@ namespace Halley {
 
 		void spawnPending(); // Warning: use with care, will invalidate entities
 
-		void onEntityDirty();
+		// Returns a command buffer for the calling thread; it gets applied on the next spawnPending()
+		// Buffers are applied in order of CPU worker index, after those of threads outside the pool, rather than in the order the threads first asked for them.
+		// Only the order of commands recorded by the same thread is guaranteed, though: which worker picks up which job (and
+		// so which buffer a command lands in) can change from run to run, so commands from different threads must not depend on each other.
+		EntityCommandBuffer& getEntityCommandBuffer();
 
-		void setEntityReloaded();
+		void onEntityDirty(Entity& entity);
+
+		void setEntityReloaded(Entity& entity);
 
 		template <typename T>
 		Family& getFamily() noexcept
@@ -123,8 +137,20 @@ namespace Halley {
 
 		size_t sendSystemMessage(SystemMessageContext context, const String& targetSystem);
 
+		MessageBus& getMessageBus() { return messageBus; }
+		const MessageBus& getMessageBus() const { return messageBus; }
+
 		bool isDevMode() const;
 
+		void setParallelSystemsEnabled(bool enabled);
+		bool isParallelSystemsEnabled() const;
+
+		// Stores the components of entities with the same mask together, see Archetype. Must be set while the world is empty.
+		// Makes Entity::getComponent a direct lookup, and lets systems go through a family one array per component (Family::forEachChunk).
+		// Per-entity family references keep working, and are reloaded when an entity moves to a different archetype.
+		void setArchetypeStorageEnabled(bool enabled);
+		bool isArchetypeStorageEnabled() const;
+
 		void setEditor(bool isEditor);
 		bool isEditor() const;
 
@@ -132,31 +158,63 @@ namespace Halley {
 		const HalleyAPI& api;
 		Resources& resources;
 		std::array<Vector<std::unique_ptr<System>>, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> systems;
+		std::array<SystemScheduler, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> schedulers;
 		CreateComponentFunction createComponent;
 		bool collectMetrics = false;
 		bool entityDirty = false;
 		bool entityReloaded = false;
 		bool editor = false;
+		bool parallelSystems = false;
 		
 		Vector<Entity*> entities;
 		Vector<Entity*> entitiesPendingCreation;
+		Vector<Entity*> dirtyEntities;
+		Vector<Entity*> reloadedEntities;
+		Vector<Entity*> entitiesRemoved;
 		MappedPool<Entity*> entityMap;
 
 		//TreeMap<FamilyMaskType, std::unique_ptr<Family>> families;
 		Vector<std::unique_ptr<Family>> families;
-		TreeMap<String, std::shared_ptr<Service>> services;
+		HashMap<StringId, std::shared_ptr<Service>> services;
 
 		TreeMap<FamilyMaskType, std::vector<Family*>> familyCache;
 
+		struct FamilyTodo {
+			Vector<std::pair<FamilyMaskType, Entity*>> toAdd;
+			Vector<std::pair<FamilyMaskType, Entity*>> toRemove;
+			Vector<std::pair<FamilyMaskType, Entity*>> toReload;
+			Vector<std::pair<FamilyMaskType, Entity*>> toRefresh;
+			bool active = false;
+		};
+		// Kept between updates so that the vectors keep their capacity
+		TreeMap<FamilyMaskType, FamilyTodo> familyTodos;
+		Vector<std::pair<FamilyMaskType, FamilyTodo*>> activeFamilyTodos;
+
 		std::shared_ptr<MaskStorage> maskStorage;
 		std::shared_ptr<ComponentDeleterTable> componentDeleterTable;
+		std::unique_ptr<ArchetypeStorage> archetypeStorage;
+		size_t knownArchetypes = 0;
+
+		struct CommandBufferEntry {
+			size_t order;
+			std::shared_ptr<EntityCommandBuffer> buffer;
+		};
+
+		uint64_t worldId;
+		std::mutex commandBuffersMutex;
+		Vector<CommandBufferEntry> commandBuffers;
+		bool commandBuffersSorted = true;
 
 		mutable std::array<StopwatchRollingAveraging, 3> timer;
 
 		std::list<SystemMessageContext> pendingSystemMessages;
+		MessageBus messageBus;
 
 		void allocateEntity(Entity* entity);
+		void runEntityCommands();
 		void updateEntities();
+		FamilyTodo& getFamilyTodo(FamilyMaskType mask);
+		void markForDestruction(Entity& entity);
 		void initSystems();
 
 		void doDestroyEntity(EntityId id);
@@ -168,8 +226,9 @@ namespace Halley {
 
 		NOINLINE Family& addFamily(std::unique_ptr<Family> family) noexcept;
 		void onAddFamily(Family& family) noexcept;
+		void updateFamilyArchetypes();
 
-		Service* tryGetService(const String& name) const;
+		Service* tryGetService(StringId name) const;
 
 		const std::vector<Family*>& getFamiliesFor(const FamilyMaskType& mask);
 
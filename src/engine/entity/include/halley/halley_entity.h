@@ -17,6 +17,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "entity/family.h"
 #include "entity/entity_data.h"
 #include "entity/entity_data_delta.h"
+#include "entity/entity_command_buffer.h"
 #include "entity/entity_scene.h"
 #include "entity/entity_factory.h"
 #include "entity/entity_stage.h"
@@ -0,0 +1,92 @@
+#include "archetype.h"
+#include <algorithm>
+#include <gsl/gsl_assert>
+#include "type_deleter.h"
+#include <halley/utils/utils.h>
+#include <halley/support/exception.h>
+#include <halley/text/string_converter.h>
+
+using namespace Halley;
+
+Archetype::Archetype(FamilyMaskType mask, const Vector<int>& componentIds, const ComponentDeleterTable& table)
+	: mask(mask)
+{
+	columnByComponent.fill(-1);
+	columns.reserve(componentIds.size());
+
+	size_t offset = 0;
+	for (const auto id: componentIds) {
+		if (id < 0 || size_t(id) >= maxComponents) {
+			throw Exception("Invalid component id in archetype: " + toString(id), HalleyExceptions::Entity);
+		}
+
+		auto* deleter = table.get(id);
+		const size_t alignment = deleter->getAlignment();
+		chunkAlignment = std::max(chunkAlignment, alignment);
+		offset = alignUp(offset, alignment);
+
+		columnByComponent[id] = int16_t(columns.size());
+		columns.push_back(Column{ id, deleter->getSize(), offset });
+		offset += deleter->getSize() * chunkCapacity;
+	}
+	chunkSize = alignUp(std::max(offset, size_t(1)), chunkAlignment);
+}
+
+Archetype::~Archetype()
+{
+	// Components are owned by the entities, which must have released their slots by now
+	for (auto* chunk: chunks) {
+		::operator delete(chunk, std::align_val_t(chunkAlignment));
+	}
+}
+
+size_t Archetype::allocSlot(EntityId entityId)
+{
+	Expects(entityId.isValid());
+	++liveCount;
+	if (!freeSlots.empty()) {
+		// Reuse the lowest free slot first, to keep live entities packed towards the start
+		std::pop_heap(freeSlots.begin(), freeSlots.end(), std::greater<>());
+		const size_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		slotEntities[slot] = entityId;
+		return slot;
+	}
+
+	if (nextSlot == chunks.size() * chunkCapacity) {
+		allocChunk();
+	}
+	slotEntities.push_back(entityId);
+	return nextSlot++;
+}
+
+void Archetype::freeSlot(size_t slot)
+{
+	Expects(liveCount > 0);
+	Expects(slot < nextSlot);
+	--liveCount;
+	slotEntities[slot] = EntityId();
+	freeSlots.push_back(slot);
+	std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<>());
+}
+
+void Archetype::allocChunk()
+{
+	chunks.push_back(static_cast<char*>(::operator new(chunkSize, std::align_val_t(chunkAlignment))));
+}
+
+Archetype& ArchetypeStorage::getArchetype(FamilyMaskType mask, const Vector<int>& componentIds, const ComponentDeleterTable& table)
+{
+	auto iter = archetypes.find(mask);
+	if (iter != archetypes.end()) {
+		return *iter->second;
+	}
+
+	// Keep columns in component id order, so every entity with this mask maps to the same layout
+	auto ids = componentIds;
+	std::sort(ids.begin(), ids.end());
+	auto& result = archetypes[mask];
+	result = std::make_unique<Archetype>(mask, ids, table);
+	byCreation.push_back(result.get());
+	return *result;
+}
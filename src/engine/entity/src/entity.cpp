@@ -1,6 +1,7 @@
 #include <halley/data_structures/memory_pool.h>
 #include "entity.h"
 #include "world.h"
+#include "archetype.h"
 #include "components/transform_2d_component.h"
 
 
@@ -24,6 +25,7 @@ void Entity::destroyComponents(ComponentDeleterTable& table)
 	}
 	components.clear();
 	liveComponents = 0;
+	releaseArchetypeSlot();
 }
 
 void Entity::removeComponentById(World& world, int id)
@@ -83,7 +85,63 @@ void Entity::deleteComponent(Component* component, int id, ComponentDeleterTable
 {
 	TypeDeleterBase* deleter = table.get(id);
 	deleter->callDestructor(component);
-	PoolPool::getPool(deleter->getSize())->free(component);
+	if (!archetype || !archetype->owns(id, archetypeSlot, component)) {
+		PoolPool::getPool(deleter->getSize())->free(component);
+	}
+}
+
+bool Entity::relocateComponents(ArchetypeStorage& archetypes, ComponentDeleterTable& table)
+{
+	Archetype* target = nullptr;
+	if (!components.empty()) {
+		if (archetype && archetype->getMask() == mask) {
+			target = archetype;
+		} else {
+			Vector<int> ids;
+			ids.reserve(components.size());
+			for (const auto& c: components) {
+				ids.push_back(c.first);
+			}
+			target = &archetypes.getArchetype(mask, ids, table);
+		}
+	}
+	const size_t targetSlot = target == archetype ? archetypeSlot : (target ? target->allocSlot(entityId) : 0);
+
+	// Move every component that isn't already in its slot, releasing its old storage
+	bool relocated = false;
+	for (auto& c: components) {
+		void* dst = target->getComponent(c.first, targetSlot);
+		if (c.second != dst) {
+			table.get(c.first)->callMoveConstructor(dst, c.second);
+			deleteComponent(c.second, c.first, table);
+			c.second = static_cast<Component*>(dst);
+			relocated = true;
+		}
+	}
+
+	if (target != archetype) {
+		releaseArchetypeSlot();
+		archetype = target;
+		archetypeSlot = targetSlot;
+	}
+
+	if (relocated) {
+		// Children might be holding pointers to our components (e.g. their parent transform)
+		for (auto& child: children) {
+			child->markHierarchyDirty();
+		}
+	}
+	
+	return relocated;
+}
+
+void Entity::releaseArchetypeSlot()
+{
+	if (archetype) {
+		archetype->freeSlot(archetypeSlot);
+		archetype = nullptr;
+		archetypeSlot = 0;
+	}
 }
 
 void Entity::keepOnlyComponentsWithIds(const std::vector<int>& ids, World& world)
@@ -107,7 +165,7 @@ void Entity::markDirty(World& world)
 {
 	if (!dirty) {
 		dirty = true;
-		world.onEntityDirty();
+		world.onEntityDirty(*this);
 	}
 }
 
@@ -204,8 +262,9 @@ FamilyMaskType Entity::getMask() const
 	return mask;
 }
 
-void Entity::refresh(MaskStorage& storage, ComponentDeleterTable& table)
+bool Entity::refresh(MaskStorage& storage, ComponentDeleterTable& table, ArchetypeStorage* archetypes)
 {
+	bool relocated = false;
 	if (dirty) {
 		dirty = false;
 
@@ -222,11 +281,17 @@ void Entity::refresh(MaskStorage& storage, ComponentDeleterTable& table)
 		}
 		mask = FamilyMaskType(m, storage);
 
+		// Move components into contiguous storage shared with other entities of the same mask
+		if (archetypes) {
+			relocated = relocateComponents(*archetypes, table);
+		}
+
 		// Notify parent
 		if (parent) {
 			parent->propagateChildrenChange();
 		}
 	}
+	return relocated;
 }
 
 EntityId Entity::getEntityId() const
@@ -311,7 +376,10 @@ bool Entity::hasBit(const World& world, int index) const
 void EntityRef::setReloaded()
 {
 	Expects(entity);
+	if (entity->reloaded) {
+		return;
+	}
 	entity->reloaded = true;
 
-	world->setEntityReloaded();
+	world->setEntityReloaded(*entity);
 }
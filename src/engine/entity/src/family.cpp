@@ -70,3 +70,31 @@ void Family::reloadEntity(Entity& entity)
 {
 	toReload.push_back(entity.getEntityId());
 }
+
+void EntitySlotIndex::set(EntityId id, size_t slot)
+{
+	const auto idx = getIndex(id);
+	const auto page = idx / pageSize;
+	if (page >= pages.size()) {
+		pages.resize(page + 1);
+	}
+	if (!pages[page]) {
+		pages[page] = std::make_unique<Page>();
+		pages[page]->fill(static_cast<uint32_t>(invalidSlot));
+	}
+	(*pages[page])[idx % pageSize] = static_cast<uint32_t>(slot);
+}
+
+void EntitySlotIndex::remove(EntityId id)
+{
+	const auto idx = getIndex(id);
+	const auto page = idx / pageSize;
+	if (page < pages.size() && pages[page]) {
+		(*pages[page])[idx % pageSize] = static_cast<uint32_t>(invalidSlot);
+	}
+}
+
+void EntitySlotIndex::clear()
+{
+	pages.clear();
+}
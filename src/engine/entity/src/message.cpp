@@ -1,15 +1,26 @@
 #include "message.h"
+#include "system_message.h"
+#include <halley/data_structures/memory_pool.h>
 
 using namespace Halley;
 
-/*
 void* Message::operator new(size_t size)
 {
 	return PoolPool::getPool(size)->alloc();
 }
 
-void Message::operator delete(void* ptr)
+void Message::operator delete(void* ptr, size_t size)
 {
-	PoolPool::getPool(static_cast<Message*>(ptr)->getSize())->free(ptr);
+	// The destructor is virtual, so size is that of the most derived type
+	PoolPool::getPool(size)->free(ptr);
+}
+
+void* SystemMessage::operator new(size_t size)
+{
+	return PoolPool::getPool(size)->alloc();
+}
+
+void SystemMessage::operator delete(void* ptr, size_t size)
+{
+	PoolPool::getPool(size)->free(ptr);
 }
-*/
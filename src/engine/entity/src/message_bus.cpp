@@ -0,0 +1,111 @@
+#include "message_bus.h"
+#include <algorithm>
+#include <gsl/gsl_assert>
+#include <halley/utils/utils.h>
+
+using namespace Halley;
+
+MessageBus::~MessageBus()
+{
+	// Destroy messages before the streams release their memory
+	for (auto& stream: streams) {
+		if (stream) {
+			for (auto& e: stream->entries) {
+				e.msg->~Message();
+			}
+			stream->entries.clear();
+		}
+	}
+}
+
+void MessageBus::purge(int type, int age)
+{
+	if (auto* stream = tryGetStream(type)) {
+		stream->removeAge(age);
+	}
+}
+
+gsl::span<const MessageBus::Entry> MessageBus::getMessages(int type) const
+{
+	if (auto* stream = tryGetStream(type)) {
+		return stream->entries;
+	}
+	return {};
+}
+
+size_t MessageBus::getNumMessages() const
+{
+	size_t n = 0;
+	for (const auto& stream: streams) {
+		if (stream) {
+			n += stream->entries.size();
+		}
+	}
+	return n;
+}
+
+MessageBus::Stream& MessageBus::getStream(int type, size_t size, size_t alignment)
+{
+	Expects(type >= 0);
+	if (size_t(type) >= streams.size()) {
+		streams.resize(size_t(type) + 1);
+	}
+	auto& stream = streams[type];
+	if (!stream) {
+		stream = std::make_unique<Stream>(size, alignment);
+	}
+	Expects(stream->getSlotSize() == alignUp(size, alignment));
+	return *stream;
+}
+
+MessageBus::Stream* MessageBus::tryGetStream(int type) const
+{
+	return type >= 0 && size_t(type) < streams.size() ? streams[type].get() : nullptr;
+}
+
+MessageBus::Stream::Stream(size_t slotSize, size_t slotAlignment)
+	: slotSize(alignUp(slotSize, slotAlignment))
+	, slotAlignment(std::max(slotAlignment, alignof(void*)))
+{
+}
+
+MessageBus::Stream::~Stream()
+{
+	Expects(entries.empty());
+	for (auto* block: blocks) {
+		::operator delete(block, std::align_val_t(slotAlignment));
+	}
+}
+
+void* MessageBus::Stream::allocSlot()
+{
+	if (freeSlots.empty()) {
+		auto* block = static_cast<char*>(::operator new(slotSize * slotsPerBlock, std::align_val_t(slotAlignment)));
+		blocks.push_back(block);
+
+		// Hand out the lowest addresses first, so that messages sent together end up next to each other
+		freeSlots.reserve(freeSlots.size() + slotsPerBlock);
+		for (size_t i = slotsPerBlock; i > 0; --i) {
+			freeSlots.push_back(block + (i - 1) * slotSize);
+		}
+	}
+
+	auto* result = freeSlots.back();
+	freeSlots.pop_back();
+	return result;
+}
+
+void MessageBus::Stream::removeAge(int age)
+{
+	// Destroys matching messages, keeping the order of the remaining ones
+	// Messages still pending are left alone, as their sender hasn't dispatched them yet
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [&] (const Entry& e)
+	{
+		if (e.age == age && e.delivered) {
+			e.msg->~Message();
+			freeSlots.push_back(e.msg);
+			return true;
+		}
+		return false;
+	}), entries.end());
+}
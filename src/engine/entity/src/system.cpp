@@ -1,6 +1,7 @@
 #include "system.h"
-#include <halley/data_structures/flat_map.h>
+#include <algorithm>
 #include "halley/support/debug.h"
+#include "entity_command_buffer.h"
 
 using namespace Halley;
 
@@ -9,6 +10,8 @@ System::System(Vector<FamilyBindingBase*> uninitializedFamilies, Vector<int> mes
 	, messageTypesReceived(std::move(messageTypesReceived))
 	, timer(0)
 {
+	// Message types are processed in id order
+	std::sort(this->messageTypesReceived.begin(), this->messageTypesReceived.end());
 }
 
 size_t System::getEntityCount() const
@@ -35,6 +38,11 @@ void System::setCollectSamples(bool collect)
 	collectSamples = collect;
 }
 
+EntityCommandBuffer& System::getEntityCommandBuffer() const
+{
+	return world->getEntityCommandBuffer();
+}
+
 void System::onAddedToWorld(World& w, int id) {
 	world = &w;
 	systemId = id;
@@ -46,70 +54,52 @@ void System::onAddedToWorld(World& w, int id) {
 
 void System::purgeMessages()
 {
-	if (!messagesSentTo.empty()) {
-		for (auto& target: messagesSentTo) {
-			// Purge all messages of this age
-			Entity* entity = world->tryGetRawEntity(target);
-
-			if (entity) {
-				auto& inbox = entity->inbox;
-				inbox.erase(std::remove_if(inbox.begin(), inbox.end(), [&] (const MessageEntry& e) { return e.age == systemId; }), inbox.end());
-			}
-		}
-		messagesSentTo.clear();
+	// Messages sent on the previous update have now been seen by every other system
+	auto& bus = world->getMessageBus();
+	for (const auto type: messageTypesSent) {
+		bus.purge(type, systemId);
 	}
 }
 
 void System::processMessages()
 {
-	// This whole method is probably very inefficient.
-	struct MessageBox
-	{
-		Vector<Message*> msg;
-		Vector<size_t> elemIdx;
-	};
-	FlatMap<int, MessageBox> inboxes;
-
-	if (!families.empty()) {
-		auto& fam = *families[0];
-		size_t sz = fam.count();
-		for (size_t i = 0; i < sz; i++) {
-			FamilyBase* elem = reinterpret_cast<FamilyBase*>(fam.getElement(i));
-			Entity* entity = world->tryGetRawEntity(elem->entityId);
-			if (entity) {
-				for (const auto& msg: entity->inbox) {
-					if (std::find(messageTypesReceived.begin(), messageTypesReceived.end(), msg.type) != messageTypesReceived.end()) {
-						auto& inbox = inboxes[msg.type];
-						inbox.msg.emplace_back(msg.msg.get());
-						inbox.elemIdx.emplace_back(i);
-					}
+	if (families.empty()) {
+		return;
+	}
+
+	// Deliver to entities in the main family, in family order
+	// Messages for the same entity keep the order they were sent in, so this matches walking each entity's messages in turn
+	const auto& bus = world->getMessageBus();
+	const auto& fam = *families[0];
+	for (const auto type: messageTypesReceived) {
+		messagesReceived.clear();
+		for (const auto& entry: bus.getMessages(type)) {
+			if (entry.delivered) {
+				const size_t idx = fam.getIndexOf(entry.target);
+				if (idx != EntitySlotIndex::invalidSlot) {
+					messagesReceived.emplace_back(idx, entry.msg);
 				}
 			}
 		}
-		for (auto& iter : inboxes) {
-			int id = iter.first;
-			auto& inbox = iter.second;
-			onMessagesReceived(id, inbox.msg.data(), inbox.elemIdx.data(), inbox.msg.size());
+
+		if (!messagesReceived.empty()) {
+			std::stable_sort(messagesReceived.begin(), messagesReceived.end(), [] (const auto& a, const auto& b) { return a.first < b.first; });
+			inboxMessages.clear();
+			inboxIndices.clear();
+			for (const auto& m: messagesReceived) {
+				inboxIndices.push_back(m.first);
+				inboxMessages.push_back(m.second);
+			}
+			onMessagesReceived(type, inboxMessages.data(), inboxIndices.data(), inboxMessages.size());
 		}
 	}
 }
 
-void System::doSendMessage(EntityId entityId, std::unique_ptr<Message> msg, int id)
-{
-	outbox.emplace_back(std::make_pair(entityId, MessageEntry(std::move(msg), id, systemId)));
-}
-
 void System::dispatchMessages()
 {
-	if (!outbox.empty()) {
-		for (auto& o: outbox) {
-			Entity* entity = world->tryGetRawEntity(o.first);
-			if (entity) {
-				entity->inbox.emplace_back(std::move(o.second));
-				messagesSentTo.push_back(o.first);
-			}
-		}
-		outbox.clear();
+	auto& bus = world->getMessageBus();
+	for (const auto type: messageTypesSent) {
+		bus.dispatch(type, systemId, [&] (EntityId target) { return world->tryGetRawEntity(target) == nullptr; });
 	}
 }
 
@@ -144,6 +134,7 @@ size_t System::getSystemMessagesInInbox() const
 
 void System::doUpdate(Time time) {
 	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
+	ProfilerEvent event(profilerName);
 	if (collectSamples) {
 		timer.beginSample();
 	}
@@ -168,6 +159,7 @@ void System::doRender(RenderContext& rc) {
 	}
 	
 	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
+	ProfilerEvent event(profilerName);
 	if (collectSamples) {
 		timer.beginSample();
 	}
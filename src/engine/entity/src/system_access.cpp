@@ -0,0 +1,43 @@
+#include "system_access.h"
+#include <algorithm>
+
+using namespace Halley;
+
+namespace {
+	template <typename T>
+	bool intersects(const Vector<T>& a, const Vector<T>& b)
+	{
+		for (const auto& v: a) {
+			if (std::find(b.begin(), b.end(), v) != b.end()) {
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+SystemAccessSignature::SystemAccessSignature(Vector<int> componentsRead, Vector<int> componentsWritten, Vector<String> sharedResources, bool exclusive, bool entityMessages)
+	: componentsRead(std::move(componentsRead))
+	, componentsWritten(std::move(componentsWritten))
+	, sharedResources(std::move(sharedResources))
+	, exclusive(exclusive)
+	, entityMessages(entityMessages)
+{
+}
+
+bool SystemAccessSignature::conflictsWith(const SystemAccessSignature& other) const
+{
+	if (exclusive || other.exclusive) {
+		return true;
+	}
+
+	// Entity messages go through the world's MessageBus, which isn't safe to touch from more than one system at a time
+	if (entityMessages && other.entityMessages) {
+		return true;
+	}
+
+	return intersects(componentsWritten, other.componentsWritten)
+		|| intersects(componentsWritten, other.componentsRead)
+		|| intersects(componentsRead, other.componentsWritten)
+		|| intersects(sharedResources, other.sharedResources);
+}
@@ -0,0 +1,92 @@
+#include "system_scheduler.h"
+#include "system.h"
+#include <halley/concurrency/concurrent.h>
+#include <halley/data_structures/frame_allocator.h>
+#include <halley/support/debug.h>
+
+using namespace Halley;
+
+void SystemScheduler::markDirty()
+{
+	dirty = true;
+}
+
+void SystemScheduler::run(Vector<std::unique_ptr<System>>& systems, Time elapsed, ExecutionQueue& queue, const std::function<void()>& onStageDone)
+{
+	if (dirty) {
+		buildStages(systems);
+		dirty = false;
+	}
+
+	const bool hasWorkers = queue.threadCount() > 0;
+	FrameVector<Future<void>> futures;
+	FrameVector<std::exception_ptr> errors;
+
+	for (auto& stage: stages) {
+		if (stage.size() == 1 || !hasWorkers) {
+			for (const auto idx: stage) {
+				systems[idx]->doUpdate(elapsed);
+			}
+			onStageDone();
+			continue;
+		}
+
+		// Exceptions can't be allowed to escape into the thread pool, so they're collected and re-thrown here
+		futures.clear();
+		errors.clear();
+		errors.resize(stage.size());
+		for (size_t i = 1; i < stage.size(); ++i) {
+			auto* system = systems[stage[i]].get();
+			auto* error = &errors[i];
+			futures.push_back(Concurrent::execute(queue, [system, error, elapsed] ()
+			{
+				// The debug trace ring is only written from the thread running the world
+				Debug::setTraceEnabledOnThisThread(false);
+				try {
+					system->doUpdate(elapsed);
+				} catch (...) {
+					*error = std::current_exception();
+				}
+				Debug::setTraceEnabledOnThisThread(true);
+			}));
+		}
+
+		// Run the first one on this thread rather than waiting idle
+		try {
+			systems[stage[0]]->doUpdate(elapsed);
+		} catch (...) {
+			errors[0] = std::current_exception();
+		}
+		Concurrent::whenAll(futures.begin(), futures.end()).wait();
+
+		for (auto& e: errors) {
+			if (e) {
+				std::rethrow_exception(e);
+			}
+		}
+
+		onStageDone();
+	}
+}
+
+void SystemScheduler::buildStages(const Vector<std::unique_ptr<System>>& systems)
+{
+	// Each system goes in the stage right after the latest earlier system it conflicts with
+	stages.clear();
+	Vector<size_t> stageOf(systems.size(), 0);
+	for (size_t i = 0; i < systems.size(); ++i) {
+		const auto& access = systems[i]->getAccessSignature();
+		size_t stage = 0;
+		for (size_t j = 0; j < i; ++j) {
+			if (stage <= stageOf[j] && access.conflictsWith(systems[j]->getAccessSignature())) {
+				stage = stageOf[j] + 1;
+			}
+		}
+		stageOf[i] = stage;
+
+		if (stages.size() <= stage) {
+			stages.resize(stage + 1);
+		}
+		stages[stage].push_back(i);
+	}
+}
@@ -1,11 +1,15 @@
 #include <iostream>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
 #include <halley/support/exception.h>
 #include <halley/data_structures/memory_pool.h>
 #include <halley/utils/utils.h>
 #include "world.h"
 #include "system.h"
 #include "family.h"
+#include "archetype.h"
+#include "entity_command_buffer.h"
 #include "halley/text/string_converter.h"
 #include "halley/support/debug.h"
 #include "halley/file_formats/config_file.h"
@@ -13,9 +17,14 @@
 #include "halley/core/api/halley_api.h"
 #include "halley/core/graphics/render_context.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/executor.h"
 
 using namespace Halley;
 
+namespace {
+	std::atomic<uint64_t> nextWorldId { 1 };
+}
+
 World::World(const HalleyAPI& api, Resources& resources, bool collectMetrics, CreateComponentFunction createComponent)
 	: api(api)
 	, resources(resources)
@@ -23,6 +32,7 @@ World::World(const HalleyAPI& api, Resources& resources, bool collectMetrics, Cr
 	, collectMetrics(collectMetrics)
 	, maskStorage(FamilyMask::MaskStorageInterface::createStorage())
 	, componentDeleterTable(std::make_shared<ComponentDeleterTable>())
+	, worldId(nextWorldId++)
 {
 	for (auto& t: timer) {
 		t.setNumSamples(isDevMode() ? 300 : 30);
@@ -58,6 +68,8 @@ std::unique_ptr<World> World::make(const HalleyAPI& api, Resources& resources, c
 {
 	auto world = std::make_unique<World>(api, resources, devMode, CreateEntityFunctions::getCreateComponent());
 	const auto& sceneConfig = resources.get<ConfigFile>(sceneName)->getRoot();
+	world->setArchetypeStorageEnabled(sceneConfig["archetypeStorage"].asBool(false));
+	world->setParallelSystemsEnabled(sceneConfig["parallelSystems"].asBool(false));
 	world->loadSystems(sceneConfig, CreateEntityFunctions::getCreateSystem());
 	return world;
 }
@@ -70,16 +82,19 @@ System& World::addSystem(std::unique_ptr<System> system, TimeLine timelineType)
 	auto& ref = *system.get();
 	auto& timeline = getSystems(timelineType);
 	timeline.emplace_back(std::move(system));
+	schedulers[static_cast<int>(timelineType)].markDirty();
 	ref.onAddedToWorld(*this, int(timeline.size()));
 	return ref;
 }
 
 void World::removeSystem(System& system)
 {
-	for (auto& sys : systems) {
+	for (size_t t = 0; t < systems.size(); ++t) {
+		auto& sys = systems[t];
 		for (size_t i = 0; i < sys.size(); i++) {
 			if (sys[i].get() == &system) {
 				sys.erase(sys.begin() + i);
+				schedulers[t].markDirty();
 				return;
 			}
 		}
@@ -128,10 +143,11 @@ System& World::getSystem(const String& name)
 Service& World::addService(std::shared_ptr<Service> service)
 {
 	auto& ref = *service;
-	if (services.find(service->getName()) != services.end()) {
-		throw Exception("Service already registered: " + service->getName(), HalleyExceptions::Entity);
+	const auto name = service->getName();
+	if (services.find(name) != services.end()) {
+		throw Exception("Service already registered: " + name, HalleyExceptions::Entity);
 	}
-	services[service->getName()] = std::move(service);
+	services[name] = std::move(service);
 	return ref;
 }
 
@@ -158,7 +174,7 @@ void World::loadSystems(const ConfigNode& root, std::function<std::unique_ptr<Sy
 	}
 }
 
-Service* World::tryGetService(const String& name) const
+Service* World::tryGetService(StringId name) const
 {
 	const auto iter = services.find(name);
 	if (iter == services.end()) {
@@ -231,10 +247,22 @@ void World::doDestroyEntity(EntityId id)
 
 void World::doDestroyEntity(Entity* e)
 {
+	markForDestruction(*e);
 	e->destroy();
 	entityDirty = true;
 }
 
+void World::markForDestruction(Entity& entity)
+{
+	// Entity::destroy() marks the whole hierarchy dirty without telling us, so queue it up here
+	if (!entity.dirty) {
+		dirtyEntities.push_back(&entity);
+	}
+	for (auto* child: entity.children) {
+		markForDestruction(*child);
+	}
+}
+
 EntityRef World::getEntity(EntityId id)
 {
 	Entity* entity = tryGetRawEntity(id);
@@ -351,13 +379,15 @@ std::vector<ConstEntityRef> World::getTopLevelEntities() const
 	return result;
 }
 
-void World::onEntityDirty()
+void World::onEntityDirty(Entity& entity)
 {
+	dirtyEntities.push_back(&entity);
 	entityDirty = true;
 }
 
-void World::setEntityReloaded()
+void World::setEntityReloaded(Entity& entity)
 {
+	reloadedEntities.push_back(&entity);
 	entityReloaded = true;
 	entityDirty = true;
 }
@@ -399,6 +429,37 @@ bool World::isDevMode() const
 	return api.core->isDevMode();
 }
 
+void World::setParallelSystemsEnabled(bool enabled)
+{
+	parallelSystems = enabled;
+}
+
+bool World::isParallelSystemsEnabled() const
+{
+	return parallelSystems;
+}
+
+void World::setArchetypeStorageEnabled(bool enabled)
+{
+	if (enabled == isArchetypeStorageEnabled()) {
+		return;
+	}
+	if (!entities.empty() || !entitiesPendingCreation.empty()) {
+		throw Exception("Archetype storage can only be toggled on an empty world", HalleyExceptions::Entity);
+	}
+	archetypeStorage = enabled ? std::make_unique<ArchetypeStorage>() : std::unique_ptr<ArchetypeStorage>();
+	knownArchetypes = 0;
+	for (auto& family: families) {
+		family->archetypes.clear();
+		family->archetypeStorageEnabled = enabled;
+	}
+}
+
+bool World::isArchetypeStorageEnabled() const
+{
+	return static_cast<bool>(archetypeStorage);
+}
+
 void World::setEditor(bool isEditor)
 {
 	editor = isEditor;
@@ -466,14 +527,76 @@ void World::allocateEntity(Entity* entity) {
 	entity->entityId.value = res.second;
 }
 
+EntityCommandBuffer& World::getEntityCommandBuffer()
+{
+	struct ThreadBuffer {
+		uint64_t worldId;
+		EntityCommandBuffer* buffer;
+		std::weak_ptr<EntityCommandBuffer> owner;
+	};
+
+	// World ids are never reused, so stale entries from destroyed worlds can't be matched
+	thread_local Vector<ThreadBuffer> threadBuffers;
+	for (auto& b: threadBuffers) {
+		if (b.worldId == worldId) {
+			return *b.buffer;
+		}
+	}
+
+	// Drop entries of worlds that are gone, so a long lived thread doesn't keep growing the list
+	threadBuffers.erase(std::remove_if(threadBuffers.begin(), threadBuffers.end(), [] (const ThreadBuffer& b) { return b.owner.expired(); }), threadBuffers.end());
+
+	// Threads outside the CPU pool go first, in order of creation, then workers by index
+	const auto workerIdx = Executors::hasInstance() ? Executors::getCPU().getCurrentWorkerIndex() : std::optional<size_t>();
+	const size_t order = workerIdx ? *workerIdx + 1 : 0;
+
+	auto buffer = std::make_shared<EntityCommandBuffer>();
+	threadBuffers.push_back(ThreadBuffer{ worldId, buffer.get(), buffer });
+
+	std::unique_lock<std::mutex> lock(commandBuffersMutex);
+	commandBuffersSorted = commandBuffersSorted && (commandBuffers.empty() || commandBuffers.back().order <= order);
+	commandBuffers.push_back(CommandBufferEntry{ order, std::move(buffer) });
+	return *commandBuffers.back().buffer;
+}
+
+void World::runEntityCommands()
+{
+	{
+		std::unique_lock<std::mutex> lock(commandBuffersMutex);
+		if (!commandBuffersSorted) {
+			std::stable_sort(commandBuffers.begin(), commandBuffers.end(), [] (const CommandBufferEntry& a, const CommandBufferEntry& b) { return a.order < b.order; });
+			commandBuffersSorted = true;
+		}
+	}
+
+	// Don't hold the lock while running, as commands are free to request a command buffer themselves
+	for (size_t i = 0; ; ++i) {
+		EntityCommandBuffer* buffer = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(commandBuffersMutex);
+			if (i >= commandBuffers.size()) {
+				break;
+			}
+			buffer = commandBuffers[i].buffer.get();
+		}
+		if (!buffer->empty()) {
+			buffer->run(*this);
+		}
+	}
+}
+
 void World::spawnPending()
 {
+	runEntityCommands();
+
 	if (!entitiesPendingCreation.empty()) {
 		HALLEY_DEBUG_TRACE();
+		entities.reserve(entities.size() + entitiesPendingCreation.size());
 		for (auto& e : entitiesPendingCreation) {
 			e->onReady();
+			e->worldIndex = entities.size();
+			entities.push_back(e);
 		}
-		std::move(entitiesPendingCreation.begin(), entitiesPendingCreation.end(), std::insert_iterator<decltype(entities)>(entities, entities.end()));
 		entitiesPendingCreation.clear();
 		entityDirty = true;
 		HALLEY_DEBUG_TRACE();
@@ -482,6 +605,16 @@ void World::spawnPending()
 	updateEntities();
 }
 
+World::FamilyTodo& World::getFamilyTodo(FamilyMaskType mask)
+{
+	auto& todo = familyTodos[mask];
+	if (!todo.active) {
+		todo.active = true;
+		activeFamilyTodos.emplace_back(mask, &todo);
+	}
+	return todo;
+}
+
 void World::updateEntities()
 {
 	if (!entityDirty) {
@@ -491,23 +624,14 @@ void World::updateEntities()
 	entityDirty = false;
 
 	HALLEY_DEBUG_TRACE();
-	size_t nEntities = entities.size();
-
-	std::vector<size_t> entitiesRemoved;
 
-	struct FamilyTodo {
-		std::vector<std::pair<FamilyMaskType, Entity*>> toAdd;
-		std::vector<std::pair<FamilyMaskType, Entity*>> toRemove;
-		std::vector<std::pair<FamilyMaskType, Entity*>> toReload;
-	};
-	std::map<FamilyMaskType, FamilyTodo> pending;
-
-	// Update all entities
+	// Update all entities that were marked dirty since the last update
 	// This loop should be as fast as reasonably possible
-	for (size_t i = 0; i < nEntities; i++) {
-		auto& entity = *entities[i];
-		if (i + 20 < nEntities) { // Watch out for sign! Don't subtract!
-			prefetchL2(entities[i + 20]);
+	const size_t nDirty = dirtyEntities.size();
+	for (size_t i = 0; i < nDirty; i++) {
+		auto& entity = *dirtyEntities[i];
+		if (i + 20 < nDirty) { // Watch out for sign! Don't subtract!
+			prefetchL2(dirtyEntities[i + 20]);
 		}
 
 		// Check if it needs any sort of updating
@@ -515,67 +639,85 @@ void World::updateEntities()
 			// First of all, let's check if it's dead
 			if (!entity.isAlive()) {
 				// Remove from systems
-				pending[entity.getMask()].toRemove.emplace_back(FamilyMaskType(), &entity);
-				entitiesRemoved.push_back(i);
+				getFamilyTodo(entity.getMask()).toRemove.emplace_back(FamilyMaskType(), &entity);
+				entitiesRemoved.push_back(&entity);
 			} else {
 				// It's alive, so check old and new system inclusions
 				FamilyMaskType oldMask = entity.getMask();
-				entity.refresh(*maskStorage, *componentDeleterTable);
+				const bool relocated = entity.refresh(*maskStorage, *componentDeleterTable, archetypeStorage.get());
 				FamilyMaskType newMask = entity.getMask();
 
 				// Did it change?
 				if (oldMask != newMask) {
-					pending[oldMask].toRemove.emplace_back(newMask, &entity);
-					pending[newMask].toAdd.emplace_back(oldMask, &entity);
+					getFamilyTodo(oldMask).toRemove.emplace_back(newMask, &entity);
+					getFamilyTodo(newMask).toAdd.emplace_back(oldMask, &entity);
+				} else if (relocated) {
+					// Same families, but component addresses changed
+					getFamilyTodo(newMask).toRefresh.emplace_back(newMask, &entity);
 				}
 			}
 		}
 	}
+	dirtyEntities.clear();
+
+	if (archetypeStorage) {
+		updateFamilyArchetypes();
+	}
 
 	if (entityReloaded) {
-		for (size_t i = 0; i < nEntities; i++) {
-			auto& entity = *entities[i];
-			if (entity.reloaded && entity.isAlive()) {
-				pending[entity.getMask()].toReload.emplace_back(entity.getMask(), &entity);
-				entity.reloaded = false;
+		for (auto* entity: reloadedEntities) {
+			if (entity->reloaded && entity->isAlive()) {
+				getFamilyTodo(entity->getMask()).toReload.emplace_back(entity->getMask(), entity);
+				entity->reloaded = false;
 			}
 		}
+		reloadedEntities.clear();
 	}
 
 	entityReloaded = false;
 
 	HALLEY_DEBUG_TRACE();
 	// Go through every family adding/removing entities as needed
-	for (auto& todo: pending) {
-		for (auto* fam: getFamiliesFor(todo.first)) {
+	for (auto& [mask, todo]: activeFamilyTodos) {
+		for (auto* fam: getFamiliesFor(mask)) {
 			const auto& famMask = fam->inclusionMask;
 			const auto& optFamMask = fam->optionalMask;
 			auto& ms = *maskStorage;
 			
-			for (auto& e: todo.second.toRemove) {
+			for (auto& e: todo->toRemove) {
 				// Only remove if the entity is not about to be re-added
 				const auto& newMask = e.first;
 				if (!newMask.contains(famMask, ms)) {
 					fam->removeEntity(*e.second);
 				}
 			}
-			for (auto& e: todo.second.toAdd) {
+			for (auto& e: todo->toAdd) {
 				// Only add if the entity was not already in this
 				const auto& oldMask = e.first;
-				const auto& newMask = todo.first;
+				const auto& newMask = mask;
 				if (!oldMask.contains(famMask, ms)) {
 					fam->addEntity(*e.second);
-				} else if (optFamMask.unionChangedBetween(oldMask, newMask, ms)) {
-					// Needs refreshing of optional references
+				} else if (archetypeStorage || optFamMask.unionChangedBetween(oldMask, newMask, ms)) {
+					// Needs refreshing of optional references, or of all references if the entity moved to a new archetype
 					fam->refreshEntity(*e.second);
 				}
 			}
+			for (auto& e: todo->toRefresh) {
+				fam->refreshEntity(*e.second);
+			}
 
-			for (auto& e : todo.second.toReload) {
+			for (auto& e : todo->toReload) {
 				fam->reloadEntity(*e.second);
 			}
 		}
+
+		todo->toAdd.clear();
+		todo->toRemove.clear();
+		todo->toReload.clear();
+		todo->toRefresh.clear();
+		todo->active = false;
 	}
+	activeFamilyTodos.clear();
 
 	HALLEY_DEBUG_TRACE();
 	// Update families
@@ -585,21 +727,19 @@ void World::updateEntities()
 	
 	HALLEY_DEBUG_TRACE();
 	// Actually remove dead entities
-	if (!entitiesRemoved.empty()) {
-		size_t livingEntityCount = entities.size();
-		for (int i = int(entitiesRemoved.size()); --i >= 0; ) {
-			size_t idx = entitiesRemoved[i];
-			auto& entity = *entities[idx];
-
-			// Remove
-			entityMap.freeId(entity.getEntityId().value);
-			deleteEntity(&entity);
-
-			// Put it at the back of the array, so it's removed when the array gets resized
-			std::swap(entities[idx], entities[--livingEntityCount]);
-		}
-		entities.resize(livingEntityCount);
+	for (auto* entity: entitiesRemoved) {
+		// Put the last entity in its place
+		const size_t idx = entity->worldIndex;
+		Expects(idx < entities.size() && entities[idx] == entity);
+		entities[idx] = entities.back();
+		entities[idx]->worldIndex = idx;
+		entities.pop_back();
+
+		// Remove
+		entityMap.freeId(entity->getEntityId().value);
+		deleteEntity(entity);
 	}
+	entitiesRemoved.clear();
 
 	HALLEY_DEBUG_TRACE();
 }
@@ -618,6 +758,14 @@ void World::initSystems()
 
 void World::updateSystems(TimeLine timeline, Time elapsed)
 {
+	if (parallelSystems) {
+		schedulers[static_cast<int>(timeline)].run(getSystems(timeline), elapsed, Executors::getCPU(), [this] ()
+		{
+			spawnPending();
+		});
+		return;
+	}
+	
 	for (auto& system : getSystems(timeline)) {
 		system->doUpdate(elapsed);
 		spawnPending();
@@ -649,9 +797,31 @@ void World::onAddFamily(Family& family) noexcept
 			family.addEntity(entity);
 		}
 	}
+
+	// Archetypes created after this point are picked up by updateFamilyArchetypes()
+	family.archetypeStorageEnabled = isArchetypeStorageEnabled();
+	for (size_t i = 0; i < knownArchetypes; ++i) {
+		const auto& archetype = archetypeStorage->getArchetype(i);
+		if (archetype.getMask().contains(family.inclusionMask, *maskStorage)) {
+			family.archetypes.push_back(&archetype);
+		}
+	}
+
 	familyCache.clear();
 }
 
+void World::updateFamilyArchetypes()
+{
+	// Let families know about the archetypes created by entities refreshed since the last update
+	const size_t n = archetypeStorage->getNumArchetypes();
+	for (; knownArchetypes < n; ++knownArchetypes) {
+		const auto& archetype = archetypeStorage->getArchetype(knownArchetypes);
+		for (auto* family: getFamiliesFor(archetype.getMask())) {
+			family->archetypes.push_back(&archetype);
+		}
+	}
+}
+
 const std::vector<Family*>& World::getFamiliesFor(const FamilyMaskType& mask)
 {
 	auto i = familyCache.find(mask);
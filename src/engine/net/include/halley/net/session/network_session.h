@@ -1,4 +1,6 @@
 #pragma once
+#include <chrono>
+#include <map>
 #include "halley/utils/utils.h"
 #include "halley/bytes/byte_serializer.h"
 #include "../connection/iconnection.h"
@@ -51,6 +53,25 @@ namespace Halley {
 		virtual void onDisconnected(int peerId);
 		
 	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct SharedDataTarget {
+			uint32_t ackedVersion = 0; // 0 until the target acknowledges a version, so it's sent the full state
+			uint32_t sentVersion = 0;
+			Clock::time_point sentTime;
+		};
+
+		// The versions of one SharedData, as seen by this peer, and which of them each connection has
+		struct SharedDataReplica {
+			uint32_t generation = 0;
+			uint32_t version = 0;
+			uint32_t oldestBaseVersion = 0; // The source won't send deltas from anything older than this
+			std::map<uint32_t, Bytes> states;
+			const IConnection* source = nullptr; // nullptr if owned by this peer
+			std::map<const IConnection*, SharedDataTarget> targets;
+			Clock::time_point snapshotTime;
+		};
+
 		NetworkService& service;
 		NetworkSessionType type = NetworkSessionType::Undefined;
 
@@ -59,25 +80,34 @@ namespace Halley {
 
 		std::unique_ptr<SharedData> sessionSharedData;
 		std::map<int, std::unique_ptr<SharedData>> sharedData;
+		std::map<int, SharedDataReplica> sharedDataReplicas; // By owner id, -1 for the session
+		uint32_t lastSharedDataGeneration = 0;
 
 		std::vector<std::shared_ptr<IConnection>> connections;
 		std::vector<InboundNetworkPacket> inbox;
 
 		OutboundNetworkPacket makeOutbound(gsl::span<const gsl::byte> data, NetworkSessionMessageHeader header);
 		void sendToAll(OutboundNetworkPacket&& packet, int except = -1);
+		IConnection& getConnection(int peerId);
 		void closeConnection(int peerId, const String& reason);
 		void processReceive();
 
-		void retransmitControlMessage(int peerId, gsl::span<const gsl::byte> bytes);
 		void receiveControlMessage(int peerId, InboundNetworkPacket& packet);
 		void onControlMessage(int peerId, const ControlMsgSetPeerId& msg);
 		void onControlMessage(int peerId, const ControlMsgSetPeerState& msg);
 		void onControlMessage(int peerId, const ControlMsgSetSessionState& msg);
+		void onControlMessage(int peerId, const ControlMsgSharedDataAck& msg);
 
 		void setMyPeerId(int id);
 
-		void checkForOutboundStateChanges(int ownerId);
-		OutboundNetworkPacket makeUpdateSharedDataPacket(int ownerId);
+		SharedData* tryGetSharedData(int ownerId);
+		void updateSharedData();
+		void snapshotSharedData(SharedData& data, SharedDataReplica& replica, Clock::time_point now);
+		void sendSharedDataUpdates(int ownerId, SharedDataReplica& replica, SharedDataCompression compression, Clock::time_point now);
+		void receiveSharedDataUpdate(int peerId, int ownerId, SharedData& data, const SharedDataUpdate& update);
+		void sendSharedDataAck(IConnection& connection, int ownerId, uint32_t generation, uint32_t version);
+		void trimSharedDataStates(SharedDataReplica& replica);
+		OutboundNetworkPacket makeUpdateSharedDataPacket(int ownerId, SharedDataUpdate update);
 		
 		OutboundNetworkPacket doMakeControlPacket(NetworkSessionControlMessageType msgType, OutboundNetworkPacket&& packet);
 	};
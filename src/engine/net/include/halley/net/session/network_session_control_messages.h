@@ -1,12 +1,14 @@
 #pragma once
 #include "halley/utils/utils.h"
 #include "halley/bytes/byte_serializer.h"
+#include "shared_data.h"
 
 namespace Halley {
 	enum class NetworkSessionControlMessageType : int8_t {
 		SetPeerId,
 		SetSessionState,
-		SetPeerState
+		SetPeerState,
+		SharedDataAck
 	};
 
 	struct ControlMsgHeader
@@ -22,8 +24,24 @@ namespace Halley {
 		void deserialize(Deserializer& s);
 	};
 
+	// A new version of a SharedData, either in full, or as the changes from an earlier version the receiver acknowledged
+	struct SharedDataUpdate {
+		uint32_t generation = 0; // Increased by the host when a peer id is reused, as the new peer's versions start over
+		uint32_t version = 0;
+		uint32_t baseVersion = 0; // 0 if data is the full state
+		SharedDataCompression compression = SharedDataCompression::None;
+		uint32_t size = 0; // Of data, before compression
+		Bytes data;
+
+		static SharedDataUpdate make(uint32_t version, const Bytes& state, uint32_t baseVersion, const Bytes* base, SharedDataCompression compression);
+		Bytes getState(const Bytes* base) const;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+
 	struct ControlMsgSetSessionState {
-		Bytes state;
+		SharedDataUpdate update;
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
@@ -31,7 +49,16 @@ namespace Halley {
 
 	struct ControlMsgSetPeerState {
 		int8_t peerId = 0;
-		Bytes state;
+		SharedDataUpdate update;
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+
+	struct ControlMsgSharedDataAck {
+		int8_t ownerId = -1; // -1 for the session's shared data
+		uint32_t generation = 0;
+		uint32_t version = 0; // 0 asks for the full state, when an update can't be applied
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <cstdint>
+#include "halley/time/halleytime.h"
+
 namespace Halley {
 	class Deserializer;
 	class Serializer;
 
+	enum class SharedDataCompression : uint8_t {
+		None,
+		Deflate,
+		LZ
+	};
+
 	class SharedData {
     public:
 		virtual ~SharedData() = default;
@@ -12,10 +21,20 @@ namespace Halley {
 		void markUnmodified();
 		bool isModified() const;
 
+		// Minimum time between updates being sent, in seconds; changes made meanwhile are sent together
+		void setSendInterval(Time interval);
+		Time getSendInterval() const;
+
+		// Applied to every update, when it makes it smaller
+		void setCompression(SharedDataCompression compression);
+		SharedDataCompression getCompression() const;
+
 		virtual void serialize(Serializer& s) const = 0;
 		virtual void deserialize(Deserializer& s) = 0;
 
 	private:
 		bool modified = false;
+		Time sendInterval = 0;
+		SharedDataCompression compression = SharedDataCompression::None;
     };
 }
@@ -4,6 +4,14 @@
 #include "connection/network_packet.h"
 using namespace Halley;
 
+namespace {
+	// Updates that haven't been acknowledged after this long are sent again
+	constexpr double sharedDataResendTime = 1.0;
+
+	// Upper bound on past versions kept around as delta bases for targets, per SharedData; any the source may still use are always kept
+	constexpr size_t maxSharedDataStates = 64;
+}
+
 NetworkSession::NetworkSession(NetworkService& service)
 	: service(service)
 {
@@ -46,6 +54,7 @@ void NetworkSession::close()
 		c->close();
 	}
 	connections.clear();
+	sharedDataReplicas.clear();
 
 	type = NetworkSessionType::Undefined;
 	myPeerId = -1;
@@ -93,12 +102,15 @@ void NetworkSession::acceptConnection(std::shared_ptr<IConnection> incoming)
 	Bytes bytes = Serializer::toBytes(msg);
 	sharedData[msg.peerId] = makePeerSharedData();
 
+	// Peer ids are reused, so start over from whatever a previous peer with this id had
+	auto& replica = sharedDataReplicas[msg.peerId];
+	replica = SharedDataReplica();
+	replica.generation = ++lastSharedDataGeneration;
+	replica.source = connections.back().get();
+
+	// The shared data is sent on the next update, as for any other connection that hasn't got it yet
 	auto& conn = *connections.back();
 	conn.send(doMakeControlPacket(NetworkSessionControlMessageType::SetPeerId, OutboundNetworkPacket(bytes)));
-	conn.send(makeUpdateSharedDataPacket(-1));
-	for (auto& i: sharedData) {
-		conn.send(makeUpdateSharedDataPacket(i.first));
-	}
 	onConnected(msg.peerId);
 }
 
@@ -108,6 +120,23 @@ void NetworkSession::update()
 	service.update();
 	connections.erase(std::remove_if(connections.begin(), connections.end(), [] (const std::shared_ptr<IConnection>& c) { return c->getStatus() == ConnectionStatus::Closed; }), connections.end());
 
+	// Forget what the removed connections had, and what they sent; done right away, as a new connection could reuse the same address
+	auto isAlive = [&] (const IConnection* conn)
+	{
+		return std::any_of(connections.begin(), connections.end(), [&] (const std::shared_ptr<IConnection>& c) { return c.get() == conn; });
+	};
+	for (auto replicaIter = sharedDataReplicas.begin(); replicaIter != sharedDataReplicas.end(); ) {
+		auto& replica = replicaIter->second;
+		if (replica.source && !isAlive(replica.source)) {
+			replicaIter = sharedDataReplicas.erase(replicaIter);
+			continue;
+		}
+		for (auto iter = replica.targets.begin(); iter != replica.targets.end(); ) {
+			iter = isAlive(iter->first) ? std::next(iter) : replica.targets.erase(iter);
+		}
+		++replicaIter;
+	}
+
 	if (type == NetworkSessionType::Host) {
 		if (getClientCount() < maxClients) { // I'm also a client!
 			service.setAcceptingConnections(true);
@@ -118,8 +147,6 @@ void NetworkSession::update()
 		} else {
 			service.setAcceptingConnections(false);
 		}
-
-		checkForOutboundStateChanges(-1);
 	}
 
 	if (type == NetworkSessionType::Client) {
@@ -129,12 +156,7 @@ void NetworkSession::update()
 	}
 
 	if (type == NetworkSessionType::Host || type == NetworkSessionType::Client) {
-		if (myPeerId != -1) {
-			auto iter = sharedData.find(myPeerId);
-			if (iter != sharedData.end()) {
-				checkForOutboundStateChanges(myPeerId);
-			}
-		}
+		updateSharedData();
 	}
 
 	// Update again to dispatch anything
@@ -320,24 +342,19 @@ void NetworkSession::processReceive()
 	}
 }
 
-void NetworkSession::closeConnection(int peerId, const String& reason)
+IConnection& NetworkSession::getConnection(int peerId)
 {
 	int connId = type == NetworkSessionType::Host ? peerId - 1 : 0;
-	connections.at(connId)->close();
+	return *connections.at(connId);
 }
 
-void NetworkSession::retransmitControlMessage(int peerId, gsl::span<const gsl::byte> bytes)
+void NetworkSession::closeConnection(int peerId, const String& reason)
 {
-	NetworkSessionMessageHeader header;
-	header.type = NetworkSessionMessageType::Control;
-	header.srcPeerId = peerId;
-	sendToAll(makeOutbound(bytes, header), peerId);
+	getConnection(peerId).close();
 }
 
 void NetworkSession::receiveControlMessage(int peerId, InboundNetworkPacket& packet)
 {
-	auto origData = packet.getBytes();
-
 	ControlMsgHeader header;
 	packet.extractHeader(header);
 
@@ -358,7 +375,12 @@ void NetworkSession::receiveControlMessage(int peerId, InboundNetworkPacket& pac
 		{
 			ControlMsgSetPeerState msg = Deserializer::fromBytes<ControlMsgSetPeerState>(packet.getBytes());
 			onControlMessage(peerId, msg);
-			retransmitControlMessage(peerId, origData);
+		}
+		break;
+	case NetworkSessionControlMessageType::SharedDataAck:
+		{
+			ControlMsgSharedDataAck msg = Deserializer::fromBytes<ControlMsgSharedDataAck>(packet.getBytes());
+			onControlMessage(peerId, msg);
 		}
 		break;
 	default:
@@ -376,31 +398,56 @@ void NetworkSession::onControlMessage(int peerId, const ControlMsgSetPeerId& msg
 
 void NetworkSession::onControlMessage(int peerId, const ControlMsgSetPeerState& msg)
 {
-	if (peerId != 0 && peerId != msg.peerId) {
+	if ((peerId != 0 && peerId != msg.peerId) || msg.peerId == myPeerId) {
 		closeConnection(peerId, "Unauthorised control message: SetPeerState");
+		return;
 	}
-	auto iter = sharedData.find(msg.peerId);
 
-	auto s = Deserializer(msg.state);
-	if (iter != sharedData.end()) {
-		iter->second->deserialize(s);
-	} else {
-		sharedData[msg.peerId] = makePeerSharedData();
-		sharedData[msg.peerId]->deserialize(s);
+	auto& data = sharedData[msg.peerId];
+	if (!data) {
+		data = makePeerSharedData();
 	}
+	receiveSharedDataUpdate(peerId, msg.peerId, *data, msg.update);
 }
 
 void NetworkSession::onControlMessage(int peerId, const ControlMsgSetSessionState& msg)
 {
 	if (peerId != 0) {
 		closeConnection(peerId, "Unauthorised control message: SetSessionState");
+		return;
 	}
 
 	if (!sessionSharedData) {
 		sessionSharedData = makeSessionSharedData();
 	}
-	auto s = Deserializer(msg.state);
-	sessionSharedData->deserialize(s);
+	receiveSharedDataUpdate(peerId, -1, *sessionSharedData, msg.update);
+}
+
+void NetworkSession::onControlMessage(int peerId, const ControlMsgSharedDataAck& msg)
+{
+	auto iter = sharedDataReplicas.find(msg.ownerId);
+	if (iter == sharedDataReplicas.end()) {
+		return;
+	}
+
+	auto& replica = iter->second;
+	if (type == NetworkSessionType::Host && msg.generation != replica.generation) {
+		// About a previous peer with the same id
+		return;
+	}
+
+	auto target = replica.targets.find(&getConnection(peerId));
+	if (target == replica.targets.end() || msg.version > replica.version) {
+		return;
+	}
+	if (msg.version == 0) {
+		// The target couldn't apply a delta, so start over from the full state
+		target->second.ackedVersion = 0;
+		target->second.sentVersion = 0;
+	} else {
+		target->second.ackedVersion = std::max(target->second.ackedVersion, msg.version);
+		trimSharedDataStates(replica);
+	}
 }
 
 void NetworkSession::setMyPeerId(int id)
@@ -412,27 +459,167 @@ void NetworkSession::setMyPeerId(int id)
 	onPeerIdAssigned();
 }
 
-void NetworkSession::checkForOutboundStateChanges(int ownerId)
+SharedData* NetworkSession::tryGetSharedData(int ownerId)
+{
+	if (ownerId == -1) {
+		return sessionSharedData.get();
+	}
+	auto iter = sharedData.find(ownerId);
+	return iter != sharedData.end() ? iter->second.get() : nullptr;
+}
+
+void NetworkSession::updateSharedData()
+{
+	const auto now = Clock::now();
+
+	// Take a new version of the data owned by this peer, unless it was taken too recently
+	auto checkOwned = [&] (int ownerId)
+	{
+		auto* data = tryGetSharedData(ownerId);
+		if (data) {
+			auto& replica = sharedDataReplicas[ownerId];
+			const bool intervalElapsed = std::chrono::duration<double>(now - replica.snapshotTime).count() >= data->getSendInterval();
+			if (replica.version == 0 || (data->isModified() && intervalElapsed)) {
+				snapshotSharedData(*data, replica, now);
+			}
+		}
+	};
+	if (type == NetworkSessionType::Host) {
+		checkOwned(-1);
+	}
+	if (myPeerId != -1) {
+		checkOwned(myPeerId);
+	}
+
+	// The host sends everything it knows about to everyone but where it came from; clients only send their own
+	for (auto& [ownerId, replica]: sharedDataReplicas) {
+		auto* data = tryGetSharedData(ownerId);
+		const bool owned = ownerId == -1 ? type == NetworkSessionType::Host : ownerId == myPeerId;
+		if (data && replica.version != 0 && (owned || type == NetworkSessionType::Host)) {
+			sendSharedDataUpdates(ownerId, replica, data->getCompression(), now);
+		}
+	}
+}
+
+void NetworkSession::snapshotSharedData(SharedData& data, SharedDataReplica& replica, Clock::time_point now)
+{
+	++replica.version;
+	replica.states[replica.version] = Serializer::toBytes(data);
+	replica.snapshotTime = now;
+	data.markUnmodified();
+	trimSharedDataStates(replica);
+}
+
+void NetworkSession::sendSharedDataUpdates(int ownerId, SharedDataReplica& replica, SharedDataCompression compression, Clock::time_point now)
 {
-	SharedData& data = ownerId == -1 ? *sessionSharedData : *sharedData.at(ownerId);
-	if (data.isModified()) {
-		sendToAll(makeUpdateSharedDataPacket(ownerId));
-		data.markUnmodified();
+	const auto& state = replica.states.at(replica.version);
+
+	for (auto& conn: connections) {
+		if (conn.get() == replica.source) {
+			continue;
+		}
+
+		auto& target = replica.targets[conn.get()];
+		if (target.ackedVersion >= replica.version) {
+			continue;
+		}
+		const bool resend = std::chrono::duration<double>(now - target.sentTime).count() >= sharedDataResendTime;
+		if (target.sentVersion >= replica.version && !resend) {
+			continue;
+		}
+
+		// Send only what changed since the last version the target has, if it's still around
+		auto base = replica.states.find(target.ackedVersion);
+		const bool hasBase = target.ackedVersion != 0 && base != replica.states.end();
+		auto update = SharedDataUpdate::make(replica.version, state, target.ackedVersion, hasBase ? &base->second : nullptr, compression);
+		update.generation = replica.generation;
+
+		conn->send(makeUpdateSharedDataPacket(ownerId, std::move(update)));
+		target.sentVersion = replica.version;
+		target.sentTime = now;
+	}
+}
+
+void NetworkSession::receiveSharedDataUpdate(int peerId, int ownerId, SharedData& data, const SharedDataUpdate& update)
+{
+	auto& connection = getConnection(peerId);
+	auto& replica = sharedDataReplicas[ownerId];
+	replica.source = &connection;
+
+	// Only the host knows when a peer id is reused, so clients follow its generations
+	if (type == NetworkSessionType::Client && update.generation != replica.generation) {
+		if (update.generation < replica.generation) {
+			return;
+		}
+		replica = SharedDataReplica();
+		replica.generation = update.generation;
+		replica.source = &connection;
+	}
+
+	// Older versions might arrive late, if they were resent; there's nothing to do but acknowledge the latest
+	if (update.version > replica.version) {
+		const Bytes* base = nullptr;
+		if (update.baseVersion != 0) {
+			auto iter = replica.states.find(update.baseVersion);
+			if (iter == replica.states.end()) {
+				sendSharedDataAck(connection, ownerId, replica.generation, 0);
+				return;
+			}
+			base = &iter->second;
+		}
+
+		auto state = update.getState(base);
+		auto s = Deserializer(state);
+		data.deserialize(s);
+
+		replica.version = update.version;
+		replica.oldestBaseVersion = update.baseVersion != 0 ? update.baseVersion : update.version;
+		replica.states[update.version] = std::move(state);
+		trimSharedDataStates(replica);
+	}
+
+	sendSharedDataAck(connection, ownerId, replica.generation, replica.version);
+}
+
+void NetworkSession::sendSharedDataAck(IConnection& connection, int ownerId, uint32_t generation, uint32_t version)
+{
+	ControlMsgSharedDataAck ack;
+	ack.ownerId = int8_t(ownerId);
+	ack.generation = generation;
+	ack.version = version;
+	connection.send(doMakeControlPacket(NetworkSessionControlMessageType::SharedDataAck, OutboundNetworkPacket(Serializer::toBytes(ack))));
+}
+
+void NetworkSession::trimSharedDataStates(SharedDataReplica& replica)
+{
+	// Keep anything that could still be used as a delta base, either by the source or by the targets
+	// The targets' bases can be dropped if there are too many, as they'll be sent the full state instead, but not the source's.
+	const uint32_t sourceOldest = replica.source ? replica.oldestBaseVersion : replica.version;
+	uint32_t oldest = sourceOldest;
+	for (const auto& target: replica.targets) {
+		if (target.second.ackedVersion != 0) {
+			oldest = std::min(oldest, target.second.ackedVersion);
+		}
+	}
+
+	auto& states = replica.states;
+	states.erase(states.begin(), states.lower_bound(oldest));
+	while (states.size() > maxSharedDataStates && states.begin()->first < sourceOldest) {
+		states.erase(states.begin());
 	}
 }
 
-OutboundNetworkPacket NetworkSession::makeUpdateSharedDataPacket(int ownerId)
+OutboundNetworkPacket NetworkSession::makeUpdateSharedDataPacket(int ownerId, SharedDataUpdate update)
 {
-	SharedData& data = ownerId == -1 ? *sessionSharedData : *sharedData.at(ownerId);
 	if (ownerId == -1) {
 		ControlMsgSetSessionState state;
-		state.state = Serializer::toBytes(data);
+		state.update = std::move(update);
 		Bytes bytes = Serializer::toBytes(state);
 		return doMakeControlPacket(NetworkSessionControlMessageType::SetSessionState, OutboundNetworkPacket(bytes));
 	} else {
 		ControlMsgSetPeerState state;
-		state.peerId = ownerId;
-		state.state = Serializer::toBytes(data);
+		state.peerId = int8_t(ownerId);
+		state.update = std::move(update);
 		Bytes bytes = Serializer::toBytes(state);
 		return doMakeControlPacket(NetworkSessionControlMessageType::SetPeerState, OutboundNetworkPacket(bytes));
 	}
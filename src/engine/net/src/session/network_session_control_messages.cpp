@@ -1,6 +1,182 @@
 #include "session/network_session_control_messages.h"
+#include "halley/bytes/compression.h"
+#include "halley/support/exception.h"
+#include <cstring>
 using namespace Halley;
 
+namespace {
+	// Unchanged gaps shorter than this are sent along with the changes around them, as that's cheaper than starting a new run
+	constexpr size_t minDeltaGap = 4;
+
+	void writeVarInt(Bytes& dst, size_t value)
+	{
+		do {
+			const auto byte = static_cast<Byte>(value & 0x7F);
+			value >>= 7;
+			dst.push_back(value != 0 ? (byte | 0x80) : byte);
+		} while (value != 0);
+	}
+
+	size_t readVarInt(const Bytes& src, size_t& pos)
+	{
+		size_t result = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (pos >= src.size()) {
+				break;
+			}
+			const auto byte = src[pos++];
+			result |= size_t(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return result;
+			}
+		}
+		throw Exception("Malformed shared data delta.", HalleyExceptions::Network);
+	}
+
+	// The new size, followed by runs of changed bytes, each as the distance from the end of the previous run, its length and contents
+	Bytes makeDelta(const Bytes& base, const Bytes& state)
+	{
+		auto isSame = [&] (size_t i) { return i < base.size() && state[i] == base[i]; };
+
+		Bytes result;
+		writeVarInt(result, state.size());
+
+		size_t prevEnd = 0;
+		size_t pos = 0;
+		while (pos < state.size()) {
+			if (isSame(pos)) {
+				++pos;
+				continue;
+			}
+
+			const size_t start = pos;
+			size_t end = pos;
+			while (pos < state.size()) {
+				if (!isSame(pos)) {
+					end = ++pos;
+				} else {
+					size_t gapEnd = pos;
+					while (gapEnd < state.size() && gapEnd - pos < minDeltaGap && isSame(gapEnd)) {
+						++gapEnd;
+					}
+					if (gapEnd - pos >= minDeltaGap || gapEnd == state.size()) {
+						break;
+					}
+					pos = gapEnd;
+				}
+			}
+
+			writeVarInt(result, start - prevEnd);
+			writeVarInt(result, end - start);
+			result.insert(result.end(), state.begin() + start, state.begin() + end);
+			prevEnd = end;
+			pos = end;
+		}
+
+		return result;
+	}
+
+	Bytes applyDelta(const Bytes& base, const Bytes& delta)
+	{
+		size_t pos = 0;
+		const size_t size = readVarInt(delta, pos);
+
+		Bytes result(base.begin(), base.begin() + std::min(base.size(), size));
+		result.resize(size);
+
+		size_t dstPos = 0;
+		while (pos < delta.size()) {
+			dstPos += readVarInt(delta, pos);
+			const size_t len = readVarInt(delta, pos);
+			if (dstPos + len > size || pos + len > delta.size()) {
+				throw Exception("Malformed shared data delta.", HalleyExceptions::Network);
+			}
+			memcpy(result.data() + dstPos, delta.data() + pos, len);
+			dstPos += len;
+			pos += len;
+		}
+
+		return result;
+	}
+}
+
+SharedDataUpdate SharedDataUpdate::make(uint32_t version, const Bytes& state, uint32_t baseVersion, const Bytes* base, SharedDataCompression compression)
+{
+	SharedDataUpdate result;
+	result.version = version;
+
+	if (base) {
+		auto delta = makeDelta(*base, state);
+		if (delta.size() < state.size()) {
+			result.baseVersion = baseVersion;
+			result.data = std::move(delta);
+		}
+	}
+	if (result.baseVersion == 0) {
+		result.data = state;
+	}
+	result.size = static_cast<uint32_t>(result.data.size());
+
+	if (compression != SharedDataCompression::None && !result.data.empty()) {
+		const auto src = gsl::as_bytes(gsl::span<const Byte>(result.data));
+		auto compressed = compression == SharedDataCompression::Deflate ? Compression::compressRaw(src, false) : Compression::compressLZ(src);
+		if (compressed.size() < result.data.size()) {
+			result.data = std::move(compressed);
+			result.compression = compression;
+		}
+	}
+
+	return result;
+}
+
+Bytes SharedDataUpdate::getState(const Bytes* base) const
+{
+	Bytes payload;
+	const auto src = gsl::as_bytes(gsl::span<const Byte>(data));
+	switch (compression) {
+	case SharedDataCompression::None:
+		payload = data;
+		break;
+	case SharedDataCompression::Deflate:
+		payload = Compression::decompressRaw(src, size, size);
+		break;
+	case SharedDataCompression::LZ:
+		payload.resize(size);
+		Compression::decompressLZ(src, gsl::as_writable_bytes(gsl::span<Byte>(payload)));
+		break;
+	default:
+		throw Exception("Unknown shared data compression.", HalleyExceptions::Network);
+	}
+
+	if (baseVersion == 0) {
+		return payload;
+	}
+	if (!base) {
+		throw Exception("Missing base version " + toString(baseVersion) + " for shared data delta.", HalleyExceptions::Network);
+	}
+	return applyDelta(*base, payload);
+}
+
+void SharedDataUpdate::serialize(Serializer& s) const
+{
+	s << generation;
+	s << version;
+	s << baseVersion;
+	s << compression;
+	s << size;
+	s << data;
+}
+
+void SharedDataUpdate::deserialize(Deserializer& s)
+{
+	s >> generation;
+	s >> version;
+	s >> baseVersion;
+	s >> compression;
+	s >> size;
+	s >> data;
+}
+
 void ControlMsgSetPeerId::serialize(Serializer& s) const
 {
 	s << peerId;
@@ -13,22 +189,36 @@ void ControlMsgSetPeerId::deserialize(Deserializer& s)
 
 void ControlMsgSetSessionState::serialize(Serializer& s) const
 {
-	s << state;
+	s << update;
 }
 
 void ControlMsgSetSessionState::deserialize(Deserializer& s)
 {
-	s >> state;
+	s >> update;
 }
 
 void ControlMsgSetPeerState::serialize(Serializer& s) const
 {
 	s << peerId;
-	s << state;
+	s << update;
 }
 
 void ControlMsgSetPeerState::deserialize(Deserializer& s)
 {
 	s >> peerId;
-	s >> state;
+	s >> update;
+}
+
+void ControlMsgSharedDataAck::serialize(Serializer& s) const
+{
+	s << ownerId;
+	s << generation;
+	s << version;
+}
+
+void ControlMsgSharedDataAck::deserialize(Deserializer& s)
+{
+	s >> ownerId;
+	s >> generation;
+	s >> version;
 }
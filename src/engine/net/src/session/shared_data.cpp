@@ -15,3 +15,23 @@ bool SharedData::isModified() const
 {
 	return modified;
 }
+
+void SharedData::setSendInterval(Time interval)
+{
+	sendInterval = interval;
+}
+
+Time SharedData::getSendInterval() const
+{
+	return sendInterval;
+}
+
+void SharedData::setCompression(SharedDataCompression compression)
+{
+	this->compression = compression;
+}
+
+SharedDataCompression SharedData::getCompression() const
+{
+	return compression;
+}
@@ -118,6 +118,7 @@ namespace Halley
 		std::shared_ptr<UIWidget> makeOptionListMorpher(const ConfigNode& entryNode);
 		std::shared_ptr<UIWidget> makeTreeList(const ConfigNode& node);
 		std::shared_ptr<UIWidget> makeDebugConsole(const ConfigNode& node);
+		std::shared_ptr<UIWidget> makeVirtualList(const ConfigNode& node);
 
 		bool hasCondition(const String& condition) const;
 		bool resolveConditions(const ConfigNode& node) const;
@@ -23,8 +23,17 @@ namespace Halley {
 		Keyboard,
 		Gamepad
 	};
+
+	// Layout work done during the last UIRoot::update
+	struct UILayoutStats {
+		int passes = 0;
+		int nodesVisited = 0; // Widgets that were given a rect
+		int nodesLaidOut = 0; // Widgets that had to lay out their contents, rather than keep their previous layout
+	};
 	
 	class UIRoot final : public UIParent {
+		friend class UIWidget;
+
 	public:
 		explicit UIRoot(const HalleyAPI& api, Rect4f rect = {});
 		~UIRoot();
@@ -42,6 +51,7 @@ namespace Halley {
 
 		void mouseOverNext(bool forward = true);
 		void runLayout();
+		const UILayoutStats& getLayoutStats() const;
 		
 		std::optional<std::shared_ptr<IAudioHandle>> playSound(const String& eventName);
 		void sendEvent(UIEvent event) const override;
@@ -84,6 +94,7 @@ namespace Halley {
 		Vector2f overscan;
 
 		bool anyMouseButtonHeld = false;
+		UILayoutStats layoutStats;
 
 		std::function<Vector2f(Vector2f)> mouseRemap;
 		std::unique_ptr<TextInputCapture> textCapture;
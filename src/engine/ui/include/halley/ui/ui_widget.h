@@ -239,6 +239,11 @@ namespace Halley {
 		mutable Vector2f layoutSize;
 		mutable int layoutNeeded = 1;
 
+		// What the contents were last laid out for; they're left alone until one of these changes, or layout is marked as needed
+		Rect4f lastLayoutRect;
+		Vector2f lastLayoutOrigin;
+		bool layoutDirty = true;
+
 		std::shared_ptr<UIEventHandler> eventHandler;
 		std::shared_ptr<UIValidator> validator;
 		std::shared_ptr<UIDataBind> dataBind;
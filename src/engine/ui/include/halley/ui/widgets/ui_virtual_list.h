@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../ui_widget.h"
+#include "halley/data_structures/vector.h"
+
+namespace Halley {
+	class UIScrollPane;
+
+	class IUIVirtualListDataSource {
+	public:
+		virtual ~IUIVirtualListDataSource() = default;
+
+		virtual size_t getNumRows() const = 0;
+
+		// Creates an empty row widget; rows are pooled, so this is only called until there are enough to fill the visible area
+		virtual std::shared_ptr<UIWidget> makeRow() = 0;
+
+		// Fills a (possibly recycled) row widget with the contents of the row at index
+		virtual void bindRow(UIWidget& row, size_t index) = 0;
+	};
+
+	// A vertical list that only keeps widgets for the rows inside the visible area of the UIScrollPane containing it
+	// Row widgets are recycled as the list scrolls, so the cost of updating and laying it out depends on how many rows fit
+	// on screen, rather than on the total. Rows can have different heights: each is measured when it's first bound, and rows
+	// that were never bound are assumed to have the estimated height.
+	class UIVirtualList : public UIWidget {
+	public:
+		UIVirtualList(String id, float estimatedRowHeight, std::shared_ptr<IUIVirtualListDataSource> dataSource = {});
+
+		void setDataSource(std::shared_ptr<IUIVirtualListDataSource> dataSource);
+		IUIVirtualListDataSource* getDataSource() const;
+
+		// Call when rows were added, removed or changed; this discards all cached measurements
+		void notifyDataChanged();
+		// Call when a single row changed, to rebind it and measure it again
+		void notifyRowChanged(size_t index);
+
+		size_t getNumRows() const;
+		std::optional<size_t> getRowAt(float y) const;
+		Rect4f getRowRect(size_t index) const;
+		std::shared_ptr<UIWidget> getRowWidget(size_t index) const;
+		std::pair<size_t, size_t> getVisibleRows() const;
+
+		void scrollToRow(size_t index, bool center = false);
+
+		Vector2f getLayoutMinimumSize(bool force) const override;
+
+	protected:
+		void update(Time t, bool moved) override;
+
+	private:
+		struct Slot {
+			std::shared_ptr<UIWidget> widget;
+			std::optional<size_t> index;
+		};
+
+		constexpr static int maxMeasurePasses = 4;
+
+		std::shared_ptr<IUIVirtualListDataSource> dataSource;
+		float estimatedRowHeight;
+
+		Vector<Slot> slots; // Matches the sizer entries, one to one
+		Vector<float> rowHeights; // Negative if not measured yet
+		mutable Vector<float> rowOffsets; // Prefix sums of rowHeights, with one extra entry for the total
+		mutable bool offsetsDirty = true;
+		bool needsRebind = true;
+		std::pair<size_t, size_t> visibleRows;
+
+		void updateOffsets() const;
+		float getRowHeight(size_t index) const;
+		float getTotalHeight() const;
+
+		std::pair<float, float> getVisibleArea() const;
+		std::pair<size_t, size_t> getRowRange(float top, float bottom) const;
+		UIScrollPane* findScrollPane() const;
+
+		bool bindVisibleRows();
+		Slot& getFreeSlot();
+	};
+}
@@ -27,6 +27,7 @@
 #include "widgets/ui_tree_list.h"
 #include "halley/ui/behaviours/ui_reload_ui_behaviour.h"
 #include "widgets/ui_debug_console.h"
+#include "widgets/ui_virtual_list.h"
 
 using namespace Halley;
 
@@ -66,6 +67,7 @@ UIFactory::UIFactory(const HalleyAPI& api, Resources& resources, const I18N& i18
 	addFactory("optionListMorpher", [=](const ConfigNode& node) { return makeOptionListMorpher(node); });
 	addFactory("treeList", [=](const ConfigNode& node) { return makeTreeList(node); });
 	addFactory("debugConsole", [=](const ConfigNode& node) { return makeDebugConsole(node); });
+	addFactory("virtualList", [=](const ConfigNode& node) { return makeVirtualList(node); });
 }
 
 UIFactory::~UIFactory()
@@ -926,6 +928,16 @@ std::shared_ptr<UIWidget> UIFactory::makeDebugConsole(const ConfigNode& entryNod
 	return widget;
 }
 
+std::shared_ptr<UIWidget> UIFactory::makeVirtualList(const ConfigNode& entryNode)
+{
+	// The data source has to be set from code, with UIVirtualList::setDataSource
+	const auto& node = entryNode["widget"];
+	auto id = node["id"].asString();
+	auto estimatedRowHeight = node["estimatedRowHeight"].asFloat(20.0f);
+
+	return std::make_shared<UIVirtualList>(id, estimatedRowHeight);
+}
+
 bool UIFactory::hasCondition(const String& condition) const
 {
 	return std::find(conditions.begin(), conditions.end(), condition) != conditions.end();
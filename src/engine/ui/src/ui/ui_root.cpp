@@ -60,17 +60,24 @@ Rect4f UIRoot::getRect() const
 
 void UIRoot::runLayout()
 {
+	++layoutStats.passes;
 	for (auto& c: getChildren()) {
 		c->layout();
 	}
 }
 
+const UILayoutStats& UIRoot::getLayoutStats() const
+{
+	return layoutStats;
+}
+
 void UIRoot::update(Time t, UIInputType activeInputType, spInputDevice mouse, spInputDevice manual)
 {
 	auto joystickType = manual->getJoystickType();
 	bool first = true;
 
 	updateKeyboardInput();
+	layoutStats = UILayoutStats();
 
 	do {
 		// Spawn new widgets
@@ -137,6 +137,31 @@ Vector2f UIWidget::getLayoutMinimumSize(bool force) const
 void UIWidget::setRect(Rect4f rect)
 {
 	setWidgetRect(rect);
+
+	const auto origin = getLayoutOriginPosition();
+	if (root) {
+		++root->layoutStats.nodesVisited;
+	}
+	if (!layoutDirty && rect == lastLayoutRect && origin == lastLayoutOrigin) {
+		// Our contents stay where the sizer last put them, but the children still get to lay out their own
+		for (auto& c: getChildren()) {
+			if (sizer) {
+				if (c->isActive()) {
+					c->setRect(c->getRect());
+				}
+			} else {
+				c->layout();
+			}
+		}
+		return;
+	}
+	layoutDirty = false;
+	lastLayoutRect = rect;
+	lastLayoutOrigin = origin;
+	if (root) {
+		++root->layoutStats.nodesLaidOut;
+	}
+
 	if (sizer) {
 		auto border = getInnerBorder();
 		auto p0 = getLayoutOriginPosition();
@@ -333,6 +358,10 @@ void UIWidget::setPosition(Vector2f pos)
 {
 	Expects(pos.isValid());
 	
+	if (position != pos) {
+		// No longer where the parent last put it, so the parent has to place it again
+		markAsNeedingLayout();
+	}
 	position = pos;
 	positionUpdated = true;
 }
@@ -820,6 +849,7 @@ bool UIWidget::needsLayout() const
 void UIWidget::markAsNeedingLayout()
 {
 	layoutNeeded = 1;
+	layoutDirty = true;
 	if (parent) {
 		parent->markAsNeedingLayout();
 	}
@@ -0,0 +1,272 @@
+#include "widgets/ui_virtual_list.h"
+#include "widgets/ui_scroll_pane.h"
+#include "ui_event.h"
+#include <algorithm>
+
+using namespace Halley;
+
+UIVirtualList::UIVirtualList(String id, float estimatedRowHeight, std::shared_ptr<IUIVirtualListDataSource> dataSource)
+	: UIWidget(std::move(id), Vector2f(), UISizer(UISizerType::Free))
+	, estimatedRowHeight(std::max(1.0f, estimatedRowHeight))
+{
+	setDataSource(std::move(dataSource));
+}
+
+void UIVirtualList::setDataSource(std::shared_ptr<IUIVirtualListDataSource> source)
+{
+	// Rows made by the previous source might not be compatible with the new one
+	clear();
+	slots.clear();
+	dataSource = std::move(source);
+	notifyDataChanged();
+}
+
+IUIVirtualListDataSource* UIVirtualList::getDataSource() const
+{
+	return dataSource.get();
+}
+
+void UIVirtualList::notifyDataChanged()
+{
+	rowHeights.clear();
+	rowHeights.resize(dataSource ? dataSource->getNumRows() : 0, -1.0f);
+	offsetsDirty = true;
+
+	for (auto& slot: slots) {
+		slot.index.reset();
+		slot.widget->setActive(false);
+	}
+	visibleRows = {};
+	needsRebind = true;
+	markAsNeedingLayout();
+}
+
+void UIVirtualList::notifyRowChanged(size_t index)
+{
+	if (index >= rowHeights.size()) {
+		return;
+	}
+
+	for (auto& slot: slots) {
+		if (slot.index == index) {
+			slot.index.reset();
+			slot.widget->setActive(false);
+		}
+	}
+	needsRebind = true;
+}
+
+size_t UIVirtualList::getNumRows() const
+{
+	return rowHeights.size();
+}
+
+std::optional<size_t> UIVirtualList::getRowAt(float y) const
+{
+	if (y < 0 || y >= getTotalHeight()) {
+		return {};
+	}
+	const auto iter = std::upper_bound(rowOffsets.begin(), rowOffsets.end(), y);
+	return size_t(iter - rowOffsets.begin()) - 1;
+}
+
+Rect4f UIVirtualList::getRowRect(size_t index) const
+{
+	updateOffsets();
+	Expects(index < rowHeights.size());
+	return Rect4f(0, rowOffsets[index], getSize().x, getRowHeight(index));
+}
+
+std::shared_ptr<UIWidget> UIVirtualList::getRowWidget(size_t index) const
+{
+	for (const auto& slot: slots) {
+		if (slot.index == index) {
+			return slot.widget;
+		}
+	}
+	return {};
+}
+
+std::pair<size_t, size_t> UIVirtualList::getVisibleRows() const
+{
+	return visibleRows;
+}
+
+void UIVirtualList::scrollToRow(size_t index, bool center)
+{
+	if (index < rowHeights.size()) {
+		sendEvent(UIEvent(center ? UIEventType::MakeAreaVisibleCentered : UIEventType::MakeAreaVisible, getId(), getRowRect(index)));
+	}
+}
+
+Vector2f UIVirtualList::getLayoutMinimumSize(bool force) const
+{
+	if (!isActive() && !force) {
+		return {};
+	}
+
+	// Only the width comes from the rows that exist; the height covers every row, bound or not
+	const auto size = UIWidget::getLayoutMinimumSize(force);
+	return Vector2f(size.x, std::max(size.y, getTotalHeight()));
+}
+
+void UIVirtualList::update(Time t, bool moved)
+{
+	if (!dataSource) {
+		return;
+	}
+
+	if (rowHeights.size() != dataSource->getNumRows()) {
+		notifyDataChanged();
+	}
+
+	const auto [top, bottom] = getVisibleArea();
+	if (needsRebind || getRowRange(top, bottom) != visibleRows) {
+		if (bindVisibleRows()) {
+			// Place the rows right away, rather than showing them at their old positions until the next layout
+			setRect(getRect());
+		}
+	}
+}
+
+void UIVirtualList::updateOffsets() const
+{
+	if (offsetsDirty) {
+		rowOffsets.resize(rowHeights.size() + 1);
+		float pos = 0;
+		for (size_t i = 0; i < rowHeights.size(); ++i) {
+			rowOffsets[i] = pos;
+			pos += getRowHeight(i);
+		}
+		rowOffsets.back() = pos;
+		offsetsDirty = false;
+	}
+}
+
+float UIVirtualList::getRowHeight(size_t index) const
+{
+	const float height = rowHeights[index];
+	return height < 0 ? estimatedRowHeight : height;
+}
+
+float UIVirtualList::getTotalHeight() const
+{
+	updateOffsets();
+	return rowOffsets.back();
+}
+
+std::pair<float, float> UIVirtualList::getVisibleArea() const
+{
+	const float total = getTotalHeight();
+	const auto* pane = findScrollPane();
+	if (!pane) {
+		return { 0.0f, total };
+	}
+
+	// One extra row on each side, so rows coming into view are already laid out
+	const auto paneRect = pane->getRect();
+	const float y0 = getPosition().y;
+	return { std::max(0.0f, paneRect.getTop() - y0 - estimatedRowHeight), std::min(total, paneRect.getBottom() - y0 + estimatedRowHeight) };
+}
+
+std::pair<size_t, size_t> UIVirtualList::getRowRange(float top, float bottom) const
+{
+	updateOffsets();
+	const size_t n = rowHeights.size();
+	if (n == 0 || bottom <= top) {
+		return { 0, 0 };
+	}
+
+	const auto first = size_t(std::max(std::ptrdiff_t(0), std::upper_bound(rowOffsets.begin(), rowOffsets.end(), top) - rowOffsets.begin() - 1));
+	const auto last = std::min(n, size_t(std::lower_bound(rowOffsets.begin(), rowOffsets.end(), bottom) - rowOffsets.begin()));
+	return { std::min(first, n), std::max(std::min(first, n), last) };
+}
+
+UIScrollPane* UIVirtualList::findScrollPane() const
+{
+	for (auto* p = getParent(); p; ) {
+		auto* widget = dynamic_cast<UIWidget*>(p);
+		if (!widget) {
+			break;
+		}
+		if (auto* pane = dynamic_cast<UIScrollPane*>(widget)) {
+			return pane;
+		}
+		p = widget->getParent();
+	}
+	return nullptr;
+}
+
+bool UIVirtualList::bindVisibleRows()
+{
+	bool changed = false;
+
+	// Measuring rows can move the ones after them, and change what's visible, so repeat until it settles
+	for (int pass = 0; pass < maxMeasurePasses; ++pass) {
+		const auto [top, bottom] = getVisibleArea();
+		const auto range = getRowRange(top, bottom);
+
+		// Release rows that are no longer visible
+		for (auto& slot: slots) {
+			if (slot.index && (slot.index.value() < range.first || slot.index.value() >= range.second)) {
+				slot.index.reset();
+				slot.widget->setActive(false);
+				changed = true;
+			}
+		}
+
+		// Bind the rows that became visible
+		bool remeasured = false;
+		for (size_t i = range.first; i < range.second; ++i) {
+			if (getRowWidget(i)) {
+				continue;
+			}
+
+			auto& slot = getFreeSlot();
+			dataSource->bindRow(*slot.widget, i);
+			slot.index = i;
+			slot.widget->setActive(true);
+			slot.widget->markAsNeedingLayout();
+			changed = true;
+
+			const float height = slot.widget->getLayoutMinimumSize(false).y;
+			if (height != rowHeights[i]) {
+				rowHeights[i] = height;
+				offsetsDirty = true;
+				remeasured = true;
+			}
+		}
+
+		visibleRows = range;
+		if (!remeasured) {
+			break;
+		}
+	}
+
+	updateOffsets();
+	auto& sizer = getSizer();
+	for (size_t i = 0; i < slots.size(); ++i) {
+		if (slots[i].index) {
+			sizer[i].setPosition(Vector2f(0, rowOffsets[slots[i].index.value()]));
+		}
+	}
+
+	needsRebind = false;
+	if (changed) {
+		markAsNeedingLayout();
+	}
+	return changed;
+}
+
+UIVirtualList::Slot& UIVirtualList::getFreeSlot()
+{
+	for (auto& slot: slots) {
+		if (!slot.index) {
+			return slot;
+		}
+	}
+
+	auto widget = dataSource->makeRow();
+	add(widget, 0, Vector4f(), UISizerFillFlags::FillHorizontal);
+	return slots.emplace_back(Slot{ std::move(widget), {} });
+}
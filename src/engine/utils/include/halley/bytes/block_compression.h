@@ -0,0 +1,51 @@
+#pragma once
+#include "../utils/utils.h"
+#include "halley/data_structures/vector.h"
+#include <gsl/gsl>
+
+namespace Halley {
+	// Data split into fixed-size blocks, each LZ compressed on its own (or stored, when that doesn't help)
+	// Any block can be decompressed without touching the others, so readers can stream from the middle of the data.
+	// Layout: Header, then one uint32 per block with its compressed size (top bit set if stored), then the blocks.
+	class BlockCompression {
+	public:
+		constexpr static size_t defaultBlockSize = 64 * 1024;
+
+		struct Header {
+			std::array<char, 4> identifier;
+			uint32_t blockSize;
+			uint64_t rawSize;
+
+			size_t getNumBlocks() const;
+			size_t getTableSize() const;
+		};
+
+		// Locates the blocks of a compressed buffer; built from its header and block table
+		class Index {
+		public:
+			Index() = default;
+			Index(const Header& header, gsl::span<const gsl::byte> table);
+
+			size_t getRawSize() const { return rawSize; }
+			size_t getBlockSize() const { return blockSize; }
+			size_t getNumBlocks() const { return blockInfo.size(); }
+
+			// Offsets are from the start of the compressed buffer
+			size_t getBlockOffset(size_t block) const { return blockOffsets[block]; }
+			size_t getCompressedBlockSize(size_t block) const;
+			size_t getRawBlockSize(size_t block) const;
+
+			void decompressBlock(size_t block, gsl::span<const gsl::byte> compressedBlock, gsl::span<gsl::byte> dst) const;
+
+		private:
+			size_t rawSize = 0;
+			size_t blockSize = 0;
+			Vector<uint32_t> blockInfo;
+			Vector<size_t> blockOffsets;
+		};
+
+		static Bytes compress(gsl::span<const gsl::byte> src, size_t blockSize = defaultBlockSize);
+		static Index readIndex(gsl::span<const gsl::byte> src);
+		static void decompress(gsl::span<const gsl::byte> src, gsl::span<gsl::byte> dst);
+	};
+}
@@ -14,5 +14,10 @@ namespace Halley {
 
 		static Bytes compressRaw(gsl::span<const gsl::byte> bytes, bool insertLength);
 		static Bytes decompressRaw(gsl::span<const gsl::byte> bytes, size_t maxSize, size_t expectedSize = 0);
+
+		// Fast LZ77 codec (LZ4 block layout), much quicker to decode than zlib at a lower ratio
+		// The output doesn't store the decompressed size; decompressLZ needs dst to be exactly that size.
+		static Bytes compressLZ(gsl::span<const gsl::byte> bytes);
+		static void decompressLZ(gsl::span<const gsl::byte> src, gsl::span<gsl::byte> dst);
 	};
 }
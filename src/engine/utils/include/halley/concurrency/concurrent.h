@@ -1,6 +1,9 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <exception>
 #include <halley/text/halleystring.h>
 #include "executor.h"
 #include "future.h"
@@ -19,10 +22,10 @@ namespace Halley
 	namespace Concurrent
 	{
 		template <typename F>
-		auto execute(ExecutionQueue& e, F f) -> Future<typename std::result_of<F()>::type>
+		auto execute(ExecutionQueue& e, F f, TaskPriority priority = TaskPriority::Normal) -> Future<typename std::result_of<F()>::type>
 		{
 			using R = typename std::result_of<F()>::type;
-			return TaskQueueHelper<R>::enqueueOn(e, MovableFunction<R>(std::move(f)));
+			return TaskQueueHelper<R>::enqueueCallableOn(e, std::move(f), priority);
 		}
 
 		template <typename F>
@@ -70,5 +73,95 @@ namespace Halley
 		{
 			foreach(ExecutionQueue::getDefault(), begin, end, f);
 		}
+
+		// Splits [begin, end) into chunks of chunkSize elements. Each worker starts on its own share of the chunks and
+		// then steals from the others once it runs out, so uneven per-element costs still balance across threads.
+		// The calling thread works too, and never waits on a helper that hasn't started, so this is safe to call from
+		// within a task running on the same queue.
+		template <typename T, typename F>
+		void foreachChunked(ExecutionQueue& e, T begin, T end, size_t chunkSize, F f)
+		{
+			const size_t n = end - begin;
+			if (n == 0) {
+				return;
+			}
+			chunkSize = std::max(size_t(1), chunkSize);
+			const size_t nChunks = (n + chunkSize - 1) / chunkSize;
+
+			constexpr size_t maxWorkers = 16;
+			const size_t nWorkers = std::max(size_t(1), std::min(std::min(maxWorkers, e.threadCount() + 1), nChunks));
+
+			struct alignas(64) WorkerRange {
+				std::atomic<size_t> next;
+				size_t end;
+			};
+
+			struct State {
+				std::array<WorkerRange, maxWorkers> ranges;
+				std::atomic<int> inFlight;
+				std::atomic<bool> closed;
+				std::exception_ptr error;
+				std::atomic<bool> hasError;
+			};
+
+			auto state = std::make_shared<State>();
+			state->inFlight = 0;
+			state->closed = false;
+			state->hasError = false;
+			for (size_t j = 0; j < nWorkers; ++j) {
+				state->ranges[j].next = nChunks * j / nWorkers;
+				state->ranges[j].end = nChunks * (j + 1) / nWorkers;
+			}
+
+			auto runWorker = [&f, begin, n, chunkSize, nWorkers] (State& s, size_t self)
+			{
+				try {
+					for (size_t k = 0; k < nWorkers; ++k) {
+						auto& range = s.ranges[(self + k) % nWorkers];
+						for (size_t chunk = range.next.fetch_add(1); chunk < range.end; chunk = range.next.fetch_add(1)) {
+							const size_t start = chunk * chunkSize;
+							const size_t stop = std::min(n, start + chunkSize);
+							for (auto i = begin + start; i < begin + stop; ++i) {
+								f(*i);
+							}
+						}
+					}
+				} catch (...) {
+					if (!s.hasError.exchange(true)) {
+						s.error = std::current_exception();
+					}
+				}
+			};
+
+			for (size_t j = 1; j < nWorkers; ++j) {
+				e.addToQueue([state, runWorker, j] ()
+				{
+					// Only touch the caller's data if it's still waiting for us
+					++state->inFlight;
+					if (!state->closed) {
+						runWorker(*state, j);
+					}
+					--state->inFlight;
+				});
+			}
+
+			runWorker(*state, 0);
+
+			// Every chunk has been claimed by now; wait for any helpers still running theirs
+			state->closed = true;
+			while (state->inFlight > 0) {
+				std::this_thread::yield();
+			}
+
+			if (state->hasError) {
+				std::rethrow_exception(state->error);
+			}
+		}
+
+		template <typename T, typename F>
+		void foreachChunked(T begin, T end, size_t chunkSize, F f)
+		{
+			foreachChunked(ExecutionQueue::getDefault(), begin, end, chunkSize, f);
+		}
 	}
 }
@@ -6,22 +6,136 @@
 #include <functional>
 #include <atomic>
 #include <vector>
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+#include <new>
+#include <optional>
 #include "halley/text/halleystring.h"
 
 namespace Halley
 {
-	using TaskBase = std::function<void()>;
+	// A move-only void() callable that stores small callables inline, so queueing a task doesn't allocate
+	// Callables larger than inlineSize (or that might throw on move) fall back to the heap.
+	class TaskFunction
+	{
+	public:
+		constexpr static size_t inlineSize = 64;
+
+		TaskFunction() = default;
+
+		template <typename F, typename std::enable_if_t<!std::is_same_v<std::decay_t<F>, TaskFunction>, int> = 0>
+		TaskFunction(F&& f)
+		{
+			using T = std::decay_t<F>;
+			if constexpr (sizeof(T) <= inlineSize && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<T>) {
+				new (storage.data()) T(std::forward<F>(f));
+				vtable = &inlineVTable<T>;
+			} else {
+				*reinterpret_cast<T**>(storage.data()) = new T(std::forward<F>(f));
+				vtable = &heapVTable<T>;
+			}
+		}
+
+		TaskFunction(TaskFunction&& other) noexcept
+		{
+			moveFrom(other);
+		}
+
+		TaskFunction& operator=(TaskFunction&& other) noexcept
+		{
+			if (this != &other) {
+				reset();
+				moveFrom(other);
+			}
+			return *this;
+		}
+
+		TaskFunction(const TaskFunction& other) = delete;
+		TaskFunction& operator=(const TaskFunction& other) = delete;
+
+		~TaskFunction()
+		{
+			reset();
+		}
+
+		void operator()()
+		{
+			vtable->call(storage.data());
+		}
+
+		explicit operator bool() const
+		{
+			return vtable != nullptr;
+		}
+
+		void reset()
+		{
+			if (vtable) {
+				vtable->destroy(storage.data());
+				vtable = nullptr;
+			}
+		}
+
+	private:
+		struct VTable {
+			void (*call)(void*);
+			void (*move)(void* dst, void* src);
+			void (*destroy)(void*);
+		};
+
+		template <typename T>
+		constexpr static VTable inlineVTable = {
+			[] (void* p) { (*static_cast<T*>(p))(); },
+			[] (void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); static_cast<T*>(src)->~T(); },
+			[] (void* p) { static_cast<T*>(p)->~T(); }
+		};
+
+		template <typename T>
+		constexpr static VTable heapVTable = {
+			[] (void* p) { (**static_cast<T**>(p))(); },
+			[] (void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+			[] (void* p) { delete *static_cast<T**>(p); }
+		};
+
+		alignas(std::max_align_t) std::array<char, inlineSize> storage;
+		const VTable* vtable = nullptr;
+
+		void moveFrom(TaskFunction& other)
+		{
+			if (other.vtable) {
+				other.vtable->move(storage.data(), other.storage.data());
+				vtable = other.vtable;
+				other.vtable = nullptr;
+			}
+		}
+	};
+
+	using TaskBase = TaskFunction;
+
+	enum class TaskPriority {
+		High,
+		Normal,
+		Low
+	};
 
+	// Each attached executor owns a deque: tasks queued from one of this queue's own threads go to that thread's deque,
+	// which it pops LIFO, while idle threads steal FIFO from the others. Tasks queued from anywhere else go into the
+	// shared injection queues, one per priority. High priority injected tasks are taken before a thread's own deque.
 	class ExecutionQueue
 	{
 	public:
 		ExecutionQueue();
-		void addToQueue(TaskBase task);
+		~ExecutionQueue();
+
+		void addToQueue(TaskBase task, TaskPriority priority = TaskPriority::Normal);
 
 		TaskBase getNext();
 		std::vector<TaskBase> getAll();
 
 		size_t threadCount() const;
+		std::optional<size_t> getCurrentWorkerIndex() const; // Index of the calling thread among this queue's workers, if it's one of them
 		void onAttached();
 		void onDetached();
 		void abort();
@@ -29,13 +143,41 @@ namespace Halley
 		static ExecutionQueue& getDefault();
 
 	private:
-		std::deque<TaskBase> queue;
-		std::mutex mutex;
+		friend class Executor;
+
+		constexpr static size_t maxWorkers = 64;
+		constexpr static size_t numPriorities = 3;
+		constexpr static size_t noWorker = size_t(-1);
+
+		struct alignas(64) WorkerQueue {
+			std::mutex mutex;
+			std::deque<TaskBase> tasks;
+			bool inUse = false;
+		};
+
+		std::array<std::deque<TaskBase>, numPriorities> injected;
+		std::mutex injectedMutex;
+		std::array<std::atomic<int>, numPriorities> injectedCount {};
+
+		std::array<std::unique_ptr<WorkerQueue>, maxWorkers> workers;
+		std::atomic<size_t> numWorkers;
+
+		std::mutex sleepMutex;
 		std::condition_variable condition;
+		std::atomic<int> sleepingCount;
+		std::atomic<int> pendingCount;
 
 		std::atomic<int> attachedCount;
-		std::atomic<bool> hasTasks;
 		std::atomic<bool> aborted;
+
+		TaskBase getNext(size_t workerIdx);
+		bool tryPop(size_t workerIdx, TaskBase& task);
+		bool tryPopInjected(TaskBase& task, TaskPriority highest, TaskPriority lowest);
+		bool trySteal(size_t workerIdx, TaskBase& task);
+		size_t getCurrentWorker() const;
+		size_t attachWorker();
+		void detachWorker(size_t workerIdx);
+		void wakeOne();
 	};
 
 	class Executors
@@ -43,6 +185,7 @@ namespace Halley
 	public:
 		static Executors& get();
 		static void setInstance(Executors& e);
+		static bool hasInstance() { return instance != nullptr; }
 
 		static ExecutionQueue& getCPU() { return instance->cpu; }
 		static ExecutionQueue& getCPUAux() { return instance->cpuAux; }
@@ -466,6 +466,17 @@ namespace Halley
 				TaskHelper<T>::setPromise(promise, payload);
 			});
 		}
+
+		template <typename F>
+		[[nodiscard]] static Future<T> enqueueCallableOn(ExecutionQueue& e, F f, TaskPriority priority)
+		{
+			Promise<T> promise;
+			auto future = promise.getFuture();
+			e.addToQueue([f(std::move(f)), promise(std::move(promise))]() mutable {
+				TaskHelper<T>::setPromise(promise, f);
+			}, priority);
+			return future;
+		}
 	};
 
 	template<typename T>
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace Halley {
+	// Scratch memory that only lives for a couple of frames, with no cost to free
+	// Each thread allocates linearly from its own pair of buffers: one for the current frame, and one for the previous
+	// frame, which is kept so that anything allocated late in a frame is still valid while the next one starts.
+	// A buffer is reset as a whole once its frame is two frames old, so nothing allocated here may be kept longer
+	// than that. In debug builds, reset memory is filled with 0xDD to make such mistakes obvious.
+	class FrameArena
+	{
+	public:
+		constexpr static size_t blockSize = 64 * 1024;
+
+		// Called by the main loop at the start of every frame
+		static void onFrameStart();
+		static uint64_t getFrameNumber();
+
+		// Before the first frame starts, there's nothing to reset the arena, so FrameAllocator uses the heap instead
+		static bool isActive();
+
+		static void* alloc(size_t size, size_t align);
+
+		// Gives back memory if it was the last allocation made by this thread, e.g. a temporary that's already gone
+		static void free(void* p, size_t size);
+
+		// Bytes allocated by the calling thread on the current frame, and owned by its buffers
+		static size_t getUsedBytes();
+		static size_t getReservedBytes();
+	};
+
+	// STL allocator on top of FrameArena, e.g. for per-frame temporary containers
+	template <typename T>
+	class FrameAllocator
+	{
+	public:
+		using value_type = T;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		FrameAllocator()
+			: useArena(FrameArena::isActive())
+		{}
+
+		template <typename U>
+		FrameAllocator(const FrameAllocator<U>& other)
+			: useArena(other.usesArena())
+		{}
+
+		T* allocate(size_t n)
+		{
+			if (useArena) {
+				return static_cast<T*>(FrameArena::alloc(n * sizeof(T), alignof(T)));
+			}
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		void deallocate(T* p, size_t n)
+		{
+			if (useArena) {
+				FrameArena::free(p, n * sizeof(T));
+			} else {
+				::operator delete(p);
+			}
+		}
+
+		bool usesArena() const { return useArena; }
+
+		template <typename U>
+		bool operator==(const FrameAllocator<U>& other) const { return useArena == other.usesArena(); }
+
+		template <typename U>
+		bool operator!=(const FrameAllocator<U>& other) const { return useArena != other.usesArena(); }
+
+	private:
+		bool useArena;
+	};
+
+	template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
@@ -21,9 +21,17 @@
 
 \*****************************************************************/
 
+#include <array>
 #include <cstdint>
+#include <new>
+#include <utility>
+#include "memory_pool.h"
+#include "vector.h"
 
 namespace Halley {
+	// Maps ids onto entries, which are handed out from large blocks
+	// Not thread-safe, as each pool has a single owner (e.g. the entity map of a World). The blocks themselves come from
+	// PoolPool, so they're included in its stats.
 	template <typename T, size_t blockLen = 16384>
 	class MappedPool {
 		struct Entry {
@@ -31,25 +39,50 @@ namespace Halley {
 			uint32_t nextFreeEntryIndex;
 			uint32_t revision;
 		};
+		static_assert(alignof(Entry) <= PoolPool::granularity);
 
 		struct Block {
-			Vector<Entry> data;
+			Entry* data;
 
 			Block(size_t blockIndex)
-				: data(blockLen)
+				: data(static_cast<Entry*>(getBlockPool()->alloc()))
 			{
 				size_t base = blockIndex * blockLen;
 				for (size_t i = 0; i < blockLen; i++) {
 					// Each entry points to the next
+					new (&data[i]) Entry();
 					data[i].nextFreeEntryIndex = static_cast<uint32_t>(i + 1 + base);
 					data[i].revision = 0;
 				}
 			}
 
+			~Block()
+			{
+				if (data) {
+					getBlockPool()->free(data);
+				}
+			}
+
 			Block(const Block& other) = delete;
 			Block& operator=(const Block& other) = delete;
-			Block(Block&& other) noexcept = default;
-			Block& operator=(Block&& other) noexcept = default;
+
+			Block(Block&& other) noexcept
+				: data(other.data)
+			{
+				other.data = nullptr;
+			}
+
+			Block& operator=(Block&& other) noexcept
+			{
+				std::swap(data, other.data);
+				return *this;
+			}
+
+			static SizePool* getBlockPool()
+			{
+				static SizePool* pool = PoolPool::getPool(sizeof(Entry) * blockLen);
+				return pool;
+			}
 		};
 
 	public:
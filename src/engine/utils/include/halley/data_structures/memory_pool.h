@@ -1,33 +1,69 @@
 #pragma once
 
-#include "flat_map.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "vector.h"
 
 namespace Halley {
+	struct MemoryPoolStats
+	{
+		size_t blockSize = 0;
+		size_t liveBytes = 0; // Currently allocated by users of the pool
+		size_t highWaterBytes = 0; // Peak of what was handed out to threads, including blocks sitting in their caches
+		size_t reservedBytes = 0; // Obtained from the system, and never given back
+	};
+
+	// Fixed size blocks, safe to allocate and free from any thread, including freeing on a different thread
+	// Each thread keeps a small cache of free blocks per pool, so most calls don't lock; the cache trades blocks with the
+	// pool's shared free list in batches when it runs out, or holds too many.
 	class SizePool
 	{
 	public:
 		explicit SizePool(size_t size);
 		~SizePool();
 
+		SizePool(const SizePool& other) = delete;
+		SizePool& operator=(const SizePool& other) = delete;
+
 		size_t getSize() const { return size; }
 		void* alloc();
 		void free(void* p);
 
+		MemoryPoolStats getStats() const;
+
+		// Used by the thread caches
+		size_t getBatchSize() const { return batchSize; }
+		void* takeBatch(size_t& n);
+		void returnBatch(void* head, size_t n);
+		void retireLiveBlocks(int64_t n);
+
 	private:
-		void* pimpl;
-		size_t size;
+		const size_t size;
+		const size_t batchSize;
+		const bool pooled;
+		const size_t classIndex;
+
+		mutable std::mutex mutex;
+		void* freeList = nullptr;
+		Vector<void*> slabs;
+		size_t outstanding = 0;
+		size_t highWater = 0;
+		int64_t retiredLive = 0;
+
+		void addSlab();
 	};
 
 	// yo dawg
 	class PoolPool
 	{
 	public:
-		static SizePool* getPool(size_t size);
+		constexpr static size_t granularity = 16;
+		constexpr static size_t maxPooledSize = 2048;
 
-	private:
-		static PoolPool& get();
-
-		FlatMap<size_t, SizePool*> pools;
+		static SizePool* getPool(size_t size);
+		static Vector<MemoryPoolStats> getStats();
 	};
 
 	template <typename T>
@@ -36,27 +72,20 @@ namespace Halley {
 	public:
 		static void* alloc()
 		{
-			return get().pool->alloc();
+			return get()->alloc();
 		}
 
 		static void free(void* p)
 		{
-			get().pool->free(p);
+			get()->free(p);
 		}
 
 	private:
-		PoolAllocator()
-		{
-			pool = new SizePool(sizeof(T));
-		}
-
-		static PoolAllocator& get()
+		static SizePool* get()
 		{
-			static PoolAllocator instance;
-			return instance;
+			static SizePool* pool = PoolPool::getPool(sizeof(T));
+			return pool;
 		}
-
-		SizePool* pool;
 	};
-	
+
 }
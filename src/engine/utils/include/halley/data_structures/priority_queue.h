@@ -1,3 +1,5 @@
+#pragma once
+
 #include <algorithm>
 #include <vector>
 
@@ -45,6 +47,11 @@ namespace Halley {
 	        heap.reserve(size);
         }
 
+        void clear()
+        {
+	        heap.clear();
+        }
+
     private:
         std::vector<T> heap;
         Comparator comparator;
@@ -119,6 +119,21 @@ namespace Halley {
             numEntries.fetch_sub(numToRead);
     	}
 
+    	// Gives the reader access to the oldest entry in place, so it can be consumed without copying it out
+    	// Whatever the reader leaves in the entry is only released when the writer overwrites it, on the writer's thread
+    	T& peekOne()
+    	{
+            Expects(canRead(1));
+            return entries[readPos];
+    	}
+
+    	void popOne()
+    	{
+            Expects(canRead(1));
+            readPos = (readPos + 1) % entries.size();
+            --numEntries;
+    	}
+
     private:
         size_t readPos = 0;
         size_t writePos = 0;
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <gsl/span>
+
+namespace Halley
+{
+	enum class MemoryAccessHint {
+		Normal,
+		Sequential,
+		Random,
+		WillNeed,
+		DontNeed
+	};
+
+	// A read-only view of a whole file, paged in by the OS on demand
+	// Obtained from OS::mapFile; the view stays valid until this object is destroyed.
+	class MemoryMappedFile
+	{
+	public:
+		virtual ~MemoryMappedFile() {}
+
+		virtual gsl::span<const gsl::byte> getData() const = 0;
+
+		// Tells the OS how [pos, pos + size) will be accessed. DontNeed drops those pages from memory; they are read back
+		// from the file if accessed again, so views into the range remain valid.
+		virtual void advise(size_t pos, size_t size, MemoryAccessHint hint) {}
+	};
+}
@@ -14,6 +14,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 
 #include "data_structures/bin_pack.h"
 #include "data_structures/dynamic_grid.h"
+#include "data_structures/frame_allocator.h"
 #include "data_structures/hash_map.h"
 #include "data_structures/mapped_pool.h"
 #include "data_structures/maybe.h"
@@ -80,6 +81,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "support/debug.h"
 #include "support/exception.h"
 #include "support/logger.h"
+#include "support/profiler.h"
 #include "support/redirect_stream.h"
 
 #include "text/encode.h"
@@ -87,6 +89,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "text/halleystring.h"
 #include "text/i18n.h"
 #include "text/string_converter.h"
+#include "text/string_id.h"
 #include "text/string_serializer.h"
 
 #include "time/halleytime.h"
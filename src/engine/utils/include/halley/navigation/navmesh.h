@@ -4,6 +4,7 @@
 #include "navigation_query.h"
 #include "halley/maths/polygon.h"
 #include "halley/maths/base_transform.h"
+#include "halley/data_structures/priority_queue.h"
 
 namespace Halley {
 	class Random;
@@ -110,6 +111,7 @@ namespace Halley {
 			NodeAndConn cameFrom;
 			bool inOpenSet = false;
 			bool inClosedSet = false;
+			uint32_t generation = 0;
 		};
 
 		class NodeComparator {
@@ -125,6 +127,21 @@ namespace Halley {
 			const std::vector<State>& state;
 		};
 
+		// Per-thread A* state, reused across queries
+		// Entries are stamped with the query's generation and only reset when first touched by a query, so starting one is O(1)
+		class Scratch {
+		public:
+			std::vector<State> state;
+			PriorityQueue<NodeId, NodeComparator> openSet;
+
+			Scratch();
+			void begin(size_t nNodes);
+			State& get(NodeId id);
+
+		private:
+			uint32_t generation = 0;
+		};
+
 		std::vector<Node> nodes;
 		std::vector<Polygon> polygons;
 		std::vector<Portal> portals;
@@ -145,6 +162,7 @@ namespace Halley {
 
 		std::optional<std::vector<NodeAndConn>> pathfind(int fromId, int toId) const;
 		std::vector<NodeAndConn> makeResult(const std::vector<State>& state, int startId, int endId) const;
+		static Scratch& getScratch();
 		std::optional<NavigationPath> makePath(const NavigationQuery& query, const std::vector<NodeAndConn>& nodePath) const;
 		void postProcessPath(std::vector<Vector2f>& points, NavigationQuery::PostProcessingType type) const;
 
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include "navmesh.h"
 #include "navigation_query.h"
 #include "navigation_path.h"
+#include "halley/data_structures/hash_map.h"
 
 namespace Halley {
 	class NavmeshSet {
@@ -10,6 +13,11 @@ namespace Halley {
 		NavmeshSet();
 		NavmeshSet(const ConfigNode& nodeData);
 
+		NavmeshSet(const NavmeshSet& other);
+		NavmeshSet(NavmeshSet&& other) noexcept;
+		NavmeshSet& operator=(const NavmeshSet& other);
+		NavmeshSet& operator=(NavmeshSet&& other) noexcept;
+
 		ConfigNode toConfigNode() const;
 
 		void add(Navmesh navmesh);
@@ -22,6 +30,10 @@ namespace Halley {
 		void reportUnlinkedPortals(std::function<String(Vector2i)> getChunkName) const;
 
 		std::optional<NavigationPath> pathfind(const NavigationQuery& query) const;
+
+		// Runs all queries on the default execution queue, with each worker reusing its own scratch state
+		// Results are in the same order as the queries.
+		std::vector<std::optional<NavigationPath>> pathfind(gsl::span<const NavigationQuery> queries) const;
 		std::optional<NavigationPath> pathfindInRegion(const NavigationQuery& query, uint16_t regionId) const;
 
 		gsl::span<const Navmesh> getNavmeshes() const { return navmeshes; }
@@ -44,9 +56,11 @@ namespace Halley {
 			{}
 		};
 		
+		// A portal between two regions, as seen from fromRegion; the portal graph is built by linkNavmeshes()
 		struct PortalNode {
 			Vector2f pos;
 			std::vector<PortalConnection> connections;
+			std::vector<PortalConnection> incoming;
 			uint16_t fromRegion;
 			uint16_t fromPortal;
 			uint16_t toRegion;
@@ -71,6 +85,7 @@ namespace Halley {
 			NodeId cameFrom;
 			bool inOpenSet = false;
 			bool inClosedSet = false;
+			uint32_t generation = 0;
 		};
 
 		class NodeComparator {
@@ -86,11 +101,39 @@ namespace Halley {
 			const std::vector<State>& state;
 		};
 
+		// Per-thread A* state, reused across queries (see Navmesh::Scratch)
+		class Scratch {
+		public:
+			std::vector<State> state;
+			PriorityQueue<NodeId, NodeComparator> openSet;
+
+			Scratch();
+			void begin(size_t nNodes);
+			State& get(NodeId id);
+
+		private:
+			uint32_t generation = 0;
+		};
+
+		// Shortest portal graph distance from every portal node into one destination region, ignoring where in that region the path ends
+		// This is a lower bound on the remaining cost, so it's used as the A* heuristic for region paths into that region,
+		// which then only expand the portals along the best route. Built on demand and kept until the portal graph changes.
+		struct RegionCosts {
+			std::vector<float> costToGo;
+		};
+
 		std::vector<Navmesh> navmeshes;
 		std::vector<PortalNode> portalNodes;
 		std::vector<RegionNode> regionNodes;
 
+		mutable std::mutex regionCostsMutex;
+		mutable HashMap<NodeId, std::shared_ptr<const RegionCosts>> regionCosts;
+
 		void tryLinkNavMeshes(uint16_t idxA, uint16_t idxB);
+		void invalidateRegionCosts();
+		std::shared_ptr<const RegionCosts> getRegionCosts(NodeId toRegionId) const;
+		static std::vector<float> computeCostsToRegion(gsl::span<const PortalNode> portalNodes, uint16_t toRegionId);
+		static Scratch& getScratch();
 
 		std::vector<NavigationPath::RegionNode> findRegionPath(Vector2f startPos, Vector2f endPos, uint16_t fromRegionId, uint16_t toRegionId) const;
 	};
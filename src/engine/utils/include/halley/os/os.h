@@ -23,6 +23,7 @@
 
 #include "halley/text/halleystring.h"
 #include "halley/file/path.h"
+#include "halley/file/memory_mapped_file.h"
 #include "halley/core/api/system_api.h"
 
 namespace Halley {
@@ -68,6 +69,9 @@ namespace Halley {
 		virtual void atomicWriteFile(const Path& path, gsl::span<const gsl::byte> data, std::optional<Path> backupOldVersionPath = {});
 		virtual std::vector<Path> enumerateDirectory(const Path& path);
 
+		// Returns null if the file can't be mapped, or the platform doesn't support it
+		virtual std::unique_ptr<MemoryMappedFile> mapFile(const Path& path);
+
 		virtual void setConsoleColor(int foreground, int background);
 		virtual int runCommand(String command, String cwd = "", ILoggerSink* sink = nullptr);
 		virtual Future<int> runCommandAsync(const String& string, const String& cwd = "", ILoggerSink* sink = nullptr);
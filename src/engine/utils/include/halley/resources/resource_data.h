@@ -59,6 +59,7 @@ namespace Halley {
 	public:
 		ResourceDataStatic(String path);
 		ResourceDataStatic(const void* data, size_t size, String path, bool owning = true);
+		ResourceDataStatic(std::shared_ptr<const char> data, size_t size, String path); // Shares ownership of data, e.g. to keep the memory it's in alive
 
 		void set(const void* data, size_t size, bool owning = true);
 		bool isLoaded() const;
@@ -49,6 +49,7 @@ namespace Halley {
 		static String getCallStack(int skip = 3);
 
 		static void trace(const char* filename, int line, const char* arg = nullptr);
+		static void setTraceEnabledOnThisThread(bool enabled); // The trace ring isn't thread-safe, so threads running alongside the main one should disable it
 		static String getLastTraces();
 		static void printLastTraces();
 
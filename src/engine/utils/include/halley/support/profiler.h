@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "halley/text/halleystring.h"
+#include "halley/data_structures/vector.h"
+
+namespace Halley
+{
+	// The events recorded by every thread during a range of frames
+	// Event names point to the strings given when they were recorded, see Profiler::intern
+	class ProfilerCapture
+	{
+	public:
+		struct Event
+		{
+			const char* name;
+			int64_t start;
+			int64_t end;
+		};
+
+		struct Thread
+		{
+			String name;
+			uint32_t id;
+			Vector<Event> events;
+		};
+
+		int64_t start = 0;
+		int64_t end = 0;
+		Vector<int64_t> frameStarts;
+		Vector<Thread> threads;
+
+		bool empty() const;
+
+		// Converts to the JSON format read by chrome://tracing and Perfetto
+		String toChromeTrace() const;
+	};
+
+	// Records timed events from any thread, to find out where each frame went
+	// Each thread writes to its own ring buffer, without locking, so recent history is always available to be captured.
+	// Recording is off by default, and ProfilerEvent does nothing but check a flag until it's turned on.
+	class Profiler
+	{
+	public:
+		constexpr static size_t eventsPerThread = 16384;
+		constexpr static size_t framesKept = 256;
+
+		static void setEnabled(bool value);
+		static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+		// Names the calling thread in captures
+		static void setThreadName(const String& name);
+
+		// Returns a copy of name that stays valid until the program exits, for names that don't come from literals
+		static const char* intern(const String& name);
+
+		// Nanoseconds since an arbitrary point
+		static int64_t getTime();
+
+		static void addEvent(const char* name, int64_t start, int64_t end);
+
+		// Marks the start of a new frame, called by the main loop
+		static void onFrameStart();
+		static uint64_t getFrameNumber();
+
+		// Captures the last nFrames complete frames
+		static ProfilerCapture capture(size_t nFrames);
+
+	private:
+		static std::atomic<bool> enabled;
+	};
+
+	// Records an event for the lifetime of this object
+	class ProfilerEvent
+	{
+	public:
+		explicit ProfilerEvent(const char* name)
+			: name(name)
+			, start(Profiler::isEnabled() ? Profiler::getTime() : -1)
+		{}
+
+		~ProfilerEvent()
+		{
+			if (start >= 0) {
+				Profiler::addEvent(name, start, Profiler::getTime());
+			}
+		}
+
+		ProfilerEvent(const ProfilerEvent& other) = delete;
+		ProfilerEvent& operator=(const ProfilerEvent& other) = delete;
+
+	private:
+		const char* name;
+		int64_t start;
+	};
+}
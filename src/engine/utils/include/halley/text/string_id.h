@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "halleystring.h"
+
+namespace Halley {
+	// A string reduced to a 64-bit hash, for cheap lookups and comparisons by name
+	// Ids made from a char array in a constant expression are hashed at compile time. Ids made anywhere else are interned into
+	// a global table, so their text stays available, and two strings that hash the same are caught.
+	// Comparisons only look at the hash; debug builds also check the text of ids that weren't interned against the table.
+	class StringId
+	{
+	public:
+		constexpr StringId()
+			: value(hash("", 0))
+			, str("")
+			, len(0)
+		{}
+
+		// In a constant expression the array can only be a literal or another constant, so the id points straight at it.
+		// Anywhere else, it's read up to its first null and interned, so it doesn't need to outlive the id.
+		template <size_t N>
+		constexpr StringId(const char (&str)[N])
+			: StringId(str, textLength(str, N - 1), isConstantEvaluated())
+		{}
+
+		StringId(const String& str);
+		StringId(const std::string& str);
+
+		constexpr uint64_t getValue() const { return value; }
+		constexpr const char* c_str() const { return str; }
+		constexpr size_t length() const { return len; }
+		constexpr bool isEmpty() const { return len == 0; }
+		String getString() const;
+
+		constexpr bool operator==(const StringId& other) const
+		{
+#ifdef _DEBUG
+			if (value == other.value && str != other.str && !isConstantEvaluated()) {
+				checkCollision(*this, other);
+			}
+#endif
+			return value == other.value;
+		}
+		constexpr bool operator!=(const StringId& other) const { return !(*this == other); }
+		constexpr bool operator<(const StringId& other) const { return value < other.value; }
+
+		// 64-bit FNV-1a
+		static constexpr uint64_t hash(const char* str, size_t len)
+		{
+			uint64_t result = 14695981039346656037ull;
+			for (size_t i = 0; i < len; ++i) {
+				result ^= static_cast<uint8_t>(str[i]);
+				result *= 1099511628211ull;
+			}
+			return result;
+		}
+
+		// Number of distinct strings interned so far
+		static size_t getNumInterned();
+
+	private:
+		uint64_t value;
+		const char* str;
+		size_t len;
+
+		explicit StringId(std::string_view str, uint64_t value);
+
+		constexpr StringId(const char* str, size_t len, bool isConstant)
+			: value(hash(str, len))
+			, str(isConstant ? str : intern(std::string_view(str, len), value))
+			, len(len)
+		{}
+
+		static constexpr bool isConstantEvaluated()
+		{
+			return __builtin_is_constant_evaluated();
+		}
+
+		static constexpr size_t textLength(const char* str, size_t maxLen)
+		{
+			size_t len = 0;
+			while (len < maxLen && str[len] != 0) {
+				++len;
+			}
+			return len;
+		}
+
+		static const char* intern(std::string_view str, uint64_t value);
+		static void checkCollision(const StringId& a, const StringId& b);
+	};
+}
+
+namespace std {
+	template<>
+	struct hash<Halley::StringId>
+	{
+		size_t operator()(const Halley::StringId& id) const noexcept
+		{
+			return static_cast<size_t>(id.getValue());
+		}
+	};
+}
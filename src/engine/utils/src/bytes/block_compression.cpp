@@ -0,0 +1,129 @@
+#include "halley/bytes/block_compression.h"
+#include "halley/bytes/compression.h"
+#include "halley/support/exception.h"
+#include <cstring>
+
+using namespace Halley;
+
+namespace {
+	constexpr uint32_t storedFlag = 0x80000000u;
+	constexpr char identifier[] = "HLZB";
+}
+
+size_t BlockCompression::Header::getNumBlocks() const
+{
+	return blockSize == 0 ? 0 : size_t((rawSize + blockSize - 1) / blockSize);
+}
+
+size_t BlockCompression::Header::getTableSize() const
+{
+	return getNumBlocks() * sizeof(uint32_t);
+}
+
+BlockCompression::Index::Index(const Header& header, gsl::span<const gsl::byte> table)
+	: rawSize(size_t(header.rawSize))
+	, blockSize(header.blockSize)
+{
+	if (memcmp(header.identifier.data(), identifier, 4) != 0 || header.blockSize == 0 || header.blockSize >= storedFlag) {
+		throw Exception("Invalid block compressed data.", HalleyExceptions::Compression);
+	}
+
+	const size_t nBlocks = header.getNumBlocks();
+	if (size_t(table.size()) < nBlocks * sizeof(uint32_t)) {
+		throw Exception("Block compressed data is truncated.", HalleyExceptions::Compression);
+	}
+
+	blockInfo.resize(nBlocks);
+	memcpy(blockInfo.data(), table.data(), nBlocks * sizeof(uint32_t));
+
+	blockOffsets.resize(nBlocks);
+	size_t offset = sizeof(Header) + header.getTableSize();
+	for (size_t i = 0; i < nBlocks; ++i) {
+		blockOffsets[i] = offset;
+		offset += getCompressedBlockSize(i);
+	}
+}
+
+size_t BlockCompression::Index::getCompressedBlockSize(size_t block) const
+{
+	return blockInfo[block] & ~storedFlag;
+}
+
+size_t BlockCompression::Index::getRawBlockSize(size_t block) const
+{
+	return std::min(blockSize, rawSize - block * blockSize);
+}
+
+void BlockCompression::Index::decompressBlock(size_t block, gsl::span<const gsl::byte> compressedBlock, gsl::span<gsl::byte> dst) const
+{
+	Expects(size_t(compressedBlock.size()) == getCompressedBlockSize(block));
+	Expects(size_t(dst.size()) == getRawBlockSize(block));
+
+	if (blockInfo[block] & storedFlag) {
+		if (compressedBlock.size() != dst.size()) {
+			throw Exception("Block compressed data is corrupt.", HalleyExceptions::Compression);
+		}
+		memcpy(dst.data(), compressedBlock.data(), dst.size());
+	} else {
+		Compression::decompressLZ(compressedBlock, dst);
+	}
+}
+
+Bytes BlockCompression::compress(gsl::span<const gsl::byte> src, size_t blockSize)
+{
+	Expects(blockSize > 0 && blockSize < storedFlag);
+
+	Header header;
+	memcpy(header.identifier.data(), identifier, 4);
+	header.blockSize = uint32_t(blockSize);
+	header.rawSize = uint64_t(src.size());
+	const size_t nBlocks = header.getNumBlocks();
+
+	Bytes result(sizeof(Header) + header.getTableSize());
+	memcpy(result.data(), &header, sizeof(Header));
+
+	for (size_t i = 0; i < nBlocks; ++i) {
+		const auto block = src.subspan(i * blockSize, std::min(blockSize, size_t(src.size()) - i * blockSize));
+		const auto compressed = Compression::compressLZ(block);
+
+		uint32_t info;
+		if (compressed.size() < size_t(block.size())) {
+			info = uint32_t(compressed.size());
+			result.insert(result.end(), compressed.begin(), compressed.end());
+		} else {
+			info = uint32_t(block.size()) | storedFlag;
+			const auto* bytes = reinterpret_cast<const Byte*>(block.data());
+			result.insert(result.end(), bytes, bytes + block.size());
+		}
+		memcpy(result.data() + sizeof(Header) + i * sizeof(uint32_t), &info, sizeof(uint32_t));
+	}
+
+	return result;
+}
+
+BlockCompression::Index BlockCompression::readIndex(gsl::span<const gsl::byte> src)
+{
+	if (size_t(src.size()) < sizeof(Header)) {
+		throw Exception("Block compressed data is truncated.", HalleyExceptions::Compression);
+	}
+	Header header;
+	memcpy(&header, src.data(), sizeof(Header));
+	return Index(header, src.subspan(sizeof(Header)));
+}
+
+void BlockCompression::decompress(gsl::span<const gsl::byte> src, gsl::span<gsl::byte> dst)
+{
+	const auto index = readIndex(src);
+	if (size_t(dst.size()) != index.getRawSize()) {
+		throw Exception("Block compressed data doesn't match the expected size.", HalleyExceptions::Compression);
+	}
+
+	for (size_t i = 0; i < index.getNumBlocks(); ++i) {
+		const size_t offset = index.getBlockOffset(i);
+		const size_t size = index.getCompressedBlockSize(i);
+		if (offset + size > size_t(src.size())) {
+			throw Exception("Block compressed data is truncated.", HalleyExceptions::Compression);
+		}
+		index.decompressBlock(i, src.subspan(offset, size), dst.subspan(i * index.getBlockSize(), index.getRawBlockSize(i)));
+	}
+}
@@ -1,5 +1,8 @@
 #include <cstdlib>
 #include <memory>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 #include "halley/bytes/compression.h"
 //#include "../../contrib/lodepng/lodepng.h"
 #include "../../../../contrib/zlib/zlib.h"
@@ -168,3 +171,179 @@ Bytes Compression::decompressRaw(gsl::span<const gsl::byte> bytes, size_t maxSiz
 		return result;
 	}
 }
+
+namespace {
+	constexpr size_t lzMinMatch = 4;
+	constexpr size_t lzLastLiterals = 5; // The last bytes are always literals, so the decoder never reads a match past the end
+	constexpr size_t lzMatchStartLimit = 12;
+	constexpr size_t lzMaxOffset = 65535;
+	constexpr int lzHashLog = 14;
+
+	uint32_t lzRead32(const uint8_t* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t lzHash(uint32_t seq)
+	{
+		return (seq * 2654435761u) >> (32 - lzHashLog);
+	}
+
+	void lzWriteLength(Bytes& out, size_t len)
+	{
+		while (len >= 255) {
+			out.push_back(255);
+			len -= 255;
+		}
+		out.push_back(Byte(len));
+	}
+
+	void lzWriteSequence(Bytes& out, const uint8_t* literals, size_t literalLen, size_t offset, size_t matchLen)
+	{
+		const size_t matchCode = matchLen > 0 ? matchLen - lzMinMatch : 0;
+		out.push_back(Byte((std::min(literalLen, size_t(15)) << 4) | std::min(matchCode, size_t(15))));
+		if (literalLen >= 15) {
+			lzWriteLength(out, literalLen - 15);
+		}
+		out.insert(out.end(), literals, literals + literalLen);
+
+		if (matchLen > 0) {
+			out.push_back(Byte(offset & 0xFF));
+			out.push_back(Byte(offset >> 8));
+			if (matchCode >= 15) {
+				lzWriteLength(out, matchCode - 15);
+			}
+		}
+	}
+}
+
+Bytes Compression::compressLZ(gsl::span<const gsl::byte> bytes)
+{
+	const auto* src = reinterpret_cast<const uint8_t*>(bytes.data());
+	const size_t n = size_t(bytes.size());
+
+	Bytes out;
+	out.reserve(n + n / 255 + 16);
+
+	size_t anchor = 0;
+	if (n > lzMatchStartLimit) {
+		std::vector<uint32_t> table(size_t(1) << lzHashLog, 0);
+		const size_t matchStartLimit = n - lzMatchStartLimit;
+		const size_t matchEndLimit = n - lzLastLiterals;
+
+		size_t i = 0;
+		while (i < matchStartLimit) {
+			const uint32_t seq = lzRead32(src + i);
+			auto& slot = table[lzHash(seq)];
+			const size_t candidate = slot;
+			slot = uint32_t(i);
+
+			if (candidate < i && i - candidate <= lzMaxOffset && lzRead32(src + candidate) == seq) {
+				size_t len = lzMinMatch;
+				while (i + len < matchEndLimit && src[candidate + len] == src[i + len]) {
+					++len;
+				}
+				lzWriteSequence(out, src + anchor, i - anchor, i - candidate, len);
+				i += len;
+				anchor = i;
+
+				if (i - 2 < matchStartLimit) {
+					table[lzHash(lzRead32(src + i - 2))] = uint32_t(i - 2);
+				}
+			} else {
+				// Skip ahead faster the longer we go without a match, so incompressible data doesn't cost much
+				i += 1 + ((i - anchor) >> 6);
+			}
+		}
+	}
+
+	lzWriteSequence(out, src + anchor, n - anchor, 0, 0);
+	return out;
+}
+
+void Compression::decompressLZ(gsl::span<const gsl::byte> bytes, gsl::span<gsl::byte> dstBytes)
+{
+	const auto* src = reinterpret_cast<const uint8_t*>(bytes.data());
+	auto* dst = reinterpret_cast<uint8_t*>(dstBytes.data());
+	const size_t n = size_t(bytes.size());
+	const size_t m = size_t(dstBytes.size());
+	size_t ip = 0;
+	size_t op = 0;
+
+	auto fail = [] ()
+	{
+		throw Exception("Unable to decompress data: corrupt LZ stream.", HalleyExceptions::Compression);
+	};
+
+	auto readLength = [&] (size_t len) -> size_t
+	{
+		if (len == 15) {
+			uint8_t b;
+			do {
+				if (ip >= n) {
+					fail();
+				}
+				b = src[ip++];
+				len += b;
+			} while (b == 255);
+		}
+		return len;
+	};
+
+	while (true) {
+		if (ip >= n) {
+			fail();
+		}
+		const uint8_t token = src[ip++];
+
+		const size_t literalLen = readLength(token >> 4);
+		if (literalLen > n - ip || literalLen > m - op) {
+			fail();
+		}
+		if (literalLen <= 16 && n - ip >= 16 && m - op >= 16) {
+			// Short literal run with room to spare on both sides: one fixed size copy, then advance by the real length
+			memcpy(dst + op, src + ip, 16);
+		} else {
+			memcpy(dst + op, src + ip, literalLen);
+		}
+		ip += literalLen;
+		op += literalLen;
+
+		if (ip == n) {
+			// The last sequence has no match
+			break;
+		}
+
+		if (n - ip < 2) {
+			fail();
+		}
+		const size_t offset = size_t(src[ip]) | (size_t(src[ip + 1]) << 8);
+		ip += 2;
+		const size_t matchLen = readLength(token & 0xF) + lzMinMatch;
+		if (offset == 0 || offset > op || matchLen > m - op) {
+			fail();
+		}
+
+		const uint8_t* match = dst + op - offset;
+		if (offset >= 8 && matchLen <= 32 && m - op >= 32) {
+			// Copy in 8 byte steps; each step only reads bytes already written, since offset >= 8
+			for (size_t i = 0; i < matchLen; i += 8) {
+				memcpy(dst + op + i, match + i, 8);
+			}
+		} else if (offset >= matchLen) {
+			memcpy(dst + op, match, matchLen);
+		} else {
+			// Overlapping match, repeating the last offset bytes
+			for (size_t i = 0; i < matchLen; ++i) {
+				dst[op + i] = match[i];
+			}
+		}
+		op += matchLen;
+	}
+
+	if (op != m) {
+		fail();
+	}
+}
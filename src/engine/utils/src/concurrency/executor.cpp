@@ -3,57 +3,249 @@
 #include <halley/support/exception.h>
 #include "halley/text/string_converter.h"
 #include "halley/support/logger.h"
+#include "halley/support/profiler.h"
 
 using namespace Halley;
 
 Executors* Executors::instance = nullptr;
 
+namespace {
+	thread_local ExecutionQueue* currentQueue = nullptr;
+	thread_local size_t currentWorkerIdx = 0;
+}
+
 ExecutionQueue::ExecutionQueue()
-	: aborted(false)
+	: numWorkers(0)
+	, sleepingCount(0)
+	, pendingCount(0)
+	, attachedCount(0)
+	, aborted(false)
 {
-	hasTasks.store(false);
 }
 
+ExecutionQueue::~ExecutionQueue() = default;
+
 TaskBase ExecutionQueue::getNext()
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	while (queue.empty()) {
-		if (!aborted) {
-			condition.wait(lock);
+	auto task = getNext(getCurrentWorker());
+	if (!task) {
+		return TaskBase([] () {});
+	}
+	return task;
+}
+
+TaskBase ExecutionQueue::getNext(size_t workerIdx)
+{
+	TaskBase task;
+	while (!aborted) {
+		if (tryPopInjected(task, TaskPriority::High, TaskPriority::High)
+			|| (workerIdx != noWorker && tryPop(workerIdx, task))
+			|| tryPopInjected(task, TaskPriority::Normal, TaskPriority::Low)
+			|| trySteal(workerIdx, task)) {
+			return task;
 		}
-		if (aborted) {
-			queue.clear();
-			return TaskBase([] () {});
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		++sleepingCount;
+		while (pendingCount <= 0 && !aborted) {
+			condition.wait(lock);
 		}
+		--sleepingCount;
 	}
-
-	TaskBase value = queue.front();
-	queue.pop_front();
-	return value;
+	return task;
 }
 
 std::vector<TaskBase> ExecutionQueue::getAll()
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	hasTasks.store(false);
-	std::vector<TaskBase> tasks(queue.begin(), queue.end());
-	queue.clear();
+	std::vector<TaskBase> tasks;
+	if (pendingCount <= 0) {
+		return tasks;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(injectedMutex);
+		for (size_t i = 0; i < numPriorities; ++i) {
+			for (auto& task: injected[i]) {
+				tasks.push_back(std::move(task));
+			}
+			injected[i].clear();
+			injectedCount[i] = 0;
+		}
+	}
+
+	const size_t n = numWorkers;
+	for (size_t i = 0; i < n; ++i) {
+		auto& worker = *workers[i];
+		std::unique_lock<std::mutex> lock(worker.mutex);
+		for (auto& task: worker.tasks) {
+			tasks.push_back(std::move(task));
+		}
+		worker.tasks.clear();
+	}
+
+	pendingCount -= int(tasks.size());
 	return tasks;
 }
 
-void ExecutionQueue::addToQueue(TaskBase task)
+void ExecutionQueue::addToQueue(TaskBase task, TaskPriority priority)
 {
 #if HAS_THREADS
-	std::unique_lock<std::mutex> lock(mutex);
-	queue.emplace_back(task);
-	hasTasks.store(true);
+	// Count first, so a thread that finds the count raised but not the task yet retries rather than sleeping
+	++pendingCount;
+
+	const auto workerIdx = priority == TaskPriority::Normal ? getCurrentWorker() : noWorker;
+	if (workerIdx != noWorker) {
+		auto& worker = *workers[workerIdx];
+		std::unique_lock<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	} else {
+		std::unique_lock<std::mutex> lock(injectedMutex);
+		injected[static_cast<size_t>(priority)].push_back(std::move(task));
+		++injectedCount[static_cast<size_t>(priority)];
+	}
 
-	condition.notify_one();
+	wakeOne();
 #else
 	task();
 #endif
 }
 
+bool ExecutionQueue::tryPop(size_t workerIdx, TaskBase& task)
+{
+	auto& worker = *workers[workerIdx];
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty()) {
+		return false;
+	}
+
+	// Newest first, as it's most likely to still be in cache
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	--pendingCount;
+	return true;
+}
+
+bool ExecutionQueue::tryPopInjected(TaskBase& task, TaskPriority highest, TaskPriority lowest)
+{
+	const size_t first = static_cast<size_t>(highest);
+	const size_t last = static_cast<size_t>(lowest);
+
+	bool any = false;
+	for (size_t i = first; i <= last; ++i) {
+		any = any || injectedCount[i] > 0;
+	}
+	if (!any) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(injectedMutex);
+	for (size_t i = first; i <= last; ++i) {
+		auto& queue = injected[i];
+		if (!queue.empty()) {
+			task = std::move(queue.front());
+			queue.pop_front();
+			--injectedCount[i];
+			--pendingCount;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ExecutionQueue::trySteal(size_t workerIdx, TaskBase& task)
+{
+	const size_t n = numWorkers;
+	const size_t start = workerIdx == noWorker ? 0 : workerIdx + 1;
+	for (size_t i = 0; i < n; ++i) {
+		const size_t victimIdx = (start + i) % n;
+		if (victimIdx == workerIdx) {
+			continue;
+		}
+
+		// Oldest first, which tends to be the largest chunk of remaining work
+		auto& victim = *workers[victimIdx];
+		std::unique_lock<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			--pendingCount;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t ExecutionQueue::getCurrentWorker() const
+{
+	return currentQueue == this ? currentWorkerIdx : noWorker;
+}
+
+size_t ExecutionQueue::attachWorker()
+{
+	std::unique_lock<std::mutex> lock(injectedMutex);
+
+	const size_t n = numWorkers;
+	size_t idx = n;
+	for (size_t i = 0; i < n; ++i) {
+		if (!workers[i]->inUse) {
+			idx = i;
+			break;
+		}
+	}
+
+	if (idx == n) {
+		if (n == maxWorkers) {
+			throw Exception("Too many threads attached to execution queue", HalleyExceptions::Concurrency);
+		}
+		workers[idx] = std::make_unique<WorkerQueue>();
+		numWorkers = n + 1;
+	}
+	workers[idx]->inUse = true;
+
+	currentQueue = this;
+	currentWorkerIdx = idx;
+	return idx;
+}
+
+void ExecutionQueue::detachWorker(size_t workerIdx)
+{
+	currentQueue = nullptr;
+
+	// Hand over anything left behind, so it's not stranded if no other thread steals it
+	std::deque<TaskBase> leftover;
+	{
+		auto& worker = *workers[workerIdx];
+		std::unique_lock<std::mutex> lock(worker.mutex);
+		leftover = std::move(worker.tasks);
+		worker.tasks.clear();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(injectedMutex);
+		auto& queue = injected[static_cast<size_t>(TaskPriority::Normal)];
+		for (auto& task: leftover) {
+			queue.push_back(std::move(task));
+		}
+		injectedCount[static_cast<size_t>(TaskPriority::Normal)] += int(leftover.size());
+		workers[workerIdx]->inUse = false;
+	}
+
+	if (!leftover.empty()) {
+		wakeOne();
+	}
+}
+
+void ExecutionQueue::wakeOne()
+{
+	if (sleepingCount > 0) {
+		// Taking the lock ensures that a thread that's about to sleep either sees the new task or gets notified
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+		}
+		condition.notify_one();
+	}
+}
+
 Executors& Executors::get()
 {
 	if (!instance) {
@@ -72,6 +264,12 @@ size_t ExecutionQueue::threadCount() const
 	return attachedCount.load();
 }
 
+std::optional<size_t> ExecutionQueue::getCurrentWorkerIndex() const
+{
+	const auto idx = getCurrentWorker();
+	return idx != noWorker ? idx : std::optional<size_t>();
+}
+
 void ExecutionQueue::onAttached()
 {
 	++attachedCount;
@@ -85,7 +283,7 @@ void ExecutionQueue::onDetached()
 void ExecutionQueue::abort()
 {
 	{
-		std::unique_lock<std::mutex> lock(mutex);
+		std::unique_lock<std::mutex> lock(sleepMutex);
 		if (aborted) {
 			return;
 		}
@@ -129,10 +327,12 @@ bool Executor::runPending()
 void Executor::runForever()
 {
 #if HAS_THREADS
+	const auto workerIdx = queue.attachWorker();
 	try {
 		while (running)	{
-			auto next = queue.getNext();
-			if (running) {
+			auto next = queue.getNext(workerIdx);
+			if (running && next) {
+				ProfilerEvent event("Task");
 				next();
 			}
 		}
@@ -142,6 +342,7 @@ void Executor::runForever()
 	} catch (...) {
 		Logger::logError("Executor aborting due to unknown exception.");
 	}
+	queue.detachWorker(workerIdx);
 #endif
 }
 
@@ -188,8 +389,10 @@ ThreadPool::ThreadPool(const String& name, ExecutionQueue& queue, size_t n, Make
 	threads.resize(n);
 
 	for (size_t i = 0; i < n; i++) {
-		threads[i] = makeThread(name + " Pool " + toString(i), [this, i]()
+		const auto threadName = name + " Pool " + toString(i);
+		threads[i] = makeThread(threadName, [this, i, threadName]()
 		{
+			Profiler::setThreadName(threadName);
 			try {
 				executors[i]->runForever();
 			} catch (std::exception& e) {
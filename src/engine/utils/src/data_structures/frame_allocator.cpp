@@ -0,0 +1,188 @@
+#include "halley/data_structures/frame_allocator.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <gsl/gsl_assert>
+#include "halley/data_structures/vector.h"
+#include "halley/support/debug.h"
+#include "halley/utils/utils.h"
+
+using namespace Halley;
+
+namespace {
+	constexpr size_t maxAlign = alignof(std::max_align_t);
+
+	// Starts at 0, meaning no frame has started yet
+	std::atomic<uint64_t> frameNumber { 0 };
+
+	class FrameBuffer {
+	public:
+		FrameBuffer() = default;
+		FrameBuffer(const FrameBuffer& other) = delete;
+		FrameBuffer& operator=(const FrameBuffer& other) = delete;
+
+		~FrameBuffer()
+		{
+			for (auto& block: blocks) {
+				::operator delete(block.data, std::align_val_t(maxAlign));
+			}
+		}
+
+		void* alloc(size_t size, size_t align)
+		{
+			auto* p = alignPointer(top, align);
+			if (!top || p + size > end) {
+				addBlock(size + align);
+				p = alignPointer(top, align);
+			}
+			top = p + size;
+			used += size;
+			return p;
+		}
+
+		bool free(void* p, size_t size)
+		{
+			auto* start = static_cast<char*>(p);
+			if (start >= blockStart && start + size == top) {
+				top = static_cast<char*>(p);
+				used -= size;
+				return true;
+			}
+			return false;
+		}
+
+		void reset(uint64_t frame)
+		{
+			this->frame = frame;
+
+			// If last time didn't fit in a single block, replace them all with one big enough for it
+			if (blocks.size() > 1) {
+				size_t total = 0;
+				for (auto& block: blocks) {
+					total += block.size;
+					::operator delete(block.data, std::align_val_t(maxAlign));
+				}
+				blocks.clear();
+				addBlock(total);
+			} else if (!blocks.empty()) {
+				if constexpr (Debug::isDebug()) {
+					memset(blocks[0].data, 0xDD, top - blocks[0].data);
+				}
+				blockStart = top = blocks[0].data;
+				end = top + blocks[0].size;
+			}
+			used = 0;
+		}
+
+		uint64_t getFrame() const { return frame; }
+		size_t getUsedBytes() const { return used; }
+
+		size_t getReservedBytes() const
+		{
+			size_t total = 0;
+			for (auto& block: blocks) {
+				total += block.size;
+			}
+			return total;
+		}
+
+	private:
+		struct Block {
+			char* data;
+			size_t size;
+		};
+
+		Vector<Block> blocks;
+		char* blockStart = nullptr;
+		char* top = nullptr;
+		char* end = nullptr;
+		size_t used = 0;
+		uint64_t frame = 0;
+
+		static char* alignPointer(char* p, size_t align)
+		{
+			return reinterpret_cast<char*>(alignUp(reinterpret_cast<uintptr_t>(p), uintptr_t(align)));
+		}
+
+		void addBlock(size_t minSize)
+		{
+			const size_t size = alignUp(std::max(minSize, FrameArena::blockSize), FrameArena::blockSize);
+			auto* data = static_cast<char*>(::operator new(size, std::align_val_t(maxAlign)));
+			if constexpr (Debug::isDebug()) {
+				memset(data, 0xDD, size);
+			}
+			blocks.push_back(Block{ data, size });
+			blockStart = top = data;
+			end = data + size;
+		}
+	};
+
+	class ThreadArena {
+	public:
+		// Threads only find out that the frame changed when they next allocate
+		FrameBuffer& getCurrent()
+		{
+			const auto frame = frameNumber.load(std::memory_order_acquire);
+			if (buffers[current].getFrame() != frame) {
+				current = 1 - current;
+				buffers[current].reset(frame);
+			}
+			return buffers[current];
+		}
+
+		size_t getReservedBytes() const
+		{
+			return buffers[0].getReservedBytes() + buffers[1].getReservedBytes();
+		}
+
+	private:
+		FrameBuffer buffers[2];
+		size_t current = 0;
+	};
+
+	ThreadArena& getThreadArena()
+	{
+		thread_local ThreadArena arena;
+		return arena;
+	}
+}
+
+void FrameArena::onFrameStart()
+{
+	frameNumber.fetch_add(1, std::memory_order_acq_rel);
+}
+
+uint64_t FrameArena::getFrameNumber()
+{
+	return frameNumber.load(std::memory_order_acquire);
+}
+
+bool FrameArena::isActive()
+{
+	return getFrameNumber() > 0;
+}
+
+void* FrameArena::alloc(size_t size, size_t align)
+{
+	Expects(align <= maxAlign);
+	return getThreadArena().getCurrent().alloc(size, align);
+}
+
+void FrameArena::free(void* p, size_t size)
+{
+	// Only the calling thread's latest allocation can be taken back; anything else is reclaimed on reset
+	getThreadArena().getCurrent().free(p, size);
+}
+
+size_t FrameArena::getUsedBytes()
+{
+	return getThreadArena().getCurrent().getUsedBytes();
+}
+
+size_t FrameArena::getReservedBytes()
+{
+	auto& arena = getThreadArena();
+	arena.getCurrent();
+	return arena.getReservedBytes();
+}
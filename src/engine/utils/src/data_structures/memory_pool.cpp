@@ -1,49 +1,339 @@
-#include <boost/pool/pool.hpp>
 #include "halley/data_structures/memory_pool.h"
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <new>
+#include <set>
+#include <gsl/gsl_assert>
+#include "halley/utils/utils.h"
 
 using namespace Halley;
 
-PoolPool& PoolPool::get()
-{
-	static PoolPool* pools = nullptr;
-	if (!pools) {
-		pools = new PoolPool();
+namespace {
+	constexpr size_t numClasses = PoolPool::maxPooledSize / PoolPool::granularity;
+	constexpr size_t slabSize = 64 * 1024;
+	constexpr size_t batchBytes = 8 * 1024;
+
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	class ThreadCache;
+
+	// Both of these are leaked on purpose, as blocks can still be freed while the program exits
+	struct Pools {
+		std::array<std::unique_ptr<SizePool>, numClasses> classes;
+		std::mutex largeMutex;
+		std::map<size_t, std::unique_ptr<SizePool>> large;
+
+		Pools()
+		{
+			for (size_t i = 0; i < numClasses; ++i) {
+				classes[i] = std::make_unique<SizePool>((i + 1) * PoolPool::granularity);
+			}
+		}
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::set<const ThreadCache*> caches;
+	};
+
+	Pools& getPools()
+	{
+		static Pools* pools = new Pools();
+		return *pools;
 	}
-	return *pools;
-}
 
-SizePool* PoolPool::getPool(size_t size)
-{
-	auto& pools = get().pools;
-	auto iter = pools.find(size);
-	if (iter != pools.end()) {
-		return iter->second;
+	Registry& getRegistry()
+	{
+		static Registry* registry = new Registry();
+		return *registry;
 	}
 
-	auto pool = new SizePool(size);
-	pools[size] = pool;
-	return pool;
-}
+	// Trivially destructible, so they can still be read by other thread_local destructors after this thread's cache is gone
+	thread_local ThreadCache* currentCache = nullptr;
+	thread_local bool currentCacheDestroyed = false;
+
+	class ThreadCache {
+	public:
+		ThreadCache()
+		{
+			auto& registry = getRegistry();
+			std::unique_lock<std::mutex> lock(registry.mutex);
+			registry.caches.insert(this);
+			currentCache = this;
+		}
+
+		~ThreadCache()
+		{
+			currentCache = nullptr;
+			currentCacheDestroyed = true;
+
+			{
+				auto& registry = getRegistry();
+				std::unique_lock<std::mutex> lock(registry.mutex);
+				registry.caches.erase(this);
+			}
+
+			// Hand everything back, so other threads can use it
+			auto& pools = getPools();
+			for (size_t i = 0; i < numClasses; ++i) {
+				auto& pool = *pools.classes[i];
+				if (lists[i].count > 0) {
+					pool.returnBatch(lists[i].head, lists[i].count);
+				}
+				const auto n = live[i].load(std::memory_order_relaxed);
+				if (n != 0) {
+					pool.retireLiveBlocks(n);
+				}
+			}
+		}
+
+		void* alloc(SizePool& pool, size_t idx)
+		{
+			auto& list = lists[idx];
+			if (!list.head) {
+				size_t n = pool.getBatchSize();
+				list.head = static_cast<FreeBlock*>(pool.takeBatch(n));
+				list.count = n;
+			}
+
+			auto* block = list.head;
+			list.head = block->next;
+			--list.count;
+			addLive(idx, 1);
+			return block;
+		}
+
+		void free(SizePool& pool, size_t idx, void* p)
+		{
+			auto& list = lists[idx];
+			auto* block = static_cast<FreeBlock*>(p);
+			block->next = list.head;
+			list.head = block;
+			++list.count;
+			addLive(idx, -1);
+
+			// Threads that mostly free what others allocated would otherwise accumulate blocks forever
+			const size_t batchSize = pool.getBatchSize();
+			if (list.count >= 2 * batchSize) {
+				auto* head = list.head;
+				auto* tail = head;
+				for (size_t i = 1; i < batchSize; ++i) {
+					tail = tail->next;
+				}
+				list.head = tail->next;
+				list.count -= batchSize;
+				tail->next = nullptr;
+				pool.returnBatch(head, batchSize);
+			}
+		}
 
-typedef boost::pool<boost::default_user_allocator_malloc_free> PoolType;
+		int64_t getLive(size_t idx) const
+		{
+			return live[idx].load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct FreeList {
+			FreeBlock* head = nullptr;
+			size_t count = 0;
+		};
+
+		std::array<FreeList, numClasses> lists;
+
+		// Only written by the owning thread, but read by stats from any thread
+		// Can go negative, when this thread frees blocks allocated by another
+		std::array<std::atomic<int64_t>, numClasses> live {};
+
+		void addLive(size_t idx, int64_t n)
+		{
+			live[idx].store(live[idx].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+	};
+
+	// Null once the thread is exiting and its cache has been destroyed
+	ThreadCache* getThreadCache()
+	{
+		if (!currentCache && !currentCacheDestroyed) {
+			thread_local ThreadCache cache;
+		}
+		return currentCache;
+	}
+}
 
 SizePool::SizePool(size_t size)
-	: size(size)
+	: size(alignUp(std::max(size, sizeof(FreeBlock)), PoolPool::granularity))
+	, batchSize(std::max(size_t(4), batchBytes / this->size))
+	, pooled(this->size <= PoolPool::maxPooledSize)
+	, classIndex(this->size / PoolPool::granularity - 1)
 {
-	pimpl = new PoolType(size);
 }
 
 SizePool::~SizePool()
 {
-	delete reinterpret_cast<PoolType*>(pimpl);
+	for (auto* slab: slabs) {
+		::operator delete(slab, std::align_val_t(PoolPool::granularity));
+	}
 }
 
 void* SizePool::alloc()
 {
-	return reinterpret_cast<PoolType*>(pimpl)->malloc();
+	if (pooled) {
+		if (auto* cache = getThreadCache()) {
+			return cache->alloc(*this, classIndex);
+		}
+
+		// Called while this thread exits, after its cache is gone, so go straight to the shared list
+		size_t n = 1;
+		auto* block = takeBatch(n);
+		retireLiveBlocks(1);
+		return block;
+	}
+
+	// Too big to be worth pooling, but still counted
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++retiredLive;
+		++outstanding;
+		highWater = std::max(highWater, outstanding);
+	}
+	return ::operator new(size, std::align_val_t(PoolPool::granularity));
 }
 
 void SizePool::free(void* p)
 {
-	reinterpret_cast<PoolType*>(pimpl)->free(p);
+	if (pooled) {
+		if (auto* cache = getThreadCache()) {
+			cache->free(*this, classIndex, p);
+		} else {
+			static_cast<FreeBlock*>(p)->next = nullptr;
+			returnBatch(p, 1);
+			retireLiveBlocks(-1);
+		}
+		return;
+	}
+
+	::operator delete(p, std::align_val_t(PoolPool::granularity));
+	std::unique_lock<std::mutex> lock(mutex);
+	--retiredLive;
+	--outstanding;
+}
+
+MemoryPoolStats SizePool::getStats() const
+{
+	int64_t live = 0;
+	if (pooled) {
+		auto& registry = getRegistry();
+		std::unique_lock<std::mutex> lock(registry.mutex);
+		for (const auto* cache: registry.caches) {
+			live += cache->getLive(classIndex);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	live += retiredLive;
+
+	MemoryPoolStats result;
+	result.blockSize = size;
+	result.liveBytes = size_t(std::max(int64_t(0), live)) * size;
+	result.highWaterBytes = highWater * size;
+	result.reservedBytes = pooled ? slabs.size() * std::max(slabSize, size * batchSize) : outstanding * size;
+	return result;
+}
+
+void* SizePool::takeBatch(size_t& n)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!freeList) {
+		addSlab();
+	}
+
+	auto* head = static_cast<FreeBlock*>(freeList);
+	auto* tail = head;
+	size_t taken = 1;
+	while (taken < n && tail->next) {
+		tail = tail->next;
+		++taken;
+	}
+	freeList = tail->next;
+	tail->next = nullptr;
+
+	n = taken;
+	outstanding += taken;
+	highWater = std::max(highWater, outstanding);
+	return head;
+}
+
+void SizePool::returnBatch(void* head, size_t n)
+{
+	Expects(head != nullptr);
+	Expects(n > 0);
+
+	auto* tail = static_cast<FreeBlock*>(head);
+	while (tail->next) {
+		tail = tail->next;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	tail->next = static_cast<FreeBlock*>(freeList);
+	freeList = head;
+	outstanding -= n;
+}
+
+void SizePool::retireLiveBlocks(int64_t n)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	retiredLive += n;
+}
+
+void SizePool::addSlab()
+{
+	const size_t bytes = std::max(slabSize, size * batchSize);
+	auto* slab = static_cast<char*>(::operator new(bytes, std::align_val_t(PoolPool::granularity)));
+	slabs.push_back(slab);
+
+	// Link the blocks in address order, so the first ones handed out are next to each other
+	const size_t n = bytes / size;
+	for (size_t i = 0; i < n; ++i) {
+		auto* block = reinterpret_cast<FreeBlock*>(slab + i * size);
+		block->next = i + 1 < n ? reinterpret_cast<FreeBlock*>(slab + (i + 1) * size) : static_cast<FreeBlock*>(freeList);
+	}
+	freeList = slab;
+}
+
+SizePool* PoolPool::getPool(size_t size)
+{
+	auto& pools = getPools();
+	if (size <= maxPooledSize) {
+		return pools.classes[std::max(size_t(1), (size + granularity - 1) / granularity) - 1].get();
+	}
+
+	const size_t rounded = alignUp(size, granularity);
+	std::unique_lock<std::mutex> lock(pools.largeMutex);
+	auto& pool = pools.large[rounded];
+	if (!pool) {
+		pool = std::make_unique<SizePool>(rounded);
+	}
+	return pool.get();
+}
+
+Vector<MemoryPoolStats> PoolPool::getStats()
+{
+	Vector<MemoryPoolStats> result;
+	auto& pools = getPools();
+	for (const auto& pool: pools.classes) {
+		auto stats = pool->getStats();
+		if (stats.highWaterBytes > 0) {
+			result.push_back(stats);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(pools.largeMutex);
+	for (const auto& [size, pool]: pools.large) {
+		result.push_back(pool->getStats());
+	}
+	return result;
 }
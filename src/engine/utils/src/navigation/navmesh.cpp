@@ -230,6 +230,43 @@ std::vector<Navmesh::NodeAndConn> Navmesh::makeResult(const std::vector<State>&
 	return result;
 }
 
+Navmesh::Scratch::Scratch()
+	: openSet(NodeComparator(state))
+{
+}
+
+void Navmesh::Scratch::begin(size_t nNodes)
+{
+	if (state.size() < nNodes) {
+		state.resize(nNodes);
+	}
+	openSet.clear();
+
+	if (++generation == 0) {
+		// Wrapped around, so old stamps could be mistaken for current ones
+		for (auto& s: state) {
+			s.generation = 0;
+		}
+		generation = 1;
+	}
+}
+
+Navmesh::State& Navmesh::Scratch::get(NodeId id)
+{
+	auto& s = state[id];
+	if (s.generation != generation) {
+		s = State();
+		s.generation = generation;
+	}
+	return s;
+}
+
+Navmesh::Scratch& Navmesh::getScratch()
+{
+	static thread_local Scratch scratch;
+	return scratch;
+}
+
 std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int toId) const
 {
 	// Ensure the query is valid
@@ -238,13 +275,10 @@ std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, i
 		return {};
 	}
 
-	// State map. Using vector for perf, trading space for CPU.
-	// TODO: measure this vs unordered_map or some other hashtable, it's not impossible that it'd perform better (compact memory)
-	std::vector<State> state(nodes.size(), State{});
-
-	// Open set
-	auto openSet = PriorityQueue<NodeId, NodeComparator>(NodeComparator(state));
-	openSet.reserve(std::min(static_cast<size_t>(100), nodes.size()));
+	auto& scratch = getScratch();
+	scratch.begin(nodes.size());
+	auto& state = scratch.state;
+	auto& openSet = scratch.openSet;
 
 	// Define heuristic function
 	const Vector2f endPos = nodes[toId].pos;
@@ -256,7 +290,7 @@ std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, i
 
 	// Initialize the query
 	{
-		auto& firstNodeState = state[fromId];
+		auto& firstNodeState = scratch.get(NodeId(fromId));
 		firstNodeState.cameFrom = NodeAndConn();
 		firstNodeState.gScore = 0;
 		firstNodeState.fScore = h(nodes[fromId].pos);
@@ -281,8 +315,8 @@ std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, i
 		for (size_t i = 0; i < curNode.nConnections; ++i) {
 			if (curNode.connections[i]) {
 				const auto nodeId = curNode.connections[i].value();
-				if (!state[nodeId].inClosedSet) {
-					auto& neighState = state[nodeId];
+				auto& neighState = scratch.get(nodeId);
+				if (!neighState.inClosedSet) {
 					const float neighScore = gScore + curNode.costs[i];
 
 					if (neighScore < neighState.gScore) {
@@ -2,6 +2,7 @@
 
 #include "halley/data_structures/priority_queue.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/concurrent.h"
 using namespace Halley;
 
 NavmeshSet::NavmeshSet()
@@ -15,6 +16,44 @@ NavmeshSet::NavmeshSet(const ConfigNode& nodeData)
 	}
 }
 
+NavmeshSet::NavmeshSet(const NavmeshSet& other)
+	: navmeshes(other.navmeshes)
+	, portalNodes(other.portalNodes)
+	, regionNodes(other.regionNodes)
+{
+}
+
+NavmeshSet::NavmeshSet(NavmeshSet&& other) noexcept
+	: navmeshes(std::move(other.navmeshes))
+	, portalNodes(std::move(other.portalNodes))
+	, regionNodes(std::move(other.regionNodes))
+{
+	other.invalidateRegionCosts();
+}
+
+NavmeshSet& NavmeshSet::operator=(const NavmeshSet& other)
+{
+	if (this != &other) {
+		navmeshes = other.navmeshes;
+		portalNodes = other.portalNodes;
+		regionNodes = other.regionNodes;
+		invalidateRegionCosts();
+	}
+	return *this;
+}
+
+NavmeshSet& NavmeshSet::operator=(NavmeshSet&& other) noexcept
+{
+	if (this != &other) {
+		navmeshes = std::move(other.navmeshes);
+		portalNodes = std::move(other.portalNodes);
+		regionNodes = std::move(other.regionNodes);
+		invalidateRegionCosts();
+		other.invalidateRegionCosts();
+	}
+	return *this;
+}
+
 ConfigNode NavmeshSet::toConfigNode() const
 {
 	ConfigNode::MapType result;
@@ -25,6 +64,7 @@ ConfigNode NavmeshSet::toConfigNode() const
 void NavmeshSet::add(Navmesh navmesh)
 {
 	navmeshes.push_back(std::move(navmesh));
+	invalidateRegionCosts();
 }
 
 void NavmeshSet::addChunk(NavmeshSet navmeshSet, Vector2f origin, Vector2i gridPosition)
@@ -40,16 +80,19 @@ void NavmeshSet::addRaw(NavmeshSet navmeshSet)
 	for (auto& navmesh: navmeshSet.navmeshes) {
 		navmeshes.push_back(std::move(navmesh));
 	}
+	invalidateRegionCosts();
 }
 
 void NavmeshSet::clear()
 {
 	navmeshes.clear();
+	invalidateRegionCosts();
 }
 
 void NavmeshSet::clearSubWorld(int subWorld)
 {
 	navmeshes.erase(std::remove_if(navmeshes.begin(), navmeshes.end(), [&] (const Navmesh& nav) { return nav.getSubWorld() == subWorld; }), navmeshes.end());
+	invalidateRegionCosts();
 }
 
 std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& query) const
@@ -76,6 +119,16 @@ std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& query)
 	}
 }
 
+std::vector<std::optional<NavigationPath>> NavmeshSet::pathfind(gsl::span<const NavigationQuery> queries) const
+{
+	std::vector<std::optional<NavigationPath>> results(queries.size());
+	Concurrent::foreachChunked(ExecutionQueue::getDefault(), queries.data(), queries.data() + queries.size(), 8, [&] (const NavigationQuery& query)
+	{
+		results[&query - queries.data()] = pathfind(query);
+	});
+	return results;
+}
+
 std::optional<NavigationPath> NavmeshSet::pathfindInRegion(const NavigationQuery& query, uint16_t regionId) const
 {
 	return navmeshes[regionId].pathfind(query);
@@ -110,6 +163,7 @@ void NavmeshSet::linkNavmeshes()
 	regionNodes.clear();
 	regionNodes.resize(navmeshes.size());
 	portalNodes.clear();
+	invalidateRegionCosts();
 
 	for (auto& navmesh: navmeshes) {
 		navmesh.markPortalsDisconnected();
@@ -140,6 +194,13 @@ void NavmeshSet::linkNavmeshes()
 			}
 		}
 	}
+
+	// Reverse edges, used to compute the distances into each region
+	for (size_t curPortalId = 0; curPortalId < portalNodes.size(); ++curPortalId) {
+		for (const auto& conn: portalNodes[curPortalId].connections) {
+			portalNodes[conn.portalId].incoming.emplace_back(static_cast<uint16_t>(curPortalId), conn.regionId, conn.cost);
+		}
+	}
 }
 
 void NavmeshSet::reportUnlinkedPortals(std::function<String(Vector2i)> getChunkName) const
@@ -232,29 +293,40 @@ std::vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPo
 		return {};
 	}
 
-	// State map. Using vector for perf, trading space for CPU.
-	// TODO: measure this vs unordered_map or some other hashtable, it's not impossible that it'd perform better (compact memory)
-	std::vector<State> state(portalNodes.size(), State{});
+	const auto costs = getRegionCosts(toRegionId);
+	const auto& costToGo = costs->costToGo;
 
-	// Open set
-	auto openSet = PriorityQueue<NodeId, NodeComparator>(NodeComparator(state));
-	openSet.reserve(std::min(static_cast<size_t>(100), portalNodes.size()));
+	auto& scratch = getScratch();
+	scratch.begin(portalNodes.size());
+	auto& state = scratch.state;
+	auto& openSet = scratch.openSet;
+
+	// Every path ends by walking from a portal into the destination region to endPos, which is at least this far
+	float minFinalCost = std::numeric_limits<float>::infinity();
+	for (const auto portalId: regionNodes[toRegionId].portals) {
+		minFinalCost = std::min(minFinalCost, (portalNodes[portalId].pos - endPos).length());
+	}
 
 	// Define heuristic function
-	auto h = [&] (Vector2f pos) -> float
+	// Both terms are lower bounds on the remaining cost, and the precomputed one is usually very close to it
+	auto h = [&] (NodeId id) -> float
 	{
-		return (pos - endPos).length();
+		return std::max((portalNodes[id].pos - endPos).length(), costToGo[id] + minFinalCost);
 	};
 
 	// Initialize the query
 	{
 		const auto& startRegion = regionNodes[fromRegionId];
 		for (const auto portalId : startRegion.portals) {
-			auto& nodeState = state[portalId];
+			if (costToGo[portalId] == std::numeric_limits<float>::infinity()) {
+				// Can't reach the destination through here
+				continue;
+			}
+			auto& nodeState = scratch.get(portalId);
 			const auto pos = portalNodes[portalId].pos;
 			nodeState.cameFrom = std::numeric_limits<uint16_t>::max();
 			nodeState.gScore = (pos - startPos).length();
-			nodeState.fScore = h(pos);
+			nodeState.fScore = nodeState.gScore + h(portalId);
 			nodeState.inOpenSet = true;
 			openSet.push(portalId);
 		}
@@ -292,15 +364,19 @@ std::vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPo
 		const float gScore = state[curId].gScore;
 		for (size_t i = 0; i < curNode.connections.size(); ++i) {
 			const auto nodeId = curNode.connections[i].portalId;
-			if (!state[nodeId].inClosedSet) {
-				auto& neighState = state[nodeId];
+			if (costToGo[nodeId] == std::numeric_limits<float>::infinity()) {
+				continue;
+			}
+
+			auto& neighState = scratch.get(nodeId);
+			if (!neighState.inClosedSet) {
 				const float neighScore = gScore + curNode.connections[i].cost;
 
 				// This neighbour needs updating
 				if (neighScore < neighState.gScore) {
 					neighState.cameFrom = curId;
 					neighState.gScore = neighScore;
-					neighState.fScore = neighScore + h(portalNodes[nodeId].pos);
+					neighState.fScore = neighScore + h(nodeId);
 					if (!neighState.inOpenSet) {
 						neighState.inOpenSet = true;
 						openSet.push(nodeId);
@@ -315,6 +391,94 @@ std::vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPo
 	return {};
 }
 
+void NavmeshSet::invalidateRegionCosts()
+{
+	std::unique_lock<std::mutex> lock(regionCostsMutex);
+	regionCosts.clear();
+}
+
+std::shared_ptr<const NavmeshSet::RegionCosts> NavmeshSet::getRegionCosts(NodeId toRegionId) const
+{
+	std::unique_lock<std::mutex> lock(regionCostsMutex);
+	auto& result = regionCosts[toRegionId];
+	if (!result) {
+		result = std::make_shared<const RegionCosts>(RegionCosts{ computeCostsToRegion(portalNodes, toRegionId) });
+	}
+	return result;
+}
+
+std::vector<float> NavmeshSet::computeCostsToRegion(gsl::span<const PortalNode> portalNodes, uint16_t toRegionId)
+{
+	// Dijkstra over the reversed portal graph, starting from every portal that enters the destination region
+	std::vector<float> cost(portalNodes.size(), std::numeric_limits<float>::infinity());
+
+	// Entries carry the cost they were pushed with, so lowering a node's cost later doesn't disturb the heap
+	// Instead, the node is pushed again, and the stale entry is skipped when popped.
+	using Entry = std::pair<float, NodeId>;
+	auto openSet = PriorityQueue<Entry, std::greater<>>(std::greater<>());
+
+	for (size_t i = 0; i < portalNodes.size(); ++i) {
+		if (portalNodes[i].toRegion == toRegionId) {
+			cost[i] = 0;
+			openSet.push(Entry(0.0f, static_cast<NodeId>(i)));
+		}
+	}
+
+	while (!openSet.empty()) {
+		const auto [curCost, curId] = openSet.top();
+		openSet.pop();
+		if (curCost > cost[curId]) {
+			continue;
+		}
+
+		for (const auto& conn: portalNodes[curId].incoming) {
+			const float newCost = curCost + conn.cost;
+			if (newCost < cost[conn.portalId]) {
+				cost[conn.portalId] = newCost;
+				openSet.push(Entry(newCost, conn.portalId));
+			}
+		}
+	}
+
+	return cost;
+}
+
+NavmeshSet::Scratch::Scratch()
+	: openSet(NodeComparator(state))
+{
+}
+
+void NavmeshSet::Scratch::begin(size_t nNodes)
+{
+	if (state.size() < nNodes) {
+		state.resize(nNodes);
+	}
+	openSet.clear();
+
+	if (++generation == 0) {
+		for (auto& s: state) {
+			s.generation = 0;
+		}
+		generation = 1;
+	}
+}
+
+NavmeshSet::State& NavmeshSet::Scratch::get(NodeId id)
+{
+	auto& s = state[id];
+	if (s.generation != generation) {
+		s = State();
+		s.generation = generation;
+	}
+	return s;
+}
+
+NavmeshSet::Scratch& NavmeshSet::getScratch()
+{
+	static thread_local Scratch scratch;
+	return scratch;
+}
+
 std::pair<uint16_t, uint16_t> NavmeshSet::getPortalDestination(uint16_t region, uint16_t edge) const
 {
 	constexpr auto maxVal = std::numeric_limits<uint16_t>::max();
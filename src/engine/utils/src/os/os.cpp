@@ -122,6 +122,11 @@ std::vector<Path> OS::enumerateDirectory(const Path& path)
 	return {};
 }
 
+std::unique_ptr<MemoryMappedFile> OS::mapFile(const Path& path)
+{
+	return {};
+}
+
 void OS::setConsoleColor(int, int)
 {
 }
@@ -33,6 +33,8 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 using namespace Halley;
 
@@ -170,4 +172,87 @@ std::vector<Path> Halley::OSUnix::enumerateDirectory(const Path& path)
 	return result;
 }
 
+namespace {
+	class UnixMemoryMappedFile final : public MemoryMappedFile {
+	public:
+		UnixMemoryMappedFile(void* data, size_t size)
+			: data(data)
+			, size(size)
+		{}
+
+		~UnixMemoryMappedFile()
+		{
+			if (size > 0) {
+				munmap(data, size);
+			}
+		}
+
+		gsl::span<const gsl::byte> getData() const override
+		{
+			return gsl::span<const gsl::byte>(static_cast<const gsl::byte*>(data), size);
+		}
+
+		void advise(size_t pos, size_t len, MemoryAccessHint hint) override
+		{
+			if (pos >= size || len == 0) {
+				return;
+			}
+
+			// madvise wants a page-aligned start
+			static const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+			const size_t start = pos - pos % pageSize;
+			const size_t end = std::min(pos + len, size);
+			madvise(static_cast<char*>(data) + start, end - start, getAdvice(hint));
+		}
+
+	private:
+		void* data;
+		size_t size;
+
+		static int getAdvice(MemoryAccessHint hint)
+		{
+			switch (hint) {
+			case MemoryAccessHint::Sequential:
+				return MADV_SEQUENTIAL;
+			case MemoryAccessHint::Random:
+				return MADV_RANDOM;
+			case MemoryAccessHint::WillNeed:
+				return MADV_WILLNEED;
+			case MemoryAccessHint::DontNeed:
+				return MADV_DONTNEED;
+			default:
+				return MADV_NORMAL;
+			}
+		}
+	};
+}
+
+std::unique_ptr<MemoryMappedFile> Halley::OSUnix::mapFile(const Path& path)
+{
+	const int fd = open(path.string().c_str(), O_RDONLY);
+	if (fd < 0) {
+		return {};
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return {};
+	}
+
+	const size_t size = size_t(st.st_size);
+	void* data = nullptr;
+	if (size > 0) {
+		data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+
+	// The mapping keeps its own reference to the file
+	close(fd);
+	if (data == MAP_FAILED) {
+		return {};
+	}
+
+	return std::make_unique<UnixMemoryMappedFile>(data, size);
+}
+
 #endif
@@ -37,6 +37,7 @@ namespace Halley {
 		virtual String getUserDataDir() override;
 		void createDirectories(const Path& path) override;
 		std::vector<Path> enumerateDirectory(const Path& path) override;
+		std::unique_ptr<MemoryMappedFile> mapFile(const Path& path) override;
 
 		int runCommand(String command, String cwd, ILoggerSink* sink) override;
 	};
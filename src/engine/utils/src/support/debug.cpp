@@ -206,8 +206,16 @@ String Debug::getCallStack(int skip)
 #undef min
 #endif
 
+namespace {
+	thread_local bool traceEnabled = true;
+}
+
 void Debug::trace(const char* filename, int line, const char* arg)
 {
+	if (!traceEnabled) {
+		return;
+	}
+
 	auto& trace = lastTraces[tracePos];
 	tracePos = (tracePos + 1) % int(lastTraces.size());
 	trace.filename = filename;
@@ -222,6 +230,11 @@ void Debug::trace(const char* filename, int line, const char* arg)
 	}
 }
 
+void Debug::setTraceEnabledOnThisThread(bool enabled)
+{
+	traceEnabled = enabled;
+}
+
 String Debug::getLastTraces()
 {
 	String result;
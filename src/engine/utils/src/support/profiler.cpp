@@ -0,0 +1,253 @@
+#include "halley/support/profiler.h"
+#include "halley/text/string_converter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+
+using namespace Halley;
+
+std::atomic<bool> Profiler::enabled { false };
+
+namespace {
+	// Only the owning thread writes to it; captures read it from other threads, and discard whatever was overwritten meanwhile
+	class ThreadBuffer {
+	public:
+		constexpr static size_t capacity = Profiler::eventsPerThread;
+		static_assert((capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+
+		ThreadBuffer(uint32_t id)
+			: id(id)
+			, name("Thread " + toString(id))
+		{}
+
+		void add(const ProfilerCapture::Event& event)
+		{
+			if (!events) {
+				// Allocated on first use, as most threads are only named, and never record anything
+				events = std::make_unique<ProfilerCapture::Event[]>(capacity);
+				eventsReady.store(true, std::memory_order_release);
+			}
+
+			// The fence makes a reader that sees any of this event also see a count of at least n, so it knows the old one is gone
+			const auto n = written.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			events[n & (capacity - 1)] = event;
+			written.store(n + 1, std::memory_order_release);
+		}
+
+		void read(int64_t start, int64_t end, Vector<ProfilerCapture::Event>& dst) const
+		{
+			if (!eventsReady.load(std::memory_order_acquire)) {
+				return;
+			}
+
+			const auto last = written.load(std::memory_order_acquire);
+			const auto first = last > capacity ? last - capacity : 0;
+			Vector<uint64_t> indices;
+			for (auto i = first; i < last; ++i) {
+				const auto& event = events[i & (capacity - 1)];
+				if (event.end > start && event.start < end) {
+					dst.push_back(event);
+					indices.push_back(i);
+				}
+			}
+
+			// Anything written since the copy started might have replaced some of the oldest events, which are at the front
+			// The event at lastAfter may be half written, and it shares its slot with the one at lastAfter - capacity
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const auto lastAfter = written.load(std::memory_order_relaxed);
+			const auto firstValid = lastAfter + 1 > capacity ? lastAfter + 1 - capacity : 0;
+			const auto nLost = std::lower_bound(indices.begin(), indices.end(), firstValid) - indices.begin();
+			dst.erase(dst.begin(), dst.begin() + nLost);
+
+			// Events are written when they end, so nested events come before their parents
+			std::stable_sort(dst.begin(), dst.end(), [] (const auto& a, const auto& b) { return a.start < b.start; });
+		}
+
+		const uint32_t id;
+		String name;
+
+	private:
+		std::atomic<uint64_t> written { 0 };
+		std::atomic<bool> eventsReady { false };
+		std::unique_ptr<ProfilerCapture::Event[]> events;
+	};
+
+	struct ProfilerState {
+		std::mutex mutex;
+		Vector<std::shared_ptr<ThreadBuffer>> threads;
+		std::set<String> internedNames;
+		std::deque<int64_t> frameStarts;
+		uint64_t frameNumber = 0;
+	};
+
+	ProfilerState& getState()
+	{
+		static ProfilerState state;
+		return state;
+	}
+
+	ThreadBuffer& getThreadBuffer()
+	{
+		// The state keeps the buffers alive after their threads exit, so their events can still be captured
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer) {
+			auto& state = getState();
+			std::unique_lock<std::mutex> lock(state.mutex);
+			state.threads.push_back(std::make_shared<ThreadBuffer>(static_cast<uint32_t>(state.threads.size())));
+			buffer = state.threads.back().get();
+		}
+		return *buffer;
+	}
+
+	void appendEscaped(std::string& dst, const char* str)
+	{
+		for (const char* c = str; *c; ++c) {
+			if (*c == '"' || *c == '\\') {
+				dst += '\\';
+				dst += *c;
+			} else if (static_cast<unsigned char>(*c) < 0x20) {
+				dst += ' ';
+			} else {
+				dst += *c;
+			}
+		}
+	}
+
+	void appendMicroseconds(std::string& dst, int64_t ns)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.3f", double(ns) / 1000.0);
+		dst += buffer;
+	}
+}
+
+void Profiler::setEnabled(bool value)
+{
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const String& name)
+{
+	auto& buffer = getThreadBuffer();
+	std::unique_lock<std::mutex> lock(getState().mutex);
+	buffer.name = name;
+}
+
+const char* Profiler::intern(const String& name)
+{
+	auto& state = getState();
+	std::unique_lock<std::mutex> lock(state.mutex);
+	return state.internedNames.insert(name).first->c_str();
+}
+
+int64_t Profiler::getTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::addEvent(const char* name, int64_t start, int64_t end)
+{
+	getThreadBuffer().add(ProfilerCapture::Event{ name, start, end });
+}
+
+void Profiler::onFrameStart()
+{
+	const auto time = getTime();
+
+	auto& state = getState();
+	std::unique_lock<std::mutex> lock(state.mutex);
+	state.frameStarts.push_back(time);
+	if (state.frameStarts.size() > framesKept) {
+		state.frameStarts.pop_front();
+	}
+	++state.frameNumber;
+}
+
+uint64_t Profiler::getFrameNumber()
+{
+	auto& state = getState();
+	std::unique_lock<std::mutex> lock(state.mutex);
+	return state.frameNumber;
+}
+
+ProfilerCapture Profiler::capture(size_t nFrames)
+{
+	auto& state = getState();
+	std::unique_lock<std::mutex> lock(state.mutex);
+
+	ProfilerCapture result;
+	const size_t nStarts = state.frameStarts.size();
+	nFrames = std::min(nFrames, nStarts > 0 ? nStarts - 1 : 0);
+	if (nFrames == 0) {
+		return result;
+	}
+
+	result.frameStarts.assign(state.frameStarts.end() - nFrames - 1, state.frameStarts.end());
+	result.start = result.frameStarts.front();
+	result.end = result.frameStarts.back();
+
+	for (const auto& thread: state.threads) {
+		auto& dst = result.threads.emplace_back();
+		dst.name = thread->name;
+		dst.id = thread->id;
+		thread->read(result.start, result.end, dst.events);
+	}
+
+	return result;
+}
+
+bool ProfilerCapture::empty() const
+{
+	return frameStarts.empty();
+}
+
+String ProfilerCapture::toChromeTrace() const
+{
+	std::string result;
+	result.reserve(1024);
+	result += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	auto startEntry = [&] ()
+	{
+		if (!first) {
+			result += ",\n";
+		}
+		first = false;
+	};
+
+	for (const auto& thread: threads) {
+		startEntry();
+		result += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread.id) + ",\"args\":{\"name\":\"";
+		appendEscaped(result, thread.name.c_str());
+		result += "\"}}";
+	}
+
+	for (size_t i = 0; i + 1 < frameStarts.size(); ++i) {
+		startEntry();
+		result += "{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":";
+		appendMicroseconds(result, frameStarts[i] - start);
+		result += "}";
+	}
+
+	for (const auto& thread: threads) {
+		const auto tid = std::to_string(thread.id);
+		for (const auto& event: thread.events) {
+			startEntry();
+			result += "{\"name\":\"";
+			appendEscaped(result, event.name);
+			result += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"ts\":";
+			appendMicroseconds(result, event.start - start);
+			result += ",\"dur\":";
+			appendMicroseconds(result, event.end - event.start);
+			result += "}";
+		}
+	}
+
+	result += "]}\n";
+	return String(std::move(result));
+}
@@ -0,0 +1,131 @@
+#include "halley/text/string_id.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include "halley/support/exception.h"
+
+using namespace Halley;
+
+namespace {
+	// Entries are never removed or moved, so their text can be referenced forever
+	// Lookups walk a bucket's list without locking; new entries are pushed to the front of the list with a CAS.
+	class InternTable {
+	public:
+		const char* intern(std::string_view str, uint64_t hash)
+		{
+			auto& bucket = buckets[hash & (numBuckets - 1)];
+			Entry* head = bucket.load(std::memory_order_acquire);
+			if (auto* found = find(head, nullptr, str, hash)) {
+				return found->str;
+			}
+
+			auto* entry = makeEntry(str, hash);
+			while (true) {
+				entry->next = head;
+				if (bucket.compare_exchange_weak(head, entry, std::memory_order_release, std::memory_order_acquire)) {
+					count.fetch_add(1, std::memory_order_relaxed);
+					return entry->str;
+				}
+
+				// Someone else got in first; they might have added this same string
+				if (auto* found = find(head, entry->next, str, hash)) {
+					freeEntry(entry);
+					return found->str;
+				}
+			}
+		}
+
+		size_t size() const
+		{
+			return count.load(std::memory_order_relaxed);
+		}
+
+	private:
+		constexpr static size_t numBuckets = 4096;
+
+		struct Entry {
+			Entry* next;
+			uint64_t hash;
+			char str[1];
+		};
+
+		std::array<std::atomic<Entry*>, numBuckets> buckets {};
+		std::atomic<size_t> count { 0 };
+
+		// Looks through [head, end)
+		static Entry* find(Entry* head, Entry* end, std::string_view str, uint64_t hash)
+		{
+			for (auto* e = head; e != end; e = e->next) {
+				if (e->hash == hash) {
+					if (std::string_view(e->str) != str) {
+						throw Exception("StringId collision between \"" + String(e->str) + "\" and \"" + String(str) + "\"", HalleyExceptions::Utils);
+					}
+					return e;
+				}
+			}
+			return nullptr;
+		}
+
+		static Entry* makeEntry(std::string_view str, uint64_t hash)
+		{
+			auto* entry = static_cast<Entry*>(::operator new(offsetof(Entry, str) + str.size() + 1));
+			entry->next = nullptr;
+			entry->hash = hash;
+			memcpy(entry->str, str.data(), str.size());
+			entry->str[str.size()] = 0;
+			return entry;
+		}
+
+		static void freeEntry(Entry* entry)
+		{
+			::operator delete(entry);
+		}
+	};
+
+	InternTable& getInternTable()
+	{
+		// Leaked on purpose, as ids can still be used while the program exits
+		static InternTable* table = new InternTable();
+		return *table;
+	}
+}
+
+StringId::StringId(const String& str)
+	: StringId(std::string_view(str.c_str(), str.length()), hash(str.c_str(), str.length()))
+{
+}
+
+StringId::StringId(const std::string& str)
+	: StringId(std::string_view(str), hash(str.data(), str.size()))
+{
+}
+
+StringId::StringId(std::string_view str, uint64_t value)
+	: value(value)
+	, str(intern(str, value))
+	, len(str.size())
+{
+}
+
+const char* StringId::intern(std::string_view str, uint64_t value)
+{
+	return getInternTable().intern(str, value);
+}
+
+void StringId::checkCollision(const StringId& a, const StringId& b)
+{
+	// Interning both throws if their text differs
+	intern(std::string_view(a.str, a.len), a.value);
+	intern(std::string_view(b.str, b.len), b.value);
+}
+
+String StringId::getString() const
+{
+	return String(std::string_view(str, len));
+}
+
+size_t StringId::getNumInterned()
+{
+	return getInternTable().size();
+}
@@ -0,0 +1,290 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/entity/archetype.h>
+using namespace Halley;
+
+namespace {
+	int liveNames = 0;
+	int namesMoved = 0;
+
+	class NameTestComponent : public Component {
+	public:
+		static constexpr int componentIndex = 240;
+
+		String name;
+
+		NameTestComponent() { ++liveNames; }
+		NameTestComponent(String name) : name(std::move(name)) { ++liveNames; }
+		NameTestComponent(const NameTestComponent& other) : name(other.name) { ++liveNames; }
+		NameTestComponent(NameTestComponent&& other) noexcept : name(std::move(other.name)) { ++liveNames; ++namesMoved; }
+		~NameTestComponent() { --liveNames; }
+	};
+
+	class alignas(64) AlignedTestComponent : public Component {
+	public:
+		static constexpr int componentIndex = 241;
+
+		int value = 0;
+
+		AlignedTestComponent() = default;
+		AlignedTestComponent(int value) : value(value) {}
+	};
+
+	class TagTestComponent : public Component {
+	public:
+		static constexpr int componentIndex = 242;
+
+		char tag = 0;
+
+		TagTestComponent() = default;
+		TagTestComponent(char tag) : tag(tag) {}
+	};
+
+	class TestFamily : public FamilyBaseOf<TestFamily> {
+	public:
+		NameTestComponent& nameTest;
+		const AlignedTestComponent& alignedTest;
+
+		using Type = FamilyType<NameTestComponent, AlignedTestComponent>;
+
+	protected:
+		TestFamily(NameTestComponent& nameTest, const AlignedTestComponent& alignedTest)
+			: nameTest(nameTest)
+			, alignedTest(alignedTest)
+		{}
+	};
+
+	class TestCoreAPI final : public CoreAPI {
+	public:
+		void quit(int exitCode) override {}
+		void setStage(StageID stage) override {}
+		void setStage(std::unique_ptr<Stage> stage) override {}
+		void initStage(Stage& stage) override {}
+		Stage& getCurrentStage() override { throw Exception("No stage", HalleyExceptions::Core); }
+		HalleyStatics& getStatics() override { throw Exception("No statics", HalleyExceptions::Core); }
+		const Environment& getEnvironment() override { throw Exception("No environment", HalleyExceptions::Core); }
+		int64_t getTime(CoreAPITimer timer, TimeLine tl, StopwatchRollingAveraging::Mode mode) const override { return 0; }
+		void setTimerPaused(CoreAPITimer timer, TimeLine tl, bool paused) override {}
+		bool isDevMode() override { return false; }
+	};
+
+	struct TestWorld {
+		TestCoreAPI core;
+		HalleyAPI api;
+		std::unique_ptr<Resources> resources;
+		std::unique_ptr<World> world;
+
+		TestWorld()
+		{
+			api.core = &core;
+			resources = std::make_unique<Resources>(std::unique_ptr<ResourceLocator>(), api, Resources::Options());
+			world = std::make_unique<World>(api, *resources, false, CreateComponentFunction());
+			world->setArchetypeStorageEnabled(true);
+		}
+
+		~TestWorld()
+		{
+			world.reset();
+		}
+	};
+
+	bool isAligned(const void* p, size_t alignment)
+	{
+		return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+	}
+
+	EntityId makeId(size_t i)
+	{
+		EntityId result;
+		result.value = int64_t(i);
+		return result;
+	}
+}
+
+TEST(HalleyArchetype, TypeDeleterHooks)
+{
+	ComponentDeleterTable table;
+	TypeDeleter<NameTestComponent>::initialize(table);
+	TypeDeleter<AlignedTestComponent>::initialize(table);
+
+	auto* aligned = table.get(AlignedTestComponent::componentIndex);
+	EXPECT_EQ(64u, aligned->getAlignment());
+	EXPECT_EQ(sizeof(AlignedTestComponent), aligned->getSize());
+
+	auto* deleter = table.get(NameTestComponent::componentIndex);
+	EXPECT_EQ(alignof(NameTestComponent), deleter->getAlignment());
+
+	liveNames = 0;
+	namesMoved = 0;
+	{
+		NameTestComponent src("moved");
+		alignas(NameTestComponent) char dst[sizeof(NameTestComponent)];
+		deleter->callMoveConstructor(dst, &src);
+		EXPECT_EQ(1, namesMoved);
+		EXPECT_EQ(2, liveNames);
+		EXPECT_EQ(String("moved"), reinterpret_cast<NameTestComponent*>(dst)->name);
+		deleter->callDestructor(dst);
+	}
+	EXPECT_EQ(0, liveNames);
+}
+
+TEST(HalleyArchetype, SlotLayout)
+{
+	ComponentDeleterTable table;
+	TypeDeleter<NameTestComponent>::initialize(table);
+	TypeDeleter<AlignedTestComponent>::initialize(table);
+
+	ArchetypeStorage archetypes;
+	auto& archetype = archetypes.getArchetype(FamilyMaskType(), { AlignedTestComponent::componentIndex, NameTestComponent::componentIndex }, table);
+	EXPECT_EQ(&archetype, &archetypes.getArchetype(FamilyMaskType(), {}, table));
+	EXPECT_EQ(2u, archetype.getNumComponents());
+	EXPECT_EQ(nullptr, archetype.getComponent(TagTestComponent::componentIndex, 0));
+
+	// Slots span several chunks, never overlap, and keep each component aligned
+	Vector<size_t> slots;
+	for (size_t i = 0; i < Archetype::chunkCapacity * 2 + 1; ++i) {
+		slots.push_back(archetype.allocSlot(makeId(i)));
+	}
+	EXPECT_EQ(3u, archetype.getNumChunks());
+	for (const auto slot: slots) {
+		EXPECT_TRUE(isAligned(archetype.getComponent(AlignedTestComponent::componentIndex, slot), 64));
+		EXPECT_TRUE(isAligned(archetype.getComponent(NameTestComponent::componentIndex, slot), alignof(NameTestComponent)));
+	}
+	EXPECT_EQ(static_cast<char*>(archetype.getComponent(NameTestComponent::componentIndex, 0)) + sizeof(NameTestComponent), archetype.getComponent(NameTestComponent::componentIndex, 1));
+
+	// Live slots are visited in runs that never cross a chunk
+	archetype.freeSlot(slots[10]);
+	archetype.freeSlot(slots[3]);
+	Vector<std::pair<size_t, size_t>> ranges;
+	archetype.forEachRange([&] (size_t first, size_t count) { ranges.emplace_back(first, count); });
+	const auto cap = Archetype::chunkCapacity;
+	EXPECT_EQ((Vector<std::pair<size_t, size_t>>{ { 0, 3 }, { 4, 6 }, { 11, cap - 11 }, { cap, cap }, { cap * 2, 1 } }), ranges);
+	EXPECT_EQ(makeId(4), archetype.getEntityIds(4, 6)[0]);
+
+	// Freed slots are reused lowest first
+	EXPECT_EQ(slots[3], archetype.allocSlot(makeId(3)));
+	EXPECT_EQ(slots[10], archetype.allocSlot(makeId(10)));
+	for (const auto slot: slots) {
+		archetype.freeSlot(slot);
+	}
+	EXPECT_EQ(0u, archetype.getLiveCount());
+}
+
+TEST(HalleyArchetype, RelocatesOnMaskChange)
+{
+	liveNames = 0;
+	{
+		TestWorld test;
+		auto& world = *test.world;
+		auto& family = world.getFamily<TestFamily>();
+
+		Vector<EntityId> ids;
+		for (int i = 0; i < 100; ++i) {
+			auto e = world.createEntity();
+			e.addComponent(NameTestComponent("entity" + toString(i)));
+			e.addComponent(AlignedTestComponent(i));
+			ids.push_back(e.getEntityId());
+		}
+		world.spawnPending();
+		ASSERT_EQ(100u, family.count());
+
+		auto checkFamily = [&] ()
+		{
+			for (size_t i = 0; i < family.count(); ++i) {
+				auto& elem = *static_cast<TestFamily*>(family.getElement(i));
+				auto e = world.getEntity(elem.entityId);
+				EXPECT_EQ(&e.getComponent<NameTestComponent>(), &elem.nameTest);
+				EXPECT_EQ(&e.getComponent<AlignedTestComponent>(), &elem.alignedTest);
+				EXPECT_EQ("entity" + toString(elem.alignedTest.value), elem.nameTest.name);
+				EXPECT_TRUE(isAligned(&elem.alignedTest, 64));
+			}
+		};
+		checkFamily();
+
+		// Components of entities with the same mask are next to each other
+		auto first = world.getEntity(ids[0]);
+		auto second = world.getEntity(ids[1]);
+		EXPECT_EQ(reinterpret_cast<char*>(&first.getComponent<AlignedTestComponent>()) + sizeof(AlignedTestComponent), reinterpret_cast<char*>(&second.getComponent<AlignedTestComponent>()));
+
+		// Adding a component moves the entity to another archetype, without leaving the family
+		const auto* oldName = &first.getComponent<NameTestComponent>();
+		first.addComponent(TagTestComponent('x'));
+		world.spawnPending();
+		EXPECT_NE(oldName, &first.getComponent<NameTestComponent>());
+		EXPECT_EQ('x', first.getComponent<TagTestComponent>().tag);
+		EXPECT_EQ(100u, family.count());
+		checkFamily();
+
+		// Removing one moves it out of the family
+		second.removeComponent<AlignedTestComponent>();
+		world.spawnPending();
+		EXPECT_EQ(String("entity1"), second.getComponent<NameTestComponent>().name);
+		EXPECT_EQ(nullptr, second.tryGetComponent<AlignedTestComponent>());
+		EXPECT_EQ(99u, family.count());
+		checkFamily();
+
+		EXPECT_EQ(100, liveNames);
+		world.destroyEntity(ids[5]);
+		world.spawnPending();
+		EXPECT_EQ(99, liveNames);
+	}
+	EXPECT_EQ(0, liveNames);
+}
+
+TEST(HalleyArchetype, FamilyChunks)
+{
+	TestWorld test;
+	auto& world = *test.world;
+	auto& family = world.getFamily<TestFamily>();
+
+	Vector<EntityId> ids;
+	for (int i = 0; i < 200; ++i) {
+		auto e = world.createEntity();
+		e.addComponent(NameTestComponent("entity" + toString(i)));
+		e.addComponent(AlignedTestComponent(i));
+		if (i % 4 == 0) {
+			e.addComponent(TagTestComponent('t'));
+		}
+		ids.push_back(e.getEntityId());
+	}
+	world.spawnPending();
+	for (int i = 0; i < 200; i += 7) {
+		world.destroyEntity(ids[i]);
+	}
+	world.spawnPending();
+
+	// Every member is visited once, through arrays that point at the same components as the entity does
+	Vector<EntityId> visited;
+	size_t tagged = 0;
+	family.forEachChunk([&] (const FamilyChunk& chunk)
+	{
+		EXPECT_LE(chunk.size(), Archetype::chunkCapacity);
+		const auto entityIds = chunk.getEntityIds();
+		const auto names = chunk.get<NameTestComponent>();
+		const auto aligned = chunk.get<AlignedTestComponent>();
+		const auto tags = chunk.tryGet<TagTestComponent>();
+		EXPECT_TRUE(tags.empty() || tags.size() == chunk.size());
+
+		for (size_t i = 0; i < chunk.size(); ++i) {
+			auto e = world.getEntity(entityIds[i]);
+			EXPECT_EQ(&e.getComponent<NameTestComponent>(), &names[i]);
+			EXPECT_EQ(&e.getComponent<AlignedTestComponent>(), &aligned[i]);
+			EXPECT_EQ("entity" + toString(aligned[i].value), names[i].name);
+			if (!tags.empty()) {
+				EXPECT_EQ('t', tags[i].tag);
+				++tagged;
+			}
+			visited.push_back(entityIds[i]);
+		}
+	});
+
+	Vector<EntityId> members;
+	for (size_t i = 0; i < family.count(); ++i) {
+		members.push_back(static_cast<TestFamily*>(family.getElement(i))->entityId);
+	}
+	std::sort(visited.begin(), visited.end());
+	std::sort(members.begin(), members.end());
+	EXPECT_EQ(members, visited);
+	EXPECT_EQ(200u - 29u, visited.size());
+	EXPECT_EQ(50u - 8u, tagged);
+}
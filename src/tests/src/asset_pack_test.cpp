@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/core/resources/asset_pack.h>
+#include <halley/file/memory_mapped_file.h>
+#include <cstdio>
+using namespace Halley;
+
+namespace {
+	Bytes makePack(const Vector<String>& contents, bool compress = false)
+	{
+		AssetPack pack;
+		auto& data = pack.getData();
+		for (size_t i = 0; i < contents.size(); ++i) {
+			const auto raw = gsl::as_bytes(gsl::span<const char>(contents[i].c_str(), contents[i].size()));
+			const auto stored = compress ? BlockCompression::compress(raw, 16) : Bytes(contents[i].c_str(), contents[i].c_str() + contents[i].size());
+
+			AssetDatabase::Entry entry;
+			entry.path = AssetPack::makeEntryPath(data.size(), stored.size(), compress ? AssetPackCompression::LZ : AssetPackCompression::None, raw.size());
+			pack.getAssetDatabase().addAsset("asset" + toString(i), AssetType::BinaryFile, std::move(entry));
+			data.insert(data.end(), stored.begin(), stored.end());
+		}
+		return pack.writeOut();
+	}
+
+	String readAll(ResourceDataReader& reader)
+	{
+		Bytes result(reader.size());
+		reader.read(gsl::as_writable_bytes(gsl::span<Byte>(result)));
+		return String(reinterpret_cast<const char*>(result.data()), result.size());
+	}
+}
+
+TEST(HalleyAssetPack, MemoryMapped)
+{
+	const auto os = std::unique_ptr<OS>(OS::createOS());
+	OS::setInstance(os.get());
+	const Vector<String> contents = { "hello", "", "memory mapped asset pack" };
+	const auto path = Path("asset_pack_test.dat");
+	Path::writeFile(path, makePack(contents));
+
+	auto file = OS::get().mapFile(path);
+	if (!file) {
+		std::remove(path.string().c_str());
+		OS::setInstance(nullptr);
+		GTEST_SKIP() << "Memory mapping not supported";
+	}
+
+	{
+		AssetPack pack(std::move(file));
+		pack.setMemoryBudget(8);
+		EXPECT_EQ(AssetPackMode::MemoryMapped, pack.getMode());
+
+		for (size_t i = 0; i < contents.size(); ++i) {
+			const auto name = "asset" + toString(i);
+			auto staticData = pack.getData(name, AssetType::BinaryFile, false);
+			EXPECT_EQ(contents[i], dynamic_cast<ResourceDataStatic&>(*staticData).getString());
+
+			auto streamData = pack.getData(name, AssetType::BinaryFile, true);
+			EXPECT_EQ(contents[i], readAll(*dynamic_cast<ResourceDataStream&>(*streamData).getReader()));
+		}
+
+		const auto stats = pack.getStats();
+		EXPECT_EQ(3u, stats.staticLoads);
+		EXPECT_EQ(3u, stats.streamLoads);
+		EXPECT_EQ(29u, stats.bytesViewed);
+		EXPECT_EQ(29u, stats.bytesCopied);
+		EXPECT_LE(stats.budgetedBytes, size_t(24));
+		EXPECT_GT(stats.releases, 0u);
+	}
+
+	std::remove(path.string().c_str());
+	OS::setInstance(nullptr);
+}
+
+TEST(HalleyAssetPack, MemoryMappedViewOutlivesPack)
+{
+	const auto os = std::unique_ptr<OS>(OS::createOS());
+	OS::setInstance(os.get());
+	const Vector<String> contents = { "still mapped after the pack is gone" };
+	const auto path = Path("asset_pack_view_test.dat");
+	Path::writeFile(path, makePack(contents));
+
+	auto file = OS::get().mapFile(path);
+	if (!file) {
+		std::remove(path.string().c_str());
+		OS::setInstance(nullptr);
+		GTEST_SKIP() << "Memory mapping not supported";
+	}
+
+	std::unique_ptr<ResourceData> data;
+	{
+		AssetPack pack(std::move(file));
+		data = pack.getData("asset0", AssetType::BinaryFile, false);
+	}
+	EXPECT_EQ(contents[0], dynamic_cast<ResourceDataStatic&>(*data).getString());
+
+	data.reset();
+	std::remove(path.string().c_str());
+	OS::setInstance(nullptr);
+}
+
+TEST(HalleyAssetPack, Compressed)
+{
+	const auto os = std::unique_ptr<OS>(OS::createOS());
+	OS::setInstance(os.get());
+	const Vector<String> contents = { "hello", "", "compressed asset, compressed asset, compressed asset, spanning several blocks" };
+	const auto path = Path("asset_pack_compressed_test.dat");
+	Path::writeFile(path, makePack(contents, true));
+
+	auto file = OS::get().mapFile(path);
+	if (!file) {
+		std::remove(path.string().c_str());
+		OS::setInstance(nullptr);
+		GTEST_SKIP() << "Memory mapping not supported";
+	}
+
+	{
+		AssetPack pack(std::move(file));
+		for (size_t i = 0; i < contents.size(); ++i) {
+			const auto name = "asset" + toString(i);
+			auto staticData = pack.getData(name, AssetType::BinaryFile, false);
+			EXPECT_EQ(contents[i], dynamic_cast<ResourceDataStatic&>(*staticData).getString());
+
+			auto streamData = pack.getData(name, AssetType::BinaryFile, true);
+			auto reader = dynamic_cast<ResourceDataStream&>(*streamData).getReader();
+			EXPECT_EQ(contents[i], readAll(*reader));
+
+			// Seeking back into an earlier block
+			if (contents[i].size() > 20) {
+				reader->seek(3, SEEK_SET);
+				std::array<char, 20> buffer;
+				EXPECT_EQ(20, reader->read(gsl::as_writable_bytes(gsl::span<char>(buffer))));
+				EXPECT_EQ(contents[i].substr(3, 20), String(buffer.data(), buffer.size()));
+			}
+		}
+
+		EXPECT_EQ(0u, pack.getStats().bytesViewed);
+		EXPECT_GT(pack.getStats().bytesDecompressed, 0u);
+	}
+
+	std::remove(path.string().c_str());
+	OS::setInstance(nullptr);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include "audio_mixer.h"
+#include "audio_mixer_sse.h"
+#include "audio_mixer_avx.h"
+using namespace Halley;
+
+namespace {
+	struct MixerEntry {
+		const char* name;
+		std::unique_ptr<AudioMixer> mixer;
+	};
+
+	Vector<MixerEntry> getMixers()
+	{
+		Vector<MixerEntry> result;
+		result.push_back({ "Scalar", std::make_unique<AudioMixer>() });
+
+		[[maybe_unused]] const auto features = AudioMixer::getCPUFeatures();
+#ifdef HAS_SSE
+		if (features.sse) {
+			result.push_back({ "SSE", std::make_unique<AudioMixerSSE>() });
+		}
+#endif
+#ifdef HAS_AVX
+		if (features.avx) {
+			result.push_back({ "AVX", std::make_unique<AudioMixerAVX>() });
+		}
+		if (features.avx512) {
+			result.push_back({ "AVX-512", std::make_unique<AudioMixerAVX512>() });
+		}
+#endif
+		return result;
+	}
+
+	AudioBuffer makeRandomBuffer(size_t nPacks, std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+		AudioBuffer buffer;
+		buffer.packs.resize(nPacks);
+		for (auto& pack: buffer.packs) {
+			for (auto& s: pack.samples) {
+				s = dist(rng);
+			}
+		}
+		return buffer;
+	}
+
+	bool isSame(const AudioBuffer& a, const AudioBuffer& b)
+	{
+		return a.packs.size() == b.packs.size() && memcmp(a.packs.data(), b.packs.data(), a.packs.size() * sizeof(AudioSamplePack)) == 0;
+	}
+}
+
+TEST(HalleyAudioMixer, KernelsMatchScalar)
+{
+	constexpr size_t nPacks = 64;
+	std::mt19937 rng(1234);
+	const auto src = makeRandomBuffer(nPacks, rng);
+	const auto dst = makeRandomBuffer(nPacks, rng);
+	auto left = makeRandomBuffer(nPacks / 2, rng);
+	auto right = makeRandomBuffer(nPacks / 2, rng);
+	std::array<AudioBuffer*, 2> channels = { &left, &right };
+
+	auto mixers = getMixers();
+	auto& reference = *mixers[0].mixer;
+
+	auto expectedFlat = dst;
+	reference.mixAudio(src.packs, expectedFlat.packs, 0.7f, 0.7f);
+	auto expectedRamp = dst;
+	reference.mixAudio(src.packs, expectedRamp.packs, 0.2f, 0.9f);
+	auto expectedInterleaved = dst;
+	reference.interleaveChannels(expectedInterleaved.packs, channels);
+	auto expectedCompressed = dst;
+	reference.compressRange(expectedCompressed.packs);
+
+	for (auto& m: mixers) {
+		auto flat = dst;
+		m.mixer->mixAudio(src.packs, flat.packs, 0.7f, 0.7f);
+		EXPECT_TRUE(isSame(flat, expectedFlat)) << m.name;
+
+		auto ramp = dst;
+		m.mixer->mixAudio(src.packs, ramp.packs, 0.2f, 0.9f);
+		EXPECT_TRUE(isSame(ramp, expectedRamp)) << m.name;
+
+		auto interleaved = dst;
+		m.mixer->interleaveChannels(interleaved.packs, channels);
+		EXPECT_TRUE(isSame(interleaved, expectedInterleaved)) << m.name;
+
+		auto compressed = dst;
+		m.mixer->compressRange(compressed.packs);
+		EXPECT_TRUE(isSame(compressed, expectedCompressed)) << m.name;
+	}
+}
+
+TEST(HalleyAudioMixer, RepeatedMixingMatchesScalar)
+{
+	// Mixing into the same buffer over and over, as a voice does across several updates, must not drift from the scalar kernel
+	constexpr size_t nPacks = 64;
+	constexpr size_t nIterations = 100;
+	std::mt19937 rng(1234);
+	const auto src = makeRandomBuffer(nPacks, rng);
+	const auto initial = makeRandomBuffer(nPacks, rng);
+
+	auto mixers = getMixers();
+	auto expected = initial;
+	for (size_t i = 0; i < nIterations; ++i) {
+		mixers[0].mixer->mixAudio(src.packs, expected.packs, 0.2f, 0.9f);
+		mixers[0].mixer->compressRange(expected.packs);
+	}
+
+	for (auto& m: mixers) {
+		auto dst = initial;
+		for (size_t i = 0; i < nIterations; ++i) {
+			m.mixer->mixAudio(src.packs, dst.packs, 0.2f, 0.9f);
+			m.mixer->compressRange(dst.packs);
+		}
+		EXPECT_TRUE(isSame(dst, expected)) << m.name;
+	}
+}
+
+// A benchmark rather than a test, run it with --gtest_also_run_disabled_tests
+TEST(HalleyAudioMixer, DISABLED_Throughput)
+{
+	// One voice's worth of mixing per iteration, at a typical buffer size
+	constexpr size_t nPacks = 64;
+	constexpr size_t nIterations = 20000;
+	std::mt19937 rng(1234);
+	const auto src = makeRandomBuffer(nPacks, rng);
+	auto dst = makeRandomBuffer(nPacks, rng);
+
+	for (auto& m: getMixers()) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < nIterations; ++i) {
+			m.mixer->mixAudio(src.packs, dst.packs, 0.2f, 0.9f);
+			m.mixer->compressRange(dst.packs);
+		}
+		const auto end = std::chrono::steady_clock::now();
+
+		const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+		const double samplesPerIteration = double(nPacks * AudioSamplePack::NumSamples);
+		RecordProperty(std::string(m.name) + "NsPerSample", ns / (nIterations * samplesPerIteration));
+	}
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <map>
+#include <random>
+#include "audio_voice_table.h"
+using namespace Halley;
+
+TEST(HalleyAudioVoiceTable, MatchesReference)
+{
+	// Voices are only used as keys, so fake addresses are fine
+	auto fakeVoice = [] (size_t i) { return reinterpret_cast<AudioVoice*>((i + 1) * 64); };
+
+	AudioVoiceTable table(16);
+	std::multimap<uint32_t, AudioVoice*> reference;
+	std::mt19937 rng(1234);
+
+	Vector<std::pair<uint32_t, AudioVoice*>> live;
+	for (size_t step = 0; step < 20000; ++step) {
+		if (live.empty() || rng() % 3 != 0) {
+			const auto id = uint32_t(rng() % 300);
+			auto* voice = fakeVoice(step);
+			table.add(id, voice);
+			reference.emplace(id, voice);
+			live.emplace_back(id, voice);
+		} else {
+			const size_t idx = rng() % live.size();
+			const auto [id, voice] = live[idx];
+			live.erase(live.begin() + idx);
+
+			auto range = reference.equal_range(id);
+			for (auto iter = range.first; iter != range.second; ++iter) {
+				if (iter->second == voice) {
+					reference.erase(iter);
+					break;
+				}
+			}
+			EXPECT_EQ(table.remove(id, voice), reference.count(id) == 0);
+		}
+	}
+
+	EXPECT_EQ(table.size(), reference.size());
+	for (uint32_t id = 0; id < 300; ++id) {
+		size_t found = 0;
+		table.forEach(id, [&] (AudioVoice& voice)
+		{
+			auto range = reference.equal_range(id);
+			EXPECT_TRUE(std::any_of(range.first, range.second, [&] (const auto& e) { return e.second == &voice; }));
+			++found;
+		});
+		EXPECT_EQ(found, reference.count(id));
+		EXPECT_EQ(table.contains(id), reference.count(id) > 0);
+	}
+	EXPECT_FALSE(table.remove(1000, fakeVoice(0)));
+}
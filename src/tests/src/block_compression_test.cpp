@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/bytes/block_compression.h>
+using namespace Halley;
+
+namespace {
+	Bytes makeData(size_t size, Random& rng, int alphabet)
+	{
+		// Mix of random runs and copies of earlier data, so there's something to match at all distances
+		Bytes result;
+		result.reserve(size);
+		while (result.size() < size) {
+			const size_t len = std::min(size - result.size(), size_t(rng.getInt(1, 300)));
+			if (!result.empty() && rng.getInt(0, 2) != 0) {
+				const size_t from = size_t(rng.getInt(0, int(result.size()) - 1));
+				for (size_t i = 0; i < len; ++i) {
+					result.push_back(result[from + i]);
+				}
+			} else {
+				for (size_t i = 0; i < len; ++i) {
+					result.push_back(Byte(rng.getInt(0, alphabet - 1)));
+				}
+			}
+		}
+		return result;
+	}
+
+	Bytes roundTrip(const Bytes& data, size_t blockSize)
+	{
+		const auto compressed = BlockCompression::compress(gsl::as_bytes(gsl::span<const Byte>(data)), blockSize);
+		Bytes result(data.size());
+		BlockCompression::decompress(gsl::as_bytes(gsl::span<const Byte>(compressed)), gsl::as_writable_bytes(gsl::span<Byte>(result)));
+		return result;
+	}
+}
+
+TEST(HalleyBlockCompression, RoundTrip)
+{
+	Random rng(uint32_t(1234));
+	for (size_t size: { 0, 1, 5, 12, 13, 100, 4095, 4096, 4097, 70000, 300000 }) {
+		for (int alphabet: { 1, 4, 256 }) {
+			const auto data = makeData(size, rng, alphabet);
+			EXPECT_EQ(data, roundTrip(data, 4096)) << "size " << size << ", alphabet " << alphabet;
+		}
+	}
+}
+
+TEST(HalleyBlockCompression, CompressesRepetitiveData)
+{
+	Bytes data;
+	const String line = "{ \"position\": [1.0, 2.0, 3.0], \"normal\": [0.0, 1.0, 0.0] }\n";
+	while (data.size() < 100000) {
+		data.insert(data.end(), line.c_str(), line.c_str() + line.size());
+	}
+
+	const auto compressed = BlockCompression::compress(gsl::as_bytes(gsl::span<const Byte>(data)));
+	EXPECT_LT(compressed.size(), data.size() / 10);
+}
+
+TEST(HalleyBlockCompression, BlocksDecompressIndependently)
+{
+	Random rng(uint32_t(42));
+	const auto data = makeData(50000, rng, 16);
+	const auto compressed = BlockCompression::compress(gsl::as_bytes(gsl::span<const Byte>(data)), 8192);
+	const auto src = gsl::as_bytes(gsl::span<const Byte>(compressed));
+	const auto index = BlockCompression::readIndex(src);
+	ASSERT_EQ(7u, index.getNumBlocks());
+
+	for (size_t i = index.getNumBlocks(); i-- > 0;) {
+		Bytes block(index.getRawBlockSize(i));
+		index.decompressBlock(i, src.subspan(index.getBlockOffset(i), index.getCompressedBlockSize(i)), gsl::as_writable_bytes(gsl::span<Byte>(block)));
+		EXPECT_TRUE(std::equal(block.begin(), block.end(), data.begin() + i * 8192));
+	}
+}
+
+TEST(HalleyBlockCompression, RejectsCorruptData)
+{
+	Random rng(uint32_t(7));
+	const auto data = makeData(20000, rng, 8);
+	auto compressed = BlockCompression::compress(gsl::as_bytes(gsl::span<const Byte>(data)));
+	compressed.resize(compressed.size() - 10);
+
+	Bytes result(data.size());
+	EXPECT_THROW(BlockCompression::decompress(gsl::as_bytes(gsl::span<const Byte>(compressed)), gsl::as_writable_bytes(gsl::span<Byte>(result))), Exception);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/entity/entity_command_buffer.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	class TestCoreAPI final : public CoreAPI {
+	public:
+		void quit(int exitCode) override {}
+		void setStage(StageID stage) override {}
+		void setStage(std::unique_ptr<Stage> stage) override {}
+		void initStage(Stage& stage) override {}
+		Stage& getCurrentStage() override { throw Exception("No stage", HalleyExceptions::Core); }
+		HalleyStatics& getStatics() override { throw Exception("No statics", HalleyExceptions::Core); }
+		const Environment& getEnvironment() override { throw Exception("No environment", HalleyExceptions::Core); }
+		int64_t getTime(CoreAPITimer timer, TimeLine tl, StopwatchRollingAveraging::Mode mode) const override { return 0; }
+		void setTimerPaused(CoreAPITimer timer, TimeLine tl, bool paused) override {}
+		bool isDevMode() override { return false; }
+	};
+
+	// A world with a two thread CPU pool
+	struct TestWorld {
+		TestCoreAPI core;
+		HalleyAPI api;
+		std::unique_ptr<Resources> resources;
+		std::unique_ptr<World> world;
+
+		TestWorld()
+		{
+			// Shared by every test, as a queue can't be reused once its pool stops
+			static Executors executors;
+			Executors::setInstance(executors);
+			static ThreadPool threadPool("test", Executors::getCPU(), 2, [] (String name, std::function<void()> f) { return std::thread(std::move(f)); });
+
+			api.core = &core;
+			resources = std::make_unique<Resources>(std::unique_ptr<ResourceLocator>(), api, Resources::Options());
+			world = std::make_unique<World>(api, *resources, false, CreateComponentFunction());
+		}
+
+		~TestWorld()
+		{
+			world.reset();
+		}
+
+		Vector<String> getEntityNames()
+		{
+			Vector<String> result;
+			for (auto& e: world->getEntities()) {
+				result.push_back(e.getName());
+			}
+			return result;
+		}
+	};
+
+	// Returns false if the condition still doesn't hold after a few seconds
+	template <typename F>
+	bool waitFor(F condition)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!condition()) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+
+TEST(HalleyEntityCommandBuffer, ConcurrentBuffering)
+{
+	TestWorld test;
+	constexpr int nThreads = 4;
+	constexpr int nEntities = 100;
+
+	Vector<std::thread> threads;
+	for (int i = 0; i < nThreads; ++i) {
+		threads.emplace_back([&test, i] ()
+		{
+			auto& buffer = test.world->getEntityCommandBuffer();
+			for (int j = 0; j < nEntities; ++j) {
+				EXPECT_EQ(&buffer, &test.world->getEntityCommandBuffer());
+				buffer.createEntity("t" + toString(i) + "_" + toString(j));
+			}
+		});
+	}
+	for (auto& t: threads) {
+		t.join();
+	}
+
+	EXPECT_TRUE(test.getEntityNames().empty());
+	test.world->spawnPending();
+
+	// Nothing is lost, and each thread's commands keep their order
+	const auto names = test.getEntityNames();
+	ASSERT_EQ(size_t(nThreads * nEntities), names.size());
+	for (int i = 0; i < nThreads; ++i) {
+		int next = 0;
+		for (const auto& name: names) {
+			if (name == "t" + toString(i) + "_" + toString(next)) {
+				++next;
+			}
+		}
+		EXPECT_EQ(nEntities, next);
+	}
+}
+
+TEST(HalleyEntityCommandBuffer, MergeOrder)
+{
+	TestWorld test;
+	std::atomic<int> arrived = 0;
+	std::atomic<int> done = 0;
+	std::atomic<bool> highRecorded = false;
+	std::array<std::atomic<size_t>, 2> indices;
+
+	// Each worker records one command, the one with the higher index first
+	for (size_t slot = 0; slot < 2; ++slot) {
+		Executors::getCPU().addToQueue([&, slot] ()
+		{
+			const auto idx = Executors::getCPU().getCurrentWorkerIndex();
+			indices[slot] = idx.value_or(0);
+			++arrived;
+			if (idx && waitFor([&] () { return arrived == 2; })) {
+				const size_t other = indices[1 - slot];
+				if (*idx > other) {
+					test.world->getEntityCommandBuffer().createEntity("worker" + toString(*idx));
+					highRecorded = true;
+				} else if (waitFor([&] () { return highRecorded.load(); })) {
+					test.world->getEntityCommandBuffer().createEntity("worker" + toString(*idx));
+				}
+			}
+			++done;
+		});
+	}
+	ASSERT_TRUE(waitFor([&] () { return done == 2; }));
+
+	// The calling thread isn't a worker, so it goes first, even though its buffer was the last one created
+	test.world->getEntityCommandBuffer().createEntity("main");
+	test.world->spawnPending();
+
+	const size_t low = std::min(indices[0].load(), indices[1].load());
+	const size_t high = std::max(indices[0].load(), indices[1].load());
+	ASSERT_NE(low, high);
+	EXPECT_EQ(Vector<String>({ "main", "worker" + toString(low), "worker" + toString(high) }), test.getEntityNames());
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	std::thread makeThread(String name, std::function<void()> f)
+	{
+		return std::thread(std::move(f));
+	}
+
+	// Returns false if the condition still doesn't hold after a few seconds
+	template <typename F>
+	bool waitFor(F condition)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!condition()) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	class TaskLog {
+	public:
+		void add(String entry)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			entries.push_back(std::move(entry));
+		}
+
+		Vector<String> get() const
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			return entries;
+		}
+
+		size_t size() const
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			return entries.size();
+		}
+
+	private:
+		mutable std::mutex mutex;
+		Vector<String> entries;
+	};
+}
+
+TEST(HalleyExecutor, PriorityOrder)
+{
+	ExecutionQueue queue;
+	TaskLog log;
+	std::atomic<bool> blocked = false;
+	std::atomic<bool> release = false;
+
+	{
+		ThreadPool pool("test", queue, 1, makeThread);
+
+		// Keep the only worker busy, with a task of its own queued behind it
+		queue.addToQueue([&] ()
+		{
+			queue.addToQueue([&] () { log.add("local"); });
+			blocked = true;
+			waitFor([&] () { return release.load(); });
+		});
+		ASSERT_TRUE(waitFor([&] () { return blocked.load(); }));
+
+		queue.addToQueue([&] () { log.add("low"); }, TaskPriority::Low);
+		queue.addToQueue([&] () { log.add("normal"); }, TaskPriority::Normal);
+		queue.addToQueue([&] () { log.add("high"); }, TaskPriority::High);
+		release = true;
+
+		EXPECT_TRUE(waitFor([&] () { return log.size() == 4; }));
+	}
+
+	// High priority tasks from outside go ahead of the worker's own tasks, other injected tasks go after them
+	EXPECT_EQ(Vector<String>({ "high", "local", "normal", "low" }), log.get());
+}
+
+TEST(HalleyExecutor, IdleWorkersSteal)
+{
+	ExecutionQueue queue;
+	constexpr int nTasks = 20;
+	std::atomic<int> done = 0;
+	std::atomic<int> ranOnOwner = 0;
+
+	{
+		ThreadPool pool("test", queue, 2, makeThread);
+
+		// The tasks go to the deque of a worker which then stays busy until they're done, so only the other one can run them
+		queue.addToQueue([&] ()
+		{
+			const auto owner = std::this_thread::get_id();
+			for (int i = 0; i < nTasks; ++i) {
+				queue.addToQueue([&, owner] ()
+				{
+					if (std::this_thread::get_id() == owner) {
+						++ranOnOwner;
+					}
+					++done;
+				});
+			}
+			waitFor([&] () { return done == nTasks; });
+		});
+
+		EXPECT_TRUE(waitFor([&] () { return done == nTasks; }));
+	}
+
+	EXPECT_EQ(0, ranOnOwner);
+}
+
+TEST(HalleyExecutor, DetachHandsOverTasks)
+{
+	ExecutionQueue queue;
+	std::atomic<bool> blockerRunning = false;
+	std::atomic<bool> thrown = false;
+	std::atomic<bool> leftoverRan = false;
+
+	{
+		ThreadPool pool("test", queue, 2, makeThread);
+
+		// Occupy one worker until the other has gone, so the task left behind can only run after the hand over
+		queue.addToQueue([&] ()
+		{
+			blockerRunning = true;
+			waitFor([&] () { return thrown.load(); });
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		});
+		ASSERT_TRUE(waitFor([&] () { return blockerRunning.load(); }));
+
+		// An exception escaping a task stops its worker
+		queue.addToQueue([&] ()
+		{
+			queue.addToQueue([&] () { leftoverRan = true; });
+			thrown = true;
+			throw Exception("Worker stops here", HalleyExceptions::Concurrency);
+		});
+
+		EXPECT_TRUE(waitFor([&] () { return leftoverRan.load(); }));
+	}
+}
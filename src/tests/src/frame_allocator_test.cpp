@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <thread>
+using namespace Halley;
+
+TEST(HalleyFrameAllocator, LinearPerFrame)
+{
+	FrameArena::onFrameStart();
+
+	// A fresh thread, so it starts with an empty arena
+	std::thread thread([] ()
+	{
+		EXPECT_TRUE(FrameAllocator<int>().usesArena());
+		EXPECT_EQ(FrameArena::getUsedBytes(), 0);
+
+		FrameVector<int> values;
+		for (int i = 0; i < 1000; ++i) {
+			values.push_back(i);
+		}
+		const auto used = FrameArena::getUsedBytes();
+		EXPECT_GE(used, values.capacity() * sizeof(int));
+
+		// Freeing the last allocation gives it back
+		{
+			FrameVector<int> temp(100);
+		}
+		EXPECT_EQ(FrameArena::getUsedBytes(), used);
+
+		auto* a = FrameArena::alloc(24, 8);
+		auto* b = FrameArena::alloc(8, 16);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0);
+		EXPECT_GE(static_cast<char*>(b), static_cast<char*>(a) + 24);
+
+		// Bigger than a block
+		FrameVector<char> big(FrameArena::blockSize * 3, 'x');
+		EXPECT_EQ(big.back(), 'x');
+		const auto reserved = FrameArena::getReservedBytes();
+		EXPECT_GE(reserved, FrameArena::blockSize * 4);
+
+		// The previous frame's memory is kept, and the current frame starts empty
+		FrameArena::onFrameStart();
+		EXPECT_EQ(FrameArena::getUsedBytes(), 0);
+		EXPECT_EQ(values[999], 999);
+
+		// Two frames later, it's reused, and fits in a single block
+		FrameArena::onFrameStart();
+		FrameArena::alloc(16, 16);
+		EXPECT_EQ(FrameArena::getReservedBytes(), reserved);
+	});
+	thread.join();
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/tools/assets/import_assets_database.h>
+#include <halley/tools/file/filesystem.h>
+#include <halley/utils/hash.h>
+using namespace Halley;
+
+namespace {
+	struct TestDirectory {
+		Path path;
+
+		TestDirectory()
+			: path(FileSystem::getTemporaryPath())
+		{
+			FileSystem::createDir(path);
+		}
+
+		~TestDirectory()
+		{
+			FileSystem::remove(path);
+		}
+	};
+
+	struct TestDatabase {
+		TestDirectory dir;
+		std::unique_ptr<ImportAssetsDatabase> db;
+
+		TestDatabase()
+		{
+			db = std::make_unique<ImportAssetsDatabase>(dir.path / "assets", dir.path / "import.db", dir.path / "assets.db", std::vector<String>{ "pc" });
+			db->setImportCachePath(dir.path / "import_cache");
+		}
+
+		AssetDependency makeDependency(const String& name, const String& contents, const String& importedContents)
+		{
+			const auto path = dir.path / name;
+			FileSystem::writeFile(path, contents);
+
+			// The timestamp never matches, as if the file had been touched since the import
+			return AssetDependency(path, 0, Hash::hash(Bytes(importedContents.c_str(), importedContents.c_str() + importedContents.length())));
+		}
+	};
+
+	ImportAssetsDatabaseEntry makeAsset(const String& assetId, uint64_t inputHash)
+	{
+		return ImportAssetsDatabaseEntry(assetId, Path("src"), Path(assetId + ".png"), inputHash);
+	}
+}
+
+TEST(HalleyImportAssetsDatabase, InputContentHashes)
+{
+	TestDatabase test;
+	auto& db = *test.db;
+
+	auto asset = makeAsset("sprite", 1234);
+	EXPECT_TRUE(db.needsImporting(asset, false));
+	db.markAsImported(asset);
+	EXPECT_FALSE(db.needsImporting(asset, false));
+	EXPECT_TRUE(db.needsImporting(makeAsset("sprite", 1235), false));
+}
+
+TEST(HalleyImportAssetsDatabase, DependencyContentHashes)
+{
+	TestDatabase test;
+	auto& db = *test.db;
+
+	// A file that was only touched doesn't need a re-import, but one with different contents or that went missing does
+	auto touched = makeAsset("touched", 1);
+	touched.additionalInputFiles.push_back(test.makeDependency("touched.txt", "same", "same"));
+	db.markAsImported(touched);
+	EXPECT_FALSE(db.needsImporting(touched, false));
+	EXPECT_TRUE(db.isDependencyUnchanged(touched.additionalInputFiles[0]));
+
+	auto changed = makeAsset("changed", 2);
+	changed.additionalInputFiles.push_back(test.makeDependency("changed.txt", "new", "old"));
+	db.markAsImported(changed);
+	EXPECT_TRUE(db.needsImporting(changed, false));
+	EXPECT_FALSE(db.isDependencyUnchanged(changed.additionalInputFiles[0]));
+
+	auto removed = makeAsset("removed", 3);
+	removed.additionalInputFiles.push_back(test.makeDependency("removed.txt", "gone", "gone"));
+	db.markAsImported(removed);
+	FileSystem::remove(removed.additionalInputFiles[0].path);
+	EXPECT_TRUE(db.needsImporting(removed, false));
+
+	EXPECT_EQ(std::vector<String>{ "touched" }, db.getDependents(touched.additionalInputFiles[0].path));
+}
+
+TEST(HalleyImportAssetsDatabase, ImportCacheKeys)
+{
+	TestDatabase test;
+	auto& db = *test.db;
+
+	// Same inputs and importer give a cache hit, anything else a miss
+	const auto key = db.getImportCacheKey(makeAsset("sprite", 1234), 1);
+	EXPECT_EQ(key, db.getImportCacheKey(makeAsset("sprite", 1234), 1));
+	EXPECT_NE(key, db.getImportCacheKey(makeAsset("sprite", 1234), 2));
+	EXPECT_NE(key, db.getImportCacheKey(makeAsset("sprite", 1235), 1));
+	EXPECT_NE(key, db.getImportCacheKey(makeAsset("other", 1234), 1));
+
+	// Only the most recent few imports of each asset are kept
+	EXPECT_TRUE(db.addToImportCache("sprite", 1).empty());
+	EXPECT_TRUE(db.addToImportCache("sprite", 2).empty());
+	EXPECT_TRUE(db.addToImportCache("sprite", 3).empty());
+	EXPECT_TRUE(db.addToImportCache("sprite", 1).empty());
+	EXPECT_EQ(std::vector<uint64_t>{ 2 }, db.addToImportCache("sprite", 4));
+}
+
+TEST(HalleyImportAssetsDatabase, DeletingRemovesCachedImports)
+{
+	TestDatabase test;
+	auto& db = *test.db;
+
+	auto addCached = [&] (const String& assetId, uint64_t key)
+	{
+		FileSystem::writeFile(db.getImportCacheFile(key), String("cached"));
+		db.addToImportCache(assetId, key);
+	};
+
+	const auto asset = makeAsset("sprite", 1234);
+	db.markAsImported(asset);
+	addCached("sprite", 1);
+	addCached("sprite", 2);
+	addCached("other", 3);
+
+	db.markDeleted(asset);
+	EXPECT_FALSE(FileSystem::exists(db.getImportCacheFile(1)));
+	EXPECT_FALSE(FileSystem::exists(db.getImportCacheFile(2)));
+	EXPECT_TRUE(FileSystem::exists(db.getImportCacheFile(3)));
+}
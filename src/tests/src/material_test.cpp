@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+TEST(HalleyMaterial, StateHash)
+{
+	const auto definition = std::make_shared<MaterialDefinition>();
+	Material a(definition);
+	Material b(definition);
+	EXPECT_EQ(a.getHash(), b.getHash());
+	EXPECT_TRUE(a == b);
+
+	// Every change to the state is picked up, even after the hash was cached
+	b.setStencilReferenceOverride(3);
+	EXPECT_NE(a.getHash(), b.getHash());
+	b.setStencilReferenceOverride({});
+	EXPECT_EQ(a.getHash(), b.getHash());
+
+	b.setPassEnabled(0, true);
+	EXPECT_NE(a.getHash(), b.getHash());
+	EXPECT_FALSE(a == b);
+
+	// The definition is part of the hash
+	Material c(std::make_shared<MaterialDefinition>());
+	EXPECT_NE(a.getHash(), c.getHash());
+}
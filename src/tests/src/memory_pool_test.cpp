@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <set>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	MemoryPoolStats getStats(size_t blockSize)
+	{
+		for (const auto& stats: PoolPool::getStats()) {
+			if (stats.blockSize == blockSize) {
+				return stats;
+			}
+		}
+		return {};
+	}
+
+	// Uses the pool from its destructor, which runs after the thread's cache is destroyed if this was constructed first
+	struct LateUser {
+		SizePool* pool = nullptr;
+		void* block = nullptr;
+
+		~LateUser()
+		{
+			if (pool) {
+				pool->free(block);
+				pool->free(pool->alloc());
+			}
+		}
+	};
+}
+
+TEST(HalleyMemoryPool, SizeClasses)
+{
+	EXPECT_EQ(PoolPool::getPool(1), PoolPool::getPool(16));
+	EXPECT_EQ(PoolPool::getPool(17)->getSize(), 32);
+	EXPECT_EQ(PoolPool::getPool(17), PoolPool::getPool(32));
+	EXPECT_EQ(PoolPool::getPool(5000)->getSize(), 5008);
+
+	auto* large = PoolPool::getPool(5000);
+	void* p = large->alloc();
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % PoolPool::granularity, 0);
+	EXPECT_EQ(getStats(5008).liveBytes, 5008);
+	large->free(p);
+	EXPECT_EQ(getStats(5008).liveBytes, 0);
+}
+
+TEST(HalleyMemoryPool, FreeOnOtherThreads)
+{
+	// An unusual size, so no other test shares its pool
+	constexpr size_t blockSize = 1200;
+	constexpr size_t nBlocks = 1000;
+	auto* pool = PoolPool::getPool(blockSize);
+	const auto baseLive = getStats(blockSize).liveBytes;
+
+	Vector<void*> blocks;
+	std::thread producer([&] ()
+	{
+		for (size_t i = 0; i < nBlocks; ++i) {
+			auto* p = pool->alloc();
+			memset(p, 0xCD, blockSize);
+			blocks.push_back(p);
+		}
+	});
+	producer.join();
+
+	EXPECT_EQ(std::set<void*>(blocks.begin(), blocks.end()).size(), nBlocks);
+	EXPECT_EQ(getStats(blockSize).liveBytes, baseLive + nBlocks * blockSize);
+
+	// Each thread frees a share of them, and reuses some for itself
+	Vector<std::thread> consumers;
+	for (size_t t = 0; t < 4; ++t) {
+		consumers.emplace_back([&, t] ()
+		{
+			for (size_t i = t; i < nBlocks; i += 4) {
+				pool->free(blocks[i]);
+			}
+			for (size_t i = 0; i < 10; ++i) {
+				pool->free(pool->alloc());
+			}
+		});
+	}
+	for (auto& t: consumers) {
+		t.join();
+	}
+
+	const auto stats = getStats(blockSize);
+	EXPECT_EQ(stats.liveBytes, baseLive);
+	EXPECT_GE(stats.highWaterBytes, nBlocks * blockSize);
+	EXPECT_GE(stats.reservedBytes, stats.highWaterBytes);
+}
+
+TEST(HalleyMemoryPool, UseWhileThreadExits)
+{
+	constexpr size_t blockSize = 1104;
+	auto* pool = PoolPool::getPool(blockSize);
+	const auto baseLive = getStats(blockSize).liveBytes;
+
+	std::thread thread([&] ()
+	{
+		thread_local LateUser user;
+		user.pool = pool;
+		user.block = pool->alloc();
+	});
+	thread.join();
+
+	EXPECT_EQ(getStats(blockSize).liveBytes, baseLive);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "halley/entity/message_bus.h"
+using namespace Halley;
+
+namespace {
+	int liveMessages = 0;
+
+	class TestMessage final : public Message {
+	public:
+		static constexpr int messageIndex = 3;
+
+		int value = 0;
+		String payload;
+
+		TestMessage(int value = 0) : value(value), payload("payload that doesn't fit in small string storage") { ++liveMessages; }
+		TestMessage(TestMessage&& other) noexcept : value(other.value), payload(std::move(other.payload)) { ++liveMessages; }
+		~TestMessage() override { --liveMessages; }
+
+		size_t getSize() const override { return sizeof(TestMessage); }
+	};
+
+	Vector<int> getValues(const MessageBus& bus, bool deliveredOnly = true)
+	{
+		Vector<int> result;
+		for (const auto& e: bus.getMessages(TestMessage::messageIndex)) {
+			if (e.delivered || !deliveredOnly) {
+				result.push_back(static_cast<const TestMessage*>(e.msg)->value);
+			}
+		}
+		return result;
+	}
+}
+
+TEST(HalleyMessageBus, DeliveryAndPurge)
+{
+	{
+		MessageBus bus;
+		EntityId alive;
+		alive.value = 1;
+		EntityId dead;
+		dead.value = 2;
+		auto isDead = [&] (EntityId id) { return id == dead; };
+
+		// Sender with age 0 sends 200 messages, spanning several blocks
+		for (int i = 0; i < 200; ++i) {
+			bus.send(i % 3 == 0 ? dead : alive, 0, TestMessage(i));
+		}
+		EXPECT_TRUE(getValues(bus).empty());
+		bus.dispatch(TestMessage::messageIndex, 0, isDead);
+
+		const auto values = getValues(bus);
+		ASSERT_EQ(values.size(), 133);
+		for (size_t i = 1; i < values.size(); ++i) {
+			EXPECT_LT(values[i - 1], values[i]);
+		}
+
+		// Sender with age 1 sends while age 0's messages are still around
+		bus.send(alive, 1, TestMessage(1000));
+		EXPECT_EQ(getValues(bus, false).size(), 134);
+		bus.purge(TestMessage::messageIndex, 1); // Pending, so not purged
+		bus.purge(TestMessage::messageIndex, 0);
+		EXPECT_EQ(getValues(bus, false), Vector<int>{ 1000 });
+		bus.dispatch(TestMessage::messageIndex, 1, isDead);
+		EXPECT_EQ(getValues(bus), Vector<int>{ 1000 });
+		EXPECT_EQ(liveMessages, 1);
+	}
+	EXPECT_EQ(liveMessages, 0);
+}
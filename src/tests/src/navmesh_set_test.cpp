@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	constexpr float cellSize = 10.0f;
+
+	// A grid of square regions, one navmesh each, with a portal to every neighbour that isn't walled off
+	NavmeshSet makeGrid(int w, int h, const std::function<bool(Vector2i, Vector2i)>& isWall)
+	{
+		NavmeshSet result;
+		const Vector2i dirs[] = { Vector2i(0, -1), Vector2i(1, 0), Vector2i(0, 1), Vector2i(-1, 0) };
+
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				const auto cell = Vector2i(x, y);
+				const auto p0 = Vector2f(cell) * cellSize;
+
+				Navmesh::PolygonData poly;
+				poly.polygon = Polygon({ p0, p0 + Vector2f(cellSize, 0), p0 + Vector2f(cellSize, cellSize), p0 + Vector2f(0, cellSize) });
+				for (int i = 0; i < 4; ++i) {
+					const auto other = cell + dirs[i];
+					const bool inside = other.x >= 0 && other.y >= 0 && other.x < w && other.y < h;
+					// Portal ids from 4 up link regions within a chunk, and are stored as -(id + 2)
+					poly.connections.push_back(inside && !isWall(cell, other) ? -(4 + i + 2) : -1);
+				}
+
+				std::vector<Navmesh::PolygonData> polys;
+				polys.push_back(std::move(poly));
+				result.add(Navmesh(std::move(polys), NavmeshBounds(p0, Vector2f(cellSize, 0), Vector2f(0, cellSize), 1, 1, Vector2f(1, 1)), 0));
+			}
+		}
+
+		result.linkNavmeshes();
+		return result;
+	}
+
+	bool noWalls(Vector2i, Vector2i)
+	{
+		return false;
+	}
+
+	// Walls between rows, except for a gap alternating between the ends, so the only way through is a zig-zag
+	bool zigZag(Vector2i a, Vector2i b, int w)
+	{
+		if (a.y == b.y) {
+			return false;
+		}
+		const int row = std::min(a.y, b.y);
+		const int gap = row % 2 == 0 ? w - 1 : 0;
+		return a.x != gap;
+	}
+
+	Vector2f cellCentre(Vector2i cell)
+	{
+		return (Vector2f(cell) + Vector2f(0.5f, 0.5f)) * cellSize;
+	}
+
+	std::vector<NavigationQuery> makeQueries(int w, int h, Random& rng, size_t n)
+	{
+		std::vector<NavigationQuery> result;
+		for (size_t i = 0; i < n; ++i) {
+			const auto from = cellCentre(Vector2i(rng.getInt(0, w - 1), rng.getInt(0, h - 1)));
+			const auto to = cellCentre(Vector2i(rng.getInt(0, w - 1), rng.getInt(0, h - 1)));
+			result.emplace_back(from, 0, to, 0, NavigationQuery::PostProcessingType::None);
+		}
+		return result;
+	}
+
+	void setupExecutors()
+	{
+		// Shared by every test, as a queue can't be reused once its pool stops
+		static Executors executors;
+		Executors::setInstance(executors);
+		static ThreadPool threadPool("test", Executors::getCPU(), 2, [] (String name, std::function<void()> f) { return std::thread(std::move(f)); });
+	}
+}
+
+TEST(NavmeshSet, BatchMatchesSerial)
+{
+	setupExecutors();
+	constexpr int w = 8;
+	constexpr int h = 6;
+	const auto set = makeGrid(w, h, noWalls);
+	Random rng(uint32_t(1234));
+	const auto queries = makeQueries(w, h, rng, 200);
+
+	const auto batch = set.pathfind(gsl::span<const NavigationQuery>(queries));
+	ASSERT_EQ(batch.size(), queries.size());
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const auto serial = set.pathfind(queries[i]);
+		ASSERT_EQ(batch[i].has_value(), serial.has_value()) << i;
+		if (serial) {
+			EXPECT_EQ(*batch[i], *serial) << i;
+		}
+
+		// With no walls, the shortest region path steps straight through one region per grid step
+		const auto from = Vector2i((queries[i].from / cellSize).floor());
+		const auto to = Vector2i((queries[i].to / cellSize).floor());
+		if (from != to) {
+			ASSERT_TRUE(serial.has_value()) << i;
+			EXPECT_EQ(size_t((to - from).manhattanLength() + 1), serial->regions.size()) << i;
+		}
+	}
+}
+
+TEST(NavmeshSet, RelinkingInvalidatesRegionCosts)
+{
+	constexpr int w = 5;
+	constexpr int h = 5;
+	auto walled = [&] (Vector2i a, Vector2i b) { return zigZag(a, b, w); };
+	const auto open = makeGrid(w, h, noWalls);
+	const auto zigZagged = makeGrid(w, h, walled);
+
+	// Going down the left column is a straight line without walls, and crosses every row end to end with them
+	const auto query = NavigationQuery(cellCentre(Vector2i(0, 0)), 0, cellCentre(Vector2i(0, h - 1)), 0, NavigationQuery::PostProcessingType::None);
+	const auto openPath = open.pathfind(query);
+	const auto zigZagPath = zigZagged.pathfind(query);
+	ASSERT_TRUE(openPath && zigZagPath);
+	EXPECT_EQ(size_t(h), openPath->regions.size());
+	EXPECT_EQ(size_t((h - 1) * w + 1), zigZagPath->regions.size());
+
+	// Each change to the set must drop the distances cached by the previous query
+	NavmeshSet set = makeGrid(w, h, noWalls);
+	EXPECT_EQ(openPath, set.pathfind(query));
+
+	set.clear();
+	EXPECT_FALSE(set.pathfind(query));
+
+	for (const auto& navmesh: zigZagged.getNavmeshes()) {
+		set.add(navmesh);
+	}
+	set.linkNavmeshes();
+	EXPECT_EQ(zigZagPath, set.pathfind(query));
+
+	// Adding a mesh without portals, and linking again, keeps the same route
+	const auto extra = makeGrid(1, 1, noWalls);
+	set.add(extra.getNavmeshes()[0]);
+	set.linkNavmeshes();
+	EXPECT_EQ(zigZagPath, set.pathfind(query));
+}
@@ -0,0 +1,268 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/net/halley_net.h>
+#include <deque>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	// Both ends of an in-memory connection; packets are only delivered when the test says so
+	struct LoopbackLink {
+		std::deque<Bytes> queues[2];
+		bool open = true;
+		bool holding = false;
+		bool dropping = false;
+	};
+
+	class LoopbackConnection final : public IConnection {
+	public:
+		LoopbackConnection(std::shared_ptr<LoopbackLink> link, int side)
+			: link(std::move(link))
+			, side(side)
+		{}
+
+		void close() override { link->open = false; }
+		ConnectionStatus getStatus() const override { return link->open ? ConnectionStatus::Connected : ConnectionStatus::Closed; }
+
+		void send(OutboundNetworkPacket&& packet) override
+		{
+			if (link->open && !link->dropping) {
+				const auto bytes = packet.getBytes();
+				link->queues[1 - side].emplace_back(reinterpret_cast<const Byte*>(bytes.data()), reinterpret_cast<const Byte*>(bytes.data()) + bytes.size());
+			}
+		}
+
+		bool receive(InboundNetworkPacket& packet) override
+		{
+			auto& queue = link->queues[side];
+			if (link->holding || queue.empty()) {
+				return false;
+			}
+			packet = InboundNetworkPacket(gsl::as_bytes(gsl::span<const Byte>(queue.front())));
+			queue.pop_front();
+			return true;
+		}
+
+	private:
+		std::shared_ptr<LoopbackLink> link;
+		int side;
+	};
+
+	class LoopbackNetworkService final : public NetworkService {
+	public:
+		std::deque<std::shared_ptr<IConnection>> incoming;
+		LoopbackNetworkService* host = nullptr;
+		std::shared_ptr<LoopbackLink> lastLink;
+
+		void update() override {}
+		void setAcceptingConnections(bool accepting) override {}
+
+		std::shared_ptr<IConnection> tryAcceptConnection() override
+		{
+			if (incoming.empty()) {
+				return {};
+			}
+			auto result = incoming.front();
+			incoming.pop_front();
+			return result;
+		}
+
+		std::shared_ptr<IConnection> connect(String address, int port) override
+		{
+			lastLink = std::make_shared<LoopbackLink>();
+			host->incoming.push_back(std::make_shared<LoopbackConnection>(lastLink, 1));
+			return std::make_shared<LoopbackConnection>(lastLink, 0);
+		}
+	};
+
+	class TestSharedData final : public SharedData {
+	public:
+		Bytes payload;
+
+		void set(Bytes value)
+		{
+			payload = std::move(value);
+			markModified();
+		}
+
+		void serialize(Serializer& s) const override { s << payload; }
+		void deserialize(Deserializer& s) override { s >> payload; }
+	};
+
+	class TestSession final : public NetworkSessionImpl<TestSharedData, TestSharedData> {
+	public:
+		explicit TestSession(NetworkService& service)
+			: NetworkSessionImpl(service)
+		{}
+
+		~TestSession() override
+		{
+			close();
+		}
+	};
+
+	struct Client {
+		LoopbackNetworkService service;
+		std::unique_ptr<TestSession> session;
+
+		Client(LoopbackNetworkService& hostService)
+		{
+			service.host = &hostService;
+			session = std::make_unique<TestSession>(service);
+			session->join("localhost", 0);
+		}
+	};
+
+	Bytes makePayload(size_t size, int seed)
+	{
+		Bytes result(size);
+		for (size_t i = 0; i < size; ++i) {
+			result[i] = Byte((i * 7 + seed) & 0xFF);
+		}
+		return result;
+	}
+
+	void pump(TestSession& host, gsl::span<Client* const> clients, int iterations = 50)
+	{
+		for (int i = 0; i < iterations; ++i) {
+			host.update();
+			for (auto* c: clients) {
+				c->session->update();
+			}
+		}
+	}
+
+	const Bytes* getPeerPayload(TestSession& session, int peerId)
+	{
+		const auto* data = session.tryGetClientSharedData(peerId);
+		return data ? &data->payload : nullptr;
+	}
+}
+
+TEST(NetworkSession, ReplicatesAndRelaysSharedData)
+{
+	LoopbackNetworkService hostService;
+	TestSession host(hostService);
+	host.setMaxClients(4);
+	host.host(0);
+
+	Client a(hostService);
+	Client b(hostService);
+	Client* clients[] = { &a, &b };
+	pump(host, clients);
+
+	ASSERT_EQ(ConnectionStatus::Connected, a.session->getStatus());
+	ASSERT_EQ(ConnectionStatus::Connected, b.session->getStatus());
+	const int aId = a.session->getMyPeerId();
+	const int bId = b.session->getMyPeerId();
+	EXPECT_NE(aId, bId);
+
+	// Session data goes out from the host, peer data is relayed by it; updates after the first one are deltas
+	for (int i = 0; i < 5; ++i) {
+		auto payload = makePayload(300, 0);
+		payload[i * 10] = Byte(200 + i);
+		host.getMutableSessionSharedData().set(payload);
+		a.session->getMySharedData().set(payload);
+		pump(host, clients);
+
+		EXPECT_EQ(payload, a.session->getSessionSharedData().payload);
+		EXPECT_EQ(payload, b.session->getSessionSharedData().payload);
+		ASSERT_NE(nullptr, getPeerPayload(host, aId));
+		EXPECT_EQ(payload, *getPeerPayload(host, aId));
+		ASSERT_NE(nullptr, getPeerPayload(*b.session, aId));
+		EXPECT_EQ(payload, *getPeerPayload(*b.session, aId));
+	}
+}
+
+TEST(NetworkSession, ManyUpdatesInFlight)
+{
+	LoopbackNetworkService hostService;
+	TestSession host(hostService);
+	host.setMaxClients(4);
+	host.host(0);
+
+	Client a(hostService);
+	Client* clients[] = { &a };
+	pump(host, clients);
+	ASSERT_EQ(ConnectionStatus::Connected, a.session->getStatus());
+
+	// Far more versions go out than are kept as delta bases before the client gets any of them; it must still catch up, without a disconnect
+	auto link = a.service.lastLink;
+	link->holding = true;
+	auto payload = makePayload(200, 0);
+	for (int i = 0; i < 150; ++i) {
+		payload[i] = Byte(i);
+		host.getMutableSessionSharedData().set(payload);
+		host.update();
+	}
+	link->holding = false;
+	pump(host, clients, 400);
+
+	EXPECT_EQ(ConnectionStatus::Connected, a.session->getStatus());
+	EXPECT_EQ(payload, a.session->getSessionSharedData().payload);
+}
+
+TEST(NetworkSession, ResendsLostUpdates)
+{
+	LoopbackNetworkService hostService;
+	TestSession host(hostService);
+	host.setMaxClients(4);
+	host.host(0);
+
+	Client a(hostService);
+	Client* clients[] = { &a };
+	pump(host, clients);
+	ASSERT_EQ(ConnectionStatus::Connected, a.session->getStatus());
+
+	auto link = a.service.lastLink;
+	link->dropping = true;
+	const auto payload = makePayload(100, 1);
+	host.getMutableSessionSharedData().set(payload);
+	pump(host, clients, 5);
+	link->dropping = false;
+
+	pump(host, clients, 5);
+	EXPECT_NE(payload, a.session->getSessionSharedData().payload);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	pump(host, clients, 5);
+	EXPECT_EQ(payload, a.session->getSessionSharedData().payload);
+}
+
+TEST(NetworkSession, ReusedPeerIdStartsOver)
+{
+	LoopbackNetworkService hostService;
+	TestSession host(hostService);
+	host.setMaxClients(4);
+	host.host(0);
+
+	Client a(hostService);
+	auto b = std::make_unique<Client>(hostService);
+	{
+		Client* clients[] = { &a, b.get() };
+		pump(host, clients);
+		for (int i = 0; i < 10; ++i) {
+			b->session->getMySharedData().set(makePayload(100, i));
+			pump(host, clients, 4);
+		}
+		pump(host, clients);
+	}
+	const int oldId = b->session->getMyPeerId();
+	ASSERT_NE(nullptr, getPeerPayload(*a.session, oldId));
+	EXPECT_EQ(makePayload(100, 9), *getPeerPayload(*a.session, oldId));
+
+	// A new client takes over the same id, and its first versions must not be mistaken for stale ones
+	b.reset();
+	Client c(hostService);
+	Client* clients[] = { &a, &c };
+	pump(host, clients);
+	ASSERT_EQ(oldId, c.session->getMyPeerId());
+
+	const auto payload = makePayload(100, 42);
+	c.session->getMySharedData().set(payload);
+	pump(host, clients);
+
+	ASSERT_NE(nullptr, getPeerPayload(host, oldId));
+	EXPECT_EQ(payload, *getPeerPayload(host, oldId));
+	EXPECT_EQ(payload, *getPeerPayload(*a.session, oldId));
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	struct RecordedBatch {
+		String material;
+		Vector<char> vertices;
+		Vector<IndexType> indices;
+		bool standardQuadsOnly = false;
+		std::optional<Rect4i> clip;
+
+		bool operator==(const RecordedBatch& other) const
+		{
+			return material == other.material && vertices == other.vertices && indices == other.indices && standardQuadsOnly == other.standardQuadsOnly && clip == other.clip;
+		}
+	};
+
+	std::ostream& operator<<(std::ostream& os, const RecordedBatch& batch)
+	{
+		return os << batch.material << " (" << batch.vertices.size() << " bytes, " << batch.indices.size() << " indices)";
+	}
+
+	// Records what would have been sent to the GPU
+	class RecordingPainter final : public Painter {
+	public:
+		Vector<RecordedBatch> batches;
+
+		RecordingPainter(Resources& resources)
+			: Painter(resources)
+		{}
+
+		void clear(std::optional<Colour> colour, std::optional<float> depth, std::optional<uint8_t> stencil) override {}
+		void setMaterialPass(const Material& material, int pass) override {}
+		void setMaterialData(const Material& material) override {}
+
+	protected:
+		void doStartRender() override {}
+		void doEndRender() override {}
+		void setViewPort(Rect4i rect) override {}
+		void onUpdateProjection(Material& material) override {}
+		void drawTriangles(size_t numIndices) override {}
+
+		void setClip(Rect4i rect, bool enable) override
+		{
+			clip = enable ? rect : std::optional<Rect4i>();
+		}
+
+		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, IndexType* indices, bool standardQuadsOnly) override
+		{
+			const auto* bytes = static_cast<const char*>(vertexData);
+			batches.push_back(RecordedBatch{ material.getName(), Vector<char>(bytes, bytes + numVertices * material.getVertexStride()), Vector<IndexType>(indices, indices + numIndices), standardQuadsOnly, clip });
+		}
+
+	private:
+		std::optional<Rect4i> clip;
+	};
+
+	class TestRenderTarget final : public RenderTarget {
+	public:
+		Rect4i getViewPort() const override { return Rect4i(0, 0, 640, 480); }
+		bool hasColourBuffer(int attachmentNumber) const override { return true; }
+		bool hasDepthBuffer() const override { return false; }
+	};
+
+	ConfigNode makeAttribute(const String& name, const String& type, const String& semantic)
+	{
+		ConfigNode::MapType result;
+		result["name"] = ConfigNode(name);
+		result["type"] = ConfigNode(type);
+		result["semantic"] = ConfigNode(semantic);
+		return ConfigNode(std::move(result));
+	}
+
+	std::shared_ptr<MaterialDefinition> makeLineMaterial(const String& name)
+	{
+		ConfigNode::SequenceType attributes;
+		attributes.push_back(makeAttribute("colour", "vec4", "COLOUR"));
+		attributes.push_back(makeAttribute("position", "vec2", "POSITION"));
+		attributes.push_back(makeAttribute("normal", "vec2", "NORMAL"));
+		attributes.push_back(makeAttribute("width", "vec2", "WIDTH"));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(name);
+		root["attributes"] = ConfigNode(std::move(attributes));
+
+		auto result = std::make_shared<MaterialDefinition>();
+		result->load(ConfigNode(std::move(root)));
+		return result;
+	}
+
+	std::shared_ptr<MaterialDefinition> makeBaseMaterial()
+	{
+		ConfigNode::SequenceType uniforms;
+		for (const auto& [name, type]: { std::pair<String, String>("u_mvp", "mat4"), std::pair<String, String>("u_viewPortSize", "vec2") }) {
+			ConfigNode::MapType uniform;
+			uniform[name] = ConfigNode(type);
+			uniforms.push_back(ConfigNode(std::move(uniform)));
+		}
+
+		ConfigNode::MapType block;
+		block["HalleyBlock"] = ConfigNode(std::move(uniforms));
+		ConfigNode::SequenceType blocks;
+		blocks.push_back(ConfigNode(std::move(block)));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(String("Halley/MaterialBase"));
+		root["uniforms"] = ConfigNode(std::move(blocks));
+
+		auto result = std::make_shared<MaterialDefinition>();
+		result->load(ConfigNode(std::move(root)));
+		return result;
+	}
+
+	// A painter drawing to a fake render target, with the built-in materials it needs
+	struct TestRenderer {
+		HalleyAPI api;
+		Resources resources;
+		std::unique_ptr<RecordingPainter> painter;
+		TestRenderTarget target;
+		Camera camera;
+
+		TestRenderer()
+			: resources(std::unique_ptr<ResourceLocator>(), api, Resources::Options())
+			, camera(Vector2f(320, 240))
+		{
+			resources.init<MaterialDefinition>();
+			auto& materials = resources.of<MaterialDefinition>();
+			materials.setResource(0, "Halley/MaterialBase", makeBaseMaterial());
+			materials.setResource(0, "Halley/SolidLine", makeLineMaterial("Halley/SolidLine"));
+			materials.setResource(0, "Halley/SolidPolygon", makeLineMaterial("Halley/SolidPolygon"));
+			painter = std::make_unique<RecordingPainter>(resources);
+		}
+
+		Vector<RecordedBatch> render(const std::function<void(Painter&)>& f)
+		{
+			painter->batches.clear();
+			RenderContext(*painter, camera, target).bind(f);
+			return painter->batches;
+		}
+	};
+
+	// Works with either Painter or PainterCommandList
+	template <typename T>
+	void drawPart(T& painter, int part)
+	{
+		const float x = float(part) * 10.0f;
+		if (part % 3 == 1) {
+			painter.setClip(Rect4i(part, part, 300, 200));
+		} else {
+			painter.setClip();
+		}
+
+		const Vector2f points[] = { Vector2f(x, 0), Vector2f(x + 5, 20), Vector2f(x + 30, 25) };
+		painter.drawLine(points, 2.0f, Colour4f(1, 0, 0), false);
+		painter.drawCircle(Vector2f(x, 100), 15.0f + float(part), 1.0f, Colour4f(0, 1, 0));
+		painter.drawPolygon(Polygon({ Vector2f(x, 50), Vector2f(x + 20, 50), Vector2f(x + 20, 70), Vector2f(x, 70) }), Colour4f(0, 0, 1));
+		painter.drawRect(Rect4f(x, 200, 40, 30), 1.5f, Colour4f(1, 1, 0));
+		painter.drawPolygon(Polygon({ Vector2f(x, 300), Vector2f(x + 40, 300), Vector2f(x + 20, 310), Vector2f(x + 40, 340), Vector2f(x, 340) }), Colour4f(1, 0, 1));
+		painter.drawEllipse(Vector2f(x, 400), Vector2f(30, 10), 1.0f, Colour4f(0, 1, 1));
+		painter.drawCircleArc(Vector2f(x, 450), 20.0f, 1.0f, Angle1f::fromDegrees(10), Angle1f::fromDegrees(200), Colour4f(1, 1, 1));
+	}
+}
+
+TEST(HalleyPainterCommandList, PolygonIndices)
+{
+	TestRenderer renderer;
+	const auto batches = renderer.render([] (Painter& painter)
+	{
+		painter.drawPolygon(Polygon({ Vector2f(0, 0), Vector2f(10, 0), Vector2f(10, 10), Vector2f(0, 10) }), Colour4f(1, 1, 1));
+	});
+
+	ASSERT_EQ(1u, batches.size());
+	EXPECT_EQ(Vector<IndexType>({ 0, 1, 2, 0, 2, 3 }), batches[0].indices);
+}
+
+TEST(HalleyPainterCommandList, MergedListsMatchSerialDraws)
+{
+	constexpr int nParts = 8;
+	TestRenderer renderer;
+
+	const auto serial = renderer.render([&] (Painter& painter)
+	{
+		for (int i = 0; i < nParts; ++i) {
+			drawPart(painter, i);
+		}
+	});
+
+	const auto merged = renderer.render([&] (Painter& painter)
+	{
+		// Lists are created on the render thread, each recorded on its own thread, and then replayed in order
+		Vector<PainterCommandList> lists;
+		for (int i = 0; i < nParts; ++i) {
+			lists.emplace_back(painter);
+		}
+
+		Vector<std::thread> threads;
+		for (int i = 0; i < nParts; ++i) {
+			threads.emplace_back([&lists, i] () { drawPart(lists[i], i); });
+		}
+		for (auto& t: threads) {
+			t.join();
+		}
+
+		for (const auto& list: lists) {
+			painter.draw(list);
+		}
+	});
+
+	EXPECT_GT(serial.size(), size_t(nParts));
+	EXPECT_EQ(serial, merged);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <chrono>
+using namespace Halley;
+
+namespace {
+	Particles makeParticles(size_t burst, float ttl)
+	{
+		ConfigNode::MapType config;
+		config["burst"] = static_cast<int>(burst);
+		config["ttl"] = ttl;
+		config["speed"] = 100.0f;
+		config["angle"] = 0.0f;
+		config["acceleration"] = Vector2f(0, 50);
+		config["startScale"] = 1.0f;
+		config["endScale"] = 3.0f;
+		config["fadeOutTime"] = 0.5f;
+		auto particles = Particles(ConfigNode(std::move(config)));
+
+		auto material = std::make_shared<Material>(std::make_shared<MaterialDefinition>());
+		particles.setSprites({ Sprite().setMaterial(material) });
+		return particles;
+	}
+}
+
+TEST(HalleyParticles, Simulation)
+{
+	auto particles = makeParticles(10, 1.0f);
+	particles.setPosition(Vector2f(10, 20));
+
+	particles.update(0.25);
+	particles.update(0.25);
+	ASSERT_EQ(particles.getNumParticles(), 10);
+	ASSERT_EQ(particles.getSprites().size(), 10);
+
+	// Semi-implicit Euler, with velocity updated before position
+	for (const auto& sprite: particles.getSprites()) {
+		EXPECT_NEAR(sprite.getPosition().x, 60.0f, 0.001f);
+		EXPECT_NEAR(sprite.getPosition().y, 20.0f + 0.25f * 12.5f + 0.25f * 25.0f, 0.001f);
+		EXPECT_NEAR(sprite.getScale().x, 2.0f, 0.001f);
+		EXPECT_NEAR(sprite.getColour().a, 1.0f, 0.001f);
+	}
+
+	particles.update(0.25);
+	for (const auto& sprite: particles.getSprites()) {
+		EXPECT_NEAR(sprite.getColour().a, 0.5f, 0.001f);
+	}
+
+	particles.update(0.25);
+	EXPECT_EQ(particles.getNumParticles(), 0);
+	EXPECT_TRUE(particles.getSprites().empty());
+}
+
+TEST(HalleyParticles, SpritesFollowUpdates)
+{
+	constexpr size_t nParticles = 1000;
+	auto drawnEveryUpdate = makeParticles(nParticles, 1000.0f);
+	auto drawnOnce = makeParticles(nParticles, 1000.0f);
+
+	// Sprites are brought up to date when asked for, no matter how many updates happened since
+	for (int i = 0; i < 10; ++i) {
+		drawnEveryUpdate.update(1.0 / 60.0);
+		drawnOnce.update(1.0 / 60.0);
+		ASSERT_EQ(drawnEveryUpdate.getSprites().size(), nParticles);
+	}
+
+	const auto& a = drawnEveryUpdate.getSprites();
+	const auto& b = drawnOnce.getSprites();
+	ASSERT_EQ(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		EXPECT_EQ(a[i].getPosition(), b[i].getPosition());
+		EXPECT_EQ(a[i].getScale(), b[i].getScale());
+	}
+	EXPECT_EQ(drawnOnce.getNumParticles(), nParticles);
+}
+
+// A benchmark rather than a test, run it with --gtest_also_run_disabled_tests
+TEST(HalleyParticles, DISABLED_Throughput)
+{
+	constexpr size_t nParticles = 100000;
+	constexpr size_t nIterations = 100;
+	auto particles = makeParticles(nParticles, 1000.0f);
+	particles.update(0);
+	ASSERT_EQ(particles.getNumParticles(), nParticles);
+
+	// Measures the simulation alone, and with the sprites brought up to date for drawing every update
+	for (const bool withSprites: { false, true }) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < nIterations; ++i) {
+			particles.update(1.0 / 60.0);
+			if (withSprites) {
+				EXPECT_EQ(particles.getSprites().size(), nParticles);
+			}
+		}
+		const auto end = std::chrono::steady_clock::now();
+
+		const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+		const std::string prefix = withSprites ? "updateAndSprites" : "update";
+		RecordProperty(prefix + "NsPerParticle", ns / (nIterations * nParticles));
+		RecordProperty(prefix + "MsPerUpdate", ns / nIterations / 1000000.0);
+	}
+	EXPECT_EQ(particles.getNumParticles(), nParticles);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	const ProfilerCapture::Thread* findThread(const ProfilerCapture& capture, const String& name)
+	{
+		for (const auto& thread: capture.threads) {
+			if (thread.name == name) {
+				return &thread;
+			}
+		}
+		return nullptr;
+	}
+}
+
+TEST(HalleyProfiler, CapturesFramesFromAllThreads)
+{
+	Profiler::setEnabled(true);
+	Profiler::setThreadName("Test Main");
+
+	Profiler::onFrameStart();
+	for (int frame = 0; frame < 3; ++frame) {
+		{
+			ProfilerEvent outer("Outer");
+			ProfilerEvent inner("Inner \"quoted\"");
+		}
+
+		std::thread worker([] ()
+		{
+			Profiler::setThreadName("Test Worker");
+			ProfilerEvent event(Profiler::intern(String("Worker ") + "Job"));
+		});
+		worker.join();
+
+		Profiler::onFrameStart();
+	}
+
+	const auto capture = Profiler::capture(2);
+	Profiler::setEnabled(false);
+	ASSERT_EQ(capture.frameStarts.size(), 3);
+
+	const auto* main = findThread(capture, "Test Main");
+	ASSERT_NE(main, nullptr);
+	ASSERT_EQ(main->events.size(), 4);
+	EXPECT_STREQ(main->events[0].name, "Outer");
+	EXPECT_STREQ(main->events[1].name, "Inner \"quoted\"");
+	for (const auto& event: main->events) {
+		EXPECT_GE(event.start, capture.start);
+		EXPECT_LE(event.end, capture.end);
+	}
+
+	// Each worker thread is a different thread, but all of them are named the same
+	size_t nWorkerEvents = 0;
+	for (const auto& thread: capture.threads) {
+		if (thread.name == "Test Worker") {
+			nWorkerEvents += thread.events.size();
+		}
+	}
+	EXPECT_EQ(nWorkerEvents, 2);
+
+	const auto trace = capture.toChromeTrace();
+	EXPECT_TRUE(trace.contains("\"name\":\"Worker Job\""));
+	EXPECT_TRUE(trace.contains("\"name\":\"Inner \\\"quoted\\\"\""));
+	EXPECT_TRUE(trace.contains("\"args\":{\"name\":\"Test Main\"}"));
+
+	// Nothing is recorded while disabled
+	{
+		ProfilerEvent ignored("Ignored");
+	}
+	Profiler::onFrameStart();
+	const auto idle = Profiler::capture(1);
+	const auto* idleMain = findThread(idle, "Test Main");
+	ASSERT_NE(idleMain, nullptr);
+	EXPECT_TRUE(idleMain->events.empty());
+}
+
+TEST(HalleyProfiler, CaptureWhileRingIsLapped)
+{
+	// A wide frame, which the writer below fills with back to back events numbered by their start time
+	Profiler::onFrameStart();
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	Profiler::onFrameStart();
+	const auto frame = Profiler::capture(1);
+	const auto base = frame.start + 1;
+	const auto maxEvents = frame.end - frame.start - 2;
+
+	std::atomic<bool> stop = false;
+	std::atomic<int64_t> nWritten = 0;
+	std::thread writer([&] ()
+	{
+		Profiler::setThreadName("Test Lapping");
+		for (int64_t i = 0; !stop && i < maxEvents; ++i) {
+			Profiler::addEvent("Lap", base + i, base + i + 1);
+			nWritten = i + 1;
+		}
+	});
+	while (nWritten == 0) {
+		std::this_thread::yield();
+	}
+
+	// Each capture must get a contiguous run of whole events, however many were overwritten while it was copying
+	int nLapped = 0;
+	int nBroken = 0;
+	for (int i = 0; i < 50 || (nLapped == 0 && i < 1000); ++i) {
+		const auto before = nWritten.load();
+		const auto capture = Profiler::capture(1);
+		if (nWritten - before > int64_t(Profiler::eventsPerThread)) {
+			++nLapped;
+		}
+
+		const auto* thread = findThread(capture, "Test Lapping");
+		if (!thread || thread->events.size() > Profiler::eventsPerThread) {
+			++nBroken;
+			continue;
+		}
+		for (size_t j = 0; j < thread->events.size(); ++j) {
+			const auto& event = thread->events[j];
+			if (event.end != event.start + 1 || (j > 0 && thread->events[j - 1].start + 1 != event.start)) {
+				++nBroken;
+				break;
+			}
+		}
+	}
+
+	stop = true;
+	writer.join();
+	EXPECT_EQ(0, nBroken);
+	EXPECT_GT(nLapped, 0);
+}
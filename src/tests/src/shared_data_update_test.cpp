@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <halley/net/session/network_session_control_messages.h>
+using namespace Halley;
+
+namespace {
+	Bytes makeState(size_t size, Random& rng)
+	{
+		Bytes result(size);
+		for (auto& b: result) {
+			b = Byte(rng.getInt(0, 255));
+		}
+		return result;
+	}
+
+	SharedDataUpdate sendAndReceive(const SharedDataUpdate& update)
+	{
+		return Deserializer::fromBytes<SharedDataUpdate>(Serializer::toBytes(update));
+	}
+}
+
+TEST(SharedDataUpdate, FullState)
+{
+	Random rng(uint32_t(1));
+	const auto state = makeState(200, rng);
+
+	const auto update = sendAndReceive(SharedDataUpdate::make(1, state, 0, nullptr, SharedDataCompression::None));
+	EXPECT_EQ(update.version, 1u);
+	EXPECT_EQ(update.baseVersion, 0u);
+	EXPECT_EQ(update.getState(nullptr), state);
+}
+
+TEST(SharedDataUpdate, Delta)
+{
+	Random rng(uint32_t(2));
+	const auto base = makeState(1000, rng);
+	auto state = base;
+	state[10] ^= 0xFF;
+	state[12] ^= 0xFF;
+	state[500] ^= 0xFF;
+	state.push_back(42);
+
+	const auto update = sendAndReceive(SharedDataUpdate::make(5, state, 3, &base, SharedDataCompression::None));
+	EXPECT_EQ(update.baseVersion, 3u);
+	EXPECT_LT(update.data.size(), 32u);
+	EXPECT_EQ(update.getState(&base), state);
+	EXPECT_THROW(update.getState(nullptr), Exception);
+
+	// Shrinking
+	state.resize(400);
+	EXPECT_EQ(SharedDataUpdate::make(6, state, 3, &base, SharedDataCompression::None).getState(&base), state);
+}
+
+TEST(SharedDataUpdate, DeltaFallsBackToFullState)
+{
+	Random rng(uint32_t(3));
+	const auto base = makeState(100, rng);
+	const auto state = makeState(100, rng);
+
+	const auto update = SharedDataUpdate::make(2, state, 1, &base, SharedDataCompression::None);
+	EXPECT_EQ(update.baseVersion, 0u);
+	EXPECT_EQ(update.getState(nullptr), state);
+}
+
+TEST(SharedDataUpdate, Compression)
+{
+	Bytes state;
+	for (int i = 0; i < 2000; ++i) {
+		state.push_back(Byte(i % 7));
+	}
+
+	for (auto compression: { SharedDataCompression::Deflate, SharedDataCompression::LZ }) {
+		const auto update = sendAndReceive(SharedDataUpdate::make(1, state, 0, nullptr, compression));
+		EXPECT_EQ(update.compression, compression);
+		EXPECT_LT(update.data.size(), state.size());
+		EXPECT_EQ(update.getState(nullptr), state);
+	}
+
+	// Not worth compressing
+	Random rng(uint32_t(4));
+	const auto noise = makeState(64, rng);
+	const auto update = SharedDataUpdate::make(1, noise, 0, nullptr, SharedDataCompression::Deflate);
+	EXPECT_EQ(update.compression, SharedDataCompression::None);
+	EXPECT_EQ(update.getState(nullptr), noise);
+}
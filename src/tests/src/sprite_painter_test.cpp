@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <algorithm>
+using namespace Halley;
+
+namespace {
+	class NullPainter final : public Painter {
+	public:
+		NullPainter(Resources& resources)
+			: Painter(resources)
+		{}
+
+		void clear(std::optional<Colour> colour, std::optional<float> depth, std::optional<uint8_t> stencil) override {}
+		void setMaterialPass(const Material& material, int pass) override {}
+		void setMaterialData(const Material& material) override {}
+
+	protected:
+		void doStartRender() override {}
+		void doEndRender() override {}
+		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, IndexType* indices, bool standardQuadsOnly) override {}
+		void drawTriangles(size_t numIndices) override {}
+		void setViewPort(Rect4i rect) override {}
+		void setClip(Rect4i rect, bool enable) override {}
+		void onUpdateProjection(Material& material) override {}
+	};
+
+	class TestRenderTarget final : public RenderTarget {
+	public:
+		Rect4i getViewPort() const override { return Rect4i(0, 0, 640, 480); }
+		bool hasColourBuffer(int attachmentNumber) const override { return true; }
+		bool hasDepthBuffer() const override { return false; }
+	};
+
+	ConfigNode makeAttribute(const String& name, const String& type, const String& semantic)
+	{
+		ConfigNode::MapType result;
+		result["name"] = ConfigNode(name);
+		result["type"] = ConfigNode(type);
+		result["semantic"] = ConfigNode(semantic);
+		return ConfigNode(std::move(result));
+	}
+
+	std::shared_ptr<MaterialDefinition> makeLineMaterial(const String& name)
+	{
+		ConfigNode::SequenceType attributes;
+		attributes.push_back(makeAttribute("colour", "vec4", "COLOUR"));
+		attributes.push_back(makeAttribute("position", "vec2", "POSITION"));
+		attributes.push_back(makeAttribute("normal", "vec2", "NORMAL"));
+		attributes.push_back(makeAttribute("width", "vec2", "WIDTH"));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(name);
+		root["attributes"] = ConfigNode(std::move(attributes));
+
+		auto result = std::make_shared<MaterialDefinition>();
+		result->load(ConfigNode(std::move(root)));
+		return result;
+	}
+
+	std::shared_ptr<MaterialDefinition> makeBaseMaterial()
+	{
+		ConfigNode::SequenceType uniforms;
+		for (const auto& [name, type]: { std::pair<String, String>("u_mvp", "mat4"), std::pair<String, String>("u_viewPortSize", "vec2") }) {
+			ConfigNode::MapType uniform;
+			uniform[name] = ConfigNode(type);
+			uniforms.push_back(ConfigNode(std::move(uniform)));
+		}
+
+		ConfigNode::MapType block;
+		block["HalleyBlock"] = ConfigNode(std::move(uniforms));
+		ConfigNode::SequenceType blocks;
+		blocks.push_back(ConfigNode(std::move(block)));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(String("Halley/MaterialBase"));
+		root["uniforms"] = ConfigNode(std::move(blocks));
+
+		auto result = std::make_shared<MaterialDefinition>();
+		result->load(ConfigNode(std::move(root)));
+		return result;
+	}
+
+	// Draws callback entries to a painter that discards everything, recording the order they were called in
+	struct TestRenderer {
+		HalleyAPI api;
+		Resources resources;
+		std::unique_ptr<NullPainter> painter;
+		TestRenderTarget target;
+		Camera camera;
+
+		TestRenderer()
+			: resources(std::unique_ptr<ResourceLocator>(), api, Resources::Options())
+			, camera(Vector2f(320, 240))
+		{
+			resources.init<MaterialDefinition>();
+			auto& materials = resources.of<MaterialDefinition>();
+			materials.setResource(0, "Halley/MaterialBase", makeBaseMaterial());
+			materials.setResource(0, "Halley/SolidLine", makeLineMaterial("Halley/SolidLine"));
+			materials.setResource(0, "Halley/SolidPolygon", makeLineMaterial("Halley/SolidPolygon"));
+			painter = std::make_unique<NullPainter>(resources);
+		}
+
+		Vector<int> draw(SpritePainter& spritePainter, int mask)
+		{
+			drawOrder.clear();
+			RenderContext(*painter, camera, target).bind([&] (Painter& p)
+			{
+				spritePainter.draw(mask, p);
+			});
+			return drawOrder;
+		}
+
+		// Filled in by the callbacks added with addEntries
+		Vector<int> drawOrder;
+	};
+
+	struct TestEntry {
+		int id;
+		int mask;
+		int layer;
+		float tieBreaker;
+	};
+
+	// Includes the awkward cases: negative layers and tie breakers, both zeros, and plenty of exact ties
+	Vector<TestEntry> makeEntries(size_t n, Random& rng)
+	{
+		const int layers[] = { std::numeric_limits<int>::min(), -1000, -1, 0, 1, 7, std::numeric_limits<int>::max() };
+		const float tieBreakers[] = { -std::numeric_limits<float>::infinity(), -1e30f, -2.5f, -1.0f, -0.0f, 0.0f, 1e-30f, 1.0f, 2.5f, 1e30f };
+
+		Vector<TestEntry> result;
+		for (size_t i = 0; i < n; ++i) {
+			TestEntry entry;
+			entry.id = int(i);
+			entry.mask = rng.getInt(1, 3);
+			entry.layer = layers[rng.getInt(0, int(std::size(layers)) - 1)];
+			entry.tieBreaker = rng.getInt(0, 3) == 0 ? rng.getFloat(-100.0f, 100.0f) : tieBreakers[rng.getInt(0, int(std::size(tieBreakers)) - 1)];
+			result.push_back(entry);
+		}
+		return result;
+	}
+
+	void addEntries(SpritePainter& painter, const Vector<TestEntry>& entries, TestRenderer& renderer)
+	{
+		painter.start();
+		for (const auto& e: entries) {
+			const int id = e.id;
+			painter.add([id, &renderer] (Painter&) { renderer.drawOrder.push_back(id); }, e.mask, e.layer, e.tieBreaker);
+		}
+	}
+
+	// The order given by comparing entries with SpritePainterEntry::operator<
+	Vector<int> getExpectedOrder(const Vector<TestEntry>& entries, int mask)
+	{
+		Vector<SpritePainterEntry> sorted;
+		for (const auto& e: entries) {
+			if ((e.mask & mask) != 0) {
+				sorted.push_back(SpritePainterEntry(SpritePainterEntryType::Callback, size_t(e.id), 1, e.mask, e.layer, e.tieBreaker, size_t(e.id), {}));
+			}
+		}
+		std::sort(sorted.begin(), sorted.end());
+
+		Vector<int> result;
+		for (const auto& e: sorted) {
+			result.push_back(int(e.getIndex()));
+		}
+		return result;
+	}
+}
+
+TEST(HalleySpritePainter, SortMatchesEntryOrder)
+{
+	TestRenderer renderer;
+	SpritePainter painter;
+	Random rng(uint32_t(4321));
+
+	// Small draws are sorted with a comparison sort, large ones with the radix sort
+	for (const size_t n: { 10, 63, 64, 500, 5000 }) {
+		for (int round = 0; round < 4; ++round) {
+			const auto entries = makeEntries(n, rng);
+			addEntries(painter, entries, renderer);
+			for (const int mask: { 1, 2, 3 }) {
+				EXPECT_EQ(getExpectedOrder(entries, mask), renderer.draw(painter, mask)) << n << " entries, mask " << mask;
+			}
+		}
+	}
+}
+
+TEST(HalleySpritePainter, SortCacheFollowsChanges)
+{
+	TestRenderer renderer;
+	SpritePainter painter;
+	Random rng(uint32_t(1234));
+	auto entries = makeEntries(300, rng);
+
+	// The same entries again reuse the previous order, for every mask
+	addEntries(painter, entries, renderer);
+	const auto first1 = renderer.draw(painter, 1);
+	const auto first3 = renderer.draw(painter, 3);
+	addEntries(painter, entries, renderer);
+	EXPECT_EQ(first1, renderer.draw(painter, 1));
+	EXPECT_EQ(first3, renderer.draw(painter, 3));
+	EXPECT_EQ(getExpectedOrder(entries, 1), first1);
+
+	// Any change to a key, or to which entries are there, has to be sorted again
+	std::swap(entries[10].tieBreaker, entries[200].tieBreaker);
+	entries[20].layer = -5;
+	addEntries(painter, entries, renderer);
+	EXPECT_EQ(getExpectedOrder(entries, 1), renderer.draw(painter, 1));
+	EXPECT_EQ(getExpectedOrder(entries, 3), renderer.draw(painter, 3));
+
+	entries.erase(entries.begin() + 50);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		entries[i].id = int(i);
+	}
+	addEntries(painter, entries, renderer);
+	EXPECT_EQ(getExpectedOrder(entries, 1), renderer.draw(painter, 1));
+	EXPECT_EQ(getExpectedOrder(entries, 3), renderer.draw(painter, 3));
+}
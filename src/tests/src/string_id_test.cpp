@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <cstring>
+#include <thread>
+using namespace Halley;
+
+TEST(HalleyStringId, Hashing)
+{
+	constexpr StringId literal("Halley/Sprite");
+	static_assert(literal.getValue() == StringId::hash("Halley/Sprite", 13));
+	static_assert(StringId() == StringId(""));
+
+	const auto fromString = StringId(String("Halley/Sprite"));
+	EXPECT_EQ(literal, fromString);
+	EXPECT_EQ(fromString, StringId(std::string("Halley/Sprite")));
+	EXPECT_NE(literal, StringId("Halley/Text"));
+	EXPECT_EQ(std::hash<StringId>()(literal), std::hash<StringId>()(fromString));
+
+	EXPECT_EQ(literal.getString(), "Halley/Sprite");
+	EXPECT_EQ(fromString.getString(), "Halley/Sprite");
+	EXPECT_EQ(fromString.length(), 13);
+	EXPECT_TRUE(StringId().isEmpty());
+}
+
+TEST(HalleyStringId, CharArrays)
+{
+	// Arrays that aren't constants are interned, only up to their first null
+	char buffer[32] = "Halley/Sprite";
+	const auto id = StringId(buffer);
+	strcpy(buffer, "Something else");
+
+	EXPECT_EQ(id, StringId("Halley/Sprite"));
+	EXPECT_EQ(id.length(), 13);
+	EXPECT_EQ(id.getString(), "Halley/Sprite");
+	EXPECT_EQ(id.c_str(), StringId(String("Halley/Sprite")).c_str());
+
+	// Literals used outside of a constant expression are interned as well
+	EXPECT_EQ(StringId("Halley/Text").c_str(), StringId(String("Halley/Text")).c_str());
+}
+
+TEST(HalleyStringId, Interning)
+{
+	// Interned copies outlive the strings they were made from, and are shared by every id with the same text
+	const char* interned;
+	{
+		const auto id = StringId(String("string_id_test"));
+		interned = id.c_str();
+	}
+	const auto nInterned = StringId::getNumInterned();
+	EXPECT_EQ(StringId(String("string_id_test")).c_str(), interned);
+	EXPECT_EQ(StringId::getNumInterned(), nInterned);
+
+	// Many threads interning the same strings at once all agree on them
+	Vector<std::thread> threads;
+	Vector<Vector<const char*>> results(8);
+	for (size_t t = 0; t < results.size(); ++t) {
+		threads.emplace_back([&, t] ()
+		{
+			for (int i = 0; i < 1000; ++i) {
+				results[t].push_back(StringId(String("string_id_test_") + toString(i)).c_str());
+			}
+		});
+	}
+	for (auto& t: threads) {
+		t.join();
+	}
+
+	EXPECT_EQ(StringId::getNumInterned(), nInterned + 1000);
+	for (size_t t = 1; t < results.size(); ++t) {
+		EXPECT_EQ(results[t], results[0]);
+	}
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace Halley;
+
+namespace {
+	class TestCoreAPI final : public CoreAPI {
+	public:
+		void quit(int exitCode) override {}
+		void setStage(StageID stage) override {}
+		void setStage(std::unique_ptr<Stage> stage) override {}
+		void initStage(Stage& stage) override {}
+		Stage& getCurrentStage() override { throw Exception("No stage", HalleyExceptions::Core); }
+		HalleyStatics& getStatics() override { throw Exception("No statics", HalleyExceptions::Core); }
+		const Environment& getEnvironment() override { throw Exception("No environment", HalleyExceptions::Core); }
+		int64_t getTime(CoreAPITimer timer, TimeLine tl, StopwatchRollingAveraging::Mode mode) const override { return 0; }
+		void setTimerPaused(CoreAPITimer timer, TimeLine tl, bool paused) override {}
+		bool isDevMode() override { return false; }
+	};
+
+	class TestSystem final : public System {
+	public:
+		TestSystem(SystemAccessSignature access, std::function<void()> onUpdate)
+			: System({}, {})
+			, onUpdate(std::move(onUpdate))
+		{
+			setAccessSignature(std::move(access));
+		}
+
+	protected:
+		void updateBase(Time) override
+		{
+			onUpdate();
+		}
+
+	private:
+		std::function<void()> onUpdate;
+	};
+
+	// A world running its systems on a two thread CPU pool
+	struct TestWorld {
+		TestCoreAPI core;
+		HalleyAPI api;
+		std::unique_ptr<Resources> resources;
+		std::unique_ptr<World> world;
+
+		TestWorld()
+		{
+			// Shared by every test, as a queue can't be reused once its pool stops, and other code may check Executors::hasInstance()
+			static Executors executors;
+			Executors::setInstance(executors);
+			static ThreadPool threadPool("test", Executors::getCPU(), 2, [] (String name, std::function<void()> f) { return std::thread(std::move(f)); });
+
+			api.core = &core;
+			resources = std::make_unique<Resources>(std::unique_ptr<ResourceLocator>(), api, Resources::Options());
+			world = std::make_unique<World>(api, *resources, false, CreateComponentFunction());
+			world->setParallelSystemsEnabled(true);
+		}
+
+		~TestWorld()
+		{
+			world.reset();
+		}
+
+		void addSystem(SystemAccessSignature access, std::function<void()> onUpdate)
+		{
+			world->addSystem(std::make_unique<TestSystem>(std::move(access), std::move(onUpdate)), TimeLine::FixedUpdate);
+		}
+	};
+
+	SystemAccessSignature reads(Vector<int> components)
+	{
+		return SystemAccessSignature(std::move(components), {}, {}, false, false);
+	}
+
+	SystemAccessSignature writes(Vector<int> components)
+	{
+		return SystemAccessSignature({}, std::move(components), {}, false, false);
+	}
+
+	// Returns true once count systems have arrived, or false if that didn't happen while this one was waiting
+	bool meet(std::atomic<int>& arrived, int count)
+	{
+		++arrived;
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (arrived < count) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+
+TEST(SystemScheduler, Conflicts)
+{
+	EXPECT_TRUE(SystemAccessSignature().conflictsWith(reads({ 1 })));
+	EXPECT_TRUE(reads({ 1 }).conflictsWith(SystemAccessSignature()));
+
+	EXPECT_FALSE(reads({ 1, 2 }).conflictsWith(reads({ 1, 2 })));
+	EXPECT_FALSE(writes({ 1 }).conflictsWith(writes({ 2 })));
+	EXPECT_TRUE(writes({ 1 }).conflictsWith(reads({ 2, 1 })));
+	EXPECT_TRUE(reads({ 2, 1 }).conflictsWith(writes({ 1 })));
+	EXPECT_TRUE(writes({ 1 }).conflictsWith(writes({ 1 })));
+
+	const auto api = SystemAccessSignature({}, {}, { "api" }, false, false);
+	EXPECT_TRUE(api.conflictsWith(SystemAccessSignature({ 3 }, {}, { "api" }, false, false)));
+	EXPECT_FALSE(api.conflictsWith(SystemAccessSignature({}, {}, { "resources" }, false, false)));
+
+	const auto messages = SystemAccessSignature({ 1 }, {}, {}, false, true);
+	EXPECT_TRUE(messages.conflictsWith(SystemAccessSignature({ 2 }, {}, {}, false, true)));
+	EXPECT_FALSE(messages.conflictsWith(reads({ 2 })));
+}
+
+TEST(SystemScheduler, RunsStagesInOrder)
+{
+	TestWorld test;
+
+	std::atomic<int> arrived = 0;
+	std::atomic<int> firstStageDone = 0;
+	std::atomic<bool> readersMet[2] = { false, false };
+	bool writerSawReaders = false;
+	bool exclusiveSawAll = false;
+
+	// Both readers (and the unrelated system) share the first stage, and must be running at the same time
+	test.addSystem(reads({ 1 }), [&] () { readersMet[0] = meet(arrived, 2); ++firstStageDone; });
+	test.addSystem(reads({ 1 }), [&] () { readersMet[1] = meet(arrived, 2); ++firstStageDone; });
+	test.addSystem(reads({ 2 }), [&] () { ++firstStageDone; });
+
+	// The writer has to wait for both readers, and the exclusive system for everyone
+	test.addSystem(writes({ 1 }), [&] () { writerSawReaders = firstStageDone == 3; });
+	test.addSystem(SystemAccessSignature(), [&] () { exclusiveSawAll = writerSawReaders && firstStageDone == 3; });
+
+	test.world->step(TimeLine::FixedUpdate, 0.016);
+
+	EXPECT_TRUE(readersMet[0]);
+	EXPECT_TRUE(readersMet[1]);
+	EXPECT_TRUE(writerSawReaders);
+	EXPECT_TRUE(exclusiveSawAll);
+}
+
+TEST(SystemScheduler, RethrowsWorkerExceptions)
+{
+	TestWorld test;
+
+	std::atomic<int> arrived = 0;
+	bool laterStageRan = false;
+
+	// The first system of a stage runs on the calling thread, so the second one is the one on a worker
+	test.addSystem(reads({ 1 }), [&] () { meet(arrived, 2); });
+	test.addSystem(reads({ 1 }), [&] ()
+	{
+		meet(arrived, 2);
+		throw Exception("Failed on worker", HalleyExceptions::Entity);
+	});
+	test.addSystem(writes({ 1 }), [&] () { laterStageRan = true; });
+
+	EXPECT_THROW(test.world->step(TimeLine::FixedUpdate, 0.016), Exception);
+	EXPECT_EQ(2, arrived);
+	EXPECT_FALSE(laterStageRan);
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+namespace {
+	// Records the sprite vertices that would have been sent to the GPU
+	class RecordingPainter final : public Painter {
+	public:
+		Vector<SpriteVertexAttrib> vertices;
+
+		RecordingPainter(Resources& resources)
+			: Painter(resources)
+		{}
+
+		void clear(std::optional<Colour> colour, std::optional<float> depth, std::optional<uint8_t> stencil) override {}
+		void setMaterialPass(const Material& material, int pass) override {}
+		void setMaterialData(const Material& material) override {}
+
+	protected:
+		void doStartRender() override {}
+		void doEndRender() override {}
+		void setViewPort(Rect4i rect) override {}
+		void setClip(Rect4i rect, bool enable) override {}
+		void onUpdateProjection(Material& material) override {}
+		void drawTriangles(size_t numIndices) override {}
+
+		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, IndexType* indices, bool standardQuadsOnly) override
+		{
+			// Each sprite is written as four vertices, only the first of which is kept
+			const auto* src = static_cast<const SpriteVertexAttrib*>(vertexData);
+			for (size_t i = 0; i < numVertices; i += 4) {
+				vertices.push_back(src[i]);
+			}
+		}
+	};
+
+	class TestRenderTarget final : public RenderTarget {
+	public:
+		Rect4i getViewPort() const override { return Rect4i(0, 0, 640, 480); }
+		bool hasColourBuffer(int attachmentNumber) const override { return true; }
+		bool hasDepthBuffer() const override { return false; }
+	};
+
+	ConfigNode makeAttribute(const String& name, const String& type, const String& semantic)
+	{
+		ConfigNode::MapType result;
+		result["name"] = ConfigNode(name);
+		result["type"] = ConfigNode(type);
+		result["semantic"] = ConfigNode(semantic);
+		return ConfigNode(std::move(result));
+	}
+
+	std::shared_ptr<MaterialDefinition> makeMaterial(const String& name, const Vector<std::array<const char*, 3>>& attributes)
+	{
+		ConfigNode::SequenceType attributeNodes;
+		for (const auto& a: attributes) {
+			attributeNodes.push_back(makeAttribute(a[0], a[1], a[2]));
+		}
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(name);
+		root["attributes"] = ConfigNode(std::move(attributeNodes));
+
+		auto result = std::make_shared<MaterialDefinition>();
+		result->load(ConfigNode(std::move(root)));
+		return result;
+	}
+
+	std::shared_ptr<MaterialDefinition> makeBaseMaterial()
+	{
+		ConfigNode::SequenceType uniforms;
+		for (const auto& [name, type]: { std::pair<String, String>("u_mvp", "mat4"), std::pair<String, String>("u_viewPortSize", "vec2") }) {
+			ConfigNode::MapType uniform;
+			uniform[name] = ConfigNode(type);
+			uniforms.push_back(ConfigNode(std::move(uniform)));
+		}
+
+		ConfigNode::MapType block;
+		block["HalleyBlock"] = ConfigNode(std::move(uniforms));
+		ConfigNode::SequenceType blocks;
+		blocks.push_back(ConfigNode(std::move(block)));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(String("Halley/MaterialBase"));
+		root["uniforms"] = ConfigNode(std::move(blocks));
+
+		auto result = std::make_shared<MaterialDefinition>();
+		result->load(ConfigNode(std::move(root)));
+		return result;
+	}
+
+	// Matches SpriteVertexAttrib, see shared_assets/material/sprite_base.yaml
+	std::shared_ptr<MaterialDefinition> makeSpriteMaterial()
+	{
+		return makeMaterial("Halley/Sprite", {
+			{ "vertPos", "vec4", "VERTPOS" },
+			{ "position", "vec2", "POSITION" },
+			{ "pivot", "vec2", "PIVOT" },
+			{ "size", "vec2", "SIZE" },
+			{ "scale", "vec2", "SCALE" },
+			{ "colour", "vec4", "COLOUR" },
+			{ "texCoord0", "vec4", "TEXCOORD0" },
+			{ "texCoord1", "vec4", "TEXCOORD1" },
+			{ "custom0", "vec4", "CUSTOM0" },
+			{ "custom1", "vec4", "CUSTOM1" },
+			{ "rotation", "float", "ROTATION" },
+			{ "textureRotation", "float", "TEXTUREROTATION" }
+		});
+	}
+
+	struct TestRenderer {
+		HalleyAPI api;
+		Resources resources;
+		std::unique_ptr<RecordingPainter> painter;
+		TestRenderTarget target;
+		Camera camera;
+		std::shared_ptr<Font> font;
+
+		TestRenderer()
+			: resources(std::unique_ptr<ResourceLocator>(), api, Resources::Options())
+			, camera(Vector2f(320, 240))
+		{
+			resources.init<MaterialDefinition>();
+			auto& materials = resources.of<MaterialDefinition>();
+			materials.setResource(0, "Halley/MaterialBase", makeBaseMaterial());
+			const auto lineAttributes = Vector<std::array<const char*, 3>>{ { "colour", "vec4", "COLOUR" }, { "position", "vec2", "POSITION" }, { "normal", "vec2", "NORMAL" }, { "width", "vec2", "WIDTH" } };
+			materials.setResource(0, "Halley/SolidLine", makeMaterial("Halley/SolidLine", lineAttributes));
+			materials.setResource(0, "Halley/SolidPolygon", makeMaterial("Halley/SolidPolygon", lineAttributes));
+			painter = std::make_unique<RecordingPainter>(resources);
+
+			// A 20pt bitmap font, where every glyph is a box as wide as it advances
+			font = std::make_shared<Font>("test", "test.png", 16.0f, 24.0f, 20.0f, 1.0f, Vector2i(256, 256));
+			font->setMaterial(std::make_shared<Material>(makeSpriteMaterial()));
+			for (const int c: { 0, int('a'), int('b') }) {
+				setGlyphWidth(c, 10.0f);
+			}
+		}
+
+		// Changes the font behind the text renderer's back, so only glyphs laid out again pick it up
+		void setGlyphWidth(int c, float width)
+		{
+			font->addGlyph(Font::Glyph(c, Rect4f(0, 0, width / 256.0f, 20.0f / 256.0f), Vector2f(width, 20), Vector2f(0, 16), Vector2f(), Vector2f(width, 0)));
+		}
+
+		Vector<SpriteVertexAttrib> draw(const TextRenderer& text)
+		{
+			painter->vertices.clear();
+			RenderContext(*painter, camera, target).bind([&] (Painter& p)
+			{
+				text.draw(p);
+			});
+			return painter->vertices;
+		}
+	};
+}
+
+TEST(HalleyTextRenderer, VerticesFollowChanges)
+{
+	TestRenderer renderer;
+	ASSERT_EQ(sizeof(SpriteVertexAttrib), renderer.font->getMaterial()->getDefinition().getVertexStride());
+
+	TextRenderer text(renderer.font, "ab", 20, Colour4f(1, 1, 1, 1));
+	const auto first = renderer.draw(text);
+	ASSERT_EQ(2, first.size());
+	EXPECT_EQ(Vector2f(10, 20), first[0].size);
+	EXPECT_EQ(10.0f, first[1].pos.x - first[0].pos.x);
+
+	// Unchanged text draws the vertices it already had, even though the font has changed since
+	renderer.setGlyphWidth('a', 30.0f);
+	const auto reused = renderer.draw(text);
+	ASSERT_EQ(2, reused.size());
+	EXPECT_EQ(Vector2f(10, 20), reused[0].size);
+	EXPECT_EQ(first[1].pos, reused[1].pos);
+
+	// Setting the same values again, or moving the text, still doesn't lay it out again
+	text.setText("ab").setSize(20).setColour(Colour4f(1, 1, 1, 1)).setPosition(Vector2f(100, 50));
+	const auto moved = renderer.draw(text);
+	ASSERT_EQ(2, moved.size());
+	EXPECT_EQ(Vector2f(10, 20), moved[0].size);
+	EXPECT_EQ(first[0].pos + Vector2f(100, 50), moved[0].pos);
+	EXPECT_EQ(first[1].pos + Vector2f(100, 50), moved[1].pos);
+
+	// A new colour lays out the glyphs again, picking up the wider 'a'
+	text.setColour(Colour4f(1, 0, 0, 1));
+	const auto recoloured = renderer.draw(text);
+	ASSERT_EQ(2, recoloured.size());
+	EXPECT_EQ(Colour4f(1, 0, 0, 1), recoloured[0].colour);
+	EXPECT_EQ(Vector2f(30, 20), recoloured[0].size);
+	EXPECT_EQ(30.0f, recoloured[1].pos.x - recoloured[0].pos.x);
+	EXPECT_EQ(Vector2f(100, 50), recoloured[0].pos - first[0].pos);
+
+	// So does a new size
+	renderer.setGlyphWidth('a', 10.0f);
+	text.setSize(40);
+	const auto resized = renderer.draw(text);
+	ASSERT_EQ(2, resized.size());
+	EXPECT_EQ(Vector2f(10, 20), resized[0].size);
+	EXPECT_EQ(Vector2f(2, 2), resized[0].scale);
+	EXPECT_EQ(20.0f, resized[1].pos.x - resized[0].pos.x);
+
+	// And new text, with the colour and size carried over
+	renderer.setGlyphWidth('b', 5.0f);
+	text.setText("bab");
+	const auto retexted = renderer.draw(text);
+	ASSERT_EQ(3, retexted.size());
+	EXPECT_EQ(Vector2f(5, 20), retexted[0].size);
+	EXPECT_EQ(Vector2f(10, 20), retexted[1].size);
+	EXPECT_EQ(Colour4f(1, 0, 0, 1), retexted[2].colour);
+	EXPECT_EQ(Vector2f(2, 2), retexted[2].scale);
+}
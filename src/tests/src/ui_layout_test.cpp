@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+namespace {
+	class TestInputAPI final : public InputAPI {
+	public:
+		size_t getNumberOfKeyboards() const override { return 0; }
+		std::shared_ptr<InputKeyboard> getKeyboard(int id) const override { return {}; }
+		size_t getNumberOfJoysticks() const override { return 0; }
+		std::shared_ptr<InputJoystick> getJoystick(int id) const override { return {}; }
+		size_t getNumberOfMice() const override { return 0; }
+		std::shared_ptr<InputDevice> getMouse(int id) const override { return {}; }
+		Vector<std::shared_ptr<InputTouch>> getNewTouchEvents() override { return {}; }
+		Vector<std::shared_ptr<InputTouch>> getTouchEvents() override { return {}; }
+		void setMouseRemapping(std::function<Vector2f(Vector2i)> remapFunction) override {}
+	};
+
+	struct TestUI {
+		TestInputAPI input;
+		HalleyAPI api;
+		std::unique_ptr<UIRoot> root;
+
+		TestUI()
+		{
+			// Only input is used, the rest must not be left dangling
+			api.input = &input;
+			api.platform = nullptr;
+			api.audio = nullptr;
+			root = std::make_unique<UIRoot>(api, Rect4f(0, 0, 800, 600));
+		}
+
+		// Spawns pending widgets, as UIRoot::update would
+		void spawn()
+		{
+			root->addNewChildren(UIInputType::Mouse);
+			root->descend([] (const std::shared_ptr<UIWidget>& widget)
+			{
+				widget->addNewChildren(UIInputType::Mouse);
+			}, true, true);
+		}
+
+		UILayoutStats runLayout()
+		{
+			const auto before = root->getLayoutStats();
+			root->runLayout();
+			const auto& after = root->getLayoutStats();
+			UILayoutStats result;
+			result.passes = after.passes - before.passes;
+			result.nodesVisited = after.nodesVisited - before.nodesVisited;
+			result.nodesLaidOut = after.nodesLaidOut - before.nodesLaidOut;
+			return result;
+		}
+	};
+}
+
+TEST(HalleyUILayout, StatsTrackDirtyBranch)
+{
+	TestUI ui;
+	auto panel = std::make_shared<UIWidget>("panel", Vector2f(), UISizer(UISizerType::Vertical, 0));
+	auto a = std::make_shared<UIWidget>("a", Vector2f(), UISizer());
+	auto a1 = std::make_shared<UIWidget>("a1", Vector2f(50, 20));
+	auto b = std::make_shared<UIWidget>("b", Vector2f(), UISizer());
+	auto b1 = std::make_shared<UIWidget>("b1", Vector2f(50, 20));
+	ui.root->addChild(panel);
+	panel->add(a);
+	panel->add(b);
+	a->add(a1);
+	b->add(b1);
+	ui.spawn();
+
+	const auto first = ui.runLayout();
+	EXPECT_EQ(1, first.passes);
+	EXPECT_EQ(5, first.nodesVisited);
+	EXPECT_EQ(5, first.nodesLaidOut);
+	EXPECT_EQ(Vector2f(0, 20), b1->getPosition());
+
+	// Nothing changed, so every widget is visited but none re-lays out its contents
+	const auto idle = ui.runLayout();
+	EXPECT_EQ(5, idle.nodesVisited);
+	EXPECT_EQ(0, idle.nodesLaidOut);
+
+	// Growing b1 dirties its ancestors, and a is stretched to the new panel width, but a1 is left as it was
+	b1->setMinSize(Vector2f(80, 40));
+	const auto grown = ui.runLayout();
+	EXPECT_EQ(5, grown.nodesVisited);
+	EXPECT_EQ(4, grown.nodesLaidOut);
+	EXPECT_EQ(Vector2f(80, 40), b1->getSize());
+	EXPECT_EQ(Vector2f(80, 40), b->getSize());
+	EXPECT_EQ(Vector2f(80, 20), a->getSize());
+	EXPECT_EQ(Vector2f(50, 20), a1->getSize());
+	EXPECT_EQ(Vector2f(0, 0), a1->getPosition());
+	EXPECT_EQ(Vector2f(80, 60), panel->getSize());
+}
+
+TEST(HalleyUILayout, ChildUnderCleanParentIsLaidOut)
+{
+	TestUI ui;
+	auto panel = std::make_shared<UIWidget>("panel", Vector2f(), UISizer(UISizerType::Vertical, 0));
+	auto pane = std::make_shared<UIScrollPane>("pane", Vector2f(100, 50), UISizer(UISizerType::Vertical, 0), false, true);
+	auto item = std::make_shared<UIWidget>("item", Vector2f(100, 200));
+	ui.root->addChild(panel);
+	panel->add(pane);
+	pane->add(item);
+	ui.spawn();
+
+	ui.runLayout();
+	pane->refresh();
+	ASSERT_EQ(Vector2f(100, 50), pane->getSize());
+	EXPECT_EQ(Vector2f(0, 0), item->getPosition());
+
+	// Scrolling moves the pane's contents without marking anything, so only the pane and its contents are laid out again
+	pane->scrollTo(Vector2f(0, 30));
+	const auto stats = ui.runLayout();
+	EXPECT_EQ(Vector2f(0, -30), item->getPosition());
+	EXPECT_EQ(3, stats.nodesVisited);
+	EXPECT_EQ(2, stats.nodesLaidOut);
+}
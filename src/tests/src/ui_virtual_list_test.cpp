@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+namespace {
+	class TestInputAPI final : public InputAPI {
+	public:
+		size_t getNumberOfKeyboards() const override { return 0; }
+		std::shared_ptr<InputKeyboard> getKeyboard(int id) const override { return {}; }
+		size_t getNumberOfJoysticks() const override { return 0; }
+		std::shared_ptr<InputJoystick> getJoystick(int id) const override { return {}; }
+		size_t getNumberOfMice() const override { return 0; }
+		std::shared_ptr<InputDevice> getMouse(int id) const override { return {}; }
+		Vector<std::shared_ptr<InputTouch>> getNewTouchEvents() override { return {}; }
+		Vector<std::shared_ptr<InputTouch>> getTouchEvents() override { return {}; }
+		void setMouseRemapping(std::function<Vector2f(Vector2i)> remapFunction) override {}
+	};
+
+	class TestDataSource final : public IUIVirtualListDataSource {
+	public:
+		constexpr static float rowHeight = 20.0f;
+
+		size_t nRows = 1000;
+		int nMade = 0;
+		HashMap<const UIWidget*, size_t> boundTo;
+
+		size_t getNumRows() const override
+		{
+			return nRows;
+		}
+
+		std::shared_ptr<UIWidget> makeRow() override
+		{
+			++nMade;
+			return std::make_shared<UIWidget>("row" + toString(nMade), Vector2f(50, rowHeight));
+		}
+
+		void bindRow(UIWidget& row, size_t index) override
+		{
+			boundTo[&row] = index;
+		}
+	};
+
+	// A virtual list inside a scroll pane showing five rows at a time
+	struct TestUI {
+		TestInputAPI input;
+		HalleyAPI api;
+		std::unique_ptr<UIRoot> root;
+		std::shared_ptr<TestDataSource> data;
+		std::shared_ptr<UIScrollPane> pane;
+		std::shared_ptr<UIVirtualList> list;
+
+		TestUI()
+		{
+			// Only input is used, the rest must not be left dangling
+			api.input = &input;
+			api.platform = nullptr;
+			api.audio = nullptr;
+			root = std::make_unique<UIRoot>(api, Rect4f(0, 0, 800, 600));
+			data = std::make_shared<TestDataSource>();
+			pane = std::make_shared<UIScrollPane>("pane", Vector2f(100, 5 * TestDataSource::rowHeight), UISizer(UISizerType::Vertical, 0), false, true);
+			list = std::make_shared<UIVirtualList>("list", TestDataSource::rowHeight, data);
+			root->addChild(pane);
+			pane->add(list);
+		}
+
+		// Updates and lays out a few times, as UIRoot::update would over a few frames
+		void step()
+		{
+			for (int i = 0; i < 3; ++i) {
+				root->addNewChildren(UIInputType::Mouse);
+				for (auto& c: root->getChildren()) {
+					c->doUpdate(UIWidgetUpdateType::Full, 0.016, UIInputType::Mouse, JoystickType::Generic);
+				}
+				root->runLayout();
+			}
+		}
+
+		// Checks that every row in the visible range has a widget bound to it, placed where the list says
+		void checkRows()
+		{
+			const auto [first, last] = list->getVisibleRows();
+			for (size_t i = first; i < last; ++i) {
+				const auto widget = list->getRowWidget(i);
+				ASSERT_NE(widget, nullptr) << i;
+				EXPECT_TRUE(widget->isActive()) << i;
+				EXPECT_EQ(i, data->boundTo.at(widget.get())) << i;
+				EXPECT_EQ(list->getPosition().y + list->getRowRect(i).getTop(), widget->getPosition().y) << i;
+			}
+		}
+	};
+}
+
+TEST(HalleyUIVirtualList, BindsVisibleRows)
+{
+	TestUI ui;
+	ui.step();
+
+	// Five visible rows, plus the one past the bottom edge of the pane
+	EXPECT_EQ(std::make_pair(size_t(0), size_t(6)), ui.list->getVisibleRows());
+	EXPECT_EQ(6, ui.data->nMade);
+	EXPECT_EQ(1000 * TestDataSource::rowHeight, ui.list->getSize().y);
+	EXPECT_EQ(nullptr, ui.list->getRowWidget(6));
+	ui.checkRows();
+}
+
+TEST(HalleyUIVirtualList, RecyclesRowsWhenScrolled)
+{
+	TestUI ui;
+	ui.step();
+	const auto initialWidgets = ui.list->getChildren();
+
+	// Rows 25 to 29 are in view, with one more on either side
+	ui.pane->scrollTo(Vector2f(0, 25 * TestDataSource::rowHeight));
+	ui.step();
+	EXPECT_EQ(std::make_pair(size_t(24), size_t(31)), ui.list->getVisibleRows());
+	EXPECT_EQ(nullptr, ui.list->getRowWidget(0));
+	ui.checkRows();
+
+	// Only the one extra row needed a new widget, the rest were taken from the rows that scrolled out of view
+	EXPECT_EQ(7, ui.data->nMade);
+	EXPECT_EQ(7u, ui.list->getChildren().size());
+	for (const auto& widget: initialWidgets) {
+		EXPECT_TRUE(widget->isActive());
+		EXPECT_GE(ui.data->boundTo.at(widget.get()), 24u);
+	}
+
+	// Scrolling far away and back still doesn't make any more
+	ui.pane->scrollTo(Vector2f(0, 900 * TestDataSource::rowHeight));
+	ui.step();
+	ui.pane->scrollTo(Vector2f(0, 0));
+	ui.step();
+	EXPECT_EQ(std::make_pair(size_t(0), size_t(6)), ui.list->getVisibleRows());
+	EXPECT_EQ(7, ui.data->nMade);
+	ui.checkRows();
+}
@@ -99,6 +99,9 @@ namespace Halley
 		virtual void import(const ImportingAsset&, IAssetCollector&) {}
 		virtual int dropFrontCount() const { return importByExtension ? 0 : 1; }
 
+		// Bump this whenever the output of the importer changes, so cached imports made by older versions are discarded
+		virtual int getVersion() const { return 0; }
+
 		virtual String getAssetId(const Path& file, const std::optional<Metadata>& metadata) const
 		{
 			return file.dropFront(dropFrontCount()).string();
@@ -2,6 +2,21 @@
 #include "halley/plugin/iasset_importer.h"
 
 namespace Halley {
+	// A file read by an importer through readAdditionalFile, e.g. the shaders of a material
+	class AssetDependency
+	{
+	public:
+		Path path;
+		int64_t timestamp = 0;
+		uint64_t hash = 0;
+
+		AssetDependency() = default;
+		AssetDependency(Path path, int64_t timestamp, uint64_t hash);
+
+		void serialize(Serializer& s) const;
+		void deserialize(Deserializer& s);
+	};
+
 	class AssetCollector final : public IAssetCollector
 	{
 	public:
@@ -19,7 +34,7 @@ namespace Halley {
 		std::vector<ImportingAsset> collectAdditionalAssets();
 		std::vector<std::pair<Path, Bytes>> collectOutFiles();
 		const std::vector<AssetResource>& getAssets() const;
-		const std::vector<TimestampedPath>& getAdditionalInputs() const;
+		const std::vector<AssetDependency>& getAdditionalInputs() const;
 		
 	private:
 		const ImportingAsset& asset;
@@ -29,7 +44,7 @@ namespace Halley {
 
 		std::vector<AssetResource> assets;
 		std::vector<ImportingAsset> additionalAssets;
-		std::vector<TimestampedPath> additionalInputs;
+		std::vector<AssetDependency> additionalInputs;
 		std::vector<std::pair<Path, Bytes>> outFiles;
 	};
 }
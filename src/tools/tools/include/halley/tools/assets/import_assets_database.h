@@ -2,10 +2,12 @@
 #include "halley/file/path.h"
 #include <map>
 #include <mutex>
+#include <set>
 #include "halley/text/halleystring.h"
 #include <cstdint>
 #include <utility>
 #include "asset_importer.h"
+#include "asset_collector.h"
 #include "halley/core/resources/asset_database.h"
 
 namespace Halley
@@ -17,19 +19,20 @@ namespace Halley
 	class AssetPath {
 	public:
 		AssetPath();
-		AssetPath(TimestampedPath path);
-		AssetPath(TimestampedPath path, Path dataPath);
+		AssetPath(Path path, uint64_t hash);
+		AssetPath(Path path, uint64_t hash, Path dataPath);
 
 		const Path& getPath() const;
 		const Path& getDataPath() const;
-		int64_t getTimestamp() const;
+		uint64_t getHash() const;
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
 
 	private:
-		TimestampedPath path;
+		Path path;
 		Path dataPath;
+		uint64_t hash = 0; // Contents of the file and of its meta files
 	};
 	
 	class ImportAssetsDatabaseEntry
@@ -38,16 +41,16 @@ namespace Halley
 		String assetId;
 		Path srcDir;
 		std::vector<AssetPath> inputFiles;
-		std::vector<TimestampedPath> additionalInputFiles; // These were requested by the importer, rather than enumerated directly
+		std::vector<AssetDependency> additionalInputFiles; // These were requested by the importer, rather than enumerated directly
 		std::vector<AssetResource> outputFiles;
 		ImportAssetType assetType = ImportAssetType::Undefined;
 
 		ImportAssetsDatabaseEntry() {}
 
-		ImportAssetsDatabaseEntry(String assetId, Path srcDir, const Path& inputFile, int64_t time)
+		ImportAssetsDatabaseEntry(String assetId, Path srcDir, const Path& inputFile, uint64_t hash)
 			: assetId(std::move(assetId))
 			, srcDir(std::move(srcDir))
-			, inputFiles({ TimestampedPath(inputFile, time) })
+			, inputFiles({ AssetPath(inputFile, hash) })
 		{}
 
 		ImportAssetsDatabaseEntry(String assetId, Path srcDir)
@@ -80,6 +83,7 @@ namespace Halley
 		{
 		public:
 			std::array<int64_t, 3> timestamp;
+			uint64_t hash = 0;
 			Metadata metadata;
 			Path basePath;
 			bool missing = false; // Not serialized
@@ -88,6 +92,18 @@ namespace Halley
 			void deserialize(Deserializer& s);
 		};
 
+		// A file read by importers, shared by every asset that depends on it
+		class DependencyEntry
+		{
+		public:
+			int64_t timestamp = 0;
+			uint64_t hash = 0;
+			std::set<String> dependents; // Not serialized, rebuilt from the imported assets
+
+			void serialize(Serializer& s) const;
+			void deserialize(Deserializer& s);
+		};
+
 	public:
 		ImportAssetsDatabase(Path directory, Path dbFile, Path assetsDbFile, std::vector<String> platforms);
 
@@ -96,7 +112,9 @@ namespace Halley
 		std::unique_ptr<AssetDatabase> makeAssetDatabase(const String& platform) const;
 
 		bool needToLoadInputMetadata(const Path& path, std::array<int64_t, 3> timestamps) const;
-		void setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, const Metadata& data, Path basePath);
+		bool tryUpdateInputFileTimestamps(const Path& path, std::array<int64_t, 3> timestamps, uint64_t hash);
+		void setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, uint64_t hash, const Metadata& data, Path basePath);
+		uint64_t getInputFileHash(const Path& path) const;
 		std::optional<Metadata> getMetadata(const Path& path) const;
 		std::optional<Metadata> getMetadata(AssetType type, const String& assetId) const;
 
@@ -114,6 +132,14 @@ namespace Halley
 		std::vector<ImportAssetsDatabaseEntry> getAllMissing() const;
 
 		std::vector<AssetResource> getOutFiles(String assetId) const;
+		std::vector<String> getDependents(const Path& dependency) const;
+		bool isDependencyUnchanged(const AssetDependency& dependency) const;
+
+		void setImportCachePath(Path path);
+		const Path& getImportCachePath() const;
+		Path getImportCacheFile(uint64_t key) const;
+		uint64_t getImportCacheKey(const ImportAssetsDatabaseEntry& asset, int importerVersion) const;
+		std::vector<uint64_t> addToImportCache(const String& assetId, uint64_t key);
 		std::vector<String> getInputFiles() const;
 		std::vector<std::pair<AssetType, String>> getAssetsFromFile(const Path& inputFile);
 
@@ -129,7 +155,16 @@ namespace Halley
 		std::map<String, AssetEntry> assetsImported;
 		std::map<String, AssetEntry> assetsFailed; // Ephemeral
 		std::map<String, InputFileEntry> inputFiles;
+		mutable std::map<String, DependencyEntry> dependencies; // Refreshed as they're checked
+		std::map<String, std::vector<uint64_t>> importCache; // Newest first
+
+		Path importCachePath;
+		constexpr static size_t maxCachedImportsPerAsset = 3;
 	
 		mutable std::mutex mutex;
+
+		std::optional<uint64_t> getCurrentDependencyHash(const Path& path) const;
+		void updateDependents(const String& assetId, const std::vector<AssetDependency>& oldDeps, const std::vector<AssetDependency>& newDeps);
+		void rebuildDependents();
 	};
 }
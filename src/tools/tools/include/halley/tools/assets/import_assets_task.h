@@ -17,9 +17,12 @@ namespace Halley
 		struct ImportResult {
 			std::vector<AssetResource> out;
 			std::vector<std::pair<Path, Bytes>> outFiles;
-			std::vector<TimestampedPath> additionalInputs;
+			std::vector<AssetDependency> additionalInputs;
 			bool success = false;
 			String errorMsg;
+
+			void serialize(Serializer& s) const;
+			void deserialize(Deserializer& s);
 		};
 		using MetadataFetchCallback = std::function<std::optional<Metadata>(const Path&)>;
 		
@@ -49,6 +52,10 @@ namespace Halley
 
 		bool doImportAsset(ImportAssetsDatabaseEntry& asset);
 
+		int getImporterVersion(const ImportAssetsDatabaseEntry& asset) const;
+		std::optional<ImportResult> loadCachedImport(uint64_t key);
+		void storeCachedImport(const ImportAssetsDatabaseEntry& asset, uint64_t key, const ImportResult& result);
+
 		std::vector<Path> loadFont(const ImportAssetsDatabaseEntry& asset, Path dstDir);
 		std::vector<Path> genericImporter(const ImportAssetsDatabaseEntry& asset, Path dstDir);
 		ImportResult importAsset(const ImportAssetsDatabaseEntry& asset, const MetadataFetchCallback& metadataFetcher, const AssetImporter& importer, Path assetsPath, AssetCollector::ProgressReporter progressReporter = {});
@@ -24,6 +24,7 @@ namespace Halley
 		std::optional<String> customImplementation;
 		std::vector<String> componentDependencies;
 		bool generate = false;
+		bool mutableCache = false;
 
 		bool operator<(const ComponentSchema& other) const;
 	};
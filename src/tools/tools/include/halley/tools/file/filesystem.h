@@ -22,6 +22,7 @@ namespace Halley {
 		static bool isDirectory(const Path& p);
 
 		static void copyFile(const Path& src, const Path& dst);
+		static void rename(const Path& src, const Path& dst); // Replaces dst, if it exists
 		static bool remove(const Path& path);
 
 		static void writeFile(const Path& path, gsl::span<const gsl::byte> data);
@@ -2,6 +2,9 @@
 #include "halley/text/halleystring.h"
 #include "halley/data_structures/maybe.h"
 #include "halley/utils/utils.h"
+#include "halley/resources/resource.h"
+#include "halley/core/resources/asset_pack.h"
+#include <map>
 
 namespace Halley {
 	class ConfigNode;
@@ -16,11 +19,13 @@ namespace Halley {
 		bool checkMatch(const String& asset) const;
 		bool isEncrypted() const;
 		const String& getEncryptionKey() const;
+		std::optional<AssetPackCompression> getCompression(AssetType type) const;
 
 	private:
 		String name;
 		String encryptionKey;
 		std::vector<String> matches;
+		std::map<AssetType, AssetPackCompression> compression;
 	};
 
 	class AssetPackManifest {
@@ -32,8 +37,12 @@ namespace Halley {
 
 		std::optional<std::reference_wrapper<const AssetPackManifestEntry>> getPack(const String& asset) const;
 
+		// The pack's own setting for the type if it has one, otherwise the manifest-wide one
+		AssetPackCompression getCompression(std::optional<std::reference_wrapper<const AssetPackManifestEntry>> pack, AssetType type) const;
+
 	private:
 		std::vector<String> exclude;
 		std::vector<AssetPackManifestEntry> packs;
+		std::map<AssetType, AssetPackCompression> compression;
 	};
 }
@@ -5,9 +5,29 @@
 #include "halley/support/logger.h"
 #include "halley/bytes/compression.h"
 #include "halley/utils/algorithm.h"
+#include "halley/utils/hash.h"
 
 using namespace Halley;
 
+AssetDependency::AssetDependency(Path path, int64_t timestamp, uint64_t hash)
+	: path(std::move(path))
+	, timestamp(timestamp)
+	, hash(hash)
+{}
+
+void AssetDependency::serialize(Serializer& s) const
+{
+	s << path;
+	s << timestamp;
+	s << hash;
+}
+
+void AssetDependency::deserialize(Deserializer& s)
+{
+	s >> path;
+	s >> timestamp;
+	s >> hash;
+}
 
 AssetCollector::AssetCollector(const ImportingAsset& asset, const Path& dstDir, const std::vector<Path>& assetsSrc, ProgressReporter reporter)
 	: asset(asset)
@@ -73,10 +93,12 @@ Bytes AssetCollector::readAdditionalFile(const Path& filePath)
 	for (const auto& path: assetsSrc) {
 		Path f = path / filePath;
 		if (FileSystem::exists(f)) {
-			if (!std_ex::contains_if(additionalInputs, [&] (const auto& e) { return e.first == f; })) {
-				additionalInputs.push_back(TimestampedPath(f, FileSystem::getLastWriteTime(f)));			
+			const auto timestamp = FileSystem::getLastWriteTime(f);
+			auto data = FileSystem::readFile(f);
+			if (!std_ex::contains_if(additionalInputs, [&] (const auto& e) { return e.path == f; })) {
+				additionalInputs.emplace_back(f, timestamp, Hash::hash(data));
 			}
-			return FileSystem::readFile(f);
+			return data;
 		}
 	}
 	throw Exception("Unable to find asset dependency: \"" + filePath.getString() + "\"", HalleyExceptions::Tools);
@@ -97,7 +119,7 @@ std::vector<std::pair<Path, Bytes>> AssetCollector::collectOutFiles()
 	return std::move(outFiles);
 }
 
-const std::vector<TimestampedPath>& AssetCollector::getAdditionalInputs() const
+const std::vector<AssetDependency>& AssetCollector::getAdditionalInputs() const
 {
 	return additionalInputs;
 }
@@ -10,6 +10,7 @@
 #include "halley/resources/resource_data.h"
 #include "halley/tools/assets/metadata_importer.h"
 #include "halley/concurrency/concurrent.h"
+#include "halley/utils/hash.h"
 
 using namespace Halley;
 using namespace std::chrono_literals;
@@ -126,12 +127,16 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 	}
 
 	// Load metadata if needed
+	// Timestamps are only a quick check; files that were touched are hashed, and only reloaded if their contents changed
 	if (db.needToLoadInputMetadata(filePath, timestamps)) {
-		Metadata meta = MetadataImporter::getMetaData(filePath, dirMetaPath, privateMetaPath);
-		if (skipGen) {
-			meta.set("skipGen", true);
+		const auto hash = hashInputFile(srcPath / filePath, dirMetaPath, privateMetaPath);
+		if (!db.tryUpdateInputFileTimestamps(filePath, timestamps, hash)) {
+			Metadata meta = MetadataImporter::getMetaData(filePath, dirMetaPath, privateMetaPath);
+			if (skipGen) {
+				meta.set("skipGen", true);
+			}
+			db.setInputFileMetadata(filePath, timestamps, hash, meta, srcPath);
 		}
-		db.setInputFileMetadata(filePath, timestamps, meta, srcPath);
 		dbChanged = true;
 	} else {
 		db.markInputPresent(filePath);
@@ -144,8 +149,8 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 	}
 	String assetId = assetImporter.getAssetId(filePath, db.getMetadata(filePath));
 
-	// Build timestamped path
-	auto input = TimestampedPath(filePath, std::max(timestamps[0], std::max(timestamps[1], timestamps[2])));
+	// Build hashed path
+	auto input = AssetPath(filePath, db.getInputFileHash(filePath));
 
 	// Build the asset
 	auto iter = assets.find(assetId);
@@ -165,8 +170,8 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 		if (asset.srcDir == srcPath) {
 			asset.inputFiles.push_back(input);
 		} else {
-			auto relPath = (srcPath / input.first).makeRelativeTo(asset.srcDir);
-			asset.inputFiles.emplace_back(input, relPath);
+			auto relPath = (srcPath / filePath).makeRelativeTo(asset.srcDir);
+			asset.inputFiles.emplace_back(filePath, input.getHash(), relPath);
 
 			// Don't mix files from two different source paths
 			//throw Exception("Mixed source dir input for " + assetId, HalleyExceptions::Tools);
@@ -176,6 +181,22 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 	return dbChanged;
 }
 
+uint64_t CheckAssetsTask::hashInputFile(const Path& filePath, const std::optional<Path>& dirMetaPath, const std::optional<Path>& privateMetaPath)
+{
+	Hash::Hasher hasher;
+	auto feedFile = [&] (const std::optional<Path>& path)
+	{
+		const auto data = path ? FileSystem::readFile(path.value()) : Bytes();
+		hasher.feed(data.size());
+		hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(data)));
+	};
+
+	feedFile(filePath);
+	feedFile(dirMetaPath);
+	feedFile(privateMetaPath);
+	return hasher.digest();
+}
+
 void CheckAssetsTask::sleep(int timeMs)
 {
 	std::unique_lock<std::mutex> lock(mutex);
@@ -1,50 +1,56 @@
+#include <algorithm>
 #include <utility>
 #include "halley/tools/assets/import_assets_database.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/resources/resource_data.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/utils/hash.h"
 
-constexpr static int currentAssetVersion = 87;
+constexpr static int currentAssetVersion = 88;
 
 using namespace Halley;
 
 AssetPath::AssetPath()
 {}
 
-AssetPath::AssetPath(TimestampedPath path)
+AssetPath::AssetPath(Path path, uint64_t hash)
 	: path(std::move(path))
+	, hash(hash)
 {}
 
-AssetPath::AssetPath(TimestampedPath path, Path dataPath)
+AssetPath::AssetPath(Path path, uint64_t hash, Path dataPath)
 	: path(std::move(path))
 	, dataPath(std::move(dataPath))
+	, hash(hash)
 {}
 
 const Path& AssetPath::getPath() const
 {
-	return path.first;
+	return path;
 }
 
 const Path& AssetPath::getDataPath() const
 {
-	return dataPath.isEmpty() ? path.first : dataPath;
+	return dataPath.isEmpty() ? path : dataPath;
 }
 
-int64_t AssetPath::getTimestamp() const
+uint64_t AssetPath::getHash() const
 {
-	return path.second;
+	return hash;
 }
 
 void AssetPath::serialize(Serializer& s) const
 {
 	s << path;
 	s << dataPath;
+	s << hash;
 }
 
 void AssetPath::deserialize(Deserializer& s)
 {
 	s >> path;
 	s >> dataPath;
+	s >> hash;
 }
 
 void ImportAssetsDatabaseEntry::serialize(Serializer& s) const
@@ -87,6 +93,7 @@ void ImportAssetsDatabase::InputFileEntry::serialize(Serializer& s) const
 	for (int i = 0; i < nTimestamps; ++i) {
 		s << timestamp[i];
 	}
+	s << hash;
 	s << metadata;
 	s << basePath;
 }
@@ -103,10 +110,23 @@ void ImportAssetsDatabase::InputFileEntry::deserialize(Deserializer& s)
 	for (int i = nTimestamps; i < int(timestamp.size()); ++i) {
 		timestamp[i] = 0;
 	}
+	s >> hash;
 	s >> metadata;
 	s >> basePath;
 }
 
+void ImportAssetsDatabase::DependencyEntry::serialize(Serializer& s) const
+{
+	s << timestamp;
+	s << hash;
+}
+
+void ImportAssetsDatabase::DependencyEntry::deserialize(Deserializer& s)
+{
+	s >> timestamp;
+	s >> hash;
+}
+
 ImportAssetsDatabase::ImportAssetsDatabase(Path directory, Path dbFile, Path assetsDbFile, std::vector<String> platforms)
 	: platforms(std::move(platforms))
 	, directory(std::move(directory))
@@ -155,17 +175,41 @@ bool ImportAssetsDatabase::needToLoadInputMetadata(const Path& path, std::array<
 	return false;
 }
 
-void ImportAssetsDatabase::setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, const Metadata& data, Path basePath)
+bool ImportAssetsDatabase::tryUpdateInputFileTimestamps(const Path& path, std::array<int64_t, 3> timestamps, uint64_t hash)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Touched, but with the same contents (e.g. switching branches back and forth), so the metadata is still valid
+	const auto iter = inputFiles.find(path.toString());
+	if (iter == inputFiles.end() || iter->second.hash != hash) {
+		return false;
+	}
+
+	iter->second.timestamp = timestamps;
+	iter->second.missing = false;
+	return true;
+}
+
+void ImportAssetsDatabase::setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, uint64_t hash, const Metadata& data, Path basePath)
 {
 	std::lock_guard<std::mutex> lock(mutex);
 
 	auto& input = inputFiles[path.toString()];
 	input.timestamp = timestamps;
+	input.hash = hash;
 	input.metadata = data;
 	input.basePath = std::move(basePath);
 	input.missing = false;
 }
 
+uint64_t ImportAssetsDatabase::getInputFileHash(const Path& path) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto iter = inputFiles.find(path.toString());
+	return iter == inputFiles.end() ? 0 : iter->second.hash;
+}
+
 void ImportAssetsDatabase::markInputPresent(const Path& path)
 {
 	std::lock_guard<std::mutex> lock(mutex);
@@ -254,26 +298,31 @@ Path ImportAssetsDatabase::getPrimaryInputFile(AssetType type, const String& ass
 
 bool ImportAssetsDatabase::needsImporting(const ImportAssetsDatabaseEntry& asset, bool includeFailed) const
 {
-	std::lock_guard<std::mutex> lock(mutex);
-	
-	// Check if it failed loading last time
-	auto iter = assetsFailed.find(asset.assetId);
-	const bool failed = iter != assetsFailed.end();
-	if (failed && includeFailed) {
-		return true;
-	}
-	
-	// Check if this was imported before
-	if (!failed) {
-		iter = assetsImported.find(asset.assetId);
-		if (iter == assetsImported.end()) {
-			// Asset didn't even exist before
+	// The rest of the checks hash and look for files, so they work on a copy rather than holding the lock
+	ImportAssetsDatabaseEntry oldAsset;
+	bool failed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Check if it failed loading last time
+		auto iter = assetsFailed.find(asset.assetId);
+		failed = iter != assetsFailed.end();
+		if (failed && includeFailed) {
 			return true;
 		}
-	}
 
-	// At this point, iter points to the failed one if it failed, or the the old successful one if it didn't.
-	const auto& oldAsset = iter->second.asset;
+		// Check if this was imported before
+		if (!failed) {
+			iter = assetsImported.find(asset.assetId);
+			if (iter == assetsImported.end()) {
+				// Asset didn't even exist before
+				return true;
+			}
+		}
+
+		// At this point, iter points to the failed one if it failed, or the the old successful one if it didn't.
+		oldAsset = iter->second.asset;
+	}
 
 	// Input directory changed?
 	if (asset.srcDir != oldAsset.srcDir) {
@@ -292,21 +341,22 @@ bool ImportAssetsDatabase::needsImporting(const ImportAssetsDatabaseEntry& asset
 		if (result == oldAsset.inputFiles.end()) {
 			// File wasn't there before
 			return true;
-		} else if (result->getTimestamp() != i.getTimestamp()) {
-			// Timestamp changed
+		} else if (result->getHash() != i.getHash()) {
+			// Contents changed
 			return true;
 		}
 	}
 
 	// Any of the additional input files changed?
 	for (const auto& i: oldAsset.additionalInputFiles) {
-		if (!FileSystem::exists(i.first)) {
+		const auto hash = getCurrentDependencyHash(i.path);
+		if (!hash) {
 			// File removed
 			return true;
-		} else if  (FileSystem::getLastWriteTime(i.first) != i.second) {
-			// Timestamp changed
+		} else if (hash.value() != i.hash) {
+			// Contents changed
 			return true;
-		}		
+		}
 	}
 
 	// Have any of the output files gone missing?
@@ -330,7 +380,9 @@ void ImportAssetsDatabase::markAsImported(const ImportAssetsDatabaseEntry& asset
 	entry.present = true;
 
 	std::lock_guard<std::mutex> lock(mutex);
-	assetsImported[asset.assetId] = entry;
+	auto& dst = assetsImported[asset.assetId];
+	updateDependents(asset.assetId, dst.asset.additionalInputFiles, asset.additionalInputFiles);
+	dst = std::move(entry);
 	
 	auto failIter = assetsFailed.find(asset.assetId);
 	if (failIter != assetsFailed.end()) {
@@ -340,8 +392,26 @@ void ImportAssetsDatabase::markAsImported(const ImportAssetsDatabaseEntry& asset
 
 void ImportAssetsDatabase::markDeleted(const ImportAssetsDatabaseEntry& asset)
 {
-	std::lock_guard<std::mutex> lock(mutex);
-	assetsImported.erase(asset.assetId);
+	std::vector<uint64_t> cachedImports;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto iter = assetsImported.find(asset.assetId);
+		if (iter != assetsImported.end()) {
+			updateDependents(asset.assetId, iter->second.asset.additionalInputFiles, {});
+			assetsImported.erase(iter);
+		}
+
+		const auto cacheIter = importCache.find(asset.assetId);
+		if (cacheIter != importCache.end()) {
+			cachedImports = std::move(cacheIter->second);
+			importCache.erase(cacheIter);
+		}
+	}
+
+	// Nothing will ask for these again, so they'd just sit there forever
+	for (const auto key: cachedImports) {
+		FileSystem::remove(getImportCacheFile(key));
+	}
 }
 
 void ImportAssetsDatabase::markFailed(const ImportAssetsDatabaseEntry& asset)
@@ -385,6 +455,138 @@ std::vector<AssetResource> ImportAssetsDatabase::getOutFiles(String assetId) con
 	}
 }
 
+std::vector<String> ImportAssetsDatabase::getDependents(const Path& dependency) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto iter = dependencies.find(dependency.toString());
+	if (iter == dependencies.end()) {
+		return {};
+	}
+	return std::vector<String>(iter->second.dependents.begin(), iter->second.dependents.end());
+}
+
+bool ImportAssetsDatabase::isDependencyUnchanged(const AssetDependency& dependency) const
+{
+	return getCurrentDependencyHash(dependency.path) == dependency.hash;
+}
+
+void ImportAssetsDatabase::setImportCachePath(Path path)
+{
+	importCachePath = std::move(path);
+}
+
+const Path& ImportAssetsDatabase::getImportCachePath() const
+{
+	return importCachePath;
+}
+
+Path ImportAssetsDatabase::getImportCacheFile(uint64_t key) const
+{
+	return importCachePath / (toString(key, 16, 16) + ".cache");
+}
+
+uint64_t ImportAssetsDatabase::getImportCacheKey(const ImportAssetsDatabaseEntry& asset, int importerVersion) const
+{
+	// The input hashes already cover the meta files, so this only needs to add what else can change the output
+	Hash::Hasher hasher;
+	hasher.feed(currentAssetVersion);
+	hasher.feed(importerVersion);
+	hasher.feed(int(asset.assetType));
+	hasher.feed(asset.assetId);
+	for (const auto& i: asset.inputFiles) {
+		hasher.feed(i.getPath().getString());
+		hasher.feed(i.getDataPath().getString());
+		hasher.feed(i.getHash());
+	}
+	return hasher.digest();
+}
+
+std::vector<uint64_t> ImportAssetsDatabase::addToImportCache(const String& assetId, uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto& keys = importCache[assetId];
+	keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+	keys.insert(keys.begin(), key);
+
+	std::vector<uint64_t> evicted;
+	if (keys.size() > maxCachedImportsPerAsset) {
+		evicted.assign(keys.begin() + maxCachedImportsPerAsset, keys.end());
+		keys.resize(maxCachedImportsPerAsset);
+	}
+	return evicted;
+}
+
+std::optional<uint64_t> ImportAssetsDatabase::getCurrentDependencyHash(const Path& path) const
+{
+	// Assumes the mutex is NOT held, as it might have to read the whole file
+	if (!FileSystem::exists(path)) {
+		return {};
+	}
+
+	// Only read the file if it was touched since it was last hashed
+	const auto timestamp = FileSystem::getLastWriteTime(path);
+	const auto key = path.toString();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto iter = dependencies.find(key);
+		if (iter != dependencies.end() && iter->second.timestamp == timestamp) {
+			return iter->second.hash;
+		}
+	}
+
+	const auto hash = Hash::hash(FileSystem::readFile(path));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto iter = dependencies.find(key);
+	if (iter != dependencies.end()) {
+		iter->second.timestamp = timestamp;
+		iter->second.hash = hash;
+	}
+	return hash;
+}
+
+void ImportAssetsDatabase::updateDependents(const String& assetId, const std::vector<AssetDependency>& oldDeps, const std::vector<AssetDependency>& newDeps)
+{
+	// Assumes the mutex is held
+	for (const auto& d: oldDeps) {
+		const auto iter = dependencies.find(d.path.toString());
+		if (iter != dependencies.end()) {
+			iter->second.dependents.erase(assetId);
+			if (iter->second.dependents.empty()) {
+				dependencies.erase(iter);
+			}
+		}
+	}
+
+	for (const auto& d: newDeps) {
+		auto& dep = dependencies[d.path.toString()];
+		dep.timestamp = d.timestamp;
+		dep.hash = d.hash;
+		dep.dependents.insert(assetId);
+	}
+}
+
+void ImportAssetsDatabase::rebuildDependents()
+{
+	// Assumes the mutex is held
+	for (auto& d: dependencies) {
+		d.second.dependents.clear();
+	}
+	for (const auto& a: assetsImported) {
+		for (const auto& d: a.second.asset.additionalInputFiles) {
+			dependencies[d.path.toString()].dependents.insert(a.first);
+		}
+	}
+	for (auto iter = dependencies.begin(); iter != dependencies.end();) {
+		if (iter->second.dependents.empty()) {
+			iter = dependencies.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+}
+
 std::vector<String> ImportAssetsDatabase::getInputFiles() const
 {
 	std::lock_guard<std::mutex> lock(mutex);
@@ -423,6 +625,8 @@ void ImportAssetsDatabase::serialize(Serializer& s) const
 	s << platforms;
 	s << assetsImported;
 	s << inputFiles;
+	s << dependencies;
+	s << importCache;
 }
 
 void ImportAssetsDatabase::deserialize(Deserializer& s)
@@ -435,6 +639,9 @@ void ImportAssetsDatabase::deserialize(Deserializer& s)
 		if (platformsRead == platforms) {
 			s >> assetsImported;
 			s >> inputFiles;
+			s >> dependencies;
+			s >> importCache;
+			rebuildDependents();
 		}
 	}
 }
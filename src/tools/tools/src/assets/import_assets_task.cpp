@@ -13,6 +13,21 @@
 
 using namespace Halley;
 
+void ImportAssetsTask::ImportResult::serialize(Serializer& s) const
+{
+	s << out;
+	s << outFiles;
+	s << additionalInputs;
+}
+
+void ImportAssetsTask::ImportResult::deserialize(Deserializer& s)
+{
+	s >> out;
+	s >> outFiles;
+	s >> additionalInputs;
+	success = true; // Only successful imports are stored
+}
+
 ImportAssetsTask::ImportAssetsTask(String taskName, ImportAssetsDatabase& db, std::shared_ptr<AssetImporter> importer, Path assetsPath, Vector<ImportAssetsDatabaseEntry> files, std::vector<String> deletedAssets, Project& project, bool packAfter)
 	: Task(taskName, true, true)
 	, db(db)
@@ -98,7 +113,13 @@ bool ImportAssetsTask::doImportAsset(ImportAssetsDatabaseEntry& asset)
 	logInfo("Importing " + asset.assetId);
 	Stopwatch timer;
 
-	auto result = importAsset(asset, [&] (const Path& path) { return db.getMetadata(path); }, *importer, assetsPath, [=] (float, const String&) -> bool { return !isCancelled(); });
+	// Reuse the output of a previous import of the exact same inputs, if it's still around and none of its dependencies changed
+	const bool useCache = !db.getImportCachePath().isEmpty();
+	const uint64_t cacheKey = useCache ? db.getImportCacheKey(asset, getImporterVersion(asset)) : 0;
+	auto cached = useCache ? loadCachedImport(cacheKey) : std::nullopt;
+	const bool fromCache = cached.has_value();
+
+	auto result = fromCache ? std::move(cached.value()) : importAsset(asset, [&] (const Path& path) { return db.getMetadata(path); }, *importer, assetsPath, [=] (float, const String&) -> bool { return !isCancelled(); });
 	
 	if (!result.success) {
 		logError("\"" + asset.assetId + "\" - " + result.errorMsg);
@@ -127,10 +148,14 @@ bool ImportAssetsTask::doImportAsset(ImportAssetsDatabaseEntry& asset)
 	// Write files
 	for (auto& outFile: result.outFiles) {
 		auto path = assetsPath / outFile.first;
-		logInfo("- " + asset.assetId + " -> " + path + " (" + String::prettySize(outFile.second.size()) + ")");
+		logInfo("- " + asset.assetId + " -> " + path + " (" + String::prettySize(outFile.second.size()) + ")" + (fromCache ? " [cached]" : ""));
 		FileSystem::writeFile(path, outFile.second);
 	}
 
+	if (useCache && !fromCache) {
+		storeCachedImport(asset, cacheKey, result);
+	}
+
 	// Add to list of output assets
 	for (auto& o: result.out) {
 		std::unique_lock<std::mutex> lock(mutex);
@@ -148,13 +173,55 @@ bool ImportAssetsTask::doImportAsset(ImportAssetsDatabaseEntry& asset)
 	return true;
 }
 
+int ImportAssetsTask::getImporterVersion(const ImportAssetsDatabaseEntry& asset) const
+{
+	int version = 0;
+	for (const auto& assetImporter: importer->getImporters(asset.assetType)) {
+		version = version * 31 + assetImporter.get().getVersion();
+	}
+	return version;
+}
+
+std::optional<ImportAssetsTask::ImportResult> ImportAssetsTask::loadCachedImport(uint64_t key)
+{
+	const auto data = FileSystem::readFile(db.getImportCacheFile(key));
+	if (data.empty()) {
+		return {};
+	}
+
+	ImportResult result;
+	try {
+		Deserializer::fromBytes(result, data);
+	} catch (...) {
+		logWarning("Discarding corrupted import cache entry " + db.getImportCacheFile(key));
+		return {};
+	}
+
+	// The key only covers the files enumerated as inputs, so check that the files read by the importer are still the same
+	for (const auto& dep: result.additionalInputs) {
+		if (!db.isDependencyUnchanged(dep)) {
+			return {};
+		}
+	}
+
+	return result;
+}
+
+void ImportAssetsTask::storeCachedImport(const ImportAssetsDatabaseEntry& asset, uint64_t key, const ImportResult& result)
+{
+	FileSystem::writeFile(db.getImportCacheFile(key), Serializer::toBytes(result));
+	for (const auto evicted: db.addToImportCache(asset.assetId, key)) {
+		FileSystem::remove(db.getImportCacheFile(evicted));
+	}
+}
+
 ImportAssetsTask::ImportResult ImportAssetsTask::importAsset(const ImportAssetsDatabaseEntry& asset, const MetadataFetchCallback& metadataFetcher, const AssetImporter& importer, Path assetsPath, AssetCollector::ProgressReporter progressReporter)
 {
 	ImportResult result;
 	
 	try {
 		// Create queue
-		std::list<ImportingAsset> toLoad;
+		std::vector<ImportingAsset> toLoad;
 
 		// Load files from disk
 		ImportingAsset importingAsset;
@@ -171,37 +238,70 @@ ImportAssetsTask::ImportResult ImportAssetsTask::importAsset(const ImportAssetsD
 		toLoad.emplace_back(std::move(importingAsset));
 
 		// Import
-		while (!toLoad.empty()) {
-			auto cur = std::move(toLoad.front());
-			toLoad.pop_front();
-			
-			AssetCollector collector(cur, assetsPath, importer.getAssetsSrc(), progressReporter);
-
-			for (const auto& assetImporter: importer.getImporters(cur.assetType)) {
-				try {
-					assetImporter.get().import(cur, collector);
-				} catch (...) {
-					for (const auto& i: collector.getAdditionalInputs()) {
-						result.additionalInputs.push_back(i);
-					}
-					throw;
+		// Additional assets (e.g. the textures of a spritesheet, or the image of a font) don't depend on each other, so each
+		// batch of them is imported in parallel, before moving on to whatever additional assets that batch produced.
+		struct SubImport {
+			ImportingAsset asset;
+			std::vector<ImportingAsset> additionalAssets;
+			std::vector<std::pair<Path, Bytes>> outFiles;
+			std::vector<AssetResource> out;
+			std::vector<AssetDependency> additionalInputs;
+			std::exception_ptr error;
+		};
+
+		auto importSubAsset = [&] (SubImport& cur)
+		{
+			AssetCollector collector(cur.asset, assetsPath, importer.getAssetsSrc(), progressReporter);
+			try {
+				for (const auto& assetImporter: importer.getImporters(cur.asset.assetType)) {
+					assetImporter.get().import(cur.asset, collector);
 				}
+				cur.additionalAssets = collector.collectAdditionalAssets();
+				cur.outFiles = collector.collectOutFiles();
+				cur.out = collector.getAssets();
+			} catch (...) {
+				cur.error = std::current_exception();
 			}
-			
-			for (auto& additional: collector.collectAdditionalAssets()) {
-				toLoad.emplace_front(std::move(additional));
+			cur.additionalInputs = collector.getAdditionalInputs();
+		};
+
+		while (!toLoad.empty()) {
+			std::vector<SubImport> batch(toLoad.size());
+			for (size_t i = 0; i < toLoad.size(); ++i) {
+				batch[i].asset = std::move(toLoad[i]);
 			}
+			toLoad.clear();
 
-			for (auto& outFile: collector.collectOutFiles()) {
-				result.outFiles.push_back(std::move(outFile));
+			if (batch.size() > 1 && !Debug::isDebug()) {
+				Concurrent::foreachChunked(Executors::getCPUAux(), batch.begin(), batch.end(), 1, importSubAsset);
+			} else {
+				for (auto& cur: batch) {
+					importSubAsset(cur);
+				}
 			}
 
-			for (const auto& o: collector.getAssets()) {
-				result.out.push_back(o);
+			// Inputs are recorded even on failure, so that changing them triggers another attempt
+			for (auto& cur: batch) {
+				for (auto& i: cur.additionalInputs) {
+					result.additionalInputs.push_back(std::move(i));
+				}
+			}
+			for (auto& cur: batch) {
+				if (cur.error) {
+					std::rethrow_exception(cur.error);
+				}
 			}
 
-			for (const auto& i: collector.getAdditionalInputs()) {
-				result.additionalInputs.push_back(i);
+			for (auto& cur: batch) {
+				for (auto& outFile: cur.outFiles) {
+					result.outFiles.push_back(std::move(outFile));
+				}
+				for (auto& o: cur.out) {
+					result.out.push_back(std::move(o));
+				}
+				for (auto& additional: cur.additionalAssets) {
+					toLoad.push_back(std::move(additional));
+				}
 			}
 		}
 		
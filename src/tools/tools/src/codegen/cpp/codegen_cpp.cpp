@@ -115,14 +115,14 @@ CodeGenResult CodegenCPP::generateRegistry(const Vector<ComponentSchema>& compon
 		"",
 		"",
 		"using ComponentFactoryPtr = std::function<CreateComponentFunctionResult(const EntityFactoryContext&, EntityRef&, const ConfigNode&)>;",
-		"using ComponentFactoryMap = HashMap<String, ComponentFactoryPtr>;",
+		"using ComponentFactoryMap = HashMap<StringId, ComponentFactoryPtr>;",
 		"",
 		"static ComponentFactoryMap makeComponentFactories() {",
 		"	ComponentFactoryMap result;"
 	});
 
 	for (auto& comp : components) {
-		registryCpp.push_back("	result[\"" + comp.name + "\"] = [] (const EntityFactoryContext& context, EntityRef& e, const ConfigNode& node) -> CreateComponentFunctionResult { return context.createComponent<" + comp.name + "Component>(e, node); };");
+		registryCpp.push_back("	result[" + comp.name + "Component::componentId] = [] (const EntityFactoryContext& context, EntityRef& e, const ConfigNode& node) -> CreateComponentFunctionResult { return context.createComponent<" + comp.name + "Component>(e, node); };");
 	}
 
 	registryCpp.insert(registryCpp.end(), {
@@ -244,6 +244,7 @@ Vector<String> CodegenCPP::generateComponentHeader(ComponentSchema component)
 		.setAccessLevel(MemberAccess::Public)
 		.addMember(MemberSchema(TypeSchema("int", false, true, true), "componentIndex", toString(component.id)))
 		.addMember(MemberSchema(TypeSchema("char*", true, true, true), "componentName", component.name))
+		.addMember(MemberSchema(TypeSchema("Halley::StringId", false, true, true), "componentId", component.name))
 		.addBlankLine()
 		.addMembers(component.members)
 		.addBlankLine()
@@ -609,11 +610,43 @@ Vector<String> CodegenCPP::generateSystemHeader(SystemSchema& system, const Hash
 			}, "canHandleSystemMessage", true, false, true, true), canReceiveBody);
 	}
 
+	// Access signature, used to schedule systems that don't conflict in parallel
+	std::set<String> componentsWritten;
+	std::set<String> componentsRead;
+	for (auto& fam : system.families) {
+		for (auto& comp : fam.components) {
+			const auto iter = components.find(comp.name);
+			const bool mutableCache = iter != components.end() && iter->second.mutableCache;
+			(comp.write || mutableCache ? componentsWritten : componentsRead).insert(comp.name + "Component::componentIndex");
+		}
+	}
+	for (auto& comp : componentsWritten) {
+		componentsRead.erase(comp);
+	}
+	Vector<String> sharedResources;
+	if ((int(system.access) & int(SystemAccess::API)) != 0) {
+		sharedResources.push_back("\"api\"");
+	}
+	if ((int(system.access) & int(SystemAccess::Resources)) != 0) {
+		sharedResources.push_back("\"resources\"");
+	}
+	for (auto& service : system.services) {
+		sharedResources.push_back("\"" + service.name + "\"");
+	}
+	const bool sendsSystemMessages = std::any_of(system.systemMessages.begin(), system.systemMessages.end(), [] (const MessageReferenceSchema& msg) { return msg.send; });
+	const bool exclusive = (int(system.access) & int(SystemAccess::World)) != 0 || sendsSystemMessages;
+	const bool entityMessages = !system.messages.empty();
+	const String accessSignature = "setAccessSignature(Halley::SystemAccessSignature({ "
+		+ String::concatList(Vector<String>(componentsRead.begin(), componentsRead.end()), ", ") + " }, { "
+		+ String::concatList(Vector<String>(componentsWritten.begin(), componentsWritten.end()), ", ") + " }, { "
+		+ String::concatList(sharedResources, ", ") + " }, "
+		+ (exclusive ? "true" : "false") + ", " + (entityMessages ? "true" : "false") + "));";
+
 	sysClassGen
 		.setAccessLevel(MemberAccess::Public)
 		.addCustomConstructor({}, {
 			VariableSchema(TypeSchema(""), "System", "{" + String::concatList(convert<FamilySchema, String>(system.families, [](auto& fam) { return "&" + fam.name + "Family"; }), ", ") + "}, {" + String::concatList(entityMsgsReceived, ", ") + "}")
-		}, { "static_assert(std::is_final_v<T>, \"System must be final.\");" })
+		}, { "static_assert(std::is_final_v<T>, \"System must be final.\");", accessSignature })
 		.finish()
 		.writeTo(contents);
 
@@ -674,6 +707,7 @@ Vector<String> CodegenCPP::generateMessageHeader(const MessageSchema& message, c
 	auto gen = CPPClassGenerator(message.name + suffix, "Halley::" + suffix, MemberAccess::Public, true)
 		.setAccessLevel(MemberAccess::Public)
 		.addMember(MemberSchema(TypeSchema("int", false, true, true), "messageIndex", toString(message.id)))
+		.addMember(MemberSchema(TypeSchema("Halley::StringId", false, true, true), "messageId", message.name))
 		.addBlankLine()
 		.addMembers(message.members)
 		.addBlankLine()
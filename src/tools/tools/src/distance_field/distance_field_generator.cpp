@@ -1,41 +1,112 @@
 #include "halley/tools/distance_field/distance_field_generator.h"
 #include <cassert>
+#include <limits>
 #include <halley/file_formats/image.h>
+#include <halley/concurrency/concurrent.h>
 #include <gsl/gsl_assert>
 
 using namespace Halley;
 
-static float getDistanceAt(const int* src, int srcW, int srcH, int xCentre, int yCentre, float radius)
-{
-	auto getAlpha = [&](int x, int y) { return (src[x + y * srcW] & 0xFF000000) >> 24; };
-	bool isInside = getAlpha(xCentre, yCentre) > 127;
-	if (radius < 0.001f) {
-		return isInside ? 1.0f : 0.0f;
+namespace {
+	// Large enough to never be the nearest feature, small enough that sums and differences stay finite
+	constexpr float noFeature = 1e20f;
+
+	// Felzenszwalb & Huttenlocher's 1D squared distance transform, applied in place to n samples spaced by stride
+	// Each sample starts as 0 (feature) or noFeature, and ends as the squared distance to the nearest feature, accounting
+	// for the values already computed along the other axis. Runs in O(n) via the lower envelope of parabolas rooted at each sample.
+	void transformLine(float* f, int n, size_t stride, Vector<int>& v, Vector<float>& z, Vector<float>& d)
+	{
+		auto getF = [&] (int i) { return f[i * stride]; };
+		auto intersect = [&] (int q, int p)
+		{
+			return ((getF(q) + float(q) * float(q)) - (getF(p) + float(p) * float(p))) / float(2 * q - 2 * p);
+		};
+
+		int k = 0;
+		v[0] = 0;
+		z[0] = -std::numeric_limits<float>::infinity();
+		z[1] = std::numeric_limits<float>::infinity();
+		for (int q = 1; q < n; ++q) {
+			float s = intersect(q, v[k]);
+			while (s <= z[k]) {
+				--k;
+				s = intersect(q, v[k]);
+			}
+			++k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = std::numeric_limits<float>::infinity();
+		}
+
+		k = 0;
+		for (int q = 0; q < n; ++q) {
+			while (z[k + 1] < float(q)) {
+				++k;
+			}
+			const float delta = float(q - v[k]);
+			d[q] = delta * delta + getF(v[k]);
+		}
+
+		for (int q = 0; q < n; ++q) {
+			f[q * stride] = d[q];
+		}
 	}
 
-	int iRadius = int(ceil(radius));
-	int x0 = std::max(0, xCentre - iRadius);
-	int x1 = std::min(xCentre + iRadius, srcW - 1);
-	int y0 = std::max(0, yCentre - iRadius);
-	int y1 = std::min(yCentre + iRadius, srcH - 1);
-
-	int bestDistSqr = 2147483647;
-	for (int y = y0; y <= y1; y++) {
-		for (int x = x0; x <= x1; x++) {
-			bool thisInside = getAlpha(x, y) > 127;
-			if (isInside != thisInside) {
-				// Candidate for best neighbour
-				int distSqr = (x - xCentre) * (x - xCentre) + (y - yCentre) * (y - yCentre);
-				bestDistSqr = std::min(distSqr, bestDistSqr);
+	template <typename F>
+	void forEachLine(int n, F f)
+	{
+		constexpr size_t linesPerChunk = 16;
+
+		if (Executors::hasInstance()) {
+			// Only the index matters; the chunked foreach needs something to dereference
+			Vector<int> lines(n);
+			for (int i = 0; i < n; ++i) {
+				lines[i] = i;
+			}
+			Concurrent::foreachChunked(Executors::getCPUAux(), lines.begin(), lines.end(), linesPerChunk, f);
+		} else {
+			for (int i = 0; i < n; ++i) {
+				f(i);
 			}
 		}
 	}
 
-	const float dist = float(sqrt(bestDistSqr));
-	const float normalDistance = (2 * dist - 1) / (2 * radius);
-	const float finalValue = 0.5f * (isInside ? 1.0f + normalDistance : 1.0f - normalDistance);
+	// Exact 2D squared Euclidean distance transform of grid (w x h), as a column pass followed by a row pass
+	void transformGrid(Vector<float>& grid, int w, int h)
+	{
+		forEachLine(w, [&] (int x)
+		{
+			thread_local Vector<int> v;
+			thread_local Vector<float> z;
+			thread_local Vector<float> d;
+			v.resize(h);
+			z.resize(h + 1);
+			d.resize(h);
+			transformLine(grid.data() + x, h, size_t(w), v, z, d);
+		});
 
-	return finalValue;
+		forEachLine(h, [&] (int y)
+		{
+			thread_local Vector<int> v;
+			thread_local Vector<float> z;
+			thread_local Vector<float> d;
+			v.resize(w);
+			z.resize(w + 1);
+			d.resize(w);
+			transformLine(grid.data() + size_t(y) * size_t(w), w, 1, v, z, d);
+		});
+	}
+
+	float getValue(bool isInside, float distSqr, float radius)
+	{
+		if (radius < 0.001f) {
+			return isInside ? 1.0f : 0.0f;
+		}
+
+		const float dist = std::sqrt(distSqr);
+		const float normalDistance = (2 * dist - 1) / (2 * radius);
+		return 0.5f * (isInside ? 1.0f + normalDistance : 1.0f - normalDistance);
+	}
 }
 
 std::unique_ptr<Image> DistanceFieldGenerator::generate(Image& srcImg, Vector2i size, float radius)
@@ -55,15 +126,32 @@ std::unique_ptr<Image> DistanceFieldGenerator::generate(Image& srcImg, Vector2i
 	int texelW = srcW / w;
 	int texelH = srcH / h;
 
+	// For each source pixel, compute the squared distance to the closest pixel of the opposite value, over the whole image
+	// toOutside is the transform seeded by outside pixels (read by inside pixels), and toInside the reverse
+	const size_t nPixels = size_t(srcW) * size_t(srcH);
+	Vector<char> inside(nPixels);
+	Vector<float> toOutside(nPixels);
+	Vector<float> toInside(nPixels);
+	for (size_t i = 0; i < nPixels; ++i) {
+		const bool isInside = ((src[i] & 0xFF000000) >> 24) > 127;
+		inside[i] = isInside ? 1 : 0;
+		toOutside[i] = isInside ? noFeature : 0.0f;
+		toInside[i] = isInside ? 0.0f : noFeature;
+	}
+	transformGrid(toOutside, srcW, srcH);
+	transformGrid(toInside, srcW, srcH);
+
+	const float srcRadius = radius * srcW / w;
 	for (int y = 0; y < h; y++) {
 		for (int x = 0; x < w; x++) {
 			unsigned char* dst = &dstStart[x + y * w];
 			float distAcc = 0;
-			// For each sub-pixel, compute the distance to closest pixel of the opposite value
-			// Then average it all
+			// Average the distance of each sub-pixel
 			for (int j = 0; j < texelH; j++) {
 				for (int i = 0; i < texelW; i++) {
-					distAcc += getDistanceAt(src.data(), srcW, srcH, x * srcW / w + i, y * srcH / h + j, radius * srcW / w);
+					const size_t idx = size_t(x * srcW / w + i) + size_t(y * srcH / h + j) * size_t(srcW);
+					const bool isInside = inside[idx] != 0;
+					distAcc += getValue(isInside, isInside ? toOutside[idx] : toInside[idx], srcRadius);
 				}
 			}
 			int distance = clamp(int(distAcc * 255 / (texelW * texelH)), 0, 255);
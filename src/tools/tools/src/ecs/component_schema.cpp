@@ -56,6 +56,9 @@ ComponentSchema::ComponentSchema(YAML::Node node, bool generate)
 		}
 	}
 
+	// Components that update mutable caches from const methods are written to even by systems that only read them
+	mutableCache = node["mutableCache"].as<bool>(false);
+
 	if (node["customImplementation"].IsDefined()) {
 		customImplementation = node["customImplementation"].as<std::string>();
 	}
@@ -66,6 +66,12 @@ void FileSystem::copyFile(const Path& src, const Path& dst)
 	copy_file(getNative(src), getNative(src), copy_option::overwrite_if_exists);
 }
 
+void FileSystem::rename(const Path& src, const Path& dst)
+{
+	createParentDir(dst);
+	boost::filesystem::rename(getNative(src), getNative(dst));
+}
+
 bool FileSystem::remove(const Path& path)
 {
 	boost::system::error_code ec;
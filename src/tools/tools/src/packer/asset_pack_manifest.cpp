@@ -5,6 +5,19 @@
 #include "halley/file_formats/yaml_convert.h"
 using namespace Halley;
 
+namespace {
+	std::map<AssetType, AssetPackCompression> parseCompression(const ConfigNode& node)
+	{
+		std::map<AssetType, AssetPackCompression> result;
+		if (node.getType() == ConfigNodeType::Map) {
+			for (auto& [type, codec]: node.asMap()) {
+				result[fromString<AssetType>(type)] = fromString<AssetPackCompression>(codec.asString());
+			}
+		}
+		return result;
+	}
+}
+
 AssetPackManifestEntry::AssetPackManifestEntry()
 {
 }
@@ -18,6 +31,7 @@ AssetPackManifestEntry::AssetPackManifestEntry(const ConfigNode& node)
 			matches.push_back(m.asString());
 		}
 	}
+	compression = parseCompression(node["compression"]);
 }
 
 const String& AssetPackManifestEntry::getName() const
@@ -45,6 +59,15 @@ const String& AssetPackManifestEntry::getEncryptionKey() const
 	return encryptionKey;
 }
 
+std::optional<AssetPackCompression> AssetPackManifestEntry::getCompression(AssetType type) const
+{
+	const auto iter = compression.find(type);
+	if (iter != compression.end()) {
+		return iter->second;
+	}
+	return {};
+}
+
 AssetPackManifest::AssetPackManifest(const Bytes& data)
 {
 	load(YAMLConvert::parseConfig(data));
@@ -65,6 +88,8 @@ void AssetPackManifest::load(const ConfigFile& file)
 		}
 	}
 
+	compression = parseCompression(root["compression"]);
+
 	if (root.hasKey("packs")) {
 		for (auto& p: root["packs"].asSequence()) {
 			packs.emplace_back(p);
@@ -86,3 +111,15 @@ std::optional<std::reference_wrapper<const AssetPackManifestEntry>> AssetPackMan
 	}
 	return {};
 }
+
+AssetPackCompression AssetPackManifest::getCompression(std::optional<std::reference_wrapper<const AssetPackManifestEntry>> pack, AssetType type) const
+{
+	if (pack) {
+		if (const auto packCompression = pack->get().getCompression(type)) {
+			return *packCompression;
+		}
+	}
+
+	const auto iter = compression.find(type);
+	return iter != compression.end() ? iter->second : AssetPackCompression::None;
+}
@@ -6,6 +6,7 @@
 #include "halley/tools/packer/asset_pack_manifest.h"
 #include "halley/resources/resource.h"
 #include "halley/core/resources/asset_pack.h"
+#include "halley/bytes/block_compression.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/assets/import_assets_database.h"
 using namespace Halley;
@@ -26,9 +27,9 @@ AssetPackListing::AssetPackListing(String name, String encryptionKey)
 {
 }
 
-void AssetPackListing::addFile(AssetType type, const String& name, const AssetDatabase::Entry& entry)
+void AssetPackListing::addFile(AssetType type, const String& name, const AssetDatabase::Entry& entry, AssetPackCompression compression)
 {
-	entries.push_back(Entry{ type, name, entry.path, entry.meta });
+	entries.push_back(Entry{ type, name, entry.path, entry.meta, compression });
 }
 
 const std::vector<AssetPackListing::Entry>& AssetPackListing::getEntries() const
@@ -118,7 +119,7 @@ std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackMan
 			}
 
 			// Add file to pack
-			iter->second.addFile(type, assetEntry.first, assetEntry.second);
+			iter->second.addFile(type, assetEntry.first, assetEntry.second, manifest.getCompression(packEntry, type));
 		}
 	}
 
@@ -169,6 +170,7 @@ void AssetPacker::generatePack(const String& packId, const AssetPackListing& pac
 	AssetPack pack;
 	AssetDatabase& db = pack.getAssetDatabase();
 	Bytes& data = pack.getData();
+	size_t rawTotal = 0;
 
 	for (auto& entry: packListing.getEntries()) {
 		//Logger::logDev("  [" + toString(entry.type) + "] " + entry.name);
@@ -176,17 +178,30 @@ void AssetPacker::generatePack(const String& packId, const AssetPackListing& pac
 		// Read original file
 		auto fileData = FileSystem::readFile(src / entry.path);
 		const size_t pos = data.size();
-		const size_t size = fileData.size();
-		if (size == 0) {
+		const size_t rawSize = fileData.size();
+		if (rawSize == 0) {
 			throw Exception("Unable to pack: \"" + (src / entry.path) + "\". File not found or empty.", HalleyExceptions::Tools);
 		}
+		rawTotal += rawSize;
+
+		// Compress, if the manifest asks for it and it actually saves space
+		auto compression = entry.compression;
+		if (compression == AssetPackCompression::LZ) {
+			auto compressed = BlockCompression::compress(gsl::as_bytes(gsl::span<const Byte>(fileData)));
+			if (compressed.size() < fileData.size()) {
+				fileData = std::move(compressed);
+			} else {
+				compression = AssetPackCompression::None;
+			}
+		}
+		const size_t size = fileData.size();
 		
 		// Read data into pack data
 		data.reserve(nextPowerOf2(pos + size));
 		data.resize(pos + size);
 		memcpy(data.data() + pos, fileData.data(), size);
 
-		db.addAsset(entry.name, entry.type, AssetDatabase::Entry(toString(pos) + ":" + toString(size), entry.metadata));
+		db.addAsset(entry.name, entry.type, AssetDatabase::Entry(AssetPack::makeEntryPath(pos, size, compression, rawSize), entry.metadata));
 	}
 
 	if (!packListing.getEncryptionKey().isEmpty()) {
@@ -195,6 +210,9 @@ void AssetPacker::generatePack(const String& packId, const AssetPackListing& pac
 	}
 
 	// Write pack
-	FileSystem::writeFile(dst, pack.writeOut());
-	Logger::logInfo("- Packed " + toString(packListing.getEntries().size()) + " entries on \"" + packId + "\" (" + String::prettySize(data.size()) + ").");
+	// Written next to it and then moved over it, as a running game might have the old one memory mapped
+	const auto tmpDst = Path(dst.string() + ".tmp");
+	FileSystem::writeFile(tmpDst, pack.writeOut());
+	FileSystem::rename(tmpDst, dst);
+	Logger::logInfo("- Packed " + toString(packListing.getEntries().size()) + " entries on \"" + packId + "\" (" + String::prettySize(data.size()) + ", " + String::prettySize(rawTotal) + " uncompressed).");
 }